@@ -96,10 +96,10 @@ vtkPlanarContourToRibbonModelConversionRule::~vtkPlanarContourToRibbonModelConve
 }
 
 //----------------------------------------------------------------------------
-unsigned int vtkPlanarContourToRibbonModelConversionRule::GetConversionCost(vtkDataObject* vtkNotUsed(sourceRepresentation)/*=NULL*/, vtkDataObject* vtkNotUsed(targetRepresentation)/*=NULL*/)
+unsigned int vtkPlanarContourToRibbonModelConversionRule::GetConversionCost(vtkDataObject* sourceRepresentation/*=NULL*/, vtkDataObject* vtkNotUsed(targetRepresentation)/*=NULL*/)
 {
-  // Rough input-independent guess (ms)
-  return 50;
+  // Rough input-independent guess (ms) until conversion times are measured
+  return this->EstimateConversionCost(sourceRepresentation, 50);
 }
 
 //----------------------------------------------------------------------------
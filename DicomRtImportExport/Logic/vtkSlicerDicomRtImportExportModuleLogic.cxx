@@ -635,6 +635,9 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtStructureSet(vtkSlicerDicomR
         this->GetMRMLScene()->AddNode(segmentationDisplayNode);
         segmentationNode->SetAndObserveDisplayNodeID(segmentationDisplayNode->GetID());
         segmentationDisplayNode->SetBackfaceCulling(0);
+
+        // Collect segment events while adding the structures, so that observers update only once
+        segmentationNode->GetSegmentation()->StartBatch();
       }
 
       // Add segment for current structure
@@ -646,6 +649,11 @@ bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtStructureSet(vtkSlicerDicomR
     }
   } // for all ROIs
 
+  if (segmentationNode.GetPointer())
+  {
+    segmentationNode->GetSegmentation()->EndBatch();
+  }
+
   // Force showing closed surface model instead of contour points and calculate auto opacity values for segments
   if (segmentationDisplayNode.GetPointer())
   {
@@ -1760,7 +1768,8 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
       // Apply parent transformation nodes if necessary
       if (segmentationNode->GetParentTransformNode())
       {
-        if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, binaryLabelmapCopy))
+        // Applied together with the resampling to the anatomical image geometry below
+        if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, binaryLabelmapCopy, true))
         {
           std::string errorMessage("Failed to apply parent transformation to exported segment!");
           vtkErrorMacro("ExportDicomRTStudy: " << errorMessage);
@@ -1768,7 +1777,8 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
         }
       }
       // Make sure the labelmap dimensions match the reference dimensions
-      if ( !vtkOrientedImageDataResample::DoGeometriesMatch(imageData, binaryLabelmapCopy)
+      if ( binaryLabelmapCopy->GetPendingTransform()
+        || !vtkOrientedImageDataResample::DoGeometriesMatch(imageData, binaryLabelmapCopy)
         || !SlicerRtCommon::AreExtentsEqual(imageData->GetExtent(), binaryLabelmapCopy->GetExtent()) )
       {
         if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, imageData, binaryLabelmapCopy))
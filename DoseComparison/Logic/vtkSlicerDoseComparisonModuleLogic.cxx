@@ -240,11 +240,13 @@ std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaDoseDifference()
       return errorMessage;
     }
 
-    // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
+    // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume).
+    // The copy shares the representation data with the mask segment, as the labelmap is only converted and
+    // transformed here, which replaces the voxel data instead of modifying it in place
     vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
     segmentationCopy->SetMasterRepresentationName(maskSegmentation->GetMasterRepresentationName());
     segmentationCopy->CopyConversionParameters(maskSegmentation);
-    segmentationCopy->CopySegmentFromSegmentation(maskSegmentation, maskSegmentID);
+    segmentationCopy->CopySegmentFromSegmentation(maskSegmentation, maskSegmentID, false, true);
     if (!segmentationCopy->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
     {
       std::string errorMessage("Failed to create binary labelmap representation for mask segment");
@@ -335,13 +335,15 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh()
     }
   }
 
-  // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
+  // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume).
+  // The copies share the representation data with the selected segments, as the labelmaps are only converted,
+  // transformed and resampled here, which replaces the voxel data instead of modifying it in place
   vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
   segmentationCopy->SetMasterRepresentationName(selectedSegmentation->GetMasterRepresentationName());
   segmentationCopy->CopyConversionParameters(selectedSegmentation);
   for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
   {
-    segmentationCopy->CopySegmentFromSegmentation(selectedSegmentation, (*segmentIt));
+    segmentationCopy->CopySegmentFromSegmentation(selectedSegmentation, (*segmentIt), false, true);
   }
 
   // Use dose volume geometry as reference, with oversampling of fixed 2 or automatic (as selected)
@@ -412,10 +414,11 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh()
     vtkErrorMacro("ComputeDvh: " << errorMessage);
     return errorMessage;
   }
-  // Apply parent transform on dose volume if necessary
+  // Apply parent transform on dose volume if necessary. Resampling the dose is deferred to the resampling
+  // to the oversampled geometry, so that the dose values are interpolated only once
   if (doseVolumeNode->GetParentTransformNode())
   {
-    if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(doseVolumeNode, doseImageData))
+    if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(doseVolumeNode, doseImageData, true))
     {
       std::string errorMessage("Failed to apply parent transformation to dose!");
       vtkErrorMacro("ComputeDvh: " << errorMessage);
@@ -430,6 +433,12 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh()
     // Get geometry of oversampled dose volume
     fixedOversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
     fixedOversampledDoseVolume->ShallowCopy(doseImageData);
+    if (fixedOversampledDoseVolume->GetPendingTransform())
+    {
+      // Only the transformed geometry of the dose is needed here, the voxels are transformed when resampling
+      vtkOrientedImageDataResample::TransformOrientedImage(fixedOversampledDoseVolume, fixedOversampledDoseVolume->GetPendingTransform(), true);
+      fixedOversampledDoseVolume->SetPendingTransform(NULL);
+    }
     vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(fixedOversampledDoseVolume, this->DefaultDoseVolumeOversamplingFactor);
 
     // Resample dose volume using linear interpolation
@@ -458,10 +467,10 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh()
       return errorMessage;
     }
 
-    // Apply parent transformation nodes if necessary
+    // Apply parent transformation nodes if necessary. The labelmap is resampled afterwards, so the transform is applied in that step
     if (segmentationNode->GetParentTransformNode())
     {
-      if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, segmentBinaryLabelmap))
+      if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, segmentBinaryLabelmap, true))
       {
         std::string errorMessage("Failed to apply parent transformation to segment!");
         vtkErrorMacro("ComputeDvh: " << errorMessage);
@@ -1192,8 +1192,9 @@ void vtkSlicerExternalBeamPlanningModuleLogic::ComputeDoseByPlastimatch(vtkMRMLR
   vtkSmartPointer<vtkOrientedImageData> targetLabelmap;
   if (segmentation->ContainsRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
   {
+    // Transforming the labelmap replaces its voxel data, so it can be shared with the segment
     targetLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
-    targetLabelmap->DeepCopy( vtkOrientedImageData::SafeDownCast(
+    targetLabelmap->ShallowCopy( vtkOrientedImageData::SafeDownCast(
         segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) );
   }
   else
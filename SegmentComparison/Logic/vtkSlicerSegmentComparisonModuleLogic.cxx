@@ -141,9 +141,10 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
   if ( referenceSegmentation->ContainsRepresentation(
     vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) )
   {
-    // Temporarily duplicate segment, as it may be transformed
+    // Temporarily duplicate segment, as it may be transformed. Transforms replace the voxel data
+    // instead of modifying it in place, so the data can be shared with the segment
     referenceSegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
-    referenceSegmentLabelmap->DeepCopy( vtkOrientedImageData::SafeDownCast(
+    referenceSegmentLabelmap->ShallowCopy( vtkOrientedImageData::SafeDownCast(
       referenceSegment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) );
   }
   else // Need to convert
@@ -165,9 +166,10 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
   if ( compareSegmentation->ContainsRepresentation(
     vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) )
   {
-    // Temporarily duplicate segment, as it may be transformed
+    // Temporarily duplicate segment, as it may be transformed. Transforms replace the voxel data
+    // instead of modifying it in place, so the data can be shared with the segment
     compareSegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
-    compareSegmentLabelmap->DeepCopy( vtkOrientedImageData::SafeDownCast(
+    compareSegmentLabelmap->ShallowCopy( vtkOrientedImageData::SafeDownCast(
       compareSegment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) );
   }
   else // Need to convert
@@ -231,9 +231,10 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation()
   if ( inputSegmentationANode->GetSegmentation()->ContainsRepresentation(
     vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) )
   {
-    // Make a copy in case the parent transform has to be hardened on it
+    // Make a copy in case the parent transform has to be hardened on it. Transforming and padding
+    // replace the voxel data instead of modifying it in place, so the data can be shared with the segment
     imageA = vtkSmartPointer<vtkOrientedImageData>::New();
-    imageA->DeepCopy( vtkOrientedImageData::SafeDownCast(
+    imageA->ShallowCopy( vtkOrientedImageData::SafeDownCast(
       segmentA->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) );
   }
   else // Need to convert
@@ -289,9 +290,9 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation()
     if ( inputSegmentationBNode->GetSegmentation()->ContainsRepresentation(
       vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) )
     {
-      // Temporarily duplicate segment, as it may be resampled
+      // Temporarily duplicate segment, as it may be resampled (which replaces the shared voxel data)
       imageB = vtkSmartPointer<vtkOrientedImageData>::New();
-      imageB->DeepCopy( vtkOrientedImageData::SafeDownCast(
+      imageB->ShallowCopy( vtkOrientedImageData::SafeDownCast(
         segmentB->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) );
     }
     else // Need to convert
@@ -310,7 +311,8 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation()
     // Apply parent transformation nodes if necessary
     if (inputSegmentationBNode->GetParentTransformNode())
     {
-      if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(inputSegmentationBNode, imageB))
+      // Image B is resampled to the geometry of image A, so the transform is applied in that step
+      if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(inputSegmentationBNode, imageB, true))
       {
         std::string errorMessage("Failed to apply parent transformation to segmentation B!");
         vtkErrorMacro("ApplyMorphologyOperation: " << errorMessage);
@@ -318,8 +320,8 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation()
       }
     }
 
-    // Resample image B if has a different geometry than image A
-    if (!vtkOrientedImageDataResample::DoGeometriesMatch(imageA, imageB))
+    // Resample image B if has a different geometry than image A or has a pending transform
+    if (imageB->GetPendingTransform() || !vtkOrientedImageDataResample::DoGeometriesMatch(imageA, imageB))
     {
       vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(imageB, imageA, imageB, true);
     }
@@ -500,7 +502,7 @@ std::string vtkSlicerSegmentMorphologyModuleLogic::ApplyMorphologyOperation()
 
   // Create segment for output image data
   vtkSmartPointer<vtkOrientedImageData> outputImage = vtkSmartPointer<vtkOrientedImageData>::New();
-  outputImage->DeepCopy(tempOutputImageData);
+  outputImage->ShallowCopy(tempOutputImageData);
   vtkSmartPointer<vtkMatrix4x4> imageAToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   imageA->GetImageToWorldMatrix(imageAToWorldMatrix);
   outputImage->SetGeometryFromImageToWorldMatrix(imageAToWorldMatrix);
@@ -0,0 +1,252 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkVersion.h>
+#include <vtkPolyData.h>
+#include <vtkMassProperties.h>
+#include <vtkSmartPointer.h>
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkBinaryLabelmapToClosedSurfaceConversionRule.h"
+
+// STD includes
+#include <vector>
+
+void CreateBoxLabelmap(vtkOrientedImageData* imageData, const int boxExtent[6]);
+bool AreSurfacesEquivalent(vtkPolyData* surface1, vtkPolyData* surface2);
+
+//----------------------------------------------------------------------------
+int vtkBinaryLabelmapToClosedSurfaceConversionTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Two separate boxes and one box overlapping with the first one, all in the same geometry
+  int boxExtents[3][6] = { {5,14,5,14,5,14}, {25,34,20,29,10,19}, {10,19,10,19,10,19} };
+  std::vector<vtkSmartPointer<vtkOrientedImageData> > labelmaps;
+  for (int boxIndex=0; boxIndex<3; ++boxIndex)
+  {
+    vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    CreateBoxLabelmap(labelmap, boxExtents[boxIndex]);
+    labelmaps.push_back(labelmap);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Reference: single-threaded marching cubes on each labelmap separately
+
+  vtkNew<vtkBinaryLabelmapToClosedSurfaceConversionRule> referenceRule;
+  referenceRule->SetConversionParameter(vtkBinaryLabelmapToClosedSurfaceConversionRule::GetDecimationFactorParameterName(), "0.0");
+  referenceRule->SetConversionParameter(vtkBinaryLabelmapToClosedSurfaceConversionRule::GetExtractionMethodParameterName(),
+    vtkBinaryLabelmapToClosedSurfaceConversionRule::GetMarchingCubesExtractionMethodName());
+  std::vector<vtkSmartPointer<vtkPolyData> > referenceSurfaces;
+  for (int boxIndex=0; boxIndex<3; ++boxIndex)
+  {
+    vtkSmartPointer<vtkPolyData> referenceSurface = vtkSmartPointer<vtkPolyData>::New();
+    if (!referenceRule->Convert(labelmaps[boxIndex], referenceSurface))
+    {
+      std::cerr << __LINE__ << ": Failed to convert labelmap with marching cubes!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (referenceSurface->GetNumberOfPolys() == 0)
+    {
+      std::cerr << __LINE__ << ": Marching cubes created empty surface!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    referenceSurfaces.push_back(referenceSurface);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Parallel marching cubes must create the same surface
+
+  vtkNew<vtkBinaryLabelmapToClosedSurfaceConversionRule> parallelRule;
+  parallelRule->SetConversionParameter(vtkBinaryLabelmapToClosedSurfaceConversionRule::GetDecimationFactorParameterName(), "0.0");
+  parallelRule->SetConversionParameter(vtkBinaryLabelmapToClosedSurfaceConversionRule::GetExtractionMethodParameterName(),
+    vtkBinaryLabelmapToClosedSurfaceConversionRule::GetParallelMarchingCubesExtractionMethodName());
+  for (int boxIndex=0; boxIndex<3; ++boxIndex)
+  {
+    vtkNew<vtkPolyData> parallelSurface;
+    if (!parallelRule->Convert(labelmaps[boxIndex], parallelSurface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to convert labelmap with parallel marching cubes!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!AreSurfacesEquivalent(referenceSurfaces[boxIndex], parallelSurface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Parallel marching cubes result differs from marching cubes result for box " << boxIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Multi-label marching cubes must create the same surfaces, including the
+  // overlapping box that falls back to individual conversion
+
+  vtkNew<vtkBinaryLabelmapToClosedSurfaceConversionRule> multiLabelRule;
+  multiLabelRule->SetConversionParameter(vtkBinaryLabelmapToClosedSurfaceConversionRule::GetDecimationFactorParameterName(), "0.0");
+  multiLabelRule->SetConversionParameter(vtkBinaryLabelmapToClosedSurfaceConversionRule::GetExtractionMethodParameterName(),
+    vtkBinaryLabelmapToClosedSurfaceConversionRule::GetMultiLabelMarchingCubesExtractionMethodName());
+  std::vector<vtkSmartPointer<vtkPolyData> > multiLabelSurfaces;
+  std::vector<vtkDataObject*> sourceRepresentations;
+  std::vector<vtkDataObject*> targetRepresentations;
+  for (int boxIndex=0; boxIndex<3; ++boxIndex)
+  {
+    vtkSmartPointer<vtkPolyData> multiLabelSurface = vtkSmartPointer<vtkPolyData>::New();
+    multiLabelSurfaces.push_back(multiLabelSurface);
+    sourceRepresentations.push_back(labelmaps[boxIndex]);
+    targetRepresentations.push_back(multiLabelSurface);
+  }
+  if (!multiLabelRule->ConvertMultiple(sourceRepresentations, targetRepresentations))
+  {
+    std::cerr << __LINE__ << ": Failed to convert labelmaps with multi-label marching cubes!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int boxIndex=0; boxIndex<3; ++boxIndex)
+  {
+    if (!AreSurfacesEquivalent(referenceSurfaces[boxIndex], multiLabelSurfaces[boxIndex]))
+    {
+      std::cerr << __LINE__ << ": Multi-label marching cubes result differs from marching cubes result for box " << boxIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // A labelmap that yields no polygons in the multi-label pass must fall back to
+  // individual conversion, so the result matches converting each labelmap separately
+
+  int emptyBoxExtent[6] = {0,-1,0,-1,0,-1};
+  vtkSmartPointer<vtkOrientedImageData> emptyLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  CreateBoxLabelmap(emptyLabelmap, emptyBoxExtent);
+  vtkNew<vtkPolyData> emptyReferenceSurface;
+  bool emptyReferenceSuccess = referenceRule->Convert(emptyLabelmap, emptyReferenceSurface.GetPointer());
+
+  std::vector<vtkSmartPointer<vtkPolyData> > fallbackSurfaces;
+  sourceRepresentations.clear();
+  targetRepresentations.clear();
+  for (int index=0; index<3; ++index)
+  {
+    vtkSmartPointer<vtkPolyData> fallbackSurface = vtkSmartPointer<vtkPolyData>::New();
+    fallbackSurfaces.push_back(fallbackSurface);
+    sourceRepresentations.push_back(index == 1 ? emptyLabelmap.GetPointer() : labelmaps[index/2].GetPointer());
+    targetRepresentations.push_back(fallbackSurface);
+  }
+  bool fallbackSuccess = multiLabelRule->ConvertMultiple(sourceRepresentations, targetRepresentations);
+  if (fallbackSuccess != emptyReferenceSuccess)
+  {
+    std::cerr << __LINE__ << ": Multi-label conversion reported " << (fallbackSuccess ? "success" : "failure")
+      << " for a labelmap without polygons, while individual conversion reported " << (emptyReferenceSuccess ? "success" : "failure") << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (fallbackSurfaces[1]->GetNumberOfPolys() != emptyReferenceSurface->GetNumberOfPolys())
+  {
+    std::cerr << __LINE__ << ": Multi-label conversion created " << fallbackSurfaces[1]->GetNumberOfPolys()
+      << " polygons for a labelmap without polygons instead of " << emptyReferenceSurface->GetNumberOfPolys() << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( !AreSurfacesEquivalent(referenceSurfaces[0], fallbackSurfaces[0])
+    || !AreSurfacesEquivalent(referenceSurfaces[1], fallbackSurfaces[2]) )
+  {
+    std::cerr << __LINE__ << ": Multi-label marching cubes result differs from marching cubes result next to a labelmap without polygons!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Binary labelmap to closed surface conversion test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool AreSurfacesEquivalent(vtkPolyData* surface1, vtkPolyData* surface2)
+{
+  if (!surface1 || !surface2)
+  {
+    return false;
+  }
+  if (surface1->GetNumberOfPolys() != surface2->GetNumberOfPolys())
+  {
+    return false;
+  }
+
+  double bounds1[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  double bounds2[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  surface1->GetBounds(bounds1);
+  surface2->GetBounds(bounds2);
+  for (int i=0; i<6; ++i)
+  {
+    if (fabs(bounds1[i]-bounds2[i]) > 0.001)
+    {
+      return false;
+    }
+  }
+
+  vtkNew<vtkMassProperties> massProperties1;
+  vtkNew<vtkMassProperties> massProperties2;
+#if (VTK_MAJOR_VERSION <= 5)
+  massProperties1->SetInput(surface1);
+  massProperties2->SetInput(surface2);
+#else
+  massProperties1->SetInputData(surface1);
+  massProperties2->SetInputData(surface2);
+#endif
+  massProperties1->Update();
+  massProperties2->Update();
+  if (fabs(massProperties1->GetSurfaceArea()-massProperties2->GetSurfaceArea()) > 0.001 * massProperties1->GetSurfaceArea()
+    || fabs(massProperties1->GetVolume()-massProperties2->GetVolume()) > 0.001 * massProperties1->GetVolume())
+  {
+    return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void CreateBoxLabelmap(vtkOrientedImageData* imageData, const int boxExtent[6])
+{
+  if (!imageData)
+  {
+    return;
+  }
+
+  // All labelmaps share the same non-identity geometry
+  imageData->SetExtent(0,39,0,39,0,29);
+  imageData->SetSpacing(0.5, 0.75, 1.25);
+  imageData->SetOrigin(-10.0, 5.0, 20.0);
+#if (VTK_MAJOR_VERSION <= 5)
+  imageData->SetScalarType(VTK_UNSIGNED_CHAR);
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+#else
+  imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+
+  int* extent = imageData->GetExtent();
+  unsigned char* imagePtr = (unsigned char*)imageData->GetScalarPointer();
+  for (int z=extent[4]; z<=extent[5]; ++z)
+  {
+    for (int y=extent[2]; y<=extent[3]; ++y)
+    {
+      for (int x=extent[0]; x<=extent[1]; ++x)
+      {
+        bool inside = ( x >= boxExtent[0] && x <= boxExtent[1] && y >= boxExtent[2] && y <= boxExtent[3]
+          && z >= boxExtent[4] && z <= boxExtent[5] );
+        (*imagePtr++) = (inside ? 1 : 0);
+      }
+    }
+  }
+}
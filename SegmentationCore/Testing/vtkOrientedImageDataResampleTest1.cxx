@@ -0,0 +1,499 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkVersion.h>
+#include <vtkSmartPointer.h>
+#include <vtkGridTransform.h>
+#include <vtkImageData.h>
+#include <vtkImageReslice.h>
+#include <vtkMatrix4x4.h>
+#include <vtkTransform.h>
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+void CreateTestImage(vtkImageData* image, int scalarType, const int extent[6], const int nonZeroVoxels[][3], int numberOfNonZeroVoxels);
+void CalculateEffectiveExtentBruteForce(vtkImageData* image, int effectiveExtent[6]);
+bool ResampleWithImageReslice(vtkOrientedImageData* inputImage, vtkMatrix4x4* referenceToWorldMatrix, int outputExtent[6], vtkImageData* outputImage);
+bool AreImagesEqual(vtkImageData* image1, vtkImageData* image2);
+vtkSmartPointer<vtkGridTransform> CreateDisplacementGridTransform(const double shift[3], double amplitude);
+bool ResampleToReference(vtkOrientedImageData* inputImage, int resampleMode, vtkOrientedImageData* referenceImage, vtkOrientedImageData* outputImage);
+int CountDifferingVoxels(vtkImageData* image1, vtkImageData* image2);
+
+//----------------------------------------------------------------------------
+int vtkOrientedImageDataResampleTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  //////////////////////////////////////////////////////////////////////////
+  // Effective extent calculation must match a scan of all voxels
+
+  int smallExtent[6] = {5,44,-3,26,10,29};
+  int nonZeroVoxels[4][3] = { {7,0,12}, {40,25,12}, {20,-2,28}, {33,11,15} };
+  int scalarTypes[4] = {VTK_UNSIGNED_CHAR, VTK_SHORT, VTK_UNSIGNED_SHORT, VTK_FLOAT};
+  for (int scalarTypeIndex=0; scalarTypeIndex<4; ++scalarTypeIndex)
+  {
+    for (int numberOfNonZeroVoxels=0; numberOfNonZeroVoxels<=4; ++numberOfNonZeroVoxels)
+    {
+      vtkNew<vtkImageData> image;
+      CreateTestImage(image.GetPointer(), scalarTypes[scalarTypeIndex], smallExtent, nonZeroVoxels, numberOfNonZeroVoxels);
+      int expectedEffectiveExtent[6] = {0,-1,0,-1,0,-1};
+      CalculateEffectiveExtentBruteForce(image.GetPointer(), expectedEffectiveExtent);
+      int effectiveExtent[6] = {0,-1,0,-1,0,-1};
+      bool nonEmpty = vtkOrientedImageDataResample::CalculateEffectiveExtent(image.GetPointer(), effectiveExtent);
+      if (nonEmpty != (numberOfNonZeroVoxels > 0))
+      {
+        std::cerr << __LINE__ << ": Effective extent emptiness mismatch for scalar type " << scalarTypes[scalarTypeIndex]
+          << " with " << numberOfNonZeroVoxels << " non-zero voxels!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      for (int i=0; nonEmpty && i<6; ++i)
+      {
+        if (effectiveExtent[i] != expectedEffectiveExtent[i])
+        {
+          std::cerr << __LINE__ << ": Effective extent mismatch for scalar type " << scalarTypes[scalarTypeIndex]
+            << " with " << numberOfNonZeroVoxels << " non-zero voxels!" << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  // Image that is large enough to be scanned on multiple threads
+  int largeExtent[6] = {0,199,0,199,-10,89};
+  int largeNonZeroVoxels[3][3] = { {3,150,-9}, {180,4,40}, {99,199,88} };
+  vtkNew<vtkImageData> largeImage;
+  CreateTestImage(largeImage.GetPointer(), VTK_UNSIGNED_CHAR, largeExtent, largeNonZeroVoxels, 3);
+  int expectedLargeEffectiveExtent[6] = {0,-1,0,-1,0,-1};
+  CalculateEffectiveExtentBruteForce(largeImage.GetPointer(), expectedLargeEffectiveExtent);
+  int largeEffectiveExtent[6] = {0,-1,0,-1,0,-1};
+  if (!vtkOrientedImageDataResample::CalculateEffectiveExtent(largeImage.GetPointer(), largeEffectiveExtent))
+  {
+    std::cerr << __LINE__ << ": Failed to calculate effective extent of large image!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int i=0; i<6; ++i)
+  {
+    if (largeEffectiveExtent[i] != expectedLargeEffectiveExtent[i])
+    {
+      std::cerr << __LINE__ << ": Effective extent mismatch for large image!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Nearest neighbor resampling with axis-aligned transforms (index lookup tables)
+  // must match resampling with vtkImageReslice
+
+  int labelmapExtent[6] = {0,29,0,24,0,19};
+  int labelmapNonZeroVoxels[5][3] = { {3,4,5}, {4,4,5}, {20,10,12}, {28,23,18}, {15,2,1} };
+  vtkNew<vtkOrientedImageData> labelmap;
+  CreateTestImage(labelmap.GetPointer(), VTK_UNSIGNED_CHAR, labelmapExtent, labelmapNonZeroVoxels, 5);
+  labelmap->SetOrigin(10.0, -20.0, 30.0);
+  labelmap->SetSpacing(1.0, 1.5, 2.0);
+
+  // Upsampling, downsampling, and flipping, with origins that avoid sampling exactly halfway between voxels
+  double referenceSpacings[3][3] = { {0.5, 0.5, 0.5}, {2.0, 3.0, 4.0}, {1.0, 1.5, 2.0} };
+  double referenceAxisDirections[3][3] = { {1.0, 1.0, 1.0}, {1.0, 1.0, 1.0}, {-1.0, 1.0, -1.0} };
+  double referenceOrigins[3][3] = { {10.3, -19.6, 30.2}, {9.4, -20.35, 29.3}, {39.3, -19.55, 68.7} };
+  for (int referenceIndex=0; referenceIndex<3; ++referenceIndex)
+  {
+    vtkNew<vtkMatrix4x4> referenceToWorldMatrix;
+    for (int axis=0; axis<3; ++axis)
+    {
+      referenceToWorldMatrix->SetElement(axis, axis, referenceAxisDirections[referenceIndex][axis] * referenceSpacings[referenceIndex][axis]);
+      referenceToWorldMatrix->SetElement(axis, 3, referenceOrigins[referenceIndex][axis]);
+    }
+
+    vtkNew<vtkOrientedImageData> resampledLabelmap;
+    if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(
+      labelmap.GetPointer(), referenceToWorldMatrix.GetPointer(), resampledLabelmap.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to resample labelmap to reference geometry " << referenceIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkNew<vtkImageData> expectedLabelmap;
+    if (!ResampleWithImageReslice(labelmap.GetPointer(), referenceToWorldMatrix.GetPointer(),
+      resampledLabelmap->GetExtent(), expectedLabelmap.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to resample labelmap with vtkImageReslice!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!AreImagesEqual(resampledLabelmap.GetPointer(), expectedLabelmap.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Resampled labelmap differs from vtkImageReslice result for reference geometry " << referenceIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Deferring a transform and then resampling (single interpolation) must match transforming
+  // the voxels right away (TransformOrientedImage) and then resampling the same way
+
+  // Block labelmap in the same geometry as above
+  vtkNew<vtkOrientedImageData> blockLabelmap;
+  CreateTestImage(blockLabelmap.GetPointer(), VTK_UNSIGNED_CHAR, labelmapExtent, labelmapNonZeroVoxels, 0);
+  blockLabelmap->SetOrigin(10.0, -20.0, 30.0);
+  blockLabelmap->SetSpacing(1.0, 1.5, 2.0);
+  int numberOfBlockVoxels = 0;
+  for (int k=5; k<=14; ++k)
+  {
+    for (int j=6; j<=17; ++j)
+    {
+      for (int i=8; i<=20; ++i)
+      {
+        blockLabelmap->SetScalarComponentFromDouble(i, j, k, 0, 1.0);
+        ++numberOfBlockVoxels;
+      }
+    }
+  }
+
+  // Reference aligned with the voxels of the labelmap, with an extent that cuts through the transformed block
+  vtkNew<vtkMatrix4x4> alignedReferenceToWorldMatrix;
+  alignedReferenceToWorldMatrix->SetElement(0, 0, 1.0);
+  alignedReferenceToWorldMatrix->SetElement(1, 1, 1.5);
+  alignedReferenceToWorldMatrix->SetElement(2, 2, 2.0);
+  alignedReferenceToWorldMatrix->SetElement(0, 3, 15.0);
+  alignedReferenceToWorldMatrix->SetElement(1, 3, -15.5);
+  alignedReferenceToWorldMatrix->SetElement(2, 3, 34.0);
+  vtkNew<vtkOrientedImageData> referenceImage;
+  referenceImage->SetGeometryFromImageToWorldMatrix(alignedReferenceToWorldMatrix.GetPointer());
+  referenceImage->SetExtent(0,14,0,14,0,9);
+
+  const char* transformCaseNames[3] = { "linear", "non-linear translation", "non-linear warp and linear translation" };
+  const char* resampleModeNames[3] = { "reference geometry", "reference image extent", "padded reference image extent" };
+  for (int caseIndex=0; caseIndex<3; ++caseIndex)
+  {
+    std::vector<vtkSmartPointer<vtkAbstractTransform> > transforms;
+    int maximumNumberOfDifferingVoxels = 0;
+    if (caseIndex == 0)
+    {
+      // Linear transform is applied on the geometry right away, so the results are the same
+      vtkSmartPointer<vtkTransform> rotation = vtkSmartPointer<vtkTransform>::New();
+      rotation->Translate(3.0, -2.0, 5.0);
+      rotation->RotateZ(30.0);
+      rotation->RotateX(10.0);
+      transforms.push_back(rotation);
+    }
+    else if (caseIndex == 1)
+    {
+      // Displacement of whole voxels, so interpolating once or twice gives the same result
+      double shift[3] = {2.0, -3.0, 4.0};
+      transforms.push_back(CreateDisplacementGridTransform(shift, 0.0));
+    }
+    else
+    {
+      // Non-linear transform concatenated with a linear one in the pending transform. The voxels are sampled
+      // at the same positions, only rounding of the concatenated transforms may differ at a few boundary voxels
+      double shift[3] = {0.0, 0.0, 0.0};
+      transforms.push_back(CreateDisplacementGridTransform(shift, 1.2));
+      vtkSmartPointer<vtkTransform> translation = vtkSmartPointer<vtkTransform>::New();
+      translation->Translate(3.0, 4.5, -4.0);
+      transforms.push_back(translation);
+      maximumNumberOfDifferingVoxels = numberOfBlockVoxels / 100;
+    }
+
+    vtkNew<vtkOrientedImageData> transformedLabelmap;
+    transformedLabelmap->DeepCopy(blockLabelmap.GetPointer());
+    vtkNew<vtkOrientedImageData> deferredLabelmap;
+    deferredLabelmap->DeepCopy(blockLabelmap.GetPointer());
+    vtkNew<vtkOrientedImageData> appliedLabelmap;
+    appliedLabelmap->DeepCopy(blockLabelmap.GetPointer());
+    for (std::vector<vtkSmartPointer<vtkAbstractTransform> >::iterator transformIt = transforms.begin(); transformIt != transforms.end(); ++transformIt)
+    {
+      vtkOrientedImageDataResample::TransformOrientedImage(transformedLabelmap.GetPointer(), *transformIt);
+      vtkOrientedImageDataResample::TransformOrientedImageDeferred(deferredLabelmap.GetPointer(), *transformIt);
+      vtkOrientedImageDataResample::TransformOrientedImageDeferred(appliedLabelmap.GetPointer(), *transformIt);
+    }
+    if ((caseIndex == 0) != (deferredLabelmap->GetPendingTransform() == NULL))
+    {
+      std::cerr << __LINE__ << ": Pending transform is " << (caseIndex == 0 ? "set" : "not set") << " for " << transformCaseNames[caseIndex] << " transform!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkOrientedImageDataResample::ApplyPendingTransform(appliedLabelmap.GetPointer());
+    if (appliedLabelmap->GetPendingTransform())
+    {
+      std::cerr << __LINE__ << ": Pending transform was not cleared when applied for " << transformCaseNames[caseIndex] << " transform!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    for (int resampleMode=0; resampleMode<3; ++resampleMode)
+    {
+      vtkNew<vtkOrientedImageData> expectedLabelmap;
+      vtkNew<vtkOrientedImageData> resampledDeferredLabelmap;
+      vtkNew<vtkOrientedImageData> resampledAppliedLabelmap;
+      if ( !ResampleToReference(transformedLabelmap.GetPointer(), resampleMode, referenceImage.GetPointer(), expectedLabelmap.GetPointer())
+        || !ResampleToReference(deferredLabelmap.GetPointer(), resampleMode, referenceImage.GetPointer(), resampledDeferredLabelmap.GetPointer())
+        || !ResampleToReference(appliedLabelmap.GetPointer(), resampleMode, referenceImage.GetPointer(), resampledAppliedLabelmap.GetPointer()) )
+      {
+        std::cerr << __LINE__ << ": Failed to resample " << transformCaseNames[caseIndex] << " transformed labelmap to "
+          << resampleModeNames[resampleMode] << "!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if ( resampledDeferredLabelmap->GetPendingTransform()
+        || (caseIndex != 0 && !deferredLabelmap->GetPendingTransform()) )
+      {
+        std::cerr << __LINE__ << ": Pending transform was not moved from the input to the resampled " << transformCaseNames[caseIndex]
+          << " transformed labelmap for " << resampleModeNames[resampleMode] << "!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if ( !vtkOrientedImageDataResample::DoGeometriesMatch(expectedLabelmap.GetPointer(), resampledDeferredLabelmap.GetPointer())
+        || !vtkOrientedImageDataResample::DoGeometriesMatch(expectedLabelmap.GetPointer(), resampledAppliedLabelmap.GetPointer()) )
+      {
+        std::cerr << __LINE__ << ": Geometry mismatch after resampling " << transformCaseNames[caseIndex] << " transformed labelmap to "
+          << resampleModeNames[resampleMode] << "!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      int numberOfDeferredDifferingVoxels = CountDifferingVoxels(expectedLabelmap.GetPointer(), resampledDeferredLabelmap.GetPointer());
+      int numberOfAppliedDifferingVoxels = CountDifferingVoxels(expectedLabelmap.GetPointer(), resampledAppliedLabelmap.GetPointer());
+      if ( numberOfDeferredDifferingVoxels > maximumNumberOfDifferingVoxels
+        || numberOfAppliedDifferingVoxels > maximumNumberOfDifferingVoxels )
+      {
+        std::cerr << __LINE__ << ": Resampling " << transformCaseNames[caseIndex] << " transformed labelmap to " << resampleModeNames[resampleMode]
+          << " differs in " << numberOfDeferredDifferingVoxels << " voxels with deferred transform and in " << numberOfAppliedDifferingVoxels
+          << " voxels with applied pending transform from resampling after transforming right away!" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  std::cout << "Oriented image data resample test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void CreateTestImage(vtkImageData* image, int scalarType, const int extent[6], const int nonZeroVoxels[][3], int numberOfNonZeroVoxels)
+{
+  image->SetExtent(extent[0], extent[1], extent[2], extent[3], extent[4], extent[5]);
+#if (VTK_MAJOR_VERSION <= 5)
+  image->SetScalarType(scalarType);
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+#else
+  image->AllocateScalars(scalarType, 1);
+#endif
+  for (int k=extent[4]; k<=extent[5]; ++k)
+  {
+    for (int j=extent[2]; j<=extent[3]; ++j)
+    {
+      for (int i=extent[0]; i<=extent[1]; ++i)
+      {
+        image->SetScalarComponentFromDouble(i, j, k, 0, 0.0);
+      }
+    }
+  }
+  for (int voxelIndex=0; voxelIndex<numberOfNonZeroVoxels; ++voxelIndex)
+  {
+    image->SetScalarComponentFromDouble(nonZeroVoxels[voxelIndex][0], nonZeroVoxels[voxelIndex][1], nonZeroVoxels[voxelIndex][2], 0, voxelIndex+1);
+  }
+}
+
+//----------------------------------------------------------------------------
+void CalculateEffectiveExtentBruteForce(vtkImageData* image, int effectiveExtent[6])
+{
+  int* extent = image->GetExtent();
+  effectiveExtent[0] = extent[1]+1;
+  effectiveExtent[1] = extent[0]-1;
+  effectiveExtent[2] = extent[3]+1;
+  effectiveExtent[3] = extent[2]-1;
+  effectiveExtent[4] = extent[5]+1;
+  effectiveExtent[5] = extent[4]-1;
+  for (int k=extent[4]; k<=extent[5]; ++k)
+  {
+    for (int j=extent[2]; j<=extent[3]; ++j)
+    {
+      for (int i=extent[0]; i<=extent[1]; ++i)
+      {
+        if (image->GetScalarComponentAsDouble(i, j, k, 0) != 0.0)
+        {
+          effectiveExtent[0] = std::min(effectiveExtent[0], i);
+          effectiveExtent[1] = std::max(effectiveExtent[1], i);
+          effectiveExtent[2] = std::min(effectiveExtent[2], j);
+          effectiveExtent[3] = std::max(effectiveExtent[3], j);
+          effectiveExtent[4] = std::min(effectiveExtent[4], k);
+          effectiveExtent[5] = std::max(effectiveExtent[5], k);
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool ResampleWithImageReslice(vtkOrientedImageData* inputImage, vtkMatrix4x4* referenceToWorldMatrix, int outputExtent[6], vtkImageData* outputImage)
+{
+  // Transform from reference voxel indices to input voxel indices
+  vtkSmartPointer<vtkMatrix4x4> inputImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  inputImage->GetImageToWorldMatrix(inputImageToWorldMatrix);
+  vtkSmartPointer<vtkTransform> referenceImageToInputImageTransform = vtkSmartPointer<vtkTransform>::New();
+  referenceImageToInputImageTransform->PostMultiply();
+  referenceImageToInputImageTransform->Concatenate(referenceToWorldMatrix);
+  inputImageToWorldMatrix->Invert();
+  referenceImageToInputImageTransform->Concatenate(inputImageToWorldMatrix);
+
+  // Clone of the input image with identity geometry, so that reslice works on voxel indices
+  vtkSmartPointer<vtkImageData> identityInputImage = vtkSmartPointer<vtkImageData>::New();
+  identityInputImage->ShallowCopy(inputImage);
+  identityInputImage->SetOrigin(0.0, 0.0, 0.0);
+  identityInputImage->SetSpacing(1.0, 1.0, 1.0);
+
+  vtkSmartPointer<vtkImageReslice> resliceFilter = vtkSmartPointer<vtkImageReslice>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  resliceFilter->SetInput(identityInputImage);
+#else
+  resliceFilter->SetInputData(identityInputImage);
+#endif
+  resliceFilter->SetOutputOrigin(0, 0, 0);
+  resliceFilter->SetOutputSpacing(1, 1, 1);
+  resliceFilter->SetOutputExtent(outputExtent);
+  resliceFilter->SetResliceTransform(referenceImageToInputImageTransform);
+  resliceFilter->SetInterpolationModeToNearestNeighbor();
+  resliceFilter->Update();
+  if (!resliceFilter->GetOutput())
+  {
+    return false;
+  }
+
+  outputImage->DeepCopy(resliceFilter->GetOutput());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool AreImagesEqual(vtkImageData* image1, vtkImageData* image2)
+{
+  int* extent1 = image1->GetExtent();
+  int* extent2 = image2->GetExtent();
+  for (int i=0; i<6; ++i)
+  {
+    if (extent1[i] != extent2[i])
+    {
+      return false;
+    }
+  }
+  if (image1->GetScalarType() != image2->GetScalarType())
+  {
+    return false;
+  }
+
+  for (int k=extent1[4]; k<=extent1[5]; ++k)
+  {
+    for (int j=extent1[2]; j<=extent1[3]; ++j)
+    {
+      for (int i=extent1[0]; i<=extent1[1]; ++i)
+      {
+        if (image1->GetScalarComponentAsDouble(i, j, k, 0) != image2->GetScalarComponentAsDouble(i, j, k, 0))
+        {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkGridTransform> CreateDisplacementGridTransform(const double shift[3], double amplitude)
+{
+  // Grid covers the transformed labelmaps with margin
+  vtkSmartPointer<vtkImageData> displacementGrid = vtkSmartPointer<vtkImageData>::New();
+  displacementGrid->SetOrigin(-10.0, -50.0, 0.0);
+  displacementGrid->SetSpacing(2.0, 2.0, 2.0);
+  displacementGrid->SetExtent(0,40,0,50,0,50);
+#if (VTK_MAJOR_VERSION <= 5)
+  displacementGrid->SetScalarTypeToDouble();
+  displacementGrid->SetNumberOfScalarComponents(3);
+  displacementGrid->AllocateScalars();
+#else
+  displacementGrid->AllocateScalars(VTK_DOUBLE, 3);
+#endif
+  int* extent = displacementGrid->GetExtent();
+  for (int k=extent[4]; k<=extent[5]; ++k)
+  {
+    for (int j=extent[2]; j<=extent[3]; ++j)
+    {
+      for (int i=extent[0]; i<=extent[1]; ++i)
+      {
+        double x = -10.0 + 2.0 * i;
+        double y = -50.0 + 2.0 * j;
+        double z = 2.0 * k;
+        displacementGrid->SetScalarComponentFromDouble(i, j, k, 0, shift[0] + amplitude * sin(0.2 * y));
+        displacementGrid->SetScalarComponentFromDouble(i, j, k, 1, shift[1] + amplitude * sin(0.2 * z));
+        displacementGrid->SetScalarComponentFromDouble(i, j, k, 2, shift[2] + amplitude * sin(0.2 * x));
+      }
+    }
+  }
+
+  vtkSmartPointer<vtkGridTransform> gridTransform = vtkSmartPointer<vtkGridTransform>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  gridTransform->SetDisplacementGrid(displacementGrid);
+#else
+  gridTransform->SetDisplacementGridData(displacementGrid);
+#endif
+  gridTransform->SetInterpolationModeToLinear();
+  return gridTransform;
+}
+
+//----------------------------------------------------------------------------
+bool ResampleToReference(vtkOrientedImageData* inputImage, int resampleMode, vtkOrientedImageData* referenceImage, vtkOrientedImageData* outputImage)
+{
+  if (resampleMode == 0)
+  {
+    // Output extent is calculated from the content of the input
+    vtkSmartPointer<vtkMatrix4x4> referenceToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    referenceImage->GetImageToWorldMatrix(referenceToWorldMatrix);
+    return vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(inputImage, referenceToWorldMatrix, outputImage);
+  }
+  // Output extent is the reference extent, padded to contain the input if requested
+  return vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(inputImage, referenceImage, outputImage, false, resampleMode == 2);
+}
+
+//----------------------------------------------------------------------------
+int CountDifferingVoxels(vtkImageData* image1, vtkImageData* image2)
+{
+  // Voxels outside the extent of an image are considered background
+  int* extent1 = image1->GetExtent();
+  int* extent2 = image2->GetExtent();
+  int numberOfDifferingVoxels = 0;
+  for (int k=std::min(extent1[4],extent2[4]); k<=std::max(extent1[5],extent2[5]); ++k)
+  {
+    for (int j=std::min(extent1[2],extent2[2]); j<=std::max(extent1[3],extent2[3]); ++j)
+    {
+      for (int i=std::min(extent1[0],extent2[0]); i<=std::max(extent1[1],extent2[1]); ++i)
+      {
+        bool inside1 = ( i >= extent1[0] && i <= extent1[1] && j >= extent1[2] && j <= extent1[3] && k >= extent1[4] && k <= extent1[5] );
+        bool inside2 = ( i >= extent2[0] && i <= extent2[1] && j >= extent2[2] && j <= extent2[3] && k >= extent2[4] && k <= extent2[5] );
+        double value1 = (inside1 ? image1->GetScalarComponentAsDouble(i, j, k, 0) : 0.0);
+        double value2 = (inside2 ? image2->GetScalarComponentAsDouble(i, j, k, 0) : 0.0);
+        if (value1 != value2)
+        {
+          ++numberOfDifferingVoxels;
+        }
+      }
+    }
+  }
+  return numberOfDifferingVoxels;
+}
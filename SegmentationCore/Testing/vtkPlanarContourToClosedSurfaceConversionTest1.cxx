@@ -0,0 +1,284 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLPolyDataReader.h>
+
+// SegmentationCore includes
+#include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+#include "vtkPlanarContourToClosedSurfaceReferenceRule.h"
+
+// STD includes
+#include <vector>
+
+void CreateContours(vtkPolyData* contours);
+void AddCircleContour(vtkPoints* points, vtkCellArray* lines, double center[3], double radius, int numberOfPoints);
+void AddKeyholeContour(vtkPoints* points, vtkCellArray* lines, double z, double outerRadius, double innerRadius);
+bool AreSurfacesIdentical(vtkPolyData* surface1, vtkPolyData* surface2);
+
+//----------------------------------------------------------------------------
+// Usage: vtkPlanarContourToClosedSurfaceConversionTest1 [contourFile1.vtp contourFile2.vtp ...]
+// Converts synthetic contours (containing keyholes and branching) and the planar contours in the
+// given files with the current conversion rule (serial and parallel) and with the reference implementation.
+// The outputs must be identical. The conversion times are printed as benchmark.
+int vtkPlanarContourToClosedSurfaceConversionTest1(int argc, char* argv[])
+{
+  std::vector<vtkSmartPointer<vtkPolyData> > contourSets;
+  vtkSmartPointer<vtkPolyData> syntheticContours = vtkSmartPointer<vtkPolyData>::New();
+  CreateContours(syntheticContours);
+  contourSets.push_back(syntheticContours);
+
+  for (int argIndex=1; argIndex<argc; ++argIndex)
+  {
+    vtkNew<vtkXMLPolyDataReader> reader;
+    reader->SetFileName(argv[argIndex]);
+    reader->Update();
+    if (!reader->GetOutput() || reader->GetOutput()->GetNumberOfLines() == 0)
+    {
+      std::cerr << __LINE__ << ": Failed to read planar contours from file " << argv[argIndex] << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkSmartPointer<vtkPolyData> contours = vtkSmartPointer<vtkPolyData>::New();
+    contours->DeepCopy(reader->GetOutput());
+    contourSets.push_back(contours);
+  }
+
+  vtkNew<vtkPlanarContourToClosedSurfaceReferenceRule> referenceRule;
+  vtkNew<vtkPlanarContourToClosedSurfaceConversionRule> rule;
+  rule->SetConversionParameter(vtkPlanarContourToClosedSurfaceConversionRule::GetNumberOfThreadsParameterName(), "1");
+  vtkNew<vtkPlanarContourToClosedSurfaceConversionRule> parallelRule;
+  parallelRule->SetConversionParameter(vtkPlanarContourToClosedSurfaceConversionRule::GetNumberOfThreadsParameterName(), "4");
+
+  vtkNew<vtkTimerLog> timer;
+  double totalReferenceTime = 0.0;
+  double totalTime = 0.0;
+  double totalParallelTime = 0.0;
+  for (unsigned int contourSetIndex=0; contourSetIndex<contourSets.size(); ++contourSetIndex)
+  {
+    vtkNew<vtkPolyData> referenceSurface;
+    double checkpointStart = timer->GetUniversalTime();
+    if (!referenceRule->Convert(contourSets[contourSetIndex], referenceSurface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Reference conversion failed for contour set " << contourSetIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    double referenceTime = timer->GetUniversalTime() - checkpointStart;
+
+    vtkNew<vtkPolyData> surface;
+    checkpointStart = timer->GetUniversalTime();
+    if (!rule->Convert(contourSets[contourSetIndex], surface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Conversion failed for contour set " << contourSetIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    double conversionTime = timer->GetUniversalTime() - checkpointStart;
+
+    if (surface->GetNumberOfPolys() == 0)
+    {
+      std::cerr << __LINE__ << ": Conversion created empty surface for contour set " << contourSetIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!AreSurfacesIdentical(referenceSurface.GetPointer(), surface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Converted surface differs from the reference for contour set " << contourSetIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Triangulating the plane pairs in parallel must not change the output
+    vtkNew<vtkPolyData> parallelSurface;
+    checkpointStart = timer->GetUniversalTime();
+    if (!parallelRule->Convert(contourSets[contourSetIndex], parallelSurface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Parallel conversion failed for contour set " << contourSetIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    double parallelConversionTime = timer->GetUniversalTime() - checkpointStart;
+    if (!AreSurfacesIdentical(surface.GetPointer(), parallelSurface.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Surface converted in parallel differs from serial result for contour set " << contourSetIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::cout << "Contour set " << contourSetIndex << " (" << contourSets[contourSetIndex]->GetNumberOfLines() << " contours, "
+      << surface->GetNumberOfPolys() << " triangles): reference " << referenceTime << " s, current " << conversionTime
+      << " s, parallel " << parallelConversionTime << " s" << std::endl;
+    totalReferenceTime += referenceTime;
+    totalTime += conversionTime;
+    totalParallelTime += parallelConversionTime;
+  }
+
+  std::cout << "Total conversion time: reference " << totalReferenceTime << " s, current " << totalTime
+    << " s, parallel " << totalParallelTime << " s";
+  if (totalTime > 0.0)
+  {
+    std::cout << " (speedup " << totalReferenceTime / totalTime << "x)";
+  }
+  std::cout << std::endl;
+
+  std::cout << "Planar contour to closed surface conversion test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool AreSurfacesIdentical(vtkPolyData* surface1, vtkPolyData* surface2)
+{
+  if (!surface1 || !surface2 || !surface1->GetPoints() || !surface2->GetPoints())
+  {
+    return false;
+  }
+
+  // Same points in the same order
+  if (surface1->GetNumberOfPoints() != surface2->GetNumberOfPoints())
+  {
+    return false;
+  }
+  for (vtkIdType pointId=0; pointId<surface1->GetNumberOfPoints(); ++pointId)
+  {
+    double point1[3] = {0.0,0.0,0.0};
+    double point2[3] = {0.0,0.0,0.0};
+    surface1->GetPoint(pointId, point1);
+    surface2->GetPoint(pointId, point2);
+    if (vtkMath::Distance2BetweenPoints(point1, point2) > 0.0)
+    {
+      return false;
+    }
+  }
+
+  // Same triangles in the same order
+  if (surface1->GetNumberOfPolys() != surface2->GetNumberOfPolys())
+  {
+    return false;
+  }
+  vtkCellArray* polys1 = surface1->GetPolys();
+  vtkCellArray* polys2 = surface2->GetPolys();
+  polys1->InitTraversal();
+  polys2->InitTraversal();
+  vtkNew<vtkIdList> cellPointIds1;
+  vtkNew<vtkIdList> cellPointIds2;
+  while (polys1->GetNextCell(cellPointIds1.GetPointer()))
+  {
+    if (!polys2->GetNextCell(cellPointIds2.GetPointer())
+      || cellPointIds1->GetNumberOfIds() != cellPointIds2->GetNumberOfIds())
+    {
+      return false;
+    }
+    for (vtkIdType idIndex=0; idIndex<cellPointIds1->GetNumberOfIds(); ++idIndex)
+    {
+      if (cellPointIds1->GetId(idIndex) != cellPointIds2->GetId(idIndex))
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void CreateContours(vtkPolyData* contours)
+{
+  if (!contours)
+  {
+    return;
+  }
+
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  double spacing = 2.5;
+
+  // Tapering cylinder, one contour per plane
+  for (int planeIndex=0; planeIndex<8; ++planeIndex)
+  {
+    double center[3] = {0.0, 0.0, planeIndex*spacing};
+    AddCircleContour(points.GetPointer(), lines.GetPointer(), center, 20.0 - planeIndex, 32 + 2*planeIndex);
+  }
+
+  // Contour with a keyhole channel leading to an inner hole
+  AddKeyholeContour(points.GetPointer(), lines.GetPointer(), 8*spacing, 12.0, 5.0);
+
+  // Branching into two contours
+  double leftCenter[3] = {-6.0, 0.0, 9*spacing};
+  AddCircleContour(points.GetPointer(), lines.GetPointer(), leftCenter, 5.0, 24);
+  double rightCenter[3] = {6.0, 0.0, 9*spacing};
+  AddCircleContour(points.GetPointer(), lines.GetPointer(), rightCenter, 5.0, 24);
+
+  // Only one of the branches continues
+  double topCenter[3] = {-6.0, 0.0, 10*spacing};
+  AddCircleContour(points.GetPointer(), lines.GetPointer(), topCenter, 4.0, 20);
+
+  contours->SetPoints(points.GetPointer());
+  contours->SetLines(lines.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+void AddCircleContour(vtkPoints* points, vtkCellArray* lines, double center[3], double radius, int numberOfPoints)
+{
+  lines->InsertNextCell(numberOfPoints);
+  for (int pointIndex=0; pointIndex<numberOfPoints; ++pointIndex)
+  {
+    double angle = 2.0 * vtkMath::Pi() * pointIndex / numberOfPoints;
+    lines->InsertCellPoint(points->InsertNextPoint(
+      center[0] + radius * cos(angle), center[1] + radius * sin(angle), center[2]));
+  }
+}
+
+//----------------------------------------------------------------------------
+void AddKeyholeContour(vtkPoints* points, vtkCellArray* lines, double z, double outerRadius, double innerRadius)
+{
+  // The contour goes around the outer circle until the channel, enters the inner circle,
+  // goes around the inner circle in the opposite direction, then leaves along the same channel
+  // and finishes the outer circle. The channel points are duplicated with the same coordinates.
+  const int numberOfOuterPoints = 32;
+  const int numberOfInnerPoints = 16;
+  const int channelPointIndex = 8;
+  double channelAngle = 2.0 * vtkMath::Pi() * channelPointIndex / numberOfOuterPoints;
+  double outerChannelPoint[3] = {outerRadius * cos(channelAngle), outerRadius * sin(channelAngle), z};
+  double innerChannelPoint[3] = {innerRadius * cos(channelAngle), innerRadius * sin(channelAngle), z};
+
+  lines->InsertNextCell(numberOfOuterPoints + numberOfInnerPoints + 2);
+  for (int pointIndex=0; pointIndex<channelPointIndex; ++pointIndex)
+  {
+    double angle = 2.0 * vtkMath::Pi() * pointIndex / numberOfOuterPoints;
+    lines->InsertCellPoint(points->InsertNextPoint(outerRadius * cos(angle), outerRadius * sin(angle), z));
+  }
+  lines->InsertCellPoint(points->InsertNextPoint(outerChannelPoint));
+  lines->InsertCellPoint(points->InsertNextPoint(innerChannelPoint));
+  for (int pointIndex=1; pointIndex<numberOfInnerPoints; ++pointIndex)
+  {
+    double angle = channelAngle - 2.0 * vtkMath::Pi() * pointIndex / numberOfInnerPoints;
+    lines->InsertCellPoint(points->InsertNextPoint(innerRadius * cos(angle), innerRadius * sin(angle), z));
+  }
+  lines->InsertCellPoint(points->InsertNextPoint(innerChannelPoint));
+  lines->InsertCellPoint(points->InsertNextPoint(outerChannelPoint));
+  for (int pointIndex=channelPointIndex+1; pointIndex<numberOfOuterPoints; ++pointIndex)
+  {
+    double angle = 2.0 * vtkMath::Pi() * pointIndex / numberOfOuterPoints;
+    lines->InsertCellPoint(points->InsertNextPoint(outerRadius * cos(angle), outerRadius * sin(angle), z));
+  }
+}
@@ -87,6 +87,11 @@ RULE(C, E, 4);
 RULE(D, E, 2);
 RULE(E, D, 1);
 
+// Disabled rule (infinite cost) and an expensive detour for the same conversion
+RULE(A, F, 10000000);
+RULE(A, G, 600000);
+RULE(G, F, 1);
+
 void PrintPath(const vtkSegmentationConverter::ConversionPathType& path)
 {
   for (vtkSegmentationConverter::ConversionPathType::const_iterator ruleIt = path.begin(); ruleIt != path.end(); ++ruleIt)
@@ -132,6 +137,9 @@ int vtkSegmentationConverterTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[]
   converterFactory->RegisterConverterRule(vtkSmartPointer<vtkRepCToRepERule>::New());
   converterFactory->RegisterConverterRule(vtkSmartPointer<vtkRepDToRepERule>::New());
   converterFactory->RegisterConverterRule(vtkSmartPointer<vtkRepEToRepDRule>::New());
+  converterFactory->RegisterConverterRule(vtkSmartPointer<vtkRepAToRepFRule>::New());
+  converterFactory->RegisterConverterRule(vtkSmartPointer<vtkRepAToRepGRule>::New());
+  converterFactory->RegisterConverterRule(vtkSmartPointer<vtkRepGToRepFRule>::New());
 
   vtkSmartPointer<vtkSegmentationConverter> converter = vtkSmartPointer<vtkSegmentationConverter>::New();
 
@@ -152,11 +160,16 @@ int vtkSegmentationConverterTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[]
   shortestPath = vtkSegmentationConverter::GetCheapestPath(pathsCosts);
   PrintPath(shortestPath);
   VERIFY_EQUAL("number of paths from representation A to E", shortestPath.size(), 3);
+  vtkSegmentationConverter::ConversionPathAndCostType cheapestPathCost;
+  VERIFY_EQUAL("cheapest path table entry from representation A to E", converter->GetCheapestConversionPath("RepA", "RepE", cheapestPathCost), true);
+  VERIFY_EQUAL("cost of cheapest path from representation A to E", cheapestPathCost.second, 7);
+  VERIFY_EQUAL("length of cheapest path from representation A to E", cheapestPathCost.first.size(), 3);
 
   // E->A paths: none
   std::cout << "Conversion from RepE to RepA" << std::endl;
   converter->GetPossibleConversions("RepE", "RepA", pathsCosts);
   VERIFY_EQUAL("number of paths from representation E to A", pathsCosts.size(), 0);
+  VERIFY_EQUAL("cheapest path table entry from representation E to A", converter->GetCheapestConversionPath("RepE", "RepA", cheapestPathCost), false);
   
   // B->D paths: BAD, BCD, BCED
   std::cout << "Conversion from RepB to RepD" << std::endl;
@@ -172,6 +185,8 @@ int vtkSegmentationConverterTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[]
   shortestPath = vtkSegmentationConverter::GetCheapestPath(pathsCosts);
   PrintPath(shortestPath);
   VERIFY_EQUAL("number of paths from representation B to D", shortestPath.size(), 2);
+  converter->GetCheapestConversionPath("RepB", "RepD", cheapestPathCost);
+  VERIFY_EQUAL("length of cheapest path from representation B to D", cheapestPathCost.first.size(), 2);
 
   // C->D paths: CD, CED
   std::cout << "Conversion from RepC to RepD" << std::endl;
@@ -187,6 +202,20 @@ int vtkSegmentationConverterTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[]
   shortestPath = vtkSegmentationConverter::GetCheapestPath(pathsCosts);
   PrintPath(shortestPath);
   VERIFY_EQUAL("number of paths from representation C to D", shortestPath.size(), 1);
+  converter->GetCheapestConversionPath("RepC", "RepD", cheapestPathCost);
+  VERIFY_EQUAL("length of cheapest path from representation C to D", cheapestPathCost.first.size(), 1);
+
+  // A->F paths: AF (disabled rule), AGF. The disabled rule must not be used even if the
+  // cost of the enabled path exceeds the infinite cost for a large number of segments.
+  std::cout << "Conversion from RepA to RepF" << std::endl;
+  converter->GetCheapestConversionPath("RepA", "RepF", cheapestPathCost);
+  VERIFY_EQUAL("length of cheapest path from representation A to F", cheapestPathCost.first.size(), 2);
+  std::vector<vtkDataObject*> sourceRepresentations(100, (vtkDataObject*)NULL);
+  VERIFY_EQUAL("cheapest path from representation A to F for many segments",
+    converter->GetCheapestConversionPath("RepA", "RepF", cheapestPathCost, &sourceRepresentations), true);
+  PrintPath(cheapestPathCost.first);
+  VERIFY_EQUAL("length of cheapest path from representation A to F for many segments", cheapestPathCost.first.size(), 2);
+  VERIFY_EQUAL("cost of cheapest path from representation A to F for many segments", cheapestPathCost.second, 60000100);
 
   std::cout << "Test passed." << std::endl;
   return EXIT_SUCCESS;
@@ -25,6 +25,11 @@
 #include <vtkSphereSource.h>
 #include <vtkMatrix4x4.h>
 #include <vtkImageAccumulate.h>
+#include <vtkCallbackCommand.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkUnsignedCharArray.h>
 
 // SegmentationCore includes
 #include "vtkSegmentation.h"
@@ -38,6 +43,19 @@
 
 void CreateSpherePolyData(vtkPolyData* polyData);
 void CreateCubeLabelmap(vtkOrientedImageData* imageData);
+void CountSegmentationEvents(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+void LoadDeferredLabelmap(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+bool MovePointAndCheckOriginal(vtkPolyData* copiedPolyData, vtkPolyData* originalPolyData, double originalPoint[3]);
+bool FlipVoxelAndCheckOriginal(vtkOrientedImageData* copiedLabelmap, vtkOrientedImageData* originalLabelmap);
+
+//----------------------------------------------------------------------------
+struct SegmentationEventCounts
+{
+  SegmentationEventCounts() : SegmentAdded(0), SegmentsBatchModified(0), LastBatchAddedSegments(0) { };
+  int SegmentAdded;
+  int SegmentsBatchModified;
+  int LastBatchAddedSegments;
+};
 
 //----------------------------------------------------------------------------
 int vtkSegmentationTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
@@ -79,6 +97,14 @@ int vtkSegmentationTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
     std::cerr << __LINE__ << ": Failed to add segment to segmentation!" << std::endl;
     return EXIT_FAILURE;
   }
+  double sphereBounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  sphereSegmentation->GetBounds(sphereBounds);
+  if ( fabs(sphereBounds[4]-20.0) > 0.001 || fabs(sphereBounds[5]-80.0) > 0.001
+    || sphereBounds[0] > 50.0 || sphereBounds[1] < 50.0 || sphereBounds[2] > 50.0 || sphereBounds[3] < 50.0 )
+  {
+    std::cerr << __LINE__ << ": Segmentation bounds do not match the bounds of the sphere!" << std::endl;
+    return EXIT_FAILURE;
+  }
 
   // Convert to binary labelmap without reference geometry
   sphereSegmentation->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
@@ -296,10 +322,326 @@ int vtkSegmentationTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
     return EXIT_FAILURE;
   }
 
+  //////////////////////////////////////////////////////////////////////////
+  // Copying segments and segmentations, editing the copy must not change the original
+
+  std::string closedSurfaceName(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
+  vtkPolyData* originalSurface = vtkPolyData::SafeDownCast(sphereSegment->GetRepresentation(closedSurfaceName));
+  double originalPoint[3] = {0.0,0.0,0.0};
+  originalSurface->GetPoint(0, originalPoint);
+
+  // Deep copy duplicates the representation data
+  vtkNew<vtkSegment> sphereSegmentCopy;
+  sphereSegmentCopy->DeepCopy(sphereSegment.GetPointer());
+  vtkPolyData* copiedSurface = vtkPolyData::SafeDownCast(sphereSegmentCopy->GetRepresentation(closedSurfaceName));
+  if ( !copiedSurface || originalSurface == copiedSurface || originalSurface->GetPoints() == copiedSurface->GetPoints()
+    || originalSurface->GetPoints()->GetData() == copiedSurface->GetPoints()->GetData()
+    || originalSurface->GetNumberOfPoints() != copiedSurface->GetNumberOfPoints() || originalSurface->GetNumberOfPolys() != copiedSurface->GetNumberOfPolys() )
+  {
+    std::cerr << __LINE__ << ": Representation data was not duplicated by deep copying the segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!MovePointAndCheckOriginal(copiedSurface, originalSurface, originalPoint))
+  {
+    std::cerr << __LINE__ << ": Editing deep copied segment changed the original segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Shallow copy shares the representation data until it is requested for writing (copy-on-write)
+  vtkNew<vtkSegment> sphereSegmentSharedCopy;
+  sphereSegmentSharedCopy->ShallowCopy(sphereSegment.GetPointer());
+  vtkPolyData* sharedSurface = vtkPolyData::SafeDownCast(sphereSegmentSharedCopy->GetRepresentation(closedSurfaceName));
+  if (!sharedSurface || originalSurface == sharedSurface || originalSurface->GetPoints() != sharedSurface->GetPoints())
+  {
+    std::cerr << __LINE__ << ": Shallow copied segment does not share representation data with the original!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  sharedSurface = vtkPolyData::SafeDownCast(sphereSegmentSharedCopy->GetWritableRepresentation(closedSurfaceName));
+  if ( originalSurface->GetPoints() == sharedSurface->GetPoints() || originalSurface->GetPolys() == sharedSurface->GetPolys()
+    || originalSurface->GetNumberOfPoints() != sharedSurface->GetNumberOfPoints() || originalSurface->GetNumberOfPolys() != sharedSurface->GetNumberOfPolys() )
+  {
+    std::cerr << __LINE__ << ": Representation data was not duplicated correctly when accessed for writing!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!MovePointAndCheckOriginal(sharedSurface, originalSurface, originalPoint))
+  {
+    std::cerr << __LINE__ << ": Editing shallow copied segment accessed for writing changed the original segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Deep copy of the whole segmentation
+  vtkNew<vtkSegmentation> sphereSegmentationCopy;
+  sphereSegmentationCopy->DeepCopy(sphereSegmentation.GetPointer());
+  vtkSegment* segmentInSegmentationCopy = sphereSegmentationCopy->GetSegment(sphereSegmentation->GetSegmentIdBySegment(sphereSegment.GetPointer()));
+  vtkPolyData* surfaceInSegmentationCopy = (segmentInSegmentationCopy ?
+    vtkPolyData::SafeDownCast(segmentInSegmentationCopy->GetRepresentation(closedSurfaceName)) : NULL);
+  if (!surfaceInSegmentationCopy || !MovePointAndCheckOriginal(surfaceInSegmentationCopy, originalSurface, originalPoint))
+  {
+    std::cerr << __LINE__ << ": Editing deep copied segmentation changed the original segmentation!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Shared copy of a segment from another segmentation, and shallow copy of the whole segmentation
+  std::string binaryLabelmapName(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+  vtkOrientedImageData* originalLabelmap = vtkOrientedImageData::SafeDownCast(
+    sphereSegmentation->GetSegmentRepresentation("cube", binaryLabelmapName) );
+  vtkNew<vtkSegmentation> cubeSegmentationSharedCopy;
+  cubeSegmentationSharedCopy->SetMasterRepresentationName(binaryLabelmapName.c_str());
+  vtkNew<vtkSegmentation> sphereSegmentationSharedCopy;
+  sphereSegmentationSharedCopy->ShallowCopy(sphereSegmentation.GetPointer());
+  if ( !originalLabelmap
+    || !cubeSegmentationSharedCopy->CopySegmentFromSegmentation(sphereSegmentation.GetPointer(), "cube", false, true)
+    || sphereSegmentation->GetNumberOfSegments() != 3 || sphereSegmentationSharedCopy->GetNumberOfSegments() != 3 )
+  {
+    std::cerr << __LINE__ << ": Failed to copy segments with shared representation data!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSegmentation* sharedCopies[2] = { cubeSegmentationSharedCopy.GetPointer(), sphereSegmentationSharedCopy.GetPointer() };
+  for (int copyIndex=0; copyIndex<2; ++copyIndex)
+  {
+    vtkOrientedImageData* sharedLabelmap = vtkOrientedImageData::SafeDownCast(
+      sharedCopies[copyIndex]->GetSegmentRepresentation("cube", binaryLabelmapName) );
+    if ( !sharedLabelmap || sharedLabelmap == originalLabelmap
+      || sharedLabelmap->GetPointData()->GetScalars() != originalLabelmap->GetPointData()->GetScalars() )
+    {
+      std::cerr << __LINE__ << ": Shared copy of segment does not share representation data with the original!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    sharedLabelmap = vtkOrientedImageData::SafeDownCast(
+      sharedCopies[copyIndex]->GetSegment("cube")->GetWritableRepresentation(binaryLabelmapName) );
+    if ( sharedLabelmap->GetPointData()->GetScalars() == originalLabelmap->GetPointData()->GetScalars()
+      || !FlipVoxelAndCheckOriginal(sharedLabelmap, originalLabelmap) )
+    {
+      std::cerr << __LINE__ << ": Editing shared copy of segment accessed for writing changed the original segment!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Eviction of derived representations when exceeding the memory budget
+
+  if (cubeSegmentation->GetRepresentationMemorySize(closedSurfaceName) == 0
+    || cubeSegmentation->GetRepresentationMemorySize() < cubeSegmentation->GetRepresentationMemorySize(closedSurfaceName)
+    || vtkSegmentation::GetTotalDerivedRepresentationMemorySize() < cubeSegmentation->GetRepresentationMemorySize() )
+  {
+    std::cerr << __LINE__ << ": Invalid memory usage of derived representations!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkTimeStamp evictionReadTime;
+  evictionReadTime.Modified();
+  vtkSegmentation::SetDerivedRepresentationMemoryBudget(1);
+  if ( !nonMasterSegment->IsRepresentationEvicted(closedSurfaceName)
+    || cubeSegmentation->GetRepresentationMemorySize(closedSurfaceName) != 0
+    || !cubeSegmentation->ContainsRepresentation(closedSurfaceName) )
+  {
+    std::cerr << __LINE__ << ": Derived representation was not evicted when exceeding the memory budget!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkNew<vtkSegment> evictedSegmentCopy;
+  evictedSegmentCopy->DeepCopy(nonMasterSegment.GetPointer());
+  if ( !evictedSegmentCopy->IsRepresentationEvicted(closedSurfaceName) || !evictedSegmentCopy->HasRepresentation(closedSurfaceName)
+    || !nonMasterSegment->IsRepresentationEvicted(closedSurfaceName) )
+  {
+    std::cerr << __LINE__ << ": Evicted representation was not copied with the segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkPolyData* regeneratedSurface = vtkPolyData::SafeDownCast(nonMasterSegment->GetRepresentation(closedSurfaceName));
+  if (!regeneratedSurface || regeneratedSurface->GetNumberOfPoints() == 0 || nonMasterSegment->IsRepresentationEvicted(closedSurfaceName))
+  {
+    std::cerr << __LINE__ << ": Failed to regenerate evicted representation!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (nonMasterSegment->GetModifiedSinceRead(evictionReadTime))
+  {
+    std::cerr << __LINE__ << ": Regenerating evicted representation made the segment modified since read!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Representation held by the caller must survive adding a segment, which converts and enforces the budget
+  vtkNew<vtkOrientedImageData> budgetCubeImageData;
+  CreateCubeLabelmap(budgetCubeImageData.GetPointer());
+  vtkNew<vtkSegment> budgetCubeSegment;
+  budgetCubeSegment->SetName("budget cube");
+  budgetCubeSegment->AddRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), budgetCubeImageData.GetPointer());
+  cubeSegmentation->AddSegment(budgetCubeSegment.GetPointer());
+  if ( nonMasterSegment->IsRepresentationEvicted(closedSurfaceName)
+    || nonMasterSegment->GetRepresentationObject(closedSurfaceName) != regeneratedSurface
+    || regeneratedSurface->GetNumberOfPoints() == 0 )
+  {
+    std::cerr << __LINE__ << ": Representation held by the caller was evicted when adding a segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( budgetCubeSegment->IsRepresentationEvicted(closedSurfaceName)
+    || !budgetCubeSegment->GetRepresentationObject(closedSurfaceName) )
+  {
+    std::cerr << __LINE__ << ": Representation created when adding a segment was evicted right away!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Representations not accessed since the previous call are evicted by the next one
+  vtkNew<vtkOrientedImageData> budgetCubeImageData2;
+  CreateCubeLabelmap(budgetCubeImageData2.GetPointer());
+  vtkNew<vtkSegment> budgetCubeSegment2;
+  budgetCubeSegment2->SetName("budget cube 2");
+  budgetCubeSegment2->AddRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), budgetCubeImageData2.GetPointer());
+  cubeSegmentation->AddSegment(budgetCubeSegment2.GetPointer());
+  if ( !nonMasterSegment->IsRepresentationEvicted(closedSurfaceName)
+    || !budgetCubeSegment->IsRepresentationEvicted(closedSurfaceName) )
+  {
+    std::cerr << __LINE__ << ": Representations not accessed since the previous conversion were not evicted!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSegmentation::SetDerivedRepresentationMemoryBudget(0);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Loading data of deferred representations on first request
+
+  std::string binaryLabelmapName(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+  vtkNew<vtkSegmentation> deferredSegmentation;
+  deferredSegmentation->SetMasterRepresentationName(binaryLabelmapName.c_str());
+  vtkNew<vtkOrientedImageData> deferredLabelmap;
+  deferredLabelmap->SetExtent(0,9,0,9,0,9);
+  int loadCount = 0;
+  vtkNew<vtkCallbackCommand> loaderCommand;
+  loaderCommand->SetClientData(&loadCount);
+  loaderCommand->SetCallback(LoadDeferredLabelmap);
+  vtkNew<vtkSegment> deferredSegment;
+  deferredSegment->AddObserver(vtkSegment::RepresentationDataRequestedEvent, loaderCommand.GetPointer());
+  deferredSegment->AddDeferredRepresentation(binaryLabelmapName, deferredLabelmap.GetPointer());
+  deferredSegmentation->AddSegment(deferredSegment.GetPointer(), "deferred");
+  vtkTimeStamp deferredReadTime;
+  deferredReadTime.Modified();
+  double deferredBounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  deferredSegmentation->GetBounds(deferredBounds);
+  if ( loadCount != 0 || !deferredSegment->IsRepresentationDeferred(binaryLabelmapName)
+    || deferredBounds[1] - deferredBounds[0] < 8.0 )
+  {
+    std::cerr << __LINE__ << ": Deferred representation was loaded before requested!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkOrientedImageData* loadedLabelmap = vtkOrientedImageData::SafeDownCast(deferredSegment->GetRepresentation(binaryLabelmapName));
+  deferredSegment->GetRepresentation(binaryLabelmapName);
+  if ( loadCount != 1 || loadedLabelmap != deferredLabelmap.GetPointer() || !loadedLabelmap->GetPointData()->GetScalars()
+    || deferredSegment->IsRepresentationDeferred(binaryLabelmapName) )
+  {
+    std::cerr << __LINE__ << ": Deferred representation was not loaded exactly once when requested!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (deferredSegment->GetModifiedSinceRead(deferredReadTime))
+  {
+    std::cerr << __LINE__ << ": Loading deferred representation made the segment modified since read!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  loadedLabelmap->GetPointData()->GetScalars()->SetComponent(0, 0, 0.0);
+  loadedLabelmap->GetPointData()->GetScalars()->Modified();
+  if (!deferredSegment->GetModifiedSinceRead(deferredReadTime))
+  {
+    std::cerr << __LINE__ << ": Modification of loaded deferred representation is not reported!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Collecting segment events in a batch of modifications
+
+  vtkNew<vtkSegmentation> batchSegmentation;
+  batchSegmentation->SetMasterRepresentationName(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
+  SegmentationEventCounts eventCounts;
+  vtkNew<vtkCallbackCommand> eventCounterCommand;
+  eventCounterCommand->SetClientData(&eventCounts);
+  eventCounterCommand->SetCallback(CountSegmentationEvents);
+  batchSegmentation->AddObserver(vtkSegmentation::SegmentAdded, eventCounterCommand.GetPointer());
+  batchSegmentation->AddObserver(vtkSegmentation::SegmentsBatchModified, eventCounterCommand.GetPointer());
+
+  batchSegmentation->StartBatch();
+  batchSegmentation->StartBatch();
+  for (int segmentIndex=0; segmentIndex<3; ++segmentIndex)
+  {
+    vtkNew<vtkSegment> batchSegment;
+    batchSegment->DeepCopy(sphereSegment.GetPointer());
+    batchSegmentation->AddSegment(batchSegment.GetPointer());
+  }
+  batchSegmentation->EndBatch();
+  if (eventCounts.SegmentsBatchModified != 0)
+  {
+    std::cerr << __LINE__ << ": Batch modified event invoked before the outermost batch ended!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> batchSegmentIds;
+  batchSegmentation->GetSegmentIDs(batchSegmentIds);
+  batchSegmentation->RemoveSegment(batchSegmentIds[0]);
+  batchSegmentation->EndBatch();
+  if (eventCounts.SegmentAdded != 0 || eventCounts.SegmentsBatchModified != 1 || eventCounts.LastBatchAddedSegments != 2)
+  {
+    std::cerr << __LINE__ << ": Segment events were not collected correctly in batch of modifications!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   std::cout << "Segmentation test passed." << std::endl;
   return EXIT_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void CountSegmentationEvents(vtkObject* vtkNotUsed(caller), unsigned long eid, void* clientData, void* callData)
+{
+  SegmentationEventCounts* eventCounts = reinterpret_cast<SegmentationEventCounts*>(clientData);
+  if (eid == vtkSegmentation::SegmentAdded)
+  {
+    ++eventCounts->SegmentAdded;
+  }
+  else if (eid == vtkSegmentation::SegmentsBatchModified)
+  {
+    vtkSegmentation::BatchModifiedEventData* batchModifiedData = reinterpret_cast<vtkSegmentation::BatchModifiedEventData*>(callData);
+    ++eventCounts->SegmentsBatchModified;
+    eventCounts->LastBatchAddedSegments = (int)batchModifiedData->AddedSegmentIDs.size();
+  }
+}
+
+//----------------------------------------------------------------------------
+void LoadDeferredLabelmap(vtkObject* caller, unsigned long vtkNotUsed(eid), void* clientData, void* callData)
+{
+  vtkSegment* segment = vtkSegment::SafeDownCast(caller);
+  int* loadCount = reinterpret_cast<int*>(clientData);
+  const char* representationName = reinterpret_cast<const char*>(callData);
+  vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(segment->GetRepresentationObject(representationName));
+  // Set voxels in place, as the labelmap is already observed by the segmentation.
+  // This updates the modified time of the labelmap, which the segment must not report as modification
+  vtkNew<vtkUnsignedCharArray> scalars;
+  scalars->SetNumberOfTuples(labelmap->GetNumberOfPoints());
+  scalars->FillComponent(0, 1.0);
+  labelmap->GetPointData()->SetScalars(scalars.GetPointer());
+  ++(*loadCount);
+}
+
+//----------------------------------------------------------------------------
+bool MovePointAndCheckOriginal(vtkPolyData* copiedPolyData, vtkPolyData* originalPolyData, double originalPoint[3])
+{
+  // Modify the first point of the copy in place
+  double movedPoint[3] = {0.0,0.0,0.0};
+  copiedPolyData->GetPoint(0, movedPoint);
+  movedPoint[0] += 100.0;
+  copiedPolyData->GetPoints()->SetPoint(0, movedPoint);
+  copiedPolyData->GetPoints()->Modified();
+
+  double pointAfterEdit[3] = {0.0,0.0,0.0};
+  originalPolyData->GetPoint(0, pointAfterEdit);
+  return vtkMath::Distance2BetweenPoints(originalPoint, pointAfterEdit) == 0.0;
+}
+
+//----------------------------------------------------------------------------
+bool FlipVoxelAndCheckOriginal(vtkOrientedImageData* copiedLabelmap, vtkOrientedImageData* originalLabelmap)
+{
+  // Modify the first voxel of the copy in place
+  int* extent = copiedLabelmap->GetExtent();
+  double originalValue = originalLabelmap->GetScalarComponentAsDouble(extent[0], extent[2], extent[4], 0);
+  copiedLabelmap->SetScalarComponentFromDouble(extent[0], extent[2], extent[4], 0, originalValue > 0.0 ? 0.0 : 1.0);
+  copiedLabelmap->GetPointData()->GetScalars()->Modified();
+
+  return copiedLabelmap->GetScalarComponentAsDouble(extent[0], extent[2], extent[4], 0) != originalValue
+    && originalLabelmap->GetScalarComponentAsDouble(extent[0], extent[2], extent[4], 0) == originalValue;
+}
+
 //----------------------------------------------------------------------------
 void CreateSpherePolyData(vtkPolyData* polyData)
 {
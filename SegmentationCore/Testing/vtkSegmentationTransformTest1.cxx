@@ -0,0 +1,306 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkMath.h>
+#include <vtkVersion.h>
+#include <vtkPolyData.h>
+#include <vtkPoints.h>
+#include <vtkSphereSource.h>
+#include <vtkThinPlateSplineTransform.h>
+
+// SegmentationCore includes
+#include "vtkSegmentation.h"
+#include "vtkSegment.h"
+#include "vtkSegmentationConverter.h"
+#include "vtkOrientedImageData.h"
+
+void CreateDeformingTransform(vtkThinPlateSplineTransform* transform);
+void CreateBoxLabelmap(vtkOrientedImageData* imageData);
+int CountDifferentVoxels(vtkOrientedImageData* image1, vtkOrientedImageData* image2, int& numberOfNonZeroVoxels);
+
+//----------------------------------------------------------------------------
+int vtkSegmentationTransformTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  std::string closedSurfaceName = vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName();
+  std::string binaryLabelmapName = vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName();
+
+  vtkNew<vtkThinPlateSplineTransform> transform;
+  CreateDeformingTransform(transform.GetPointer());
+
+  //////////////////////////////////////////////////////////////////////////
+  // Closed surface master: exact transform is the default, approximation
+  // by displacement grid stays within tolerance of the exact result
+
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetCenter(0.0, 0.0, 0.0);
+  sphere->SetRadius(20.0);
+  sphere->SetThetaResolution(30);
+  sphere->SetPhiResolution(30);
+  sphere->Update();
+  vtkNew<vtkPolyData> spherePolyData;
+  spherePolyData->DeepCopy(sphere->GetOutput());
+
+  vtkNew<vtkSegment> sphereSegment;
+  sphereSegment->SetName("sphere");
+  sphereSegment->AddRepresentation(closedSurfaceName, spherePolyData.GetPointer());
+  vtkNew<vtkSegmentation> surfaceSegmentation;
+  surfaceSegmentation->SetMasterRepresentationName(closedSurfaceName.c_str());
+  surfaceSegmentation->AddSegment(sphereSegment.GetPointer(), "sphere");
+  if (surfaceSegmentation->GetNonLinearTransformApproximation())
+  {
+    std::cerr << __LINE__ << ": Non-linear transform approximation must be disabled by default!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSegmentation> exactSurfaceSegmentation;
+  exactSurfaceSegmentation->DeepCopy(surfaceSegmentation.GetPointer());
+  exactSurfaceSegmentation->ApplyNonLinearTransform(transform.GetPointer());
+
+  vtkNew<vtkSegmentation> approximatedSurfaceSegmentation;
+  approximatedSurfaceSegmentation->DeepCopy(surfaceSegmentation.GetPointer());
+  approximatedSurfaceSegmentation->NonLinearTransformApproximationOn();
+  approximatedSurfaceSegmentation->ApplyNonLinearTransform(transform.GetPointer());
+
+  vtkPolyData* exactPolyData = vtkPolyData::SafeDownCast(
+    exactSurfaceSegmentation->GetSegment("sphere")->GetRepresentation(closedSurfaceName) );
+  vtkPolyData* approximatedPolyData = vtkPolyData::SafeDownCast(
+    approximatedSurfaceSegmentation->GetSegment("sphere")->GetRepresentation(closedSurfaceName) );
+  if ( !exactPolyData || !approximatedPolyData
+    || exactPolyData->GetNumberOfPoints() != spherePolyData->GetNumberOfPoints()
+    || approximatedPolyData->GetNumberOfPoints() != spherePolyData->GetNumberOfPoints() )
+  {
+    std::cerr << __LINE__ << ": Failed to transform closed surface!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const double surfaceTolerance = 0.1; // mm
+  double maximumDifference = 0.0;
+  for (vtkIdType pointId = 0; pointId < spherePolyData->GetNumberOfPoints(); ++pointId)
+  {
+    double originalPoint[3] = {0.0, 0.0, 0.0};
+    spherePolyData->GetPoint(pointId, originalPoint);
+    double expectedPoint[3] = {0.0, 0.0, 0.0};
+    transform->TransformPoint(originalPoint, expectedPoint);
+
+    // Default mode evaluates the original transform
+    double exactPoint[3] = {0.0, 0.0, 0.0};
+    exactPolyData->GetPoint(pointId, exactPoint);
+    if (sqrt(vtkMath::Distance2BetweenPoints(exactPoint, expectedPoint)) > 1e-6)
+    {
+      std::cerr << __LINE__ << ": Exact transform of point " << pointId << " does not match the input transform!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    double approximatedPoint[3] = {0.0, 0.0, 0.0};
+    approximatedPolyData->GetPoint(pointId, approximatedPoint);
+    maximumDifference = std::max(maximumDifference, sqrt(vtkMath::Distance2BetweenPoints(approximatedPoint, expectedPoint)));
+  }
+  if (maximumDifference > surfaceTolerance)
+  {
+    std::cerr << __LINE__ << ": Approximated transform of closed surface differs from exact transform by "
+      << maximumDifference << " mm (tolerance: " << surfaceTolerance << " mm)!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Maximum closed surface point difference of approximated transform: " << maximumDifference << " mm" << std::endl;
+
+  //////////////////////////////////////////////////////////////////////////
+  // Binary labelmap master: approximated and exact transform give the same
+  // labelmap except for a few voxels at the boundary of the segment
+
+  vtkNew<vtkOrientedImageData> boxImageData;
+  CreateBoxLabelmap(boxImageData.GetPointer());
+
+  vtkNew<vtkSegment> boxSegment;
+  boxSegment->SetName("box");
+  boxSegment->AddRepresentation(binaryLabelmapName, boxImageData.GetPointer());
+  vtkNew<vtkSegmentation> labelmapSegmentation;
+  labelmapSegmentation->SetMasterRepresentationName(binaryLabelmapName.c_str());
+  labelmapSegmentation->AddSegment(boxSegment.GetPointer(), "box");
+
+  vtkNew<vtkSegmentation> exactLabelmapSegmentation;
+  exactLabelmapSegmentation->DeepCopy(labelmapSegmentation.GetPointer());
+  exactLabelmapSegmentation->ApplyNonLinearTransform(transform.GetPointer());
+
+  vtkNew<vtkSegmentation> approximatedLabelmapSegmentation;
+  approximatedLabelmapSegmentation->DeepCopy(labelmapSegmentation.GetPointer());
+  approximatedLabelmapSegmentation->NonLinearTransformApproximationOn();
+  approximatedLabelmapSegmentation->ApplyNonLinearTransform(transform.GetPointer());
+
+  vtkOrientedImageData* exactImageData = vtkOrientedImageData::SafeDownCast(
+    exactLabelmapSegmentation->GetSegment("box")->GetRepresentation(binaryLabelmapName) );
+  vtkOrientedImageData* approximatedImageData = vtkOrientedImageData::SafeDownCast(
+    approximatedLabelmapSegmentation->GetSegment("box")->GetRepresentation(binaryLabelmapName) );
+  if (!exactImageData || !approximatedImageData)
+  {
+    std::cerr << __LINE__ << ": Failed to transform binary labelmap!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int numberOfNonZeroVoxels = 0;
+  int numberOfDifferentVoxels = CountDifferentVoxels(exactImageData, approximatedImageData, numberOfNonZeroVoxels);
+  if (numberOfNonZeroVoxels == 0)
+  {
+    std::cerr << __LINE__ << ": Exact transform of binary labelmap is empty!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // Nearest neighbor resampling may flip voxels whose centers are within the approximation error of the boundary
+  const double labelmapTolerance = 0.02;
+  if (numberOfDifferentVoxels < 0 || numberOfDifferentVoxels > labelmapTolerance * numberOfNonZeroVoxels)
+  {
+    std::cerr << __LINE__ << ": Approximated transform of binary labelmap differs from exact transform in "
+      << numberOfDifferentVoxels << " voxels out of " << numberOfNonZeroVoxels << " segment voxels!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Number of differing labelmap voxels of approximated transform: " << numberOfDifferentVoxels
+    << " (segment voxels: " << numberOfNonZeroVoxels << ")" << std::endl;
+
+  std::cout << "Segmentation transform test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void CreateDeformingTransform(vtkThinPlateSplineTransform* transform)
+{
+  if (!transform)
+  {
+    return;
+  }
+
+  // Corners of a cube containing the test segments are fixed, the center is displaced
+  vtkNew<vtkPoints> sourceLandmarks;
+  vtkNew<vtkPoints> targetLandmarks;
+  for (int i=0; i<8; ++i)
+  {
+    double corner[3] = { (i & 1) ? 40.0 : -40.0, (i & 2) ? 40.0 : -40.0, (i & 4) ? 40.0 : -40.0 };
+    sourceLandmarks->InsertNextPoint(corner);
+    targetLandmarks->InsertNextPoint(corner);
+  }
+  sourceLandmarks->InsertNextPoint(0.0, 0.0, 0.0);
+  targetLandmarks->InsertNextPoint(4.0, 3.0, -2.0);
+  sourceLandmarks->InsertNextPoint(15.0, -10.0, 5.0);
+  targetLandmarks->InsertNextPoint(17.0, -12.0, 5.0);
+
+  transform->SetBasisToR();
+  transform->SetSourceLandmarks(sourceLandmarks.GetPointer());
+  transform->SetTargetLandmarks(targetLandmarks.GetPointer());
+  transform->Update();
+}
+
+//----------------------------------------------------------------------------
+void CreateBoxLabelmap(vtkOrientedImageData* imageData)
+{
+  if (!imageData)
+  {
+    return;
+  }
+
+  imageData->SetExtent(0, 39, 0, 39, 0, 39);
+  imageData->SetOrigin(-20.0, -20.0, -20.0);
+  imageData->SetSpacing(1.0, 1.0, 1.0);
+#if (VTK_MAJOR_VERSION <= 5)
+  imageData->SetScalarType(VTK_UNSIGNED_CHAR);
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+#else
+  imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+
+  for (int k=0; k<40; ++k)
+  {
+    for (int j=0; j<40; ++j)
+    {
+      for (int i=0; i<40; ++i)
+      {
+        unsigned char* voxelPtr = static_cast<unsigned char*>(imageData->GetScalarPointer(i, j, k));
+        (*voxelPtr) = (i>=10 && i<30 && j>=8 && j<32 && k>=12 && k<28) ? 1 : 0;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int CountDifferentVoxels(vtkOrientedImageData* image1, vtkOrientedImageData* image2, int& numberOfNonZeroVoxels)
+{
+  numberOfNonZeroVoxels = 0;
+  if (!image1 || !image2)
+  {
+    return -1;
+  }
+  // Both transform modes keep the geometry of the labelmap, only the extent may differ
+  double spacing1[3] = {0.0, 0.0, 0.0};
+  double spacing2[3] = {0.0, 0.0, 0.0};
+  image1->GetSpacing(spacing1);
+  image2->GetSpacing(spacing2);
+  double origin1[3] = {0.0, 0.0, 0.0};
+  double origin2[3] = {0.0, 0.0, 0.0};
+  image1->GetOrigin(origin1);
+  image2->GetOrigin(origin2);
+  for (int axis=0; axis<3; ++axis)
+  {
+    if (fabs(spacing1[axis]-spacing2[axis]) > 1e-6 || fabs(origin1[axis]-origin2[axis]) > 1e-6)
+    {
+      return -1;
+    }
+  }
+
+  int extent1[6] = {0, -1, 0, -1, 0, -1};
+  int extent2[6] = {0, -1, 0, -1, 0, -1};
+  image1->GetExtent(extent1);
+  image2->GetExtent(extent2);
+  int unionExtent[6] = {0, -1, 0, -1, 0, -1};
+  for (int axis=0; axis<3; ++axis)
+  {
+    unionExtent[2*axis] = std::min(extent1[2*axis], extent2[2*axis]);
+    unionExtent[2*axis+1] = std::max(extent1[2*axis+1], extent2[2*axis+1]);
+  }
+
+  int numberOfDifferentVoxels = 0;
+  for (int k=unionExtent[4]; k<=unionExtent[5]; ++k)
+  {
+    for (int j=unionExtent[2]; j<=unionExtent[3]; ++j)
+    {
+      for (int i=unionExtent[0]; i<=unionExtent[1]; ++i)
+      {
+        double value1 = 0.0;
+        if ( i>=extent1[0] && i<=extent1[1] && j>=extent1[2] && j<=extent1[3] && k>=extent1[4] && k<=extent1[5] )
+        {
+          value1 = image1->GetScalarComponentAsDouble(i, j, k, 0);
+        }
+        double value2 = 0.0;
+        if ( i>=extent2[0] && i<=extent2[1] && j>=extent2[2] && j<=extent2[3] && k>=extent2[4] && k<=extent2[5] )
+        {
+          value2 = image2->GetScalarComponentAsDouble(i, j, k, 0);
+        }
+        if (value1 != 0.0)
+        {
+          ++numberOfNonZeroVoxels;
+        }
+        if (value1 != value2)
+        {
+          ++numberOfDifferentVoxels;
+        }
+      }
+    }
+  }
+  return numberOfDifferentVoxels;
+}
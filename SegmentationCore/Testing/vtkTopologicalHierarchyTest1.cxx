@@ -0,0 +1,234 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataCollection.h>
+#include <vtkCubeSource.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+
+// SegmentationCore includes
+#include "vtkTopologicalHierarchy.h"
+
+// STD includes
+#include <vector>
+
+void CreateBoxPolyData(vtkPolyData* polyData, double center[3], double size[3]);
+bool ContainsPairwise(vtkPolyData* polyOut, vtkPolyData* polyIn, double constraintFactor);
+void ComputeLevelsPairwise(vtkPolyDataCollection* polyDataCollection, double constraintFactor, int maximumLevel, std::vector<int>& levels);
+bool DoLevelsMatch(vtkIntArray* levels, const std::vector<int>& expectedLevels);
+
+//----------------------------------------------------------------------------
+int vtkTopologicalHierarchyTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Maximum level assigned by vtkTopologicalHierarchy
+  const int maximumLevel = 7;
+
+  // Nested boxes, randomly placed boxes, and an empty poly data
+  vtkNew<vtkPolyDataCollection> polyDataCollection;
+  std::vector<vtkSmartPointer<vtkPolyData> > polyDataList;
+  for (int nestedIndex=0; nestedIndex<10; ++nestedIndex)
+  {
+    vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+    double center[3] = {50.0, 50.0, 50.0};
+    double size[3] = {10.0 + nestedIndex*8.0, 12.0 + nestedIndex*8.0, 9.0 + nestedIndex*8.0};
+    CreateBoxPolyData(polyData, center, size);
+    polyDataList.push_back(polyData);
+  }
+  vtkMath::RandomSeed(1234);
+  for (int randomIndex=0; randomIndex<60; ++randomIndex)
+  {
+    vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+    double center[3] = {vtkMath::Random(0.0, 200.0), vtkMath::Random(0.0, 200.0), vtkMath::Random(0.0, 200.0)};
+    double size[3] = {vtkMath::Random(1.0, 80.0), vtkMath::Random(1.0, 80.0), vtkMath::Random(1.0, 80.0)};
+    CreateBoxPolyData(polyData, center, size);
+    polyDataList.push_back(polyData);
+  }
+  polyDataList.push_back(vtkSmartPointer<vtkPolyData>::New());
+  for (unsigned int polyDataIndex=0; polyDataIndex<polyDataList.size(); ++polyDataIndex)
+  {
+    polyDataCollection->AddItem(polyDataList[polyDataIndex]);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Levels must match the pairwise comparison of all poly data
+
+  vtkNew<vtkTopologicalHierarchy> topologicalHierarchy;
+  topologicalHierarchy->SetInputPolyDataCollection(polyDataCollection.GetPointer());
+  double constraintFactors[3] = {0.0, 0.05, -0.1};
+  for (int factorIndex=0; factorIndex<3; ++factorIndex)
+  {
+    topologicalHierarchy->SetContainConstraintFactor(constraintFactors[factorIndex]);
+    topologicalHierarchy->Update();
+    std::vector<int> expectedLevels;
+    ComputeLevelsPairwise(polyDataCollection.GetPointer(), constraintFactors[factorIndex], maximumLevel, expectedLevels);
+    if (!DoLevelsMatch(topologicalHierarchy->GetOutputLevels(), expectedLevels))
+    {
+      std::cerr << __LINE__ << ": Topological hierarchy levels differ from pairwise comparison with constraint factor "
+        << constraintFactors[factorIndex] << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Cached levels must be updated when the inputs change
+
+  // Unchanged inputs
+  std::vector<int> expectedLevels;
+  ComputeLevelsPairwise(polyDataCollection.GetPointer(), topologicalHierarchy->GetContainConstraintFactor(), maximumLevel, expectedLevels);
+  topologicalHierarchy->Update();
+  if (!DoLevelsMatch(topologicalHierarchy->GetOutputLevels(), expectedLevels))
+  {
+    std::cerr << __LINE__ << ": Cached topological hierarchy levels are invalid!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Moving the innermost nested box out of the others
+  double movedCenter[3] = {150.0, 150.0, 150.0};
+  double movedSize[3] = {10.0, 12.0, 9.0};
+  CreateBoxPolyData(polyDataList[0], movedCenter, movedSize);
+  topologicalHierarchy->Update();
+  ComputeLevelsPairwise(polyDataCollection.GetPointer(), topologicalHierarchy->GetContainConstraintFactor(), maximumLevel, expectedLevels);
+  if (!DoLevelsMatch(topologicalHierarchy->GetOutputLevels(), expectedLevels))
+  {
+    std::cerr << __LINE__ << ": Topological hierarchy levels were not updated after modifying an input poly data!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Removing a poly data from the collection
+  polyDataCollection->RemoveItem(3);
+  topologicalHierarchy->Update();
+  ComputeLevelsPairwise(polyDataCollection.GetPointer(), topologicalHierarchy->GetContainConstraintFactor(), maximumLevel, expectedLevels);
+  if (!DoLevelsMatch(topologicalHierarchy->GetOutputLevels(), expectedLevels))
+  {
+    std::cerr << __LINE__ << ": Topological hierarchy levels were not updated after removing an input poly data!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Topological hierarchy test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void CreateBoxPolyData(vtkPolyData* polyData, double center[3], double size[3])
+{
+  vtkNew<vtkCubeSource> cube;
+  cube->SetCenter(center);
+  cube->SetXLength(size[0]);
+  cube->SetYLength(size[1]);
+  cube->SetZLength(size[2]);
+  cube->Update();
+  polyData->DeepCopy(cube->GetOutput());
+}
+
+//----------------------------------------------------------------------------
+bool ContainsPairwise(vtkPolyData* polyOut, vtkPolyData* polyIn, double constraintFactor)
+{
+  double extentOut[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  polyOut->GetBounds(extentOut);
+  double extentIn[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  polyIn->GetBounds(extentIn);
+
+  return ( extentOut[0] < extentIn[0] - constraintFactor * (extentOut[1]-extentOut[0])
+    && extentOut[1] > extentIn[1] + constraintFactor * (extentOut[1]-extentOut[0])
+    && extentOut[2] < extentIn[2] - constraintFactor * (extentOut[3]-extentOut[2])
+    && extentOut[3] > extentIn[3] + constraintFactor * (extentOut[3]-extentOut[2])
+    && extentOut[4] < extentIn[4] - constraintFactor * (extentOut[5]-extentOut[4])
+    && extentOut[5] > extentIn[5] + constraintFactor * (extentOut[5]-extentOut[4]) );
+}
+
+//----------------------------------------------------------------------------
+void ComputeLevelsPairwise(vtkPolyDataCollection* polyDataCollection, double constraintFactor, int maximumLevel, std::vector<int>& levels)
+{
+  // Same algorithm as vtkTopologicalHierarchy, comparing every poly data with every other one
+  int numberOfPolyData = polyDataCollection->GetNumberOfItems();
+  std::vector<std::vector<int> > containedPolyData(numberOfPolyData);
+  levels.assign(numberOfPolyData, -1);
+  for (int polyOutIndex=0; polyOutIndex<numberOfPolyData; ++polyOutIndex)
+  {
+    vtkPolyData* polyOut = vtkPolyData::SafeDownCast(polyDataCollection->GetItemAsObject(polyOutIndex));
+    for (int polyInIndex=0; polyInIndex<numberOfPolyData; ++polyInIndex)
+    {
+      vtkPolyData* polyIn = vtkPolyData::SafeDownCast(polyDataCollection->GetItemAsObject(polyInIndex));
+      if (polyOutIndex != polyInIndex && ContainsPairwise(polyOut, polyIn, constraintFactor))
+      {
+        containedPolyData[polyOutIndex].push_back(polyInIndex);
+      }
+    }
+    if (containedPolyData[polyOutIndex].empty())
+    {
+      levels[polyOutIndex] = 0;
+    }
+  }
+
+  // Assign one level higher than the highest contained level, in increasing order of levels
+  for (int currentLevel=1; currentLevel<maximumLevel; ++currentLevel)
+  {
+    std::vector<int> levelsSnapshot(levels);
+    for (int polyOutIndex=0; polyOutIndex<numberOfPolyData; ++polyOutIndex)
+    {
+      if (levels[polyOutIndex] > -1)
+      {
+        continue;
+      }
+      bool allContainedHaveLevel = true;
+      for (unsigned int containedIndex=0; containedIndex<containedPolyData[polyOutIndex].size(); ++containedIndex)
+      {
+        if (levelsSnapshot[containedPolyData[polyOutIndex][containedIndex]] == -1)
+        {
+          allContainedHaveLevel = false;
+          break;
+        }
+      }
+      if (allContainedHaveLevel)
+      {
+        levels[polyOutIndex] = currentLevel;
+      }
+    }
+  }
+  for (int polyOutIndex=0; polyOutIndex<numberOfPolyData; ++polyOutIndex)
+  {
+    if (levels[polyOutIndex] == -1)
+    {
+      levels[polyOutIndex] = maximumLevel;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool DoLevelsMatch(vtkIntArray* levels, const std::vector<int>& expectedLevels)
+{
+  if (!levels || levels->GetNumberOfTuples() != (vtkIdType)expectedLevels.size())
+  {
+    return false;
+  }
+  for (unsigned int index=0; index<expectedLevels.size(); ++index)
+  {
+    if (levels->GetValue(index) != expectedLevels[index])
+    {
+      return false;
+    }
+  }
+  return true;
+}
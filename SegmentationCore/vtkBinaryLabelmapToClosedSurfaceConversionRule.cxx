@@ -22,17 +22,147 @@
 #include "vtkBinaryLabelmapToClosedSurfaceConversionRule.h"
 
 #include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
 
 // VTK includes
 #include <vtkObjectFactory.h>
 #include <vtkPolyData.h>
 #include <vtkVersion.h>
 #include <vtkMarchingCubes.h>
+#include <vtkDiscreteMarchingCubes.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkPoints.h>
 #include <vtkDecimatePro.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkImageConstantPad.h>
 #include <vtkImageChangeInformation.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkAppendPolyData.h>
+#include <vtkCleanPolyData.h>
+#include <vtkQuadricClustering.h>
+#include <vtkMultiThreader.h>
+#include <vtkTimerLog.h>
+#include <vtkMath.h>
+
+// STD includes
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Minimum number of slices in a slab processed by one thread. Thinner slabs are not worth the merge overhead
+  static const int MINIMUM_SLAB_THICKNESS = 8;
+
+  /// Shared data of the slab surface extraction threads.
+  /// Each thread only accesses its own slab image and surface.
+  struct SlabExtractionData
+  {
+    std::vector< vtkSmartPointer<vtkImageData> > SlabImages;
+    std::vector< vtkSmartPointer<vtkPolyData> > SlabSurfaces;
+    std::vector<bool> SlabSuccess;
+  };
+
+  /// Maximum label value in the merged image used by the multi-label extraction
+  static const int MAXIMUM_MERGED_LABEL = VTK_UNSIGNED_SHORT_MAX;
+
+  //----------------------------------------------------------------------------
+  /// Paint the non-zero voxels of a labelmap into the merged image with the given label.
+  /// The merged image must have the same geometry and contain the extent of the labelmap.
+  /// \return True if the labelmap overlaps with a label that has already been painted
+  template <class T>
+  bool PaintLabelTemplate(vtkImageData* labelmap, T* labelmapPtr, vtkImageData* mergedImage, unsigned short label)
+  {
+    int extent[6] = {0,-1,0,-1,0,-1};
+    labelmap->GetExtent(extent);
+    bool overlap = false;
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        unsigned short* mergedPtr = static_cast<unsigned short*>(mergedImage->GetScalarPointer(extent[0], j, k));
+        for (int i=extent[0]; i<=extent[1]; ++i, ++labelmapPtr, ++mergedPtr)
+        {
+          if (*labelmapPtr == 0)
+          {
+            continue;
+          }
+          if (*mergedPtr != 0)
+          {
+            overlap = true;
+          }
+          else
+          {
+            *mergedPtr = label;
+          }
+        }
+      }
+    }
+    return overlap;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Reset voxels of a label to background within an extent of the merged image
+  void ErasePaintedLabel(vtkImageData* mergedImage, int extent[6], unsigned short label)
+  {
+    for (int k=extent[4]; k<=extent[5]; ++k)
+    {
+      for (int j=extent[2]; j<=extent[3]; ++j)
+      {
+        unsigned short* mergedPtr = static_cast<unsigned short*>(mergedImage->GetScalarPointer(extent[0], j, k));
+        for (int i=extent[0]; i<=extent[1]; ++i, ++mergedPtr)
+        {
+          if (*mergedPtr == label)
+          {
+            *mergedPtr = 0;
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE ExtractSlabSurfaceThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    SlabExtractionData* data = static_cast<SlabExtractionData*>(threadInfo->UserData);
+    int slabIndex = threadInfo->ThreadID;
+    if (!data || slabIndex >= (int)data->SlabImages.size())
+    {
+      return VTK_THREAD_RETURN_VALUE;
+    }
+
+    vtkSmartPointer<vtkMarchingCubes> marchingCubes = vtkSmartPointer<vtkMarchingCubes>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+    marchingCubes->SetInput(data->SlabImages[slabIndex]);
+#else
+    marchingCubes->SetInputData(data->SlabImages[slabIndex]);
+#endif
+    marchingCubes->SetNumberOfContours(1);
+    marchingCubes->SetValue(0, 0.5);
+    marchingCubes->ComputeScalarsOff();
+    marchingCubes->ComputeGradientsOff();
+    marchingCubes->ComputeNormalsOff();
+    try
+    {
+      marchingCubes->Update();
+    }
+    catch(...)
+    {
+      data->SlabSuccess[slabIndex] = false;
+      return VTK_THREAD_RETURN_VALUE;
+    }
+
+    data->SlabSurfaces[slabIndex]->ShallowCopy(marchingCubes->GetOutput());
+    data->SlabSuccess[slabIndex] = true;
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
 
 //----------------------------------------------------------------------------
 vtkSegmentationConverterRuleNewMacro(vtkBinaryLabelmapToClosedSurfaceConversionRule);
@@ -41,6 +171,12 @@ vtkSegmentationConverterRuleNewMacro(vtkBinaryLabelmapToClosedSurfaceConversionR
 vtkBinaryLabelmapToClosedSurfaceConversionRule::vtkBinaryLabelmapToClosedSurfaceConversionRule()
 {
   this->ConversionParameters[GetDecimationFactorParameterName()] = std::make_pair("0.0", "Desired reduction in the total number of polygons (e.g., if set to 0.9, then reduce the data set to 10% of its original size)");
+  this->ConversionParameters[GetExtractionMethodParameterName()] = std::make_pair(GetMarchingCubesExtractionMethodName(), "Surface extraction algorithm. Possible values: \"Marching cubes\", \"Parallel marching cubes\" (runs on slabs of the labelmap in multiple threads), or \"Multi-label marching cubes\" (creates the surfaces of all non-overlapping segments with the same geometry in one pass)");
+  this->ConversionParameters[GetDecimationMethodParameterName()] = std::make_pair(GetDecimateProDecimationMethodName(), "Decimation algorithm used if decimation factor is non-zero. Possible values: \"Decimate pro\" (topology preserving) or \"Quadric clustering\" (much faster, but may change topology)");
+
+  this->LastExtractionTime = 0.0;
+  this->LastDecimationTime = 0.0;
+  this->LastTransformTime = 0.0;
 }
 
 //----------------------------------------------------------------------------
@@ -51,8 +187,8 @@ vtkBinaryLabelmapToClosedSurfaceConversionRule::~vtkBinaryLabelmapToClosedSurfac
 //----------------------------------------------------------------------------
 unsigned int vtkBinaryLabelmapToClosedSurfaceConversionRule::GetConversionCost(vtkDataObject* sourceRepresentation/*=NULL*/, vtkDataObject* targetRepresentation/*=NULL*/)
 {
-  // Rough input-independent guess (ms)
-  return 500;
+  // Rough input-independent guess (ms) until conversion times are measured
+  return this->EstimateConversionCost(sourceRepresentation, 500);
 }
 
 //----------------------------------------------------------------------------
@@ -117,8 +253,8 @@ bool vtkBinaryLabelmapToClosedSurfaceConversionRule::Convert(vtkDataObject* sour
   }
 
   // Get conversion parameters
-  double decimationFactor = vtkSegmentationConverter::DeserializeFloatingPointConversionParameter(
-    this->ConversionParameters[GetDecimationFactorParameterName()].first );
+  double decimationFactor = 0.0;
+  this->GetConversionParameterAsDouble(GetDecimationFactorParameterName(), decimationFactor);
 
   // Save geometry of oriented image data before conversion so that it can be applied on the poly data afterwards
   vtkSmartPointer<vtkMatrix4x4> labelmapImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
@@ -132,16 +268,236 @@ bool vtkBinaryLabelmapToClosedSurfaceConversionRule::Convert(vtkDataObject* sour
   identityMatrix->Identity();
   binaryLabelmapWithIdentityGeometry->SetGeometryFromImageToWorldMatrix(identityMatrix);
 
+  bool parallelExtraction = !this->ConversionParameters[GetExtractionMethodParameterName()].first.compare(
+    GetParallelMarchingCubesExtractionMethodName() );
+  std::string decimationMethod = this->ConversionParameters[GetDecimationMethodParameterName()].first;
+
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+
   // Run marching cubes
-  vtkSmartPointer<vtkMarchingCubes> marchingCubes = vtkSmartPointer<vtkMarchingCubes>::New();
+  vtkSmartPointer<vtkPolyData> extractedSurface = vtkSmartPointer<vtkPolyData>::New();
+  bool extractionSuccess = this->ExtractSurface(binaryLabelmapWithIdentityGeometry, extractedSurface, parallelExtraction);
+  double checkpointExtracted = timer->GetUniversalTime();
+  this->LastExtractionTime = checkpointExtracted - checkpointStart;
+  if (!extractionSuccess)
+  {
+    if (paddingNecessary)
+    {
+      binaryLabelMap->Delete();
+    }
+    return false;
+  }
+
+  // Decimate if necessary
+  vtkSmartPointer<vtkPolyData> decimatedSurface = extractedSurface;
+  if (decimationFactor > 0.0)
+  {
+    decimatedSurface = vtkSmartPointer<vtkPolyData>::New();
+    if (!this->DecimateSurface(extractedSurface, decimatedSurface, decimationFactor, decimationMethod))
+    {
+      if (paddingNecessary)
+      {
+        binaryLabelMap->Delete();
+      }
+      return false;
+    }
+  }
+  double checkpointDecimated = timer->GetUniversalTime();
+  this->LastDecimationTime = checkpointDecimated - checkpointExtracted;
+
+  // Transform the result surface from labelmap IJK to world coordinate system
+  vtkSmartPointer<vtkTransform> labelmapGeometryTransform = vtkSmartPointer<vtkTransform>::New();
+  labelmapGeometryTransform->SetMatrix(labelmapImageToWorldMatrix);
+
+  vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyDataFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
 #if (VTK_MAJOR_VERSION <= 5)
-  marchingCubes->SetInput(binaryLabelmapWithIdentityGeometry);
+  transformPolyDataFilter->SetInput(decimatedSurface);
 #else
-  marchingCubes->SetInputData(binaryLabelmapWithIdentityGeometry);
+  transformPolyDataFilter->SetInputData(decimatedSurface);
 #endif
-  marchingCubes->SetNumberOfContours(1);
-  marchingCubes->SetValue(0, 0.5); //TODO: In the vtkLabelmapToModelFilter class this is LabelValue/2.0. If we know why, it would make sense to explain it here.
-  marchingCubes->ComputeScalarsOff();
+  transformPolyDataFilter->SetTransform(labelmapGeometryTransform);
+  transformPolyDataFilter->Update();
+
+  // Set output
+  closedSurfacePolyData->ShallowCopy(transformPolyDataFilter->GetOutput());
+
+  double checkpointEnd = timer->GetUniversalTime();
+  this->LastTransformTime = checkpointEnd - checkpointDecimated;
+  vtkDebugMacro("Convert: Extraction: " << this->LastExtractionTime << " s, decimation: " << this->LastDecimationTime
+    << " s, transform: " << this->LastTransformTime << " s (" << closedSurfacePolyData->GetNumberOfPolys() << " polygons)");
+
+  // Delete temporary padded labelmap if it was created
+  if (paddingNecessary)
+  {
+    binaryLabelMap->Delete();
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapToClosedSurfaceConversionRule::ConvertMultiple(std::vector<vtkDataObject*>& sourceRepresentations, std::vector<vtkDataObject*>& targetRepresentations)
+{
+  if ( this->ConversionParameters[GetExtractionMethodParameterName()].first.compare(GetMultiLabelMarchingCubesExtractionMethodName())
+    || sourceRepresentations.size() < 2 )
+  {
+    return Superclass::ConvertMultiple(sourceRepresentations, targetRepresentations);
+  }
+  if (sourceRepresentations.size() != targetRepresentations.size())
+  {
+    vtkErrorMacro("ConvertMultiple: Number of source and target representations differ!");
+    return false;
+  }
+
+  // Group the labelmaps that share the same geometry and convert each group in one pass
+  unsigned int numberOfSegments = sourceRepresentations.size();
+  std::vector<bool> converted(numberOfSegments, false);
+  for (unsigned int index=0; index<numberOfSegments; ++index)
+  {
+    vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(sourceRepresentations[index]);
+    vtkPolyData* surface = vtkPolyData::SafeDownCast(targetRepresentations[index]);
+    if (converted[index] || !labelmap || !surface)
+    {
+      continue;
+    }
+
+    std::vector<unsigned int> groupIndices;
+    std::vector<vtkOrientedImageData*> groupLabelmaps;
+    std::vector<vtkPolyData*> groupSurfaces;
+    for (unsigned int otherIndex=index; otherIndex<numberOfSegments; ++otherIndex)
+    {
+      vtkOrientedImageData* otherLabelmap = vtkOrientedImageData::SafeDownCast(sourceRepresentations[otherIndex]);
+      vtkPolyData* otherSurface = vtkPolyData::SafeDownCast(targetRepresentations[otherIndex]);
+      if ( converted[otherIndex] || !otherLabelmap || !otherSurface
+        || !vtkOrientedImageDataResample::DoGeometriesMatch(labelmap, otherLabelmap) )
+      {
+        continue;
+      }
+      groupIndices.push_back(otherIndex);
+      groupLabelmaps.push_back(otherLabelmap);
+      groupSurfaces.push_back(otherSurface);
+    }
+    if (groupIndices.size() < 2)
+    {
+      continue;
+    }
+
+    std::vector<bool> groupConverted(groupIndices.size(), false);
+    this->ConvertMultiLabel(groupLabelmaps, groupSurfaces, groupConverted);
+    for (unsigned int groupIndex=0; groupIndex<groupIndices.size(); ++groupIndex)
+    {
+      converted[groupIndices[groupIndex]] = groupConverted[groupIndex];
+    }
+  }
+
+  // Convert the remaining segments individually
+  bool success = true;
+  for (unsigned int index=0; index<numberOfSegments; ++index)
+  {
+    if (!converted[index] && !this->Convert(sourceRepresentations[index], targetRepresentations[index]))
+    {
+      success = false;
+    }
+  }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkBinaryLabelmapToClosedSurfaceConversionRule::ConvertMultiLabel(std::vector<vtkOrientedImageData*>& labelmaps, std::vector<vtkPolyData*>& surfaces, std::vector<bool>& converted)
+{
+  if (labelmaps.empty() || labelmaps.size() != surfaces.size() || labelmaps.size() != converted.size())
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+
+  // Determine union extent of the non-empty labelmaps, padded by one voxel so that the surfaces are closed
+  int mergedExtent[6] = {VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN};
+  for (unsigned int index=0; index<labelmaps.size(); ++index)
+  {
+    int extent[6] = {0,-1,0,-1,0,-1};
+    labelmaps[index]->GetExtent(extent);
+    if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+    {
+      continue;
+    }
+    for (int axis=0; axis<3; ++axis)
+    {
+      mergedExtent[axis*2] = std::min(mergedExtent[axis*2], extent[axis*2] - 1);
+      mergedExtent[axis*2+1] = std::max(mergedExtent[axis*2+1], extent[axis*2+1] + 1);
+    }
+  }
+  if (mergedExtent[0] > mergedExtent[1])
+  {
+    // All labelmaps are empty
+    return;
+  }
+
+  // Create merged label image in IJK coordinate system of the common geometry
+  vtkSmartPointer<vtkImageData> mergedImage = vtkSmartPointer<vtkImageData>::New();
+  mergedImage->SetExtent(mergedExtent);
+#if (VTK_MAJOR_VERSION <= 5)
+  mergedImage->SetWholeExtent(mergedExtent);
+  mergedImage->SetScalarType(VTK_UNSIGNED_SHORT);
+  mergedImage->SetNumberOfScalarComponents(1);
+  mergedImage->AllocateScalars();
+#else
+  mergedImage->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+#endif
+  memset(mergedImage->GetScalarPointer(), 0, mergedImage->GetNumberOfPoints() * sizeof(unsigned short));
+
+  // Paint labelmaps into the merged image. Label value is the index in the group plus one.
+  // Labelmaps overlapping with a previously painted one cannot be represented in the merged image,
+  // so they are erased and left for individual conversion.
+  std::vector<int> paintedIndices;
+  for (unsigned int index=0; index<labelmaps.size() && (int)index<MAXIMUM_MERGED_LABEL; ++index)
+  {
+    vtkOrientedImageData* labelmap = labelmaps[index];
+    int extent[6] = {0,-1,0,-1,0,-1};
+    labelmap->GetExtent(extent);
+    if ( extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5]
+      || labelmap->GetNumberOfScalarComponents() != 1 )
+    {
+      continue;
+    }
+
+    unsigned short label = (unsigned short)(index + 1);
+    bool overlap = false;
+    switch (labelmap->GetScalarType())
+    {
+      vtkTemplateMacro(overlap = PaintLabelTemplate(labelmap, static_cast<VTK_TT*>(labelmap->GetScalarPointer()), mergedImage, label));
+      default:
+        vtkErrorMacro("ConvertMultiLabel: Unknown image scalar type!");
+        continue;
+    }
+    if (overlap)
+    {
+      ErasePaintedLabel(mergedImage, extent, label);
+      continue;
+    }
+    paintedIndices.push_back(index);
+  }
+  if (paintedIndices.empty())
+  {
+    return;
+  }
+
+  // Run discrete marching cubes for all painted labels at once
+  vtkSmartPointer<vtkDiscreteMarchingCubes> marchingCubes = vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  marchingCubes->SetInput(mergedImage);
+#else
+  marchingCubes->SetInputData(mergedImage);
+#endif
+  marchingCubes->SetNumberOfContours(paintedIndices.size());
+  for (unsigned int contourIndex=0; contourIndex<paintedIndices.size(); ++contourIndex)
+  {
+    marchingCubes->SetValue(contourIndex, paintedIndices[contourIndex] + 1);
+  }
+  marchingCubes->ComputeScalarsOn();
   marchingCubes->ComputeGradientsOff();
   marchingCubes->ComputeNormalsOff();
   try
@@ -150,61 +506,333 @@ bool vtkBinaryLabelmapToClosedSurfaceConversionRule::Convert(vtkDataObject* sour
   }
   catch(...)
   {
-    vtkErrorMacro("Convert: Error while running marching cubes!");
-    return false;
+    vtkErrorMacro("ConvertMultiLabel: Error while running discrete marching cubes!");
+    return;
+  }
+  vtkPolyData* mergedSurface = marchingCubes->GetOutput();
+
+  // Label of each polygon is stored in the cell scalars
+  vtkDataArray* polyLabels = mergedSurface->GetCellData()->GetScalars();
+  if (!polyLabels && mergedSurface->GetNumberOfPolys() > 0)
+  {
+    vtkErrorMacro("ConvertMultiLabel: Discrete marching cubes did not create labels for the polygons!");
+    return;
+  }
+
+  // Bucket polygons by label
+  std::vector< std::vector<vtkIdType> > labelPolyIds(labelmaps.size());
+  vtkIdType numberOfVerts = mergedSurface->GetNumberOfVerts();
+  vtkIdType numberOfLines = mergedSurface->GetNumberOfLines();
+  vtkCellArray* mergedPolys = mergedSurface->GetPolys();
+  vtkIdType npts = 0;
+  vtkIdType* pts = NULL;
+  vtkIdType polyIndex = 0;
+  mergedPolys->InitTraversal();
+  for (vtkIdType location=mergedPolys->GetTraversalLocation(); mergedPolys->GetNextCell(npts, pts); location=mergedPolys->GetTraversalLocation(), ++polyIndex)
+  {
+    int labelIndex = (int)vtkMath::Round(polyLabels->GetTuple1(numberOfVerts + numberOfLines + polyIndex)) - 1;
+    if (labelIndex >= 0 && labelIndex < (int)labelmaps.size())
+    {
+      labelPolyIds[labelIndex].push_back(location);
+    }
   }
-  if (marchingCubes->GetOutput()->GetNumberOfPolys() == 0)
+  double checkpointExtracted = timer->GetUniversalTime();
+  this->LastExtractionTime = checkpointExtracted - checkpointStart;
+
+  // Split merged surface into the individual segment surfaces, then decimate and transform them
+  double decimationFactor = 0.0;
+  this->GetConversionParameterAsDouble(GetDecimationFactorParameterName(), decimationFactor);
+  std::string decimationMethod = this->ConversionParameters[GetDecimationMethodParameterName()].first;
+
+  vtkSmartPointer<vtkMatrix4x4> labelmapImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  labelmaps[0]->GetImageToWorldMatrix(labelmapImageToWorldMatrix);
+  vtkSmartPointer<vtkTransform> labelmapGeometryTransform = vtkSmartPointer<vtkTransform>::New();
+  labelmapGeometryTransform->SetMatrix(labelmapImageToWorldMatrix);
+
+  vtkPoints* mergedPoints = mergedSurface->GetPoints();
+  std::vector<vtkIdType> pointMap(mergedSurface->GetNumberOfPoints(), -1);
+  this->LastDecimationTime = 0.0;
+  this->LastTransformTime = 0.0;
+  for (std::vector<int>::iterator paintedIt = paintedIndices.begin(); paintedIt != paintedIndices.end(); ++paintedIt)
+  {
+    // Labels that fail here are not marked as converted, so they fall back to individual conversion
+    int labelIndex = (*paintedIt);
+    std::vector<vtkIdType>& polyLocationsForLabel = labelPolyIds[labelIndex];
+    if (polyLocationsForLabel.empty())
+    {
+      vtkDebugMacro("ConvertMultiLabel: No polygons created for labelmap " << labelIndex << ", it is converted individually");
+      continue;
+    }
+
+    // Copy polygons of the label and the points they use
+    vtkSmartPointer<vtkPoints> labelPoints = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkCellArray> labelPolys = vtkSmartPointer<vtkCellArray>::New();
+    std::vector<vtkIdType> usedPointIds;
+    std::vector<vtkIdType> cellPointIds;
+    for (std::vector<vtkIdType>::iterator locationIt = polyLocationsForLabel.begin(); locationIt != polyLocationsForLabel.end(); ++locationIt)
+    {
+      mergedPolys->GetCell(*locationIt, npts, pts);
+      cellPointIds.resize(npts);
+      for (vtkIdType pointIndex=0; pointIndex<npts; ++pointIndex)
+      {
+        vtkIdType mergedPointId = pts[pointIndex];
+        if (pointMap[mergedPointId] < 0)
+        {
+          pointMap[mergedPointId] = labelPoints->InsertNextPoint(mergedPoints->GetPoint(mergedPointId));
+          usedPointIds.push_back(mergedPointId);
+        }
+        cellPointIds[pointIndex] = pointMap[mergedPointId];
+      }
+      labelPolys->InsertNextCell(npts, &(cellPointIds[0]));
+    }
+    // Reset point map only where it was used for this label
+    for (std::vector<vtkIdType>::iterator pointIt = usedPointIds.begin(); pointIt != usedPointIds.end(); ++pointIt)
+    {
+      pointMap[*pointIt] = -1;
+    }
+
+    vtkSmartPointer<vtkPolyData> labelSurface = vtkSmartPointer<vtkPolyData>::New();
+    labelSurface->SetPoints(labelPoints);
+    labelSurface->SetPolys(labelPolys);
+
+    double checkpointSplit = timer->GetUniversalTime();
+    vtkSmartPointer<vtkPolyData> decimatedSurface = labelSurface;
+    if (decimationFactor > 0.0)
+    {
+      decimatedSurface = vtkSmartPointer<vtkPolyData>::New();
+      if (!this->DecimateSurface(labelSurface, decimatedSurface, decimationFactor, decimationMethod))
+      {
+        continue;
+      }
+    }
+    double checkpointDecimated = timer->GetUniversalTime();
+    this->LastDecimationTime += checkpointDecimated - checkpointSplit;
+
+    vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyDataFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+    transformPolyDataFilter->SetInput(decimatedSurface);
+#else
+    transformPolyDataFilter->SetInputData(decimatedSurface);
+#endif
+    transformPolyDataFilter->SetTransform(labelmapGeometryTransform);
+    transformPolyDataFilter->Update();
+    surfaces[labelIndex]->ShallowCopy(transformPolyDataFilter->GetOutput());
+    converted[labelIndex] = true;
+    this->LastTransformTime += timer->GetUniversalTime() - checkpointDecimated;
+  }
+
+  vtkDebugMacro("ConvertMultiLabel: Converted " << paintedIndices.size() << " labelmaps in one pass. Extraction: " << this->LastExtractionTime
+    << " s, decimation: " << this->LastDecimationTime << " s, transform: " << this->LastTransformTime << " s");
+}
+
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapToClosedSurfaceConversionRule::ExtractSurface(vtkImageData* binaryLabelMap, vtkPolyData* surface, bool parallel)
+{
+  if (!binaryLabelMap || !surface)
   {
-    vtkErrorMacro("Convert: No polygons can be created!");
     return false;
   }
 
-  // Decimate if necessary
-  vtkSmartPointer<vtkDecimatePro> decimator = vtkSmartPointer<vtkDecimatePro>::New();
-  decimator->SetInputConnection(marchingCubes->GetOutputPort());
-  if (decimationFactor > 0.0)
+  int extent[6] = {0,-1,0,-1,0,-1};
+  binaryLabelMap->GetExtent(extent);
+  int numberOfSlices = extent[5] - extent[4] + 1;
+
+  // Determine number of slabs. Each slab contains at least a few slices, otherwise the
+  // overhead of merging the partial surfaces outweighs the gain of the parallel execution
+  int numberOfSlabs = 1;
+  if (parallel)
+  {
+    numberOfSlabs = std::min( vtkMultiThreader::GetGlobalDefaultNumberOfThreads(),
+      (numberOfSlices - 1) / MINIMUM_SLAB_THICKNESS );
+    numberOfSlabs = std::min(numberOfSlabs, (int)VTK_MAX_THREADS);
+  }
+
+  // Single-threaded marching cubes on the whole labelmap
+  if (numberOfSlabs < 2)
   {
-    decimator->SetFeatureAngle(60);
-    decimator->SplittingOff();
-    decimator->PreserveTopologyOn();
-    decimator->SetMaximumError(1);
-    decimator->SetTargetReduction(decimationFactor);
+    vtkSmartPointer<vtkMarchingCubes> marchingCubes = vtkSmartPointer<vtkMarchingCubes>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+    marchingCubes->SetInput(binaryLabelMap);
+#else
+    marchingCubes->SetInputData(binaryLabelMap);
+#endif
+    marchingCubes->SetNumberOfContours(1);
+    marchingCubes->SetValue(0, 0.5); //TODO: In the vtkLabelmapToModelFilter class this is LabelValue/2.0. If we know why, it would make sense to explain it here.
+    marchingCubes->ComputeScalarsOff();
+    marchingCubes->ComputeGradientsOff();
+    marchingCubes->ComputeNormalsOff();
     try
     {
-      decimator->Update();
+      marchingCubes->Update();
     }
     catch(...)
     {
-      vtkErrorMacro("Error decimating model");
+      vtkErrorMacro("ExtractSurface: Error while running marching cubes!");
+      return false;
+    }
+    if (marchingCubes->GetOutput()->GetNumberOfPolys() == 0)
+    {
+      vtkErrorMacro("ExtractSurface: No polygons can be created!");
       return false;
     }
+    surface->ShallowCopy(marchingCubes->GetOutput());
+    return true;
   }
 
-  // Transform the result surface from labelmap IJK to world coordinate system
-  vtkSmartPointer<vtkTransform> labelmapGeometryTransform = vtkSmartPointer<vtkTransform>::New();
-  labelmapGeometryTransform->SetMatrix(labelmapImageToWorldMatrix);
+  // Create slab images that share the voxel buffer of the input labelmap. The K slices are contiguous
+  // in memory, so a slab is simply a window on the input scalars (no copy is needed).
+  // Neighboring slabs share their boundary slice so that no cells are lost between them.
+  vtkDataArray* inputScalars = binaryLabelMap->GetPointData()->GetScalars();
+  if (!inputScalars)
+  {
+    vtkErrorMacro("ExtractSurface: Input labelmap has no scalars!");
+    return false;
+  }
+  vtkIdType sliceSize = (vtkIdType)(extent[1]-extent[0]+1) * (vtkIdType)(extent[3]-extent[2]+1);
 
-  vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyDataFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-  if (decimationFactor > 0.0)
+  SlabExtractionData data;
+  int firstSlice = extent[4];
+  for (int slabIndex=0; slabIndex<numberOfSlabs; ++slabIndex)
   {
-    transformPolyDataFilter->SetInputConnection(decimator->GetOutputPort());
+    int lastSlice = (slabIndex == numberOfSlabs-1 ? extent[5] : extent[4] + ((slabIndex+1) * (numberOfSlices-1)) / numberOfSlabs);
+    int slabExtent[6] = { extent[0], extent[1], extent[2], extent[3], firstSlice, lastSlice };
+
+    vtkSmartPointer<vtkDataArray> slabScalars = vtkSmartPointer<vtkDataArray>::Take(
+      vtkDataArray::CreateDataArray(inputScalars->GetDataType()) );
+    slabScalars->SetNumberOfComponents(inputScalars->GetNumberOfComponents());
+    slabScalars->SetVoidArray( binaryLabelMap->GetScalarPointer(extent[0], extent[2], firstSlice),
+      sliceSize * (lastSlice-firstSlice+1) * inputScalars->GetNumberOfComponents(), 1 ); // Do not free memory owned by the input
+
+    vtkSmartPointer<vtkImageData> slabImage = vtkSmartPointer<vtkImageData>::New();
+    slabImage->SetExtent(slabExtent);
+    slabImage->SetSpacing(binaryLabelMap->GetSpacing());
+    slabImage->SetOrigin(binaryLabelMap->GetOrigin());
+#if (VTK_MAJOR_VERSION <= 5)
+    slabImage->SetWholeExtent(slabExtent);
+    slabImage->SetScalarType(inputScalars->GetDataType());
+    slabImage->SetNumberOfScalarComponents(inputScalars->GetNumberOfComponents());
+#endif
+    slabImage->GetPointData()->SetScalars(slabScalars);
+
+    data.SlabImages.push_back(slabImage);
+    data.SlabSurfaces.push_back(vtkSmartPointer<vtkPolyData>::New());
+    data.SlabSuccess.push_back(false);
+
+    firstSlice = lastSlice;
   }
-  else
+
+  // Run marching cubes on the slabs in parallel
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfSlabs);
+  threader->SetSingleMethod(ExtractSlabSurfaceThreadFunction, &data);
+  threader->SingleMethodExecute();
+
+  // Merge slab surfaces in slab order so that the result is deterministic
+  vtkSmartPointer<vtkAppendPolyData> appender = vtkSmartPointer<vtkAppendPolyData>::New();
+  vtkIdType numberOfPolys = 0;
+  for (int slabIndex=0; slabIndex<numberOfSlabs; ++slabIndex)
+  {
+    if (!data.SlabSuccess[slabIndex])
+    {
+      vtkErrorMacro("ExtractSurface: Error while running marching cubes on slab " << slabIndex << "!");
+      return false;
+    }
+    numberOfPolys += data.SlabSurfaces[slabIndex]->GetNumberOfPolys();
+#if (VTK_MAJOR_VERSION <= 5)
+    appender->AddInput(data.SlabSurfaces[slabIndex]);
+#else
+    appender->AddInputData(data.SlabSurfaces[slabIndex]);
+#endif
+  }
+  if (numberOfPolys == 0)
   {
-    transformPolyDataFilter->SetInputConnection(marchingCubes->GetOutputPort());
+    vtkErrorMacro("ExtractSurface: No polygons can be created!");
+    return false;
   }
-  transformPolyDataFilter->SetTransform(labelmapGeometryTransform);
-  transformPolyDataFilter->Update();
 
-  // Set output
-  closedSurfacePolyData->ShallowCopy(transformPolyDataFilter->GetOutput());
+  // Merge the coincident points generated on the shared boundary slices
+  vtkSmartPointer<vtkCleanPolyData> cleaner = vtkSmartPointer<vtkCleanPolyData>::New();
+  cleaner->SetInputConnection(appender->GetOutputPort());
+  cleaner->PointMergingOn();
+  cleaner->SetTolerance(0.0);
+  cleaner->ConvertLinesToPointsOff();
+  cleaner->ConvertPolysToLinesOff();
+  cleaner->ConvertStripsToPolysOff();
+  cleaner->Update();
+
+  surface->ShallowCopy(cleaner->GetOutput());
+  return true;
+}
 
-  // Delete temporary padded labelmap if it was created
-  if (paddingNecessary)
+//----------------------------------------------------------------------------
+bool vtkBinaryLabelmapToClosedSurfaceConversionRule::DecimateSurface(vtkPolyData* inputSurface, vtkPolyData* decimatedSurface, double decimationFactor, const std::string& method)
+{
+  if (!inputSurface || !decimatedSurface)
   {
-    binaryLabelMap->Delete();
+    return false;
   }
 
+  if (!method.compare(GetQuadricClusteringDecimationMethodName()))
+  {
+    // The number of triangles on a surface is proportional to the square of the number of divisions,
+    // and the input is in IJK coordinates, so the number of divisions along an axis is derived from the
+    // number of voxels the surface spans along that axis
+    double bounds[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+    inputSurface->GetBounds(bounds);
+    double divisionRatio = sqrt(std::max(0.0, 1.0 - decimationFactor));
+    int divisions[3] = {2, 2, 2};
+    for (int axis=0; axis<3; ++axis)
+    {
+      divisions[axis] = std::max(2, (int)vtkMath::Round((bounds[axis*2+1] - bounds[axis*2] + 1.0) * divisionRatio));
+    }
+
+    vtkSmartPointer<vtkQuadricClustering> decimator = vtkSmartPointer<vtkQuadricClustering>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+    decimator->SetInput(inputSurface);
+#else
+    decimator->SetInputData(inputSurface);
+#endif
+    decimator->AutoAdjustNumberOfDivisionsOff();
+    decimator->SetNumberOfDivisions(divisions);
+    decimator->CopyCellDataOff();
+    try
+    {
+      decimator->Update();
+    }
+    catch(...)
+    {
+      vtkErrorMacro("DecimateSurface: Error decimating model");
+      return false;
+    }
+    decimatedSurface->ShallowCopy(decimator->GetOutput());
+    return true;
+  }
+
+  if (method.compare(GetDecimateProDecimationMethodName()))
+  {
+    vtkWarningMacro("DecimateSurface: Unknown decimation method '" << method << "', using " << GetDecimateProDecimationMethodName());
+  }
+  vtkSmartPointer<vtkDecimatePro> decimator = vtkSmartPointer<vtkDecimatePro>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  decimator->SetInput(inputSurface);
+#else
+  decimator->SetInputData(inputSurface);
+#endif
+  decimator->SetFeatureAngle(60);
+  decimator->SplittingOff();
+  decimator->PreserveTopologyOn();
+  decimator->SetMaximumError(1);
+  decimator->SetTargetReduction(decimationFactor);
+  try
+  {
+    decimator->Update();
+  }
+  catch(...)
+  {
+    vtkErrorMacro("DecimateSurface: Error decimating model");
+    return false;
+  }
+  decimatedSurface->ShallowCopy(decimator->GetOutput());
   return true;
 }
 
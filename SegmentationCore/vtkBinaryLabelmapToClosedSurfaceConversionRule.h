@@ -27,17 +27,41 @@
 
 #include "vtkSegmentationCoreConfigure.h"
 
+class vtkImageData;
+class vtkPolyData;
+
 /// \ingroup SegmentationCore
 /// \brief Convert binary labelmap representation (vtkOrientedImageData type) to
 ///   closed surface representation (vtkPolyData type). The conversion algorithm
 ///   performs a marching cubes operation on the image data followed by an optional
-///   decimation step.
+///   decimation step. Marching cubes can be run on slabs of the labelmap in parallel,
+///   and decimation can be done either with vtkDecimatePro or the faster vtkQuadricClustering.
 class vtkSegmentationCore_EXPORT vtkBinaryLabelmapToClosedSurfaceConversionRule
   : public vtkSegmentationConverterRule
 {
 public:
   /// Conversion parameter: decimation factor
   static const std::string GetDecimationFactorParameterName() { return "Decimation factor"; };
+  /// Conversion parameter: surface extraction method
+  /// Possible values are \sa GetMarchingCubesExtractionMethodName, \sa GetParallelMarchingCubesExtractionMethodName,
+  /// and \sa GetMultiLabelMarchingCubesExtractionMethodName
+  static const std::string GetExtractionMethodParameterName() { return "Surface extraction method"; };
+  /// Conversion parameter: decimation method
+  /// Possible values are \sa GetDecimateProDecimationMethodName and \sa GetQuadricClusteringDecimationMethodName
+  static const std::string GetDecimationMethodParameterName() { return "Decimation method"; };
+
+  /// Surface extraction method: single-threaded marching cubes on the whole labelmap
+  static const std::string GetMarchingCubesExtractionMethodName() { return "Marching cubes"; };
+  /// Surface extraction method: marching cubes on slabs along the K axis in multiple threads, merged afterwards
+  static const std::string GetParallelMarchingCubesExtractionMethodName() { return "Parallel marching cubes"; };
+  /// Surface extraction method: segments sharing the same geometry are merged into one label image, and the
+  /// surfaces of all of them are created in a single discrete marching cubes pass. Segments that overlap with
+  /// an already merged segment are converted individually.
+  static const std::string GetMultiLabelMarchingCubesExtractionMethodName() { return "Multi-label marching cubes"; };
+  /// Decimation method: topology preserving decimation using vtkDecimatePro
+  static const std::string GetDecimateProDecimationMethodName() { return "Decimate pro"; };
+  /// Decimation method: fast vertex clustering decimation using vtkQuadricClustering
+  static const std::string GetQuadricClusteringDecimationMethodName() { return "Quadric clustering"; };
 
 public:
   static vtkBinaryLabelmapToClosedSurfaceConversionRule* New();
@@ -57,6 +81,11 @@ public:
   /// Update the target representation based on the source representation
   virtual bool Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation);
 
+  /// Update the target representations of multiple segments. If the extraction method is multi-label marching cubes,
+  /// then segments with matching geometry are converted together in a single pass, otherwise each segment
+  /// is converted individually.
+  virtual bool ConvertMultiple(std::vector<vtkDataObject*>& sourceRepresentations, std::vector<vtkDataObject*>& targetRepresentations);
+
   /// Get the cost of the conversion.
   virtual unsigned int GetConversionCost(vtkDataObject* sourceRepresentation=NULL, vtkDataObject* targetRepresentation=NULL);
 
@@ -69,6 +98,13 @@ public:
   /// Human-readable name of the target representation
   virtual const char* GetTargetRepresentationName() { return vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(); };
 
+  /// Get time spent in surface extraction during the last conversion (in seconds)
+  vtkGetMacro(LastExtractionTime, double);
+  /// Get time spent in decimation during the last conversion (in seconds)
+  vtkGetMacro(LastDecimationTime, double);
+  /// Get time spent in transforming the surface to world coordinate system during the last conversion (in seconds)
+  vtkGetMacro(LastTransformTime, double);
+
 protected:
   /// If input labelmap has non-background border voxels, then those regions remain open in the output closed surface.
   /// This function checks whether this is the case.
@@ -78,6 +114,33 @@ protected:
   /// This function adds a 1 voxel padding to the labelmap in these cases.
   void PadLabelmap(vtkOrientedImageData* binaryLabelMap);
 
+  /// Run marching cubes on the input labelmap (that has identity geometry) and put the result in the output poly data.
+  /// If parallel extraction is requested, then the labelmap is split into slabs along the K axis that are processed
+  /// in separate threads, and the partial surfaces are merged afterwards.
+  /// \return Success flag
+  bool ExtractSurface(vtkImageData* binaryLabelMap, vtkPolyData* surface, bool parallel);
+
+  /// Decimate surface using the given method and target reduction
+  /// \return Success flag
+  bool DecimateSurface(vtkPolyData* inputSurface, vtkPolyData* decimatedSurface, double decimationFactor, const std::string& method);
+
+  /// Convert labelmaps sharing the same geometry in one pass: paint them into a merged label image,
+  /// run discrete marching cubes on it, and split the result by label.
+  /// \param labelmaps Labelmaps with the same geometry (extents may differ)
+  /// \param surfaces Output surfaces corresponding to the labelmaps
+  /// \param converted Flags set to true for the labelmaps whose surface has been created. Labelmaps that could not
+  ///   be merged (e.g. because they overlap with another one) or whose surface could not be created (no polygons,
+  ///   failed decimation) are left unprocessed for individual conversion
+  void ConvertMultiLabel(std::vector<vtkOrientedImageData*>& labelmaps, std::vector<vtkPolyData*>& surfaces, std::vector<bool>& converted);
+
+protected:
+  /// Time spent in surface extraction during the last conversion (in seconds)
+  double LastExtractionTime;
+  /// Time spent in decimation during the last conversion (in seconds)
+  double LastDecimationTime;
+  /// Time spent in transforming the surface to world coordinate system during the last conversion (in seconds)
+  double LastTransformTime;
+
 protected:
   vtkBinaryLabelmapToClosedSurfaceConversionRule();
   ~vtkBinaryLabelmapToClosedSurfaceConversionRule();
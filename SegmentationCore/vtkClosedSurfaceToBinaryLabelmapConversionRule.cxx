@@ -64,11 +64,11 @@ vtkClosedSurfaceToBinaryLabelmapConversionRule::~vtkClosedSurfaceToBinaryLabelma
 
 //----------------------------------------------------------------------------
 unsigned int vtkClosedSurfaceToBinaryLabelmapConversionRule::GetConversionCost(
-  vtkDataObject* vtkNotUsed(sourceRepresentation)/*=NULL*/,
+  vtkDataObject* sourceRepresentation/*=NULL*/,
   vtkDataObject* vtkNotUsed(targetRepresentation)/*=NULL*/)
 {
-  // Rough input-independent guess (ms)
-  return 500;
+  // Rough input-independent guess (ms) until conversion times are measured
+  return this->EstimateConversionCost(sourceRepresentation, 500);
 }
 
 //----------------------------------------------------------------------------
@@ -247,15 +247,14 @@ bool vtkClosedSurfaceToBinaryLabelmapConversionRule::CalculateOutputGeometry(vtk
     return false;
   }
 
-  // Get reference image geometry from parameters
-  std::string geometryString = this->ConversionParameters[vtkSegmentationConverter::GetReferenceImageGeometryParameterName()].first;
-  if (geometryString.empty() || !vtkSegmentationConverter::DeserializeImageGeometry(geometryString, geometryImageData))
+  // Get reference image geometry from parameters (parsed only once, not for each converted segment)
+  if (!this->GetConversionParameterAsImageGeometry(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), geometryImageData))
   {
     vtkInfoMacro("CalculateOutputGeometry: No image geometry specified, default geometry is calculated with 1 mm spacing");
-    geometryString = this->GetDefaultImageGeometryStringForPolyData(closedSurfacePolyData);
+    this->GetDefaultImageGeometryStringForPolyData(closedSurfacePolyData);
 
     // If still not valid then return with error
-    if (!vtkSegmentationConverter::DeserializeImageGeometry(geometryString, geometryImageData))
+    if (!this->GetConversionParameterAsImageGeometry(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), geometryImageData))
     {
       vtkErrorMacro("CalculateOutputGeometry: Failed to get reference image geometry");
       return false;
@@ -269,9 +268,8 @@ bool vtkClosedSurfaceToBinaryLabelmapConversionRule::CalculateOutputGeometry(vtk
   }
 
   // Get oversampling factor
-  std::string oversamplingString = this->ConversionParameters[GetOversamplingFactorParameterName()].first;
   double oversamplingFactor = 1.0;
-  if (!oversamplingString.compare("A"))
+  if (!this->ConversionParameters[GetOversamplingFactorParameterName()].first.compare("A"))
   {
     // Automatic oversampling factor is used
     vtkSmartPointer<vtkCalculateOversamplingFactor> oversamplingCalculator = vtkSmartPointer<vtkCalculateOversamplingFactor>::New();
@@ -287,16 +285,10 @@ bool vtkClosedSurfaceToBinaryLabelmapConversionRule::CalculateOutputGeometry(vtk
       oversamplingFactor = 1.0;
     }
   }
-  else
+  else if (!this->GetConversionParameterAsDouble(GetOversamplingFactorParameterName(), oversamplingFactor))
   {
-    // Static oversampling factor
-    std::stringstream ss;
-    ss << oversamplingString;
-    ss >> oversamplingFactor;
-    if (ss.fail())
-    {
-      oversamplingFactor = 1.0;
-    }
+    // Static oversampling factor could not be parsed
+    oversamplingFactor = 1.0;
   }
 
   // Apply oversampling if needed
@@ -365,8 +357,7 @@ std::string vtkClosedSurfaceToBinaryLabelmapConversionRule::GetDefaultImageGeome
   vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
   imageData->SetDimensions(dimensions);
 
-  // Serialize geometry
-  std::string serializedGeometry = vtkSegmentationConverter::SerializeImageGeometry(geometryMatrix, imageData);
-  this->ConversionParameters[vtkSegmentationConverter::GetReferenceImageGeometryParameterName()].first = serializedGeometry;
-  return serializedGeometry;
+  // Set geometry parameter (the geometry is also cached, so it does not need to be parsed)
+  this->SetConversionParameterAsImageGeometry(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), geometryMatrix, imageData->GetExtent());
+  return this->ConversionParameters[vtkSegmentationConverter::GetReferenceImageGeometryParameterName()].first;
 }
@@ -23,14 +23,18 @@
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkMatrix4x4.h>
+#include <vtkAbstractTransform.h>
 #include <vtkMath.h>
 #include <vtkMathUtilities.h>
 
 vtkStandardNewMacro(vtkOrientedImageData);
+vtkCxxSetObjectMacro(vtkOrientedImageData, PendingTransform, vtkAbstractTransform);
 
 //----------------------------------------------------------------------------
 vtkOrientedImageData::vtkOrientedImageData()
 {
+  this->PendingTransform = NULL;
+
   int i=0,j=0;
   for(i=0; i<3; i++)
     {
@@ -44,6 +48,7 @@ vtkOrientedImageData::vtkOrientedImageData()
 //----------------------------------------------------------------------------
 vtkOrientedImageData::~vtkOrientedImageData()
 {
+  this->SetPendingTransform(NULL);
 }
 
 //----------------------------------------------------------------------------
@@ -63,6 +68,8 @@ void vtkOrientedImageData::PrintSelf(ostream& os, vtkIndent indent)
       os << indent << "\n";
     }
   os << "\n";
+
+  os << indent << "PendingTransform: " << (this->PendingTransform ? this->PendingTransform->GetClassName() : "NULL") << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -76,6 +83,9 @@ void vtkOrientedImageData::ShallowCopy(vtkDataObject *dataObject)
                          {0.0, 0.0, 0.0}};
     orientedImageData->GetDirections(dirs);
     this->SetDirections(dirs);
+
+    // Pending transforms are never modified, so they can be shared even by deep copies
+    this->SetPendingTransform(orientedImageData->GetPendingTransform());
     }
 
   // Do superclass
@@ -93,6 +103,9 @@ void vtkOrientedImageData::DeepCopy(vtkDataObject *dataObject)
                          {0.0, 0.0, 0.0}};
     orientedImageData->GetDirections(dirs);
     this->SetDirections(dirs);
+
+    // Pending transforms are never modified, so they can be shared even by deep copies
+    this->SetPendingTransform(orientedImageData->GetPendingTransform());
     }
 
   // Do superclass
@@ -338,7 +351,13 @@ void vtkOrientedImageData::ComputeBounds()
     return;
     }
 
-  // Compute oriented image corners
+  // Compute oriented image corners. Start from empty bounds, as the uninitialized
+  // bounds (1,-1) would be kept by the corners around the origin
+  for (int axis=0; axis<3; ++axis)
+    {
+    this->Bounds[axis*2] = VTK_DOUBLE_MAX;
+    this->Bounds[axis*2+1] = -VTK_DOUBLE_MAX;
+    }
   vtkNew<vtkMatrix4x4> geometryMatrix;
   this->GetImageToWorldMatrix(geometryMatrix.GetPointer());
 
@@ -27,6 +27,7 @@
 #include "vtkImageData.h"
 
 class vtkMatrix4x4;
+class vtkAbstractTransform;
 
 /// \ingroup SegmentationCore
 /// \brief Image data containing orientation information
@@ -77,6 +78,14 @@ public:
   /// Get the inverse of the geometry matrix
   void GetWorldToImageMatrix(vtkMatrix4x4* mat);
 
+  /// Get transform that has been recorded on the image but not yet applied on its voxels.
+  /// World coordinates of the voxels are obtained by applying this transform on the coordinates given by the geometry.
+  /// It is applied together with the next resampling, so that the voxels are interpolated only once
+  /// (\sa vtkOrientedImageDataResample::TransformOrientedImageDeferred). NULL if there is no pending transform.
+  vtkGetObjectMacro(PendingTransform, vtkAbstractTransform);
+  /// Set pending transform. The transform must not be modified after it is set, as it is shared between copies of the image
+  virtual void SetPendingTransform(vtkAbstractTransform* transform);
+
 protected:
   vtkOrientedImageData();
   ~vtkOrientedImageData();
@@ -89,6 +98,9 @@ protected:
   /// These are unit length direction cosines
   double Directions[3][3];
 
+  /// Transform not yet applied on the voxels (\sa GetPendingTransform)
+  vtkAbstractTransform* PendingTransform;
+
 private:
   vtkOrientedImageData(const vtkOrientedImageData&);  // Not implemented.
   void operator=(const vtkOrientedImageData&);  // Not implemented.
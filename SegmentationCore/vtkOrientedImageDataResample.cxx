@@ -33,9 +33,255 @@
 #include <vtkImageReslice.h>
 #include <vtkImageConstantPad.h>
 #include <vtkGeneralTransform.h>
+#include <vtkGridTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkPlaneSource.h>
 #include <vtkAppendPolyData.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Minimum number of voxels scanned by one thread when calculating the effective extent.
+  /// Smaller images are scanned on one thread, as the threading overhead would outweigh the gain.
+  static const vtkIdType MINIMUM_NUMBER_OF_VOXELS_PER_THREAD = 1048576;
+
+  /// Tolerance for deciding whether a transform is axis-aligned
+  static const double AXIS_ALIGNED_TOLERANCE = 1e-6;
+
+  /// Shared data of the effective extent scan threads. Each thread scans a slab of slices
+  /// and only accesses its own effective extent.
+  struct EffectiveExtentScanData
+  {
+    vtkImageData* Image;
+    int NumberOfSlabs;
+    std::vector<int> SlabEffectiveExtents;
+  };
+
+  //----------------------------------------------------------------------------
+  /// Find the non-zero voxels in a slab of slices. The image is traversed in memory order,
+  /// and in each row only the voxels before the first and after the last non-zero voxel are visited.
+  /// Extents are zero-based (relative to the first voxel of the image).
+  template <class T>
+  void CalculateEffectiveExtentTemplate(vtkImageData* image, T* imagePtr, int firstSlice, int lastSlice, int effectiveExtent[6])
+  {
+    int dimensions[3] = {0, 0, 0};
+    image->GetDimensions(dimensions);
+    int numberOfComponents = image->GetNumberOfScalarComponents();
+    vtkIdType rowLength = (vtkIdType)dimensions[0] * numberOfComponents;
+    vtkIdType sliceLength = rowLength * dimensions[1];
+
+    effectiveExtent[0] = dimensions[0];
+    effectiveExtent[1] = -1;
+    effectiveExtent[2] = dimensions[1];
+    effectiveExtent[3] = -1;
+    effectiveExtent[4] = dimensions[2];
+    effectiveExtent[5] = -1;
+
+    for (int k=firstSlice; k<=lastSlice; ++k)
+    {
+      T* slicePtr = imagePtr + k*sliceLength;
+      for (int j=0; j<dimensions[1]; ++j)
+      {
+        T* rowPtr = slicePtr + j*rowLength;
+        vtkIdType firstNonZero = 0;
+        while (firstNonZero < rowLength && rowPtr[firstNonZero] == 0)
+        {
+          ++firstNonZero;
+        }
+        if (firstNonZero == rowLength)
+        {
+          // Empty row
+          continue;
+        }
+        vtkIdType lastNonZero = rowLength-1;
+        while (rowPtr[lastNonZero] == 0)
+        {
+          --lastNonZero;
+        }
+
+        effectiveExtent[0] = std::min(effectiveExtent[0], (int)(firstNonZero / numberOfComponents));
+        effectiveExtent[1] = std::max(effectiveExtent[1], (int)(lastNonZero / numberOfComponents));
+        effectiveExtent[2] = std::min(effectiveExtent[2], j);
+        effectiveExtent[3] = std::max(effectiveExtent[3], j);
+        effectiveExtent[4] = std::min(effectiveExtent[4], k);
+        effectiveExtent[5] = std::max(effectiveExtent[5], k);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void CalculateEffectiveExtentInSlab(vtkImageData* image, int firstSlice, int lastSlice, int effectiveExtent[6])
+  {
+    void* imagePtr = image->GetScalarPointer();
+    switch (image->GetScalarType())
+    {
+      vtkTemplateMacro(CalculateEffectiveExtentTemplate(image, static_cast<VTK_TT*>(imagePtr), firstSlice, lastSlice, effectiveExtent));
+      default:
+        break;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE CalculateEffectiveExtentThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    EffectiveExtentScanData* data = static_cast<EffectiveExtentScanData*>(threadInfo->UserData);
+    int slabIndex = threadInfo->ThreadID;
+    if (!data || slabIndex >= data->NumberOfSlabs)
+    {
+      return VTK_THREAD_RETURN_VALUE;
+    }
+
+    int numberOfSlices = data->Image->GetDimensions()[2];
+    int firstSlice = (int)((vtkIdType)numberOfSlices * slabIndex / data->NumberOfSlabs);
+    int lastSlice = (int)((vtkIdType)numberOfSlices * (slabIndex+1) / data->NumberOfSlabs) - 1;
+    CalculateEffectiveExtentInSlab(data->Image, firstSlice, lastSlice, &data->SlabEffectiveExtents[6*slabIndex]);
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Build a lookup table from output to input voxel indices along one axis for nearest neighbor resampling.
+  /// Indices are zero-based, -1 means that the output voxel is outside the input image.
+  void BuildNearestNeighborIndexTable(double scale, double offset, int outputMinimum, int outputMaximum,
+    int inputMinimum, int inputMaximum, std::vector<int>& indexTable)
+  {
+    indexTable.resize(std::max(0, outputMaximum - outputMinimum + 1));
+    for (int outputIndex = outputMinimum; outputIndex <= outputMaximum; ++outputIndex)
+    {
+      int inputIndex = (int)floor(scale * outputIndex + offset + 0.5);
+      indexTable[outputIndex - outputMinimum] = ( (inputIndex >= inputMinimum && inputIndex <= inputMaximum) ? inputIndex - inputMinimum : -1 );
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Nearest neighbor resampling using separable index lookup tables (single component images)
+  template <class T>
+  void ResampleNearestNeighborSeparableTemplate(vtkImageData* inputImage, T* inputPtr, vtkImageData* outputImage, T* outputPtr, std::vector<int> indexTables[3])
+  {
+    int inputDimensions[3] = {0, 0, 0};
+    inputImage->GetDimensions(inputDimensions);
+    int outputDimensions[3] = {0, 0, 0};
+    outputImage->GetDimensions(outputDimensions);
+
+    // Determine the range of output columns that are inside the input, and whether
+    // the corresponding input voxels are contiguous (in which case rows can be copied)
+    const std::vector<int>& columnTable = indexTables[0];
+    int firstValidColumn = 0;
+    while (firstValidColumn < outputDimensions[0] && columnTable[firstValidColumn] < 0)
+    {
+      ++firstValidColumn;
+    }
+    int lastValidColumn = outputDimensions[0]-1;
+    while (lastValidColumn >= firstValidColumn && columnTable[lastValidColumn] < 0)
+    {
+      --lastValidColumn;
+    }
+    bool contiguousColumns = true;
+    for (int i=firstValidColumn; i<lastValidColumn; ++i)
+    {
+      if (columnTable[i+1] != columnTable[i]+1)
+      {
+        contiguousColumns = false;
+        break;
+      }
+    }
+
+    for (int k=0; k<outputDimensions[2]; ++k)
+    {
+      int inputK = indexTables[2][k];
+      for (int j=0; j<outputDimensions[1]; ++j)
+      {
+        T* outputRowPtr = outputPtr + ((vtkIdType)k*outputDimensions[1] + j) * outputDimensions[0];
+        int inputJ = indexTables[1][j];
+        if (inputK < 0 || inputJ < 0 || firstValidColumn > lastValidColumn)
+        {
+          std::fill(outputRowPtr, outputRowPtr + outputDimensions[0], static_cast<T>(0));
+          continue;
+        }
+
+        const T* inputRowPtr = inputPtr + ((vtkIdType)inputK*inputDimensions[1] + inputJ) * inputDimensions[0];
+        std::fill(outputRowPtr, outputRowPtr + firstValidColumn, static_cast<T>(0));
+        if (contiguousColumns)
+        {
+          memcpy(outputRowPtr + firstValidColumn, inputRowPtr + columnTable[firstValidColumn],
+            (lastValidColumn - firstValidColumn + 1) * sizeof(T));
+        }
+        else
+        {
+          for (int i=firstValidColumn; i<=lastValidColumn; ++i)
+          {
+            outputRowPtr[i] = (columnTable[i] < 0 ? static_cast<T>(0) : inputRowPtr[columnTable[i]]);
+          }
+        }
+        std::fill(outputRowPtr + lastValidColumn + 1, outputRowPtr + outputDimensions[0], static_cast<T>(0));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Shared data of the transform sampling threads. Each thread samples a slab of grid slices
+  /// and only writes the displacements of its own slices.
+  struct TransformSamplingData
+  {
+    vtkAbstractTransform* Transform;
+    vtkImageData* Grid;
+    int NumberOfSlabs;
+  };
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE SampleTransformThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    TransformSamplingData* data = static_cast<TransformSamplingData*>(threadInfo->UserData);
+    int slabIndex = threadInfo->ThreadID;
+    if (!data || slabIndex >= data->NumberOfSlabs)
+    {
+      return VTK_THREAD_RETURN_VALUE;
+    }
+
+    int dimensions[3] = {0, 0, 0};
+    data->Grid->GetDimensions(dimensions);
+    double origin[3] = {0.0, 0.0, 0.0};
+    data->Grid->GetOrigin(origin);
+    double spacing[3] = {0.0, 0.0, 0.0};
+    data->Grid->GetSpacing(spacing);
+    int firstSlice = (int)((vtkIdType)dimensions[2] * slabIndex / data->NumberOfSlabs);
+    int lastSlice = (int)((vtkIdType)dimensions[2] * (slabIndex+1) / data->NumberOfSlabs) - 1;
+
+    double* displacementPtr = static_cast<double*>(data->Grid->GetScalarPointer())
+      + 3 * (vtkIdType)firstSlice * dimensions[1] * dimensions[0];
+    double point[3] = {0.0, 0.0, 0.0};
+    double transformedPoint[3] = {0.0, 0.0, 0.0};
+    for (int k=firstSlice; k<=lastSlice; ++k)
+    {
+      point[2] = origin[2] + k * spacing[2];
+      for (int j=0; j<dimensions[1]; ++j)
+      {
+        point[1] = origin[1] + j * spacing[1];
+        for (int i=0; i<dimensions[0]; ++i, displacementPtr += 3)
+        {
+          point[0] = origin[0] + i * spacing[0];
+          // The transform has been updated before starting the threads, so the internal method can be called safely
+          data->Transform->InternalTransformPoint(point, transformedPoint);
+          displacementPtr[0] = transformedPoint[0] - point[0];
+          displacementPtr[1] = transformedPoint[1] - point[1];
+          displacementPtr[2] = transformedPoint[2] - point[2];
+        }
+      }
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
 
 vtkStandardNewMacro(vtkOrientedImageDataResample);
 
@@ -57,6 +303,17 @@ bool vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage
     return false;
   }
 
+  // Apply the pending transform of the input in the same resampling step, so that the voxels are interpolated only once
+  if (inputImage->GetPendingTransform())
+  {
+    vtkSmartPointer<vtkMatrix4x4> referenceImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    referenceImage->GetImageToWorldMatrix(referenceImageToWorldMatrix);
+    int referenceExtent[6] = {0,-1,0,-1,0,-1};
+    referenceImage->GetExtent(referenceExtent);
+    return vtkOrientedImageDataResample::ResampleImageWithPendingTransform(inputImage, inputImage->GetExtent(), referenceImageToWorldMatrix,
+      referenceExtent, padImage, linearInterpolation, outputImage);
+  }
+
   // Get transform between input and reference
   vtkSmartPointer<vtkTransform> inputImageToReferenceImageTransform = vtkSmartPointer<vtkTransform>::New();
   vtkOrientedImageDataResample::GetTransformBetweenOrientedImages(inputImage, referenceImage, inputImageToReferenceImageTransform);
@@ -90,44 +347,12 @@ bool vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage
   referenceImageToInputImageTransform->Concatenate(inputImageToReferenceImageTransform);
   referenceImageToInputImageTransform->Inverse();
 
-  // Create clone for input image that has an identity geometry
-  //TODO: Creating a new vtkOrientedImageReslice class would be a better solution on the long run
-  vtkSmartPointer<vtkMatrix4x4> identityMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  identityMatrix->Identity();
-  vtkSmartPointer<vtkOrientedImageData> identityInputImage = vtkSmartPointer<vtkOrientedImageData>::New();
-  identityInputImage->ShallowCopy(inputImage);
-  identityInputImage->SetGeometryFromImageToWorldMatrix(identityMatrix);
-
-  // Perform resampling
-  vtkSmartPointer<vtkImageReslice> resliceFilter = vtkSmartPointer<vtkImageReslice>::New();
-#if (VTK_MAJOR_VERSION <= 5)
-  resliceFilter->SetInput(identityInputImage);
-#else
-  resliceFilter->SetInputData(identityInputImage);
-#endif
-  resliceFilter->SetOutputOrigin(0, 0, 0);
-  resliceFilter->SetOutputSpacing(1, 1, 1);
-  resliceFilter->SetOutputExtent(unionExtent);
-
-  resliceFilter->SetResliceTransform(referenceImageToInputImageTransform);
-
-  // Set interpolation mode
-  if (linearInterpolation)
-  {
-    resliceFilter->SetInterpolationModeToLinear();
-  }
-  else
-  {
-    resliceFilter->SetInterpolationModeToNearestNeighbor();
-  }
-  resliceFilter->Update();
-
   // Get reference geometry to set after copying result into output
   vtkSmartPointer<vtkMatrix4x4> referenceImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   referenceImage->GetImageToWorldMatrix(referenceImageToWorldMatrix);
 
-  // Set output
-  outputImage->DeepCopy(resliceFilter->GetOutput());
+  // Perform resampling
+  vtkOrientedImageDataResample::ResampleImageIjk(inputImage, referenceImageToInputImageTransform, unionExtent, linearInterpolation, outputImage);
   outputImage->SetGeometryFromImageToWorldMatrix(referenceImageToWorldMatrix);
 
   return true;
@@ -141,92 +366,21 @@ bool vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(vtkO
     return false;
   }
 
-  // Only support the following scalar types
-  int inputImageScalarType = inputImage->GetScalarType();
-  if ( inputImageScalarType != VTK_UNSIGNED_CHAR
-    && inputImageScalarType != VTK_UNSIGNED_SHORT
-    && inputImageScalarType != VTK_SHORT )
+  // Determine IJK extent of contained data (non-zero voxels) in the input image
+  int effectiveInputExtent[6] = {0,-1,0,-1,0,-1};
+  if (!vtkOrientedImageDataResample::CalculateEffectiveExtent(inputImage, effectiveInputExtent))
   {
-    vtkErrorWithObjectMacro(inputImage, "ResampleOrientedImageToReferenceGeometry: Input image scalar type must be unsigned char, unsighed short, or short!");
+    // Return with failure if effective input extent is empty
     return false;
   }
 
-  // Determine IJK extent of contained data (non-zero voxels) in the input image
-  int inputExtent[6] = {0,-1,0,-1,0,-1};
-  inputImage->GetExtent(inputExtent);
-  int inputDimensions[3] = {0, 0, 0};
-  inputImage->GetDimensions(inputDimensions);
-  int effectiveInputExtent[6] = {inputExtent[1], inputExtent[0], inputExtent[3], inputExtent[2], inputExtent[5], inputExtent[4]};
-  // Handle three scalar types
-  unsigned char* imagePtrUChar = (unsigned char*)inputImage->GetScalarPointerForExtent(inputExtent);
-  unsigned short* imagePtrUShort = (unsigned short*)inputImage->GetScalarPointerForExtent(inputExtent);
-  short* imagePtrShort = (short*)inputImage->GetScalarPointerForExtent(inputExtent);
-
-  for (int i=0; i<inputDimensions[0]; ++i)
-  {
-    for (int j=0; j<inputDimensions[1]; ++j)
-    {
-      for (int k=0; k<inputDimensions[2]; ++k)
-      {
-        int voxelValue = 0;
-        if (inputImageScalarType == VTK_UNSIGNED_CHAR)
-        {
-          voxelValue = (*(imagePtrUChar + i + j*inputDimensions[0] + k*inputDimensions[0]*inputDimensions[1]));
-        }
-        else if (inputImageScalarType == VTK_UNSIGNED_SHORT)
-        {
-          voxelValue = (*(imagePtrUShort + i + j*inputDimensions[0] + k*inputDimensions[0]*inputDimensions[1]));
-        }
-        else if (inputImageScalarType == VTK_SHORT)
-        {
-          voxelValue = (*(imagePtrShort + i + j*inputDimensions[0] + k*inputDimensions[0]*inputDimensions[1]));
-        }
-
-        if (voxelValue != 0)
-        {
-          if (i < effectiveInputExtent[0])
-          {
-            effectiveInputExtent[0] = i;
-          }
-          if (i > effectiveInputExtent[1])
-          {
-            effectiveInputExtent[1] = i;
-          }
-          if (j < effectiveInputExtent[2])
-          {
-            effectiveInputExtent[2] = j;
-          }
-          if (j > effectiveInputExtent[3])
-          {
-            effectiveInputExtent[3] = j;
-          }
-          if (k < effectiveInputExtent[4])
-          {
-            effectiveInputExtent[4] = k;
-          }
-          if (k > effectiveInputExtent[5])
-          {
-            effectiveInputExtent[5] = k;
-          }
-        }
-      }
-    }
-  }
-
-  // Return with failure if effective input extent is empty
-  if ( effectiveInputExtent[0] == effectiveInputExtent[1] || effectiveInputExtent[2] == effectiveInputExtent[3] || effectiveInputExtent[4] == effectiveInputExtent[5] )
+  // Apply the pending transform of the input in the same resampling step, so that the voxels are interpolated only once
+  if (inputImage->GetPendingTransform())
   {
-    return false;
+    return vtkOrientedImageDataResample::ResampleImageWithPendingTransform(inputImage, effectiveInputExtent, referenceToWorldMatrix,
+      NULL, false, linearInterpolation, outputImage);
   }
 
-  // Apply extent offset on calculated effective extent
-  effectiveInputExtent[0] = effectiveInputExtent[0] + inputExtent[0];
-  effectiveInputExtent[1] = effectiveInputExtent[1] + inputExtent[0];
-  effectiveInputExtent[2] = effectiveInputExtent[2] + inputExtent[2];
-  effectiveInputExtent[3] = effectiveInputExtent[3] + inputExtent[2];
-  effectiveInputExtent[4] = effectiveInputExtent[4] + inputExtent[4];
-  effectiveInputExtent[5] = effectiveInputExtent[5] + inputExtent[4];
-
   // Assemble transform
   vtkSmartPointer<vtkTransform> referenceImageToInputImageTransform = vtkSmartPointer<vtkTransform>::New();
   referenceImageToInputImageTransform->Identity();
@@ -258,15 +412,154 @@ bool vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(vtkO
   vtkOrientedImageDataResample::TransformExtent(effectiveInputExtent, referenceImageToInputImageTransform, outputExtent);
 
   // Return with failure if effective output extent is empty
-  if ( outputExtent[0] == outputExtent[1]
-    || outputExtent[2] == outputExtent[3]
-    || outputExtent[4] == outputExtent[5] )
+  if ( outputExtent[0] > outputExtent[1]
+    || outputExtent[2] > outputExtent[3]
+    || outputExtent[4] > outputExtent[5] )
   {
     return false;
   }
 
+  // Perform resampling
+  vtkOrientedImageDataResample::ResampleImageIjk(inputImage, inputImageToReferenceImageTransform, outputExtent, linearInterpolation, outputImage);
+  outputImage->SetGeometryFromImageToWorldMatrix(referenceToWorldMatrix);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedImageDataResample::CalculateEffectiveExtent(vtkImageData* image, int effectiveExtent[6])
+{
+  effectiveExtent[0] = effectiveExtent[2] = effectiveExtent[4] = 0;
+  effectiveExtent[1] = effectiveExtent[3] = effectiveExtent[5] = -1;
+  if (!image || !image->GetPointData() || !image->GetPointData()->GetScalars())
+  {
+    return false;
+  }
+
+  int extent[6] = {0,-1,0,-1,0,-1};
+  image->GetExtent(extent);
+  int dimensions[3] = {0, 0, 0};
+  image->GetDimensions(dimensions);
+  if (dimensions[0] <= 0 || dimensions[1] <= 0 || dimensions[2] <= 0)
+  {
+    return false;
+  }
+
+  // Split the image into slabs of slices that are scanned in parallel
+  vtkIdType numberOfVoxels = (vtkIdType)dimensions[0] * dimensions[1] * dimensions[2];
+  int numberOfSlabs = (int)std::min( (vtkIdType)vtkMultiThreader::GetGlobalDefaultNumberOfThreads(),
+    numberOfVoxels / MINIMUM_NUMBER_OF_VOXELS_PER_THREAD );
+  numberOfSlabs = std::min(numberOfSlabs, std::min(dimensions[2], (int)VTK_MAX_THREADS));
+
+  int zeroBasedEffectiveExtent[6] = {0,-1,0,-1,0,-1};
+  if (numberOfSlabs < 2)
+  {
+    CalculateEffectiveExtentInSlab(image, 0, dimensions[2]-1, zeroBasedEffectiveExtent);
+  }
+  else
+  {
+    EffectiveExtentScanData data;
+    data.Image = image;
+    data.NumberOfSlabs = numberOfSlabs;
+    data.SlabEffectiveExtents.resize(6*numberOfSlabs, 0);
+
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfSlabs);
+    threader->SetSingleMethod(CalculateEffectiveExtentThreadFunction, &data);
+    threader->SingleMethodExecute();
+
+    // Merge slab extents
+    zeroBasedEffectiveExtent[0] = dimensions[0];
+    zeroBasedEffectiveExtent[2] = dimensions[1];
+    zeroBasedEffectiveExtent[4] = dimensions[2];
+    for (int slabIndex=0; slabIndex<numberOfSlabs; ++slabIndex)
+    {
+      int* slabEffectiveExtent = &data.SlabEffectiveExtents[6*slabIndex];
+      for (int axis=0; axis<3; ++axis)
+      {
+        zeroBasedEffectiveExtent[2*axis] = std::min(zeroBasedEffectiveExtent[2*axis], slabEffectiveExtent[2*axis]);
+        zeroBasedEffectiveExtent[2*axis+1] = std::max(zeroBasedEffectiveExtent[2*axis+1], slabEffectiveExtent[2*axis+1]);
+      }
+    }
+  }
+
+  if (zeroBasedEffectiveExtent[1] < zeroBasedEffectiveExtent[0])
+  {
+    // No non-zero voxels
+    return false;
+  }
+
+  // Apply extent offset on calculated effective extent
+  for (int axis=0; axis<3; ++axis)
+  {
+    effectiveExtent[2*axis] = zeroBasedEffectiveExtent[2*axis] + extent[2*axis];
+    effectiveExtent[2*axis+1] = zeroBasedEffectiveExtent[2*axis+1] + extent[2*axis];
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedImageDataResample::ResampleImageIjk(vtkOrientedImageData* inputImage, vtkTransform* outputToInputIjkTransform, int outputExtent[6], bool linearInterpolation, vtkImageData* outputImage)
+{
+  if (!inputImage || !outputToInputIjkTransform || !outputImage)
+  {
+    return;
+  }
+
+  // Use separable nearest neighbor resampling if the transform is axis-aligned (only scaling, flipping and translation)
+  vtkMatrix4x4* outputToInputIjkMatrix = outputToInputIjkTransform->GetMatrix();
+  bool axisAligned = true;
+  for (int row=0; row<3; ++row)
+  {
+    for (int column=0; column<3; ++column)
+    {
+      double element = outputToInputIjkMatrix->GetElement(row, column);
+      if ( (row == column && fabs(element) < AXIS_ALIGNED_TOLERANCE)
+        || (row != column && fabs(element) > AXIS_ALIGNED_TOLERANCE) )
+      {
+        axisAligned = false;
+      }
+    }
+  }
+  if (!linearInterpolation && axisAligned && inputImage->GetNumberOfScalarComponents() == 1
+    && inputImage->GetPointData() && inputImage->GetPointData()->GetScalars())
+  {
+    int inputExtent[6] = {0,-1,0,-1,0,-1};
+    inputImage->GetExtent(inputExtent);
+    std::vector<int> indexTables[3];
+    for (int axis=0; axis<3; ++axis)
+    {
+      BuildNearestNeighborIndexTable(outputToInputIjkMatrix->GetElement(axis, axis), outputToInputIjkMatrix->GetElement(axis, 3),
+        outputExtent[2*axis], outputExtent[2*axis+1], inputExtent[2*axis], inputExtent[2*axis+1], indexTables[axis]);
+    }
+
+    // Resample into a new image so that the input and output image can be the same
+    vtkSmartPointer<vtkImageData> resampledImage = vtkSmartPointer<vtkImageData>::New();
+    resampledImage->SetExtent(outputExtent);
+#if (VTK_MAJOR_VERSION <= 5)
+    resampledImage->SetScalarType(inputImage->GetScalarType());
+    resampledImage->SetNumberOfScalarComponents(1);
+    resampledImage->AllocateScalars();
+#else
+    resampledImage->AllocateScalars(inputImage->GetScalarType(), 1);
+#endif
+
+    void* inputPtr = inputImage->GetScalarPointer();
+    void* outputPtr = resampledImage->GetScalarPointer();
+    switch (inputImage->GetScalarType())
+    {
+      vtkTemplateMacro(ResampleNearestNeighborSeparableTemplate(inputImage, static_cast<VTK_TT*>(inputPtr),
+        resampledImage, static_cast<VTK_TT*>(outputPtr), indexTables));
+      default:
+        break;
+    }
+
+    outputImage->ShallowCopy(resampledImage);
+    return;
+  }
+
   // Create clone for input image that has an identity geometry
-  //TODO: vtkOrientedImageReslice would be a better solution on the long run
+  //TODO: Creating a new vtkOrientedImageReslice class would be a better solution on the long run
   vtkSmartPointer<vtkMatrix4x4> identityMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   identityMatrix->Identity();
   vtkSmartPointer<vtkOrientedImageData> identityInputImage = vtkSmartPointer<vtkOrientedImageData>::New();
@@ -284,7 +577,7 @@ bool vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(vtkO
   resliceFilter->SetOutputSpacing(1, 1, 1);
   resliceFilter->SetOutputExtent(outputExtent);
 
-  resliceFilter->SetResliceTransform(inputImageToReferenceImageTransform);
+  resliceFilter->SetResliceTransform(outputToInputIjkTransform);
 
   // Set interpolation mode
   if (linearInterpolation)
@@ -299,9 +592,6 @@ bool vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(vtkO
 
   // Set output
   outputImage->DeepCopy(resliceFilter->GetOutput());
-  outputImage->SetGeometryFromImageToWorldMatrix(referenceToWorldMatrix);
-
-  return true;
 }
 
 //---------------------------------------------------------------------------
@@ -625,7 +915,7 @@ bool vtkOrientedImageDataResample::PadImageToContainImage(vtkOrientedImageData*
 }
 
 //----------------------------------------------------------------------------
-void vtkOrientedImageDataResample::TransformOrientedImage(vtkOrientedImageData* image, vtkAbstractTransform* transform, bool geometryOnly/* = false*/)
+void vtkOrientedImageDataResample::TransformOrientedImage(vtkOrientedImageData* image, vtkAbstractTransform* transform, bool geometryOnly/* = false*/, vtkAbstractTransform* inverseTransform/* = NULL*/)
 {
   if (!image || !transform)
   {
@@ -688,15 +978,16 @@ void vtkOrientedImageDataResample::TransformOrientedImage(vtkOrientedImageData*
     identityInputImage->ShallowCopy(image);
     identityInputImage->SetGeometryFromImageToWorldMatrix(identityMatrix);
 
-    // Invert input transform, so it becomes transformedWorldToWorld transform
-    transform->Inverse();
+    // Get transformedWorldToWorld transform. The inverse is requested from the input transform instead of
+    // inverting it in place, so that the input transform remains unchanged
+    vtkAbstractTransform* transformedWorldToWorldTransform = (inverseTransform ? inverseTransform : transform->GetInverse());
 
     // Create reslice transform
     vtkSmartPointer<vtkGeneralTransform> resliceTransform = vtkSmartPointer<vtkGeneralTransform>::New();
     resliceTransform->Identity();
     resliceTransform->PostMultiply();
     resliceTransform->Concatenate(imageToWorldMatrix);
-    resliceTransform->Concatenate(transform);
+    resliceTransform->Concatenate(transformedWorldToWorldTransform);
     resliceTransform->Concatenate(worldToImageMatrix);
 
     // Perform resampling
@@ -721,3 +1012,219 @@ void vtkOrientedImageDataResample::TransformOrientedImage(vtkOrientedImageData*
     image->SetGeometryFromImageToWorldMatrix(imageToWorldMatrix);
   }
 }
+
+//----------------------------------------------------------------------------
+bool vtkOrientedImageDataResample::SampleTransformToGrid(vtkAbstractTransform* transform, const double bounds[6], const double spacing[3], vtkGridTransform* gridTransform)
+{
+  if (!transform || !gridTransform)
+  {
+    return false;
+  }
+
+  int dimensions[3] = {0, 0, 0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    if (spacing[axis] <= 0.0 || bounds[2*axis] > bounds[2*axis+1])
+    {
+      vtkErrorWithObjectMacro(transform, "vtkOrientedImageDataResample::SampleTransformToGrid: Invalid grid bounds or spacing");
+      return false;
+    }
+    dimensions[axis] = (int)ceil( (bounds[2*axis+1] - bounds[2*axis]) / spacing[axis] ) + 1;
+  }
+
+  vtkSmartPointer<vtkImageData> displacementGrid = vtkSmartPointer<vtkImageData>::New();
+  displacementGrid->SetOrigin(bounds[0], bounds[2], bounds[4]);
+  displacementGrid->SetSpacing(spacing[0], spacing[1], spacing[2]);
+  displacementGrid->SetExtent(0, dimensions[0]-1, 0, dimensions[1]-1, 0, dimensions[2]-1);
+#if (VTK_MAJOR_VERSION <= 5)
+  displacementGrid->SetScalarTypeToDouble();
+  displacementGrid->SetNumberOfScalarComponents(3);
+  displacementGrid->AllocateScalars();
+#else
+  displacementGrid->AllocateScalars(VTK_DOUBLE, 3);
+#endif
+
+  // Make sure the transform is up-to-date, as the threads only call its internal (non-updating) methods
+  transform->Update();
+
+  // Sample the transform in slabs of slices in parallel
+  TransformSamplingData data;
+  data.Transform = transform;
+  data.Grid = displacementGrid;
+  data.NumberOfSlabs = std::min( std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), dimensions[2]), (int)VTK_MAX_THREADS );
+  data.NumberOfSlabs = std::max(data.NumberOfSlabs, 1);
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(data.NumberOfSlabs);
+  threader->SetSingleMethod(SampleTransformThreadFunction, &data);
+  threader->SingleMethodExecute();
+
+#if (VTK_MAJOR_VERSION <= 5)
+  gridTransform->SetDisplacementGrid(displacementGrid);
+#else
+  gridTransform->SetDisplacementGridData(displacementGrid);
+#endif
+  gridTransform->SetDisplacementScale(1.0);
+  gridTransform->SetDisplacementShift(0.0);
+  gridTransform->SetInterpolationModeToLinear();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedImageDataResample::TransformOrientedImageDeferred(vtkOrientedImageData* image, vtkAbstractTransform* transform)
+{
+  if (!image || !transform)
+  {
+    return;
+  }
+
+  // Linear transform only changes the geometry, which needs no resampling
+  vtkSmartPointer<vtkTransform> linearTransform = vtkSmartPointer<vtkTransform>::New();
+  if (!image->GetPendingTransform() && vtkOrientedImageDataResample::IsTransformLinear(transform, linearTransform))
+  {
+    vtkOrientedImageDataResample::TransformOrientedImage(image, linearTransform);
+    return;
+  }
+
+  // Concatenate transform to the pending transform. A new pending transform is created, as the current one
+  // may be shared with copies of the image. Input transform is copied, as it may be changed by the caller.
+  vtkSmartPointer<vtkAbstractTransform> transformCopy = vtkSmartPointer<vtkAbstractTransform>::Take(transform->MakeTransform());
+  transformCopy->DeepCopy(transform);
+  vtkSmartPointer<vtkGeneralTransform> pendingTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+  pendingTransform->PostMultiply();
+  if (image->GetPendingTransform())
+  {
+    pendingTransform->Concatenate(image->GetPendingTransform());
+  }
+  pendingTransform->Concatenate(transformCopy);
+  image->SetPendingTransform(pendingTransform);
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedImageDataResample::ApplyPendingTransform(vtkOrientedImageData* image)
+{
+  if (!image || !image->GetPendingTransform())
+  {
+    return;
+  }
+
+  vtkSmartPointer<vtkAbstractTransform> pendingTransform = image->GetPendingTransform();
+  image->SetPendingTransform(NULL);
+  vtkOrientedImageDataResample::TransformOrientedImage(image, pendingTransform);
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedImageDataResample::ResampleImageWithPendingTransform(vtkOrientedImageData* inputImage, int inputExtent[6], vtkMatrix4x4* referenceToWorldMatrix,
+  int* referenceExtent, bool padImage, bool linearInterpolation, vtkOrientedImageData* outputImage)
+{
+  if (!inputImage || !referenceToWorldMatrix || !outputImage)
+  {
+    return false;
+  }
+
+  // Keep reference to the pending transform, as the input image may be the same as the output image
+  vtkSmartPointer<vtkAbstractTransform> pendingTransform = inputImage->GetPendingTransform();
+  if (!pendingTransform.GetPointer())
+  {
+    vtkErrorWithObjectMacro(inputImage, "vtkOrientedImageDataResample::ResampleImageWithPendingTransform: Input image has no pending transform");
+    return false;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> inputImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  inputImage->GetImageToWorldMatrix(inputImageToWorldMatrix);
+  vtkSmartPointer<vtkMatrix4x4> worldToInputImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  worldToInputImageMatrix->DeepCopy(inputImageToWorldMatrix);
+  worldToInputImageMatrix->Invert();
+  vtkSmartPointer<vtkMatrix4x4> worldToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  worldToReferenceMatrix->DeepCopy(referenceToWorldMatrix);
+  worldToReferenceMatrix->Invert();
+
+  // Determine output extent
+  int outputExtent[6] = {0,-1,0,-1,0,-1};
+  if (referenceExtent)
+  {
+    std::copy(referenceExtent, referenceExtent+6, outputExtent);
+  }
+  if (!referenceExtent || padImage)
+  {
+    // Get bounds of the transformed input extent in world coordinates
+    vtkSmartPointer<vtkOrientedImageData> inputGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
+    inputGeometryImage->SetGeometryFromImageToWorldMatrix(inputImageToWorldMatrix);
+    inputGeometryImage->SetExtent(inputExtent);
+    double transformedBoundsWorld[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+    vtkOrientedImageDataResample::TransformOrientedImageDataBounds(inputGeometryImage, pendingTransform, transformedBoundsWorld);
+
+    // Get extent containing all bounding box corners in the reference frame
+    int transformedExtent[6] = {VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN};
+    for (int corner=0; corner<8; ++corner)
+    {
+      double cornerWorld[4] = { transformedBoundsWorld[corner & 1], transformedBoundsWorld[2 + ((corner>>1) & 1)], transformedBoundsWorld[4 + ((corner>>2) & 1)], 1.0 };
+      double cornerReference[4] = {0.0, 0.0, 0.0, 1.0};
+      worldToReferenceMatrix->MultiplyPoint(cornerWorld, cornerReference);
+      for (int axis=0; axis<3; ++axis)
+      {
+        transformedExtent[2*axis] = std::min(transformedExtent[2*axis], (int)floor(cornerReference[axis]));
+        transformedExtent[2*axis+1] = std::max(transformedExtent[2*axis+1], (int)ceil(cornerReference[axis]));
+      }
+    }
+
+    for (int axis=0; axis<3; ++axis)
+    {
+      bool referenceExtentValid = (referenceExtent && outputExtent[2*axis] <= outputExtent[2*axis+1]);
+      outputExtent[2*axis] = (referenceExtentValid ? std::min(outputExtent[2*axis], transformedExtent[2*axis]) : transformedExtent[2*axis]);
+      outputExtent[2*axis+1] = (referenceExtentValid ? std::max(outputExtent[2*axis+1], transformedExtent[2*axis+1]) : transformedExtent[2*axis+1]);
+    }
+  }
+
+  // Return with failure if output extent is empty
+  if (outputExtent[0] > outputExtent[1] || outputExtent[2] > outputExtent[3] || outputExtent[4] > outputExtent[5])
+  {
+    return false;
+  }
+
+  // Create reslice transform: output (reference) IJK -> world -> input world (inverse of pending transform) -> input IJK
+  vtkSmartPointer<vtkGeneralTransform> resliceTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+  resliceTransform->Identity();
+  resliceTransform->PostMultiply();
+  resliceTransform->Concatenate(referenceToWorldMatrix);
+  resliceTransform->Concatenate(pendingTransform->GetInverse());
+  resliceTransform->Concatenate(worldToInputImageMatrix);
+
+  // Create clone for input image that has an identity geometry
+  vtkSmartPointer<vtkMatrix4x4> identityMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  identityMatrix->Identity();
+  vtkSmartPointer<vtkOrientedImageData> identityInputImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  identityInputImage->ShallowCopy(inputImage);
+  identityInputImage->SetGeometryFromImageToWorldMatrix(identityMatrix);
+  identityInputImage->SetPendingTransform(NULL);
+
+  // Perform resampling
+  vtkSmartPointer<vtkImageReslice> resliceFilter = vtkSmartPointer<vtkImageReslice>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  resliceFilter->SetInput(identityInputImage);
+#else
+  resliceFilter->SetInputData(identityInputImage);
+#endif
+  resliceFilter->SetBackgroundColor(0, 0, 0, 0);
+  resliceFilter->AutoCropOutputOff();
+  resliceFilter->SetOutputOrigin(0, 0, 0);
+  resliceFilter->SetOutputSpacing(1, 1, 1);
+  resliceFilter->SetOutputExtent(outputExtent);
+  resliceFilter->SetResliceTransform(resliceTransform);
+  if (linearInterpolation)
+  {
+    resliceFilter->SetInterpolationModeToLinear();
+  }
+  else
+  {
+    resliceFilter->SetInterpolationModeToNearestNeighbor();
+  }
+  resliceFilter->Update();
+
+  // Set output. The pending transform has been applied
+  outputImage->DeepCopy(resliceFilter->GetOutput());
+  outputImage->SetGeometryFromImageToWorldMatrix(referenceToWorldMatrix);
+  outputImage->SetPendingTransform(NULL);
+
+  return true;
+}
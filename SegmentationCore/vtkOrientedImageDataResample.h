@@ -26,10 +26,12 @@
 
 #include "vtkObject.h"
 
+class vtkImageData;
 class vtkOrientedImageData;
 class vtkMatrix4x4;
 class vtkTransform;
 class vtkAbstractTransform;
+class vtkGridTransform;
 
 /// \ingroup SegmentationCore
 /// \brief Utility functions for resampling oriented image data
@@ -46,6 +48,7 @@ public:
   /// \param outputImage Output image
   /// \param linearInterpolation True if linear interpolation is requested (fractional labelmap), or false for nearest neighbor (binary labelmap). Default is false.
   /// \return Success flag
+  /// Note: The pending transform of the input image is applied in the same resampling step (\sa TransformOrientedImageDeferred)
   static bool ResampleOrientedImageToReferenceGeometry(vtkOrientedImageData* inputImage, vtkMatrix4x4* referenceGeometryMatrix, vtkOrientedImageData* outputImage, bool linearInterpolation=false);
 
   /// Resample an oriented image data to match the geometry of a reference oriented image data
@@ -56,6 +59,8 @@ public:
   /// \param padImage If enabled then it is made sure that the input image's extent fits into the resampled reference image, so if part of the extent is transformed
   ///          to be outside the reference extent, then it is padded. Disabled by default.
   /// \return Success flag
+  /// Note: The pending transform of the input image is applied in the same resampling step (\sa TransformOrientedImageDeferred).
+  ///   Pending transform of the reference image is ignored.
   static bool ResampleOrientedImageToReferenceOrientedImage(vtkOrientedImageData* inputImage, vtkOrientedImageData* referenceImage, vtkOrientedImageData* outputImage, bool linearInterpolation=false, bool padImage=false);
 
   /// Transform an oriented image data using a transform that can be linear or non-linear.
@@ -65,7 +70,33 @@ public:
   /// \param transform Input transform
   /// \param geometryOnly Only the geometry of the image is changed according to the transform if this flag is turned on.
   ///          This flag only has an effect if the transform is non-linear, in which case only the extent is changed. Off by default
-  static void TransformOrientedImage(vtkOrientedImageData* image, vtkAbstractTransform* transform, bool geometryOnly = false);
+  /// \param inverseTransform Inverse of the input transform, used for resampling if the transform is non-linear. If NULL (default)
+  ///          then the inverse is requested from the input transform. A displacement grid created by \sa SampleTransformToGrid can be
+  ///          specified to avoid evaluating an expensive (often iteratively computed) inverse for each voxel
+  static void TransformOrientedImage(vtkOrientedImageData* image, vtkAbstractTransform* transform, bool geometryOnly = false, vtkAbstractTransform* inverseTransform = NULL);
+
+  /// Sample a transform on a regular grid and set the displacements to a grid transform. Evaluating the grid transform
+  /// only needs a trilinear lookup, so it is much faster than evaluating complex non-linear transforms for many voxels or points.
+  /// The transform is sampled on multiple threads.
+  /// \param transform Transform to sample
+  /// \param bounds World bounds of the sampled region. Outside the region the displacements at the grid boundary are used
+  /// \param spacing Spacing of the grid
+  /// \param gridTransform Output grid transform using linear interpolation
+  /// \return Success flag
+  static bool SampleTransformToGrid(vtkAbstractTransform* transform, const double bounds[6], const double spacing[3], vtkGridTransform* gridTransform);
+
+  /// Record a transform on an oriented image data without resampling its voxels (\sa vtkOrientedImageData::GetPendingTransform).
+  /// If there is no pending transform and the transform is linear, then it is applied on the geometry right away, as it needs no resampling.
+  /// Otherwise the transform is concatenated to the pending transform, which is applied in the next resampling
+  /// (\sa ResampleOrientedImageToReferenceOrientedImage, \sa ResampleOrientedImageToReferenceGeometry) or by \sa ApplyPendingTransform.
+  /// This way the voxels are interpolated only once when transforming and then resampling an image.
+  /// \param image Oriented image to transform
+  /// \param transform Input transform. It is copied, so it can be changed after the call
+  static void TransformOrientedImageDeferred(vtkOrientedImageData* image, vtkAbstractTransform* transform);
+
+  /// Resample the voxels of an oriented image data according to its pending transform, and clear the pending transform.
+  /// Needs to be called before accessing the voxels of an image directly if it may have a pending transform.
+  static void ApplyPendingTransform(vtkOrientedImageData* image);
 
 public:
   /// Determine if geometries of two oriented image data objects match.
@@ -99,6 +130,14 @@ public:
   /// Pad an image to entirely contain another image
   static bool PadImageToContainImage(vtkOrientedImageData* inputImage, vtkOrientedImageData* containedImage, vtkOrientedImageData* outputImage);
 
+  /// Calculate the extent of the non-zero voxels of an image (effective extent).
+  /// The image is scanned in memory order, on multiple threads for large images.
+  /// \param image Image to scan. All scalar types and any number of components are supported
+  /// \param effectiveExtent Output extent in the index space of the image extent. If the image contains
+  ///          no non-zero voxels then the extent is empty (minimum is greater than maximum)
+  /// \return True if the image contains non-zero voxels, false otherwise
+  static bool CalculateEffectiveExtent(vtkImageData* image, int effectiveExtent[6]);
+
   /// Determine if a transform is linear and return it if it is. A simple downcast is not enough, as the transform may be
   /// a general transform, which can be linear if the concatenation it contains consist of all linear transforms.
   /// \param transform Input transform to assess
@@ -106,6 +145,29 @@ public:
   /// \return True if input is linear, false otherwise. 
   static bool IsTransformLinear(vtkAbstractTransform* transform, vtkTransform* linearTransform);
 
+protected:
+  /// Resample image into the given extent with unit spacing and zero origin.
+  /// Nearest neighbor resampling with a transform that only scales, flips and translates along the axes is
+  /// performed using separable index lookup tables, other cases are handled by vtkImageReslice.
+  /// \param inputImage Image to resample. Its geometry is ignored, the transform is applied on the voxel indices
+  /// \param outputToInputIjkTransform Transform from the output voxel indices to the input voxel indices
+  /// \param outputExtent Extent of the output image
+  /// \param linearInterpolation True if linear interpolation is requested, false for nearest neighbor
+  /// \param outputImage Output image
+  static void ResampleImageIjk(vtkOrientedImageData* inputImage, vtkTransform* outputToInputIjkTransform, int outputExtent[6], bool linearInterpolation, vtkImageData* outputImage);
+
+  /// Resample an image into a reference geometry, applying its pending transform in the same step.
+  /// \param inputImage Image to resample. Its pending transform is applied (\sa vtkOrientedImageData::GetPendingTransform)
+  /// \param inputExtent Extent of the input image that needs to be contained by the output if the output extent is calculated
+  /// \param referenceToWorldMatrix Geometry of the output image
+  /// \param referenceExtent Extent of the output image. If NULL, then the output extent contains the transformed input extent
+  /// \param padImage If enabled then the output extent is the union of the reference extent and the transformed input extent
+  /// \param linearInterpolation True if linear interpolation is requested, false for nearest neighbor
+  /// \param outputImage Output image. Can be the same as the input image
+  /// \return Success flag
+  static bool ResampleImageWithPendingTransform(vtkOrientedImageData* inputImage, int inputExtent[6], vtkMatrix4x4* referenceToWorldMatrix,
+    int* referenceExtent, bool padImage, bool linearInterpolation, vtkOrientedImageData* outputImage);
+
 protected:
   vtkOrientedImageDataResample();
   ~vtkOrientedImageDataResample();
@@ -27,11 +27,314 @@
 #include <vtkNew.h>
 #include <vtkPolyData.h>
 #include <vtkCellArray.h>
-#include <vtkLine.h>
 #include <vtkPoints.h>
 #include <vtkMath.h>
 #include <vtkIdList.h>
 #include <vtkDelaunay2D.h>
+#include <vtkPointLocator.h>
+#include <vtkTimerLog.h>
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+/// Contour points and lines of the conversion stored in flat contiguous arrays.
+/// Point coordinates are mirrored from the output points, and the point IDs of
+/// all lines are stored in one array indexed by an offset table.
+class vtkPlanarContourToClosedSurfaceConversionRule::vtkInternal
+{
+public:
+  /// Copy coordinates and line point IDs from the input
+  void Initialize(vtkPoints* points, vtkCellArray* lines)
+  {
+    this->Points = points;
+
+    vtkIdType numberOfPoints = points->GetNumberOfPoints();
+    this->PointCoordinates.resize(3*numberOfPoints);
+    for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+      points->GetPoint(pointId, &this->PointCoordinates[3*pointId]);
+    }
+
+    this->LinePointIds.clear();
+    this->LineOffsets.assign(1, 0);
+    vtkIdType numberOfCellPoints = 0;
+    vtkIdType* cellPointIds = NULL;
+    lines->InitTraversal();
+    while (lines->GetNextCell(numberOfCellPoints, cellPointIds))
+    {
+      this->LinePointIds.insert(this->LinePointIds.end(), cellPointIds, cellPointIds + numberOfCellPoints);
+      this->LineOffsets.push_back(this->LinePointIds.size());
+    }
+
+    this->LineBounds.clear();
+    this->LinePointLocators.clear();
+    this->PlanePairs.clear();
+    this->LineTriangulatedToAbove.clear();
+    this->LineTriangulatedToBelow.clear();
+  }
+
+  /// Release all data of the conversion
+  void Clear()
+  {
+    this->Points = NULL;
+    std::vector<double>().swap(this->PointCoordinates);
+    std::vector<vtkIdType>().swap(this->LinePointIds);
+    std::vector<vtkIdType>().swap(this->LineOffsets);
+    std::vector<double>().swap(this->LineBounds);
+    std::vector<vtkSmartPointer<vtkPointLocator> >().swap(this->LinePointLocators);
+    std::vector<PlanePair>().swap(this->PlanePairs);
+    std::vector<unsigned char>().swap(this->LineTriangulatedToAbove);
+    std::vector<unsigned char>().swap(this->LineTriangulatedToBelow);
+  }
+
+  int GetNumberOfLines()
+  {
+    return this->LineOffsets.empty() ? 0 : static_cast<int>(this->LineOffsets.size()) - 1;
+  }
+
+  int GetNumberOfPointsInLine(int lineIndex)
+  {
+    return static_cast<int>(this->LineOffsets[lineIndex+1] - this->LineOffsets[lineIndex]);
+  }
+
+  vtkIdType* GetLinePointIds(int lineIndex)
+  {
+    return this->LinePointIds.empty() ? NULL : &this->LinePointIds[0] + this->LineOffsets[lineIndex];
+  }
+
+  /// Get coordinates of a point. The returned pointer is invalidated by InsertNextPoint.
+  const double* GetPoint(vtkIdType pointId)
+  {
+    return &this->PointCoordinates[3*pointId];
+  }
+
+  /// Add point to the output points and the mirrored coordinates
+  vtkIdType InsertNextPoint(const double point[3])
+  {
+    vtkIdType pointId = this->Points->InsertNextPoint(point);
+    // Read back the stored coordinates, as the point array may be single precision
+    double storedPoint[3] = {0.0, 0.0, 0.0};
+    this->Points->GetPoint(pointId, storedPoint);
+    this->PointCoordinates.insert(this->PointCoordinates.end(), storedPoint, storedPoint + 3);
+    return pointId;
+  }
+
+  /// Compute the bounds of all lines. Needs to be called after the lines are finalized.
+  void ComputeLineBounds()
+  {
+    int numberOfLines = this->GetNumberOfLines();
+    this->LineBounds.resize(6*numberOfLines);
+    for (int lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
+    {
+      double* bounds = &this->LineBounds[6*lineIndex];
+      int numberOfPointsInLine = this->GetNumberOfPointsInLine(lineIndex);
+      if (numberOfPointsInLine == 0)
+      {
+        vtkMath::UninitializeBounds(bounds);
+        continue;
+      }
+      const vtkIdType* pointIds = this->GetLinePointIds(lineIndex);
+      const double* firstPoint = this->GetPoint(pointIds[0]);
+      bounds[0] = bounds[1] = firstPoint[0];
+      bounds[2] = bounds[3] = firstPoint[1];
+      bounds[4] = bounds[5] = firstPoint[2];
+      for (int pointIndex = 1; pointIndex < numberOfPointsInLine; ++pointIndex)
+      {
+        const double* point = this->GetPoint(pointIds[pointIndex]);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+          bounds[2*axis] = std::min(bounds[2*axis], point[axis]);
+          bounds[2*axis+1] = std::max(bounds[2*axis+1], point[axis]);
+        }
+      }
+    }
+
+    this->LinePointLocators.clear();
+    this->LinePointLocators.resize(numberOfLines);
+  }
+
+  double* GetLineBounds(int lineIndex)
+  {
+    return &this->LineBounds[6*lineIndex];
+  }
+
+  /// Get point locator for the points of a line. Locators are only built when first requested,
+  /// as they are only needed for lines that overlap with multiple lines on the neighboring plane.
+  vtkPointLocator* GetLinePointLocator(int lineIndex)
+  {
+    if (!this->LinePointLocators[lineIndex])
+    {
+      int numberOfPointsInLine = this->GetNumberOfPointsInLine(lineIndex);
+      const vtkIdType* pointIds = this->GetLinePointIds(lineIndex);
+      vtkSmartPointer<vtkPoints> linePoints = vtkSmartPointer<vtkPoints>::New();
+      linePoints->SetDataTypeToDouble();
+      linePoints->SetNumberOfPoints(numberOfPointsInLine);
+      for (int pointIndex = 0; pointIndex < numberOfPointsInLine; ++pointIndex)
+      {
+        linePoints->SetPoint(pointIndex, this->GetPoint(pointIds[pointIndex]));
+      }
+      vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
+      linePolyData->SetPoints(linePoints);
+
+      vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
+      pointLocator->SetDataSet(linePolyData);
+      pointLocator->BuildLocator();
+      this->LinePointLocators[lineIndex] = pointLocator;
+    }
+    return this->LinePointLocators[lineIndex];
+  }
+
+public:
+  /// Output points (input contour points and the points of the external lines)
+  vtkSmartPointer<vtkPoints> Points;
+  /// Point coordinates (x, y, z for each point), same as Points
+  std::vector<double> PointCoordinates;
+  /// Point IDs of all lines stored contiguously
+  std::vector<vtkIdType> LinePointIds;
+  /// Start index of each line in LinePointIds, followed by the total number of line point IDs
+  std::vector<vtkIdType> LineOffsets;
+  /// Bounds of each line (6 values per line)
+  std::vector<double> LineBounds;
+  /// Point locators for the points of each line (built on demand)
+  std::vector<vtkSmartPointer<vtkPointLocator> > LinePointLocators;
+
+  /// Lines of two consecutive planes to be connected
+  struct PlanePair
+  {
+    int FirstLineOnPlane1Index;
+    int NumberOfLinesInPlane1;
+    int FirstLineOnPlane2Index;
+    int NumberOfLinesInPlane2;
+    /// Each internal list represents a line from the plane and stores the
+    /// indices of the overlapping lines from the other plane
+    std::vector< std::vector< int > > Plane1Overlaps;
+    std::vector< std::vector< int > > Plane2Overlaps;
+  };
+  std::vector<PlanePair> PlanePairs;
+
+  /// Flags determining which lines are triangulated from above and from below.
+  /// Not stored as bit vector so that the flags of different lines can be set concurrently.
+  std::vector<unsigned char> LineTriangulatedToAbove;
+  std::vector<unsigned char> LineTriangulatedToBelow;
+};
+
+//----------------------------------------------------------------------------
+/// Working buffers reused by the helper functions during a conversion, so that
+/// no objects need to be allocated inside the triangulation loops.
+class vtkPlanarContourToClosedSurfaceConversionRule::vtkScratchArena
+{
+public:
+  /// Create the triangulation pipeline. It is only needed for sealing, so it is not
+  /// created for the arenas used by the plane pair triangulation threads.
+  void InitializeDelaunay()
+  {
+    if (this->Delaunay)
+    {
+      return;
+    }
+    this->DelaunayPoints = vtkSmartPointer<vtkPoints>::New();
+    this->DelaunayPoints->SetDataTypeToDouble();
+    this->DelaunayInput = vtkSmartPointer<vtkPolyData>::New();
+    this->DelaunayInput->SetPoints(this->DelaunayPoints);
+    this->DelaunayBoundary = vtkSmartPointer<vtkPolyData>::New();
+    this->DelaunayBoundary->SetPoints(this->DelaunayPoints);
+    this->Delaunay = vtkSmartPointer<vtkDelaunay2D>::New();
+#if (VTK_MAJOR_VERSION <= 5)
+    this->Delaunay->SetInput(this->DelaunayInput);
+    this->Delaunay->SetSource(this->DelaunayBoundary);
+#else
+    this->Delaunay->SetInputData(this->DelaunayInput);
+    this->Delaunay->SetSourceData(this->DelaunayBoundary);
+#endif
+    this->PolygonPointIds = vtkSmartPointer<vtkIdList>::New();
+  }
+
+public:
+  /// Dynamic programming tables of TriangulateContours (rows: line 1, columns: line 2)
+  std::vector<double> ScoreTable;
+  std::vector<int> BacktrackTable;
+  /// Closest point indices from line 1 to line 2 and vice versa
+  std::vector<int> ClosestPointsLine1;
+  std::vector<int> ClosestPointsLine2;
+
+  /// Portions of the two lines to connect, as determined by Branch
+  std::vector<vtkIdType> DividedLine1PointIds;
+  std::vector<vtkIdType> DividedLine2PointIds;
+
+  /// External line created by CreateExternalLine. The line is closed, so the last
+  /// point ID and coordinates are the same as the first ones.
+  std::vector<vtkIdType> ExternalLinePointIds;
+  std::vector<double> ExternalLineCoordinates;
+
+  /// Keyhole removal buffers
+  std::vector<int> KeyholeFlags;
+  std::vector<int> SortedPointIndices;
+  std::vector<int> PointsWithinRadius;
+  std::vector<std::vector<vtkIdType> > KeyholeLines;
+  std::vector<int> OpenKeyholeLines;
+  std::vector<vtkIdType> NewLinePointIds;
+  std::vector<vtkIdType> NewLineOffsets;
+
+  /// Pipeline triangulating the external lines (created by InitializeDelaunay)
+  vtkSmartPointer<vtkPoints> DelaunayPoints;
+  vtkSmartPointer<vtkPolyData> DelaunayInput;
+  vtkSmartPointer<vtkPolyData> DelaunayBoundary;
+  vtkSmartPointer<vtkDelaunay2D> Delaunay;
+  vtkSmartPointer<vtkIdList> PolygonPointIds;
+};
+
+namespace
+{
+  /// Shared data of the plane pair triangulation threads.
+  /// Each thread only accesses the output polygons of the plane pairs it processes.
+  struct PlanePairTriangulationData
+  {
+    vtkPlanarContourToClosedSurfaceConversionRule* Rule;
+    int NumberOfThreads;
+    std::vector< vtkSmartPointer<vtkCellArray> > PlanePairPolygons;
+  };
+
+  //----------------------------------------------------------------------------
+  /// Orders point indices of a line by the X coordinate of the points (then by index),
+  /// and compares point indices to X coordinates for range searches in the ordered list.
+  class PointIndexXCoordinateLess
+  {
+  public:
+    PointIndexXCoordinateLess(const double* pointCoordinates, const vtkIdType* linePointIds)
+      : PointCoordinates(pointCoordinates)
+      , LinePointIds(linePointIds)
+    {
+    }
+
+    double GetX(int pointIndex) const
+    {
+      return this->PointCoordinates[3*this->LinePointIds[pointIndex]];
+    }
+
+    bool operator()(int pointIndex1, int pointIndex2) const
+    {
+      double x1 = this->GetX(pointIndex1);
+      double x2 = this->GetX(pointIndex2);
+      return x1 < x2 || (x1 == x2 && pointIndex1 < pointIndex2);
+    }
+
+    bool operator()(int pointIndex, double x) const
+    {
+      return this->GetX(pointIndex) < x;
+    }
+
+    bool operator()(double x, int pointIndex) const
+    {
+      return x < this->GetX(pointIndex);
+    }
+
+  private:
+    const double* PointCoordinates;
+    const vtkIdType* LinePointIds;
+  };
+}
 
 //----------------------------------------------------------------------------
 vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToClosedSurfaceConversionRule);
@@ -39,19 +342,22 @@ vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToClosedSurfaceConversionRu
 //----------------------------------------------------------------------------
 vtkPlanarContourToClosedSurfaceConversionRule::vtkPlanarContourToClosedSurfaceConversionRule()
 {
-  //this->ConversionParameters[GetXYParameterName()] = std::make_pair("value", "description");
+  this->ConversionParameters[GetNumberOfThreadsParameterName()] = std::make_pair("1", "Number of threads triangulating the pairs of consecutive contour planes. Value of 1 means serial execution, 0 means the default number of threads of the system. The result does not depend on the number of threads.");
+  this->Internal = new vtkInternal();
+  this->LastConversionTime = 0.0;
 }
 
 //----------------------------------------------------------------------------
 vtkPlanarContourToClosedSurfaceConversionRule::~vtkPlanarContourToClosedSurfaceConversionRule()
 {
+  delete this->Internal;
 }
 
 //----------------------------------------------------------------------------
 unsigned int vtkPlanarContourToClosedSurfaceConversionRule::GetConversionCost(vtkDataObject* sourceRepresentation/*=NULL*/, vtkDataObject* targetRepresentation/*=NULL*/)
 {
-  // Rough input-independent guess (ms)
-  return 700;
+  // Rough input-independent guess (ms) until conversion times are measured
+  return this->EstimateConversionCost(sourceRepresentation, 700);
 }
 
 //----------------------------------------------------------------------------
@@ -98,219 +404,298 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
     vtkErrorMacro("Convert: Target representation is not a poly data!");
     return false;
   }
+  if (!planarContoursPolyData->GetPoints() || planarContoursPolyData->GetNumberOfLines() == 0)
+  {
+    vtkErrorMacro("Convert: Source representation contains no contours!");
+    return false;
+  }
 
-  vtkSmartPointer<vtkPolyData> inputContoursCopy = vtkSmartPointer<vtkPolyData>::New();
-  inputContoursCopy->DeepCopy(planarContoursPolyData);
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
 
-  vtkSmartPointer<vtkPoints> outputPoints = inputContoursCopy->GetPoints();
-  vtkSmartPointer<vtkCellArray> outputLines = inputContoursCopy->GetLines();
+  vtkSmartPointer<vtkPoints> outputPoints = vtkSmartPointer<vtkPoints>::New();
+  outputPoints->DeepCopy(planarContoursPolyData->GetPoints());
   vtkSmartPointer<vtkCellArray> outputPolygons = vtkSmartPointer<vtkCellArray>::New(); // add triangles to this
 
-  int numberOfLines = inputContoursCopy->GetNumberOfLines(); // total number of lines
+  // Copy points and lines into flat arrays. New points are added to the output points.
+  this->Internal->Initialize(outputPoints, planarContoursPolyData->GetLines());
+  vtkScratchArena arena;
+
+  // Number of lines before keyhole removal, which is the number of lines that are sealed
+  int numberOfInputLines = this->Internal->GetNumberOfLines();
 
   // remove keyholes from the lines
-  this->FixKeyholes(inputContoursCopy, numberOfLines, 0.1, 2);
+  this->FixKeyholes(&arena, 0.1, 2);
 
-  numberOfLines = inputContoursCopy->GetNumberOfLines();
+  int numberOfLines = this->Internal->GetNumberOfLines(); // total number of lines
 
   // set all lines to be counter-clockwise
-  this->SetLinesCounterClockwise(inputContoursCopy);
-  
-  std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators(numberOfLines);
-  std::vector<vtkSmartPointer<vtkIdList> > linePointIdLists(numberOfLines);
-  for(int lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
+  this->SetLinesCounterClockwise();
+
+  this->Internal->ComputeLineBounds();
+
+  // Get conversion parameters
+  double numberOfThreadsParameter = 1.0;
+  this->GetConversionParameterAsDouble(GetNumberOfThreadsParameterName(), numberOfThreadsParameter);
+  int numberOfThreads = (int)numberOfThreadsParameter;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  }
+  numberOfThreads = std::min(numberOfThreads, (int)VTK_MAX_THREADS);
+
+  // Connect the lines of consecutive planes
+  this->FindPlanePairs();
+  int numberOfPlanePairs = this->Internal->PlanePairs.size();
+  if (numberOfThreads < 2 || numberOfPlanePairs < 2)
   {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputContoursCopy->GetCell(lineIndex));
-    linePointIdLists[lineIndex] = currentLine->GetPointIds();
-    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-    linePolyData->SetPoints(currentLine->GetPoints());
-    pointLocators[lineIndex] = vtkSmartPointer<vtkPointLocator>::New();
-    pointLocators[lineIndex]->SetDataSet(linePolyData);
-    pointLocators[lineIndex]->BuildLocator();
+    for (int planePairIndex = 0; planePairIndex < numberOfPlanePairs; ++planePairIndex)
+    {
+      this->TriangulatePlanePair(&arena, planePairIndex, outputPolygons);
+    }
   }
+  else
+  {
+    this->TriangulatePlanePairsParallel(std::min(numberOfThreads, numberOfPlanePairs), outputPolygons);
+  }
+
+  // Triangulate all contours which are exposed.
+  this->SealMesh(&arena, numberOfInputLines, outputPolygons);
+
+  // Initialize the output data.
+  closedSurfacePolyData->SetPoints(outputPoints);
+  // Do not include lines in poly data for nicer visualization
+  closedSurfacePolyData->SetPolys(outputPolygons);
+
+  this->Internal->Clear();
+
+  double checkpointEnd = timer->GetUniversalTime();
+  this->LastConversionTime = checkpointEnd - checkpointStart;
+  vtkDebugMacro("Convert: Conversion took " << this->LastConversionTime << " s (" << numberOfLines << " contours, "
+    << numberOfPlanePairs << " plane pairs, " << numberOfThreads << " threads, " << closedSurfacePolyData->GetNumberOfPolys() << " polygons)");
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::FindPlanePairs()
+{
+  int numberOfLines = this->Internal->GetNumberOfLines();
+  this->Internal->LineTriangulatedToAbove.assign(numberOfLines, 0);
+  this->Internal->LineTriangulatedToBelow.assign(numberOfLines, 0);
 
-  // Vector of booleans to determine which lines are triangulated from above and from below.
-  std::vector< bool > lineTriganulatedToAbove(numberOfLines);
-  std::vector< bool > lineTriganulatedToBelow(numberOfLines);
-  for (int i=0; i<numberOfLines; ++i)
+  std::vector<vtkInternal::PlanePair>& planePairs = this->Internal->PlanePairs;
+  planePairs.clear();
+  if (numberOfLines == 0)
   {
-    lineTriganulatedToAbove[i] = false;
-    lineTriganulatedToBelow[i] = false;
+    return;
   }
 
   // Get two consecutive planes.
   int firstLineOnPlane1Index = 0; // pointer to first line on plane 1.
-  int numberOfLinesInPlane1 = this->GetNumberOfLinesOnPlane(inputContoursCopy, numberOfLines, 0);
+  int numberOfLinesInPlane1 = this->GetNumberOfLinesOnPlane(numberOfLines, 0);
 
   while (firstLineOnPlane1Index + numberOfLinesInPlane1 < numberOfLines)
   {
-    int firstLineOnPlane2Index = firstLineOnPlane1Index + numberOfLinesInPlane1; // pointer to first line on plane 2
-    int numberOfLinesInPlane2 = this->GetNumberOfLinesOnPlane(inputContoursCopy, numberOfLines, firstLineOnPlane2Index); // number of lines on plane 2
+    planePairs.push_back(vtkInternal::PlanePair());
+    vtkInternal::PlanePair& planePair = planePairs.back();
+    planePair.FirstLineOnPlane1Index = firstLineOnPlane1Index;
+    planePair.NumberOfLinesInPlane1 = numberOfLinesInPlane1;
+    planePair.FirstLineOnPlane2Index = firstLineOnPlane1Index + numberOfLinesInPlane1; // pointer to first line on plane 2
+    planePair.NumberOfLinesInPlane2 = this->GetNumberOfLinesOnPlane(numberOfLines, planePair.FirstLineOnPlane2Index); // number of lines on plane 2
+    planePair.Plane1Overlaps.resize(planePair.NumberOfLinesInPlane1);
+    planePair.Plane2Overlaps.resize(planePair.NumberOfLinesInPlane2);
 
-    // initialize overlaps lists. - list of list
-    // Each internal list represents a line from the plane and will store the pointers to the overlap lines
-
-    // overlaps for lines from plane 1
-    std::vector< std::vector< int > > plane1Overlaps;
-    for (int line1Index = 0; line1Index < numberOfLinesInPlane1; ++line1Index)
+    // Fill the overlaps lists.
+    for (int line1Index = 0; line1Index < planePair.NumberOfLinesInPlane1; ++line1Index)
     {
-      std::vector< int > temp;
-      plane1Overlaps.push_back(temp);
+      for (int line2Index=0; line2Index < planePair.NumberOfLinesInPlane2; ++line2Index)
+      {
+        if (this->DoLinesOverlap(planePair.FirstLineOnPlane1Index+line1Index, planePair.FirstLineOnPlane2Index+line2Index))
+        {
+          // line from plane 1 overlaps with line from plane 2
+          planePair.Plane1Overlaps[line1Index].push_back(planePair.FirstLineOnPlane2Index+line2Index);
+          planePair.Plane2Overlaps[line2Index].push_back(planePair.FirstLineOnPlane1Index+line1Index);
+        }
+      }
     }
 
-    // overlaps for lines from plane 2
-    std::vector< std::vector< int > > plane2Overlaps;
-    for (int line2Index = 0; line2Index < numberOfLinesInPlane2; ++line2Index)
+    // Build the point locators needed for branching now, so that they are not built concurrently
+    for (int line1Index = 0; line1Index < planePair.NumberOfLinesInPlane1; ++line1Index)
     {
-      std::vector< int > temp;
-      plane2Overlaps.push_back(temp);
+      if (planePair.Plane1Overlaps[line1Index].size() > 1)
+      {
+        for (int overlapIndex = 0; overlapIndex < planePair.Plane1Overlaps[line1Index].size(); ++overlapIndex)
+        {
+          this->Internal->GetLinePointLocator(planePair.Plane1Overlaps[line1Index][overlapIndex]);
+        }
+      }
     }
-
-    // Fill the overlaps lists.
-    for (int line1Index = 0; line1Index < numberOfLinesInPlane1; ++line1Index)
+    for (int line2Index = 0; line2Index < planePair.NumberOfLinesInPlane2; ++line2Index)
     {
-      vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-      line1->DeepCopy(inputContoursCopy->GetCell(firstLineOnPlane1Index+line1Index));
-
-      for (int line2Index=0; line2Index< numberOfLinesInPlane2; ++line2Index)
+      if (planePair.Plane2Overlaps[line2Index].size() > 1)
       {
-        vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-        line2->DeepCopy(inputContoursCopy->GetCell(firstLineOnPlane2Index+line2Index));
-
-        if (this->DoLinesOverlap(line1, line2))
+        for (int overlapIndex = 0; overlapIndex < planePair.Plane2Overlaps[line2Index].size(); ++overlapIndex)
         {
-          // line from plane 1 overlaps with line from plane 2
-          plane1Overlaps[line1Index].push_back(firstLineOnPlane2Index+line2Index);
-          plane2Overlaps[line2Index].push_back(firstLineOnPlane1Index+line1Index);
+          this->Internal->GetLinePointLocator(planePair.Plane2Overlaps[line2Index][overlapIndex]);
         }
       }
     }
 
-    // Go over the planeOverlaps lists.
-    for (int line1Index = firstLineOnPlane1Index; line1Index < firstLineOnPlane1Index+numberOfLinesInPlane1; ++line1Index)
-    {
-      vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-      line1->DeepCopy(inputContoursCopy->GetCell(line1Index));
-      vtkSmartPointer<vtkIdList> pointsInLine1 = line1->GetPointIds();
-      int numberOfPointsInLine1 = line1->GetNumberOfPoints();
+    // Advance the points
+    firstLineOnPlane1Index = planePair.FirstLineOnPlane2Index;
+    numberOfLinesInPlane1 = planePair.NumberOfLinesInPlane2;
+  }
+}
 
-      bool intersects = false;
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::TriangulatePlanePair(vtkScratchArena* arena, int planePairIndex, vtkCellArray* outputPolygons)
+{
+  if (!arena || !outputPolygons)
+  {
+    vtkErrorMacro("TriangulatePlanePair: Invalid scratch arena or output!");
+    return;
+  }
 
-      std::vector<vtkSmartPointer<vtkPointLocator> > overlap1PointLocators(plane1Overlaps[line1Index-firstLineOnPlane1Index].size());
-      std::vector<vtkSmartPointer<vtkIdList> > overlap1PointIds(plane1Overlaps[line1Index-firstLineOnPlane1Index].size());
+  const vtkInternal::PlanePair& planePair = this->Internal->PlanePairs[planePairIndex];
 
-      for (int i=0; i<plane1Overlaps[line1Index-firstLineOnPlane1Index].size(); ++i)
-      {
-        int j = plane1Overlaps[line1Index-firstLineOnPlane1Index][i];
-        overlap1PointLocators[i] = (pointLocators[j]);
-        overlap1PointIds[i] = (linePointIdLists[j]);
-      }
+  // Go over the planeOverlaps lists.
+  for (int line1Index = planePair.FirstLineOnPlane1Index; line1Index < planePair.FirstLineOnPlane1Index+planePair.NumberOfLinesInPlane1; ++line1Index)
+  {
+    const vtkIdType* pointsInLine1 = this->Internal->GetLinePointIds(line1Index);
+    int numberOfPointsInLine1 = this->Internal->GetNumberOfPointsInLine(line1Index);
+    const std::vector< int >& line1Overlaps = planePair.Plane1Overlaps[line1Index-planePair.FirstLineOnPlane1Index];
 
-      for (int overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index-firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line i
-      {
-        int line2Index = plane1Overlaps[line1Index-firstLineOnPlane1Index][overlapIndex];
+    for (int overlapIndex = 0; overlapIndex < line1Overlaps.size(); ++overlapIndex) // lines on plane 2 that overlap with line i
+    {
+      int line2Index = line1Overlaps[overlapIndex];
+      const vtkIdType* pointsInLine2 = this->Internal->GetLinePointIds(line2Index);
+      int numberOfPointsInLine2 = this->Internal->GetNumberOfPointsInLine(line2Index);
 
-        vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-        line2->DeepCopy(inputContoursCopy->GetCell(line2Index));
-        vtkSmartPointer<vtkIdList> pointsInLine2 = line2->GetPointIds();
-        int numberOfPointsInLine2 = line2->GetNumberOfPoints();
+      // Get the portion of line 1 that is close to line 2,
+      this->Branch(pointsInLine1, numberOfPointsInLine1, line2Index, line1Overlaps, arena->DividedLine1PointIds);
+      int numberOfdividedPointsInLine1 = arena->DividedLine1PointIds.size();
 
-        std::vector<vtkSmartPointer<vtkPointLocator> > overlap2PointLocators(plane2Overlaps[line2Index-firstLineOnPlane2Index].size());
-        std::vector<vtkSmartPointer<vtkIdList> > overlap2PointIds(plane2Overlaps[line2Index-firstLineOnPlane2Index].size());
+      // Get the portion of line 2 that is close to line 1.
+      this->Branch(pointsInLine2, numberOfPointsInLine2, line1Index, planePair.Plane2Overlaps[line2Index-planePair.FirstLineOnPlane2Index], arena->DividedLine2PointIds);
+      int numberOfdividedPointsInLine2 = arena->DividedLine2PointIds.size();
 
-        for (int i=0; i<plane2Overlaps[line2Index-firstLineOnPlane2Index].size(); ++i)
-        {
-          int j = plane2Overlaps[line2Index-firstLineOnPlane2Index][i];
-          overlap2PointLocators[i] = (pointLocators[j]);
-          overlap2PointIds[i] = (linePointIdLists[j]);
-        }
+      if (numberOfdividedPointsInLine1 > 1 && numberOfdividedPointsInLine2 > 1)
+      {
+        this->Internal->LineTriangulatedToAbove[line1Index] = 1;
+        this->Internal->LineTriangulatedToBelow[line2Index] = 1;
+        this->TriangulateContours(arena,
+          &arena->DividedLine1PointIds[0], numberOfdividedPointsInLine1,
+          &arena->DividedLine2PointIds[0], numberOfdividedPointsInLine2,
+          outputPolygons);
+      }
+    }
+  }
+}
 
-        // Get the portion of line 1 that is close to line 2,
-        vtkSmartPointer<vtkLine> dividedLine1 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, pointsInLine1, numberOfPointsInLine1, line2Index, plane1Overlaps[line1Index-firstLineOnPlane1Index], overlap1PointLocators, overlap1PointIds, dividedLine1);
-        vtkSmartPointer<vtkIdList> dividedPointsInLine1 = dividedLine1->GetPointIds();
-        int numberOfdividedPointsInLine1 = dividedLine1->GetNumberOfPoints();
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkPlanarContourToClosedSurfaceConversionRule::TriangulatePlanePairsThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  PlanePairTriangulationData* data = static_cast<PlanePairTriangulationData*>(threadInfo->UserData);
+  if (!data || !data->Rule)
+  {
+    return VTK_THREAD_RETURN_VALUE;
+  }
 
-        // Get the portion of line 2 that is close to line 1.
-        vtkSmartPointer<vtkLine> dividedLine2 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, pointsInLine2, numberOfPointsInLine2, line1Index, plane2Overlaps[line2Index-firstLineOnPlane2Index], overlap2PointLocators, overlap2PointIds, dividedLine2);
-        vtkSmartPointer<vtkIdList> dividedPointsInLine2 = dividedLine2->GetPointIds();
-        int numberOfdividedPointsInLine2 = dividedLine2->GetNumberOfPoints();
+  // Plane pairs are distributed in an interleaved manner, as the contours
+  // are typically larger in the middle of the structure
+  vtkScratchArena arena;
+  int numberOfPlanePairs = data->PlanePairPolygons.size();
+  for (int planePairIndex = threadInfo->ThreadID; planePairIndex < numberOfPlanePairs; planePairIndex += data->NumberOfThreads)
+  {
+    data->Rule->TriangulatePlanePair(&arena, planePairIndex, data->PlanePairPolygons[planePairIndex]);
+  }
 
-        if (numberOfdividedPointsInLine1 > 1 && numberOfdividedPointsInLine2 > 1)
-        {
-          lineTriganulatedToAbove[line1Index] = true;
-          lineTriganulatedToBelow[line2Index] = true;
-          this->TriangulateContours(inputContoursCopy,
-            dividedPointsInLine1, numberOfdividedPointsInLine1,
-            dividedPointsInLine2, numberOfdividedPointsInLine2,
-            outputPolygons);
-        }
-        
-      }
-    }
+  return VTK_THREAD_RETURN_VALUE;
+}
 
-    // Advance the points
-    firstLineOnPlane1Index = firstLineOnPlane2Index;
-    numberOfLinesInPlane1 = numberOfLinesInPlane2;
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::TriangulatePlanePairsParallel(int numberOfThreads, vtkCellArray* outputPolygons)
+{
+  if (!outputPolygons)
+  {
+    vtkErrorMacro("TriangulatePlanePairsParallel: Invalid vtkCellArray!");
+    return;
   }
 
-  // Triangulate all contours which are exposed.
-  this->SealMesh( inputContoursCopy, outputLines, outputPolygons, lineTriganulatedToAbove, lineTriganulatedToBelow);
+  int numberOfPlanePairs = this->Internal->PlanePairs.size();
 
-  // Initialize the output data.
-  closedSurfacePolyData->SetPoints(outputPoints);
-  //closedSurfacePolyData->SetLines(outputLines); // Do not include lines in poly data for nicer visualization
-  closedSurfacePolyData->SetPolys(outputPolygons);
+  PlanePairTriangulationData data;
+  data.Rule = this;
+  data.NumberOfThreads = numberOfThreads;
+  data.PlanePairPolygons.resize(numberOfPlanePairs);
+  for (int planePairIndex = 0; planePairIndex < numberOfPlanePairs; ++planePairIndex)
+  {
+    data.PlanePairPolygons[planePairIndex] = vtkSmartPointer<vtkCellArray>::New();
+  }
 
-  return true;
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(TriangulatePlanePairsThreadFunction, &data);
+  threader->SingleMethodExecute();
+
+  // Merge the triangles in plane pair order so that the result is the same as with serial execution
+  for (int planePairIndex = 0; planePairIndex < numberOfPlanePairs; ++planePairIndex)
+  {
+    vtkCellArray* planePairPolygons = data.PlanePairPolygons[planePairIndex];
+    vtkIdType numberOfCellPoints = 0;
+    vtkIdType* cellPointIds = NULL;
+    planePairPolygons->InitTraversal();
+    while (planePairPolygons->GetNextCell(numberOfCellPoints, cellPointIds))
+    {
+      outputPolygons->InsertNextCell(numberOfCellPoints, cellPointIds);
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkPolyData* inputROIPoints,
-                                                  vtkIdList* pointsInLine1, int numberOfPointsInLine1,
-                                                  vtkIdList* pointsInLine2, int numberOfPointsInLine2,
+void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkScratchArena* arena,
+                                                  const vtkIdType* pointsInLine1, int numberOfPointsInLine1,
+                                                  const vtkIdType* pointsInLine2, int numberOfPointsInLine2,
                                                   vtkCellArray* outputPolygons)
 {
-
-  if(! inputROIPoints)
+  if (!arena)
   {
-    vtkErrorMacro("TriangulateContours: Invalid vtkPolyData!");
+    vtkErrorMacro("TriangulateContours: Invalid scratch arena!");
     return;
   }
 
-  if (!pointsInLine1)
+  if (!pointsInLine1 || !pointsInLine2 || numberOfPointsInLine1 < 1 || numberOfPointsInLine2 < 1)
   {
-    vtkErrorMacro("TriangulateContours: Invalid vtkIdList!");
+    vtkErrorMacro("TriangulateContours: Invalid line!");
     return;
   }
 
-  if (!pointsInLine2)
+  if (!outputPolygons)
   {
-   vtkErrorMacro("TriangulateContours: Invalid vtkIdList!");
+    vtkErrorMacro("TriangulateContours: Invalid vtkCellArray!");
+    return;
   }
 
   // Pre-calculate and store the closest points.
 
   // Closest point from line 1 to line 2
-  std::vector< int > closest1;
+  std::vector< int >& closest1 = arena->ClosestPointsLine1;
+  closest1.resize(numberOfPointsInLine1);
   for (int line1PointIndex = 0; line1PointIndex < numberOfPointsInLine1; ++line1PointIndex)
   {
-    double line1Point[3] = {0,0,0};
-    inputROIPoints->GetPoint(pointsInLine1->GetId(line1PointIndex), line1Point);
-
-    closest1.push_back(this->GetClosestPoint(inputROIPoints, line1Point, pointsInLine2, numberOfPointsInLine2));
+    const double* line1Point = this->Internal->GetPoint(pointsInLine1[line1PointIndex]);
+    closest1[line1PointIndex] = this->GetClosestPoint(line1Point, pointsInLine2, numberOfPointsInLine2);
   }
 
   // closest from line 2 to line 1
-  std::vector< int > closest2;
+  std::vector< int >& closest2 = arena->ClosestPointsLine2;
+  closest2.resize(numberOfPointsInLine2);
   for (int line2PointIndex = 0; line2PointIndex < numberOfPointsInLine2; ++line2PointIndex)
   {
-    double line2Point[3] = {0,0,0};
-    inputROIPoints->GetPoint(pointsInLine2->GetId(line2PointIndex),line2Point);
-
-    closest2.push_back(this->GetClosestPoint(inputROIPoints, line2Point, pointsInLine1, numberOfPointsInLine1));
+    const double* line2Point = this->Internal->GetPoint(pointsInLine2[line2PointIndex]);
+    closest2[line2PointIndex] = this->GetClosestPoint(line2Point, pointsInLine1, numberOfPointsInLine1);
   }
 
   // Orient loops.
@@ -318,16 +703,13 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkPolyD
   int startLine1 = 0;
   int startLine2 = closest1[0];
 
-  double firstPointLine1[3] = {0,0,0}; // first point on line 1;
-  inputROIPoints->GetPoint(pointsInLine1->GetId(startLine1),firstPointLine1);
-
-  double firstPointLine2[3] = {0,0,0}; // first point on line 2;
-  inputROIPoints->GetPoint(pointsInLine2->GetId(startLine2), firstPointLine2);
+  const double* firstPointLine1 = this->Internal->GetPoint(pointsInLine1[startLine1]); // first point on line 1
+  const double* firstPointLine2 = this->Internal->GetPoint(pointsInLine2[startLine2]); // first point on line 2
 
   // Determine if the loops are closed.
   // A loop is closed if the first point is repeated as the last point.
-  bool line1Closed = (pointsInLine1->GetId(0) == pointsInLine1->GetId(numberOfPointsInLine1-1));
-  bool line2Closed = (pointsInLine2->GetId(0) == pointsInLine2->GetId(numberOfPointsInLine2-1));
+  bool line1Closed = (pointsInLine1[0] == pointsInLine1[numberOfPointsInLine1-1]);
+  bool line2Closed = (pointsInLine2[0] == pointsInLine2[numberOfPointsInLine2-1]);
 
   // Determine the ending points.
   int line1EndPoint = this->GetEndLoop(startLine1, numberOfPointsInLine1, line1Closed);
@@ -338,50 +720,43 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkPolyD
   int up = 1;
 
   // Initialize the Dynamic Programming table.
-  // Rows represent line 1. Columns represent line 2.
+  // Rows represent line 1. Columns represent line 2. The tables are stored row by row.
+  // All elements are written below, so the buffers do not need to be cleared.
+  std::vector< double >& scoreTable = arena->ScoreTable;
+  scoreTable.resize(static_cast<size_t>(numberOfPointsInLine1) * numberOfPointsInLine2);
+  std::vector< int >& backtrackTable = arena->BacktrackTable;
+  backtrackTable.resize(static_cast<size_t>(numberOfPointsInLine1) * numberOfPointsInLine2);
 
   // Initialize the score table.
-  std::vector< std::vector< double > > scoreTable( numberOfPointsInLine1, std::vector< double >( numberOfPointsInLine2 ) );
-  double distanceBetweenPoints = vtkMath::Distance2BetweenPoints(firstPointLine1, firstPointLine2);
-  scoreTable[0][0] = distanceBetweenPoints;
-
-  std::vector< std::vector< int > > backtrackTable( numberOfPointsInLine1, std::vector< int >( numberOfPointsInLine2 ) );
-  backtrackTable[0][0] = 0;
+  scoreTable[0] = vtkMath::Distance2BetweenPoints(firstPointLine1, firstPointLine2);
+  backtrackTable[0] = 0;
 
   // Initialize the first row in the table.
   int currentPointIndexLine2 = this->GetNextLocation(startLine2, numberOfPointsInLine2, line2Closed);
   for (int line2PointIndex = 1; line2PointIndex < numberOfPointsInLine2; ++line2PointIndex)
   {
-    double currentPointLine2[3] = {0,0,0}; // current point on line 2
-    inputROIPoints->GetPoint(pointsInLine2->GetId(currentPointIndexLine2),currentPointLine2);
+    const double* currentPointLine2 = this->Internal->GetPoint(pointsInLine2[currentPointIndexLine2]); // current point on line 2
 
     // Use the distance between first point on line 1 and current point on line 2.
     double distance = vtkMath::Distance2BetweenPoints(firstPointLine1, currentPointLine2);
 
-    scoreTable[0][line2PointIndex] = scoreTable[0][line2PointIndex-1]+distance;
-    backtrackTable[0][line2PointIndex] = left;
+    scoreTable[line2PointIndex] = scoreTable[line2PointIndex-1]+distance;
+    backtrackTable[line2PointIndex] = left;
 
     currentPointIndexLine2 = this->GetNextLocation(currentPointIndexLine2, numberOfPointsInLine2, line2Closed);
-
   }
 
   // Initialize the first column in the table.
   int currentPointIndexLine1 = this->GetNextLocation(startLine1, numberOfPointsInLine2, line1Closed);
   for( int line1PointIndex=1; line1PointIndex < numberOfPointsInLine1; ++line1PointIndex)
   {
-    double currentPointLine1[3] = {0,0,0}; // current point on line 1
-    inputROIPoints->GetPoint(pointsInLine1->GetId(currentPointIndexLine1), currentPointLine1);
+    const double* currentPointLine1 = this->Internal->GetPoint(pointsInLine1[currentPointIndexLine1]); // current point on line 1
 
     // Use the distance between first point on line 2 and current point on line 1.
     double distance = vtkMath::Distance2BetweenPoints(currentPointLine1, firstPointLine2);
 
-    scoreTable[line1PointIndex][0] = scoreTable[line1PointIndex-1][0]+distance;
-    backtrackTable[line1PointIndex][0] = up;
-    for(int line2PointIndex = 1; line2PointIndex < numberOfPointsInLine2; ++line2PointIndex)
-    {
-      scoreTable[line1PointIndex][line2PointIndex] = 0;
-      backtrackTable[line1PointIndex][line2PointIndex] = up;
-    }
+    scoreTable[line1PointIndex*numberOfPointsInLine2] = scoreTable[(line1PointIndex-1)*numberOfPointsInLine2]+distance;
+    backtrackTable[line1PointIndex*numberOfPointsInLine2] = up;
 
     currentPointIndexLine1 = this->GetNextLocation(currentPointIndexLine1, numberOfPointsInLine1, line1Closed);
   }
@@ -397,40 +772,37 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkPolyD
   int line2PointIndex=1;
   for (line1PointIndex = 1; line1PointIndex < numberOfPointsInLine1; ++line1PointIndex)
   {
-    double pointOnLine1[3] = {0,0,0};
-    inputROIPoints->GetPoint(pointsInLine1->GetId(currentPointIndexLine1), pointOnLine1);
+    const double* pointOnLine1 = this->Internal->GetPoint(pointsInLine1[currentPointIndexLine1]);
+    double* scoreRow = &scoreTable[line1PointIndex*numberOfPointsInLine2];
+    const double* previousScoreRow = scoreRow - numberOfPointsInLine2;
+    int* backtrackRow = &backtrackTable[line1PointIndex*numberOfPointsInLine2];
 
     for (line2PointIndex = 1; line2PointIndex < numberOfPointsInLine2; ++line2PointIndex)
     {
-      double pointOnLine2[3] = {0,0,0};
-      inputROIPoints->GetPoint(pointsInLine2->GetId(currentPointIndexLine2), pointOnLine2);
+      const double* pointOnLine2 = this->Internal->GetPoint(pointsInLine2[currentPointIndexLine2]);
 
       double distance = vtkMath::Distance2BetweenPoints(pointOnLine1, pointOnLine2);
 
       // Use the pre-calcualted closest point.
       if (currentPointIndexLine1 == closest2[previousLine2])
       {
-        scoreTable[line1PointIndex][line2PointIndex] = scoreTable[line1PointIndex][line2PointIndex-1]+distance;
-        backtrackTable[line1PointIndex][line2PointIndex] = left;
-
+        scoreRow[line2PointIndex] = scoreRow[line2PointIndex-1]+distance;
+        backtrackRow[line2PointIndex] = left;
       }
       else if (currentPointIndexLine2 == closest1[previousLine1])
       {
-        scoreTable[line1PointIndex][line2PointIndex] = scoreTable[line1PointIndex-1][line2PointIndex]+distance;
-        backtrackTable[line1PointIndex][line2PointIndex] = up;
-
+        scoreRow[line2PointIndex] = previousScoreRow[line2PointIndex]+distance;
+        backtrackRow[line2PointIndex] = up;
       }
-      else if (scoreTable[line1PointIndex][line2PointIndex-1] <= scoreTable[line1PointIndex-1][line2PointIndex])
+      else if (scoreRow[line2PointIndex-1] <= previousScoreRow[line2PointIndex])
       {
-        scoreTable[line1PointIndex][line2PointIndex] = scoreTable[line1PointIndex][line2PointIndex-1]+distance;
-        backtrackTable[line1PointIndex][line2PointIndex] = left;
-
+        scoreRow[line2PointIndex] = scoreRow[line2PointIndex-1]+distance;
+        backtrackRow[line2PointIndex] = left;
       }
       else
       {
-        scoreTable[line1PointIndex][line2PointIndex] = scoreTable[line1PointIndex-1][line2PointIndex]+distance;
-        backtrackTable[line1PointIndex][line2PointIndex] = up;
-
+        scoreRow[line2PointIndex] = previousScoreRow[line2PointIndex]+distance;
+        backtrackRow[line2PointIndex] = up;
       }
 
       // Advance the pointers
@@ -448,27 +820,15 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkPolyD
   --line2PointIndex;
   while (line1PointIndex > 0  || line2PointIndex > 0)
   {
-    double line1Point[3] = {0,0,0}; // current point on line 1
-    inputROIPoints->GetPoint(pointsInLine1->GetId(currentPointIndexLine1), line1Point);
-
-    double line2Point[3] = {0,0,0}; // current point on line 2
-    inputROIPoints->GetPoint(pointsInLine2->GetId(currentPointIndexLine2), line2Point);
-
-    double distanceBetweenPoints = vtkMath::Distance2BetweenPoints(line1Point, line2Point);
-
-    if (backtrackTable[line1PointIndex][line2PointIndex] == left)
+    vtkIdType currentTriangle[3] = {0,0,0};
+    if (backtrackTable[line1PointIndex*numberOfPointsInLine2 + line2PointIndex] == left)
     {
       int previousPointIndexLine2 = this->GetPreviousLocation(currentPointIndexLine2, numberOfPointsInLine2, line2Closed);
 
-      int currentTriangle[3] = {0,0,0};
-      currentTriangle[0] = pointsInLine1->GetId(currentPointIndexLine1);
-      currentTriangle[1] = pointsInLine2->GetId(currentPointIndexLine2);
-      currentTriangle[2] = pointsInLine2->GetId(previousPointIndexLine2);
-
-      outputPolygons->InsertNextCell(3);
-      outputPolygons->InsertCellPoint(currentTriangle[0]);
-      outputPolygons->InsertCellPoint(currentTriangle[1]);
-      outputPolygons->InsertCellPoint(currentTriangle[2]);
+      currentTriangle[0] = pointsInLine1[currentPointIndexLine1];
+      currentTriangle[1] = pointsInLine2[currentPointIndexLine2];
+      currentTriangle[2] = pointsInLine2[previousPointIndexLine2];
+      outputPolygons->InsertNextCell(3, currentTriangle);
 
       line2PointIndex -= 1;
       currentPointIndexLine2 = previousPointIndexLine2;
@@ -477,15 +837,10 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateContours(vtkPolyD
     {
       int previousPointIndexLine1 = this->GetPreviousLocation(currentPointIndexLine1, numberOfPointsInLine1, line1Closed);
 
-      int currentTriangle[3] = {0,0,0};
-      currentTriangle[0] = pointsInLine1->GetId(currentPointIndexLine1);
-      currentTriangle[1] = pointsInLine2->GetId(currentPointIndexLine2);
-      currentTriangle[2] = pointsInLine1->GetId(previousPointIndexLine1);
-
-      outputPolygons->InsertNextCell(3);
-      outputPolygons->InsertCellPoint(currentTriangle[0]);
-      outputPolygons->InsertCellPoint(currentTriangle[1]);
-      outputPolygons->InsertCellPoint(currentTriangle[2]);
+      currentTriangle[0] = pointsInLine1[currentPointIndexLine1];
+      currentTriangle[1] = pointsInLine2[currentPointIndexLine2];
+      currentTriangle[2] = pointsInLine1[previousPointIndexLine1];
+      outputPolygons->InsertNextCell(3, currentTriangle);
 
       line1PointIndex -= 1;
       currentPointIndexLine1 = previousPointIndexLine1;
@@ -511,29 +866,22 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetEndLoop(int startLoopIndex
 }
 
 //----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(vtkPolyData* inputROIPoints, double* originalPoint, vtkIdList* linePointIds, int numberOfPoints)
+int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(const double* originalPoint, const vtkIdType* linePointIds, int numberOfPoints)
 {
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
-    return 0;
-  }
-
   if (!linePointIds)
   {
-    vtkErrorMacro("GetClosestPoint: Invalid vtkIdList!");
+    vtkErrorMacro("GetClosestPoint: Invalid point ID list!");
     return 0;
   }
-  
-  double pointOnLine[3] = {0,0,0}; // point from the given line
-  inputROIPoints->GetPoint(linePointIds->GetId(0), pointOnLine);
+
+  const double* pointOnLine = this->Internal->GetPoint(linePointIds[0]); // point from the given line
 
   double minimumDistance = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine); // minimum distance from the point to the line
-  double closestPointIndex = 0;
+  int closestPointIndex = 0;
 
   for (int currentPointIndex = 1; currentPointIndex < numberOfPoints; ++currentPointIndex)
   {
-    inputROIPoints->GetPoint(linePointIds->GetId(currentPointIndex), pointOnLine);
+    pointOnLine = this->Internal->GetPoint(linePointIds[currentPointIndex]);
 
     double distanceBetweenPoints = vtkMath::Distance2BetweenPoints(originalPoint, pointOnLine);
     if (distanceBetweenPoints < minimumDistance)
@@ -547,60 +895,73 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestPoint(vtkPolyData*
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::FixKeyholes(vtkPolyData* inputROIPoints, int numberOfLines, int epsilon, int minimumSeperation)
+void vtkPlanarContourToClosedSurfaceConversionRule::FixKeyholes(vtkScratchArena* arena, int epsilon, int minimumSeperation)
 {
-  if (!inputROIPoints)
+  if (!arena)
   {
-    vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
+    vtkErrorMacro("FixKeyholes: Invalid scratch arena!");
     return;
   }
 
-  vtkSmartPointer<vtkLine> originalLine;
+  int numberOfLines = this->Internal->GetNumberOfLines();
+  double epsilon2 = static_cast<double>(epsilon) * epsilon;
 
-  std::vector<vtkSmartPointer<vtkLine> > newLines;
+  std::vector<vtkIdType>& newLinePointIds = arena->NewLinePointIds;
+  std::vector<vtkIdType>& newLineOffsets = arena->NewLineOffsets;
+  newLinePointIds.clear();
+  newLineOffsets.assign(1, 0);
 
   int pointsOfSeperation;
 
   for (int lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
   {
-    originalLine = vtkSmartPointer<vtkLine>::New();
-    originalLine->DeepCopy(inputROIPoints->GetCell(lineIndex));
-
-    vtkSmartPointer<vtkPoints> originalLinePoints = originalLine->GetPoints();
-    int numberOfPointsInLine = originalLine->GetNumberOfPoints();
-
-    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-    linePolyData->SetPoints(originalLinePoints);
+    const vtkIdType* originalLinePointIds = this->Internal->GetLinePointIds(lineIndex);
+    int numberOfPointsInLine = this->Internal->GetNumberOfPointsInLine(lineIndex);
+    if (numberOfPointsInLine == 0)
+    {
+      newLineOffsets.push_back(newLinePointIds.size());
+      continue;
+    }
 
-    vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
-    pointLocator->SetDataSet(linePolyData);
-    pointLocator->BuildLocator();
+    // Order the points of the line by X coordinate so that the points within radius
+    // of a point can be found by a range search
+    PointIndexXCoordinateLess pointIndexLess(&this->Internal->PointCoordinates[0], originalLinePointIds);
+    std::vector<int>& sortedPointIndices = arena->SortedPointIndices;
+    sortedPointIndices.resize(numberOfPointsInLine);
+    for (int pointIndex = 0; pointIndex < numberOfPointsInLine; ++pointIndex)
+    {
+      sortedPointIndices[pointIndex] = pointIndex;
+    }
+    std::sort(sortedPointIndices.begin(), sortedPointIndices.end(), pointIndexLess);
 
     bool keyHoleExists = false;
 
     // If the value of flags[i] is -1, the point is not part of a keyhole
     // If the value of flags[i] is >= 0, it represents a point that is
     // close enough that it could be considered part of a keyhole.
-    std::vector<int> flags(numberOfPointsInLine);
-
-    // Initialize the list of flags to -1.
-    for (int i=0; i<numberOfPointsInLine; ++i)
-    {
-      flags[i] = -1;
-    }
+    std::vector<int>& flags = arena->KeyholeFlags;
+    flags.assign(numberOfPointsInLine, -1);
 
     for (int point1Index = 0; point1Index < numberOfPointsInLine; ++point1Index)
     {
-      double point1[3] = {0,0,0};
-      originalLinePoints->GetPoint(point1Index, point1);
+      const double* point1 = this->Internal->GetPoint(originalLinePointIds[point1Index]);
 
-      vtkSmartPointer<vtkIdList> pointsWithinRadius = vtkSmartPointer<vtkIdList>::New();
-      pointsWithinRadius->Initialize();
-      pointLocator->FindPointsWithinRadius(epsilon, point1, pointsWithinRadius);
+      // Collect the points within radius in increasing index order
+      std::vector<int>& pointsWithinRadius = arena->PointsWithinRadius;
+      pointsWithinRadius.clear();
+      std::vector<int>::iterator candidateIt = std::lower_bound(sortedPointIndices.begin(), sortedPointIndices.end(), point1[0] - epsilon, pointIndexLess);
+      for ( ; candidateIt != sortedPointIndices.end() && pointIndexLess.GetX(*candidateIt) <= point1[0] + epsilon; ++candidateIt)
+      {
+        if (vtkMath::Distance2BetweenPoints(point1, this->Internal->GetPoint(originalLinePointIds[*candidateIt])) <= epsilon2)
+        {
+          pointsWithinRadius.push_back(*candidateIt);
+        }
+      }
+      std::sort(pointsWithinRadius.begin(), pointsWithinRadius.end());
 
-      for (int pointWithinRadiusIndex = 0; pointWithinRadiusIndex < pointsWithinRadius->GetNumberOfIds(); ++pointWithinRadiusIndex)
+      for (int pointWithinRadiusIndex = 0; pointWithinRadiusIndex < pointsWithinRadius.size(); ++pointWithinRadiusIndex)
       {
-        int point2Index = pointsWithinRadius->GetId(pointWithinRadiusIndex);
+        int point2Index = pointsWithinRadius[pointWithinRadiusIndex];
 
         // Make sure the points are not too close together on the line index-wise
         pointsOfSeperation = std::min(point2Index-point1Index, numberOfPointsInLine-1-point2Index+point1Index);
@@ -610,176 +971,125 @@ void vtkPlanarContourToClosedSurfaceConversionRule::FixKeyholes(vtkPolyData* inp
           flags[point1Index] = point2Index;
           flags[point2Index] = point1Index;
         }
-
       }
     }
 
     if (!keyHoleExists)
     {
-      newLines.push_back(originalLine);
+      newLinePointIds.insert(newLinePointIds.end(), originalLinePointIds, originalLinePointIds + numberOfPointsInLine);
+      newLineOffsets.push_back(newLinePointIds.size());
+      continue;
     }
-    else
-    {
 
-      int currentLayer = 0;
-      bool pointInChannel = false;
+    // New lines are added to the output in order of creation (not in order of completion),
+    // the same way as the vtkLine based implementation did. The order matters, as it determines
+    // the order of the triangles and which lines are sealed (only the first numberOfInputLines).
+    // The lines that are not finished yet are kept in a stack (the current layer is the top of the stack).
+    std::vector<std::vector<vtkIdType> >& keyholeLines = arena->KeyholeLines;
+    std::vector<int>& openLines = arena->OpenKeyholeLines;
+    openLines.clear();
+    int numberOfKeyholeLines = 0;
 
-      std::vector<vtkSmartPointer<vtkIdList> > rawLinePointIds;
-      std::vector<vtkSmartPointer<vtkIdList> > finishedLinePointIds;
+    int currentLayer = 0;
+    bool pointInChannel = false;
 
-      // Loop through all of the points in the line
-      for (int currentPointIndex = 0; currentPointIndex < numberOfPointsInLine; ++currentPointIndex)
+    // Loop through all of the points in the line
+    for (int currentPointIndex = 0; currentPointIndex < numberOfPointsInLine; ++currentPointIndex)
+    {
+      // Add a new line if neccessary
+      if (currentLayer == openLines.size())
       {
-        // Add a new line if neccessary
-        if (currentLayer == rawLinePointIds.size())
+        if (numberOfKeyholeLines == keyholeLines.size())
         {
-          vtkSmartPointer<vtkLine> newLine = vtkSmartPointer<vtkLine>::New();
-          newLine->GetPoints()->SetData(originalLinePoints->GetData());
-
-          vtkSmartPointer<vtkIdList> newLineIds = newLine->GetPointIds();
-          newLineIds->Initialize();
-
-          newLines.push_back(newLine);
-          rawLinePointIds.push_back(newLineIds);
+          keyholeLines.push_back(std::vector<vtkIdType>());
         }
+        keyholeLines[numberOfKeyholeLines].clear();
+        openLines.push_back(numberOfKeyholeLines);
+        ++numberOfKeyholeLines;
+      }
+      std::vector<vtkIdType>& currentLine = keyholeLines[openLines[currentLayer]];
 
-        // If the current point is not part of a keyhole, add it to the current line
-        if (flags[currentPointIndex] == -1)
+      // If the current point is not part of a keyhole, add it to the current line
+      if (flags[currentPointIndex] == -1)
+      {
+        currentLine.push_back(originalLinePointIds[currentPointIndex]);
+        pointInChannel = false;
+      }
+      else
+      {
+        // If the current point is the start of a keyhole add the point to the line,
+        // increment the layer, and start the channel.
+        if (flags[currentPointIndex] > currentPointIndex && !pointInChannel)
         {
-          rawLinePointIds[currentLayer]->InsertNextId(originalLine->GetPointId(currentPointIndex));
-          pointInChannel = false;
+          currentLine.push_back(originalLinePointIds[currentPointIndex]);
+          ++currentLayer;
+          pointInChannel = true;
         }
-        else
+        // If the current point is the end of a volume in the keyhole, add the point
+        // to the line, remove the current line from the working list, deincrement
+        // the layer and start the channel.
+        else if (flags[currentPointIndex] < currentPointIndex && !pointInChannel)
         {
-          // If the current point is the start of a keyhole add the point to the line,
-          // increment the layer, and start the channel.
-          if (flags[currentPointIndex] > currentPointIndex && !pointInChannel)
-          {
-            rawLinePointIds[currentLayer]->InsertNextId(originalLine->GetPointId(currentPointIndex));
-            ++currentLayer;
-            pointInChannel = true;
-
-          }
-          // If the current point is the end of a volume in the keyhole, add the point
-          // to the line, remove the current line from the working list, deincrement
-          // the layer, add the current line to the finished lines and start the,
-          // channel.
-          else if (flags[currentPointIndex] < currentPointIndex && !pointInChannel)
+          currentLine.push_back(originalLinePointIds[currentPointIndex]);
+          openLines.pop_back();
+          if (currentLayer > 0)
           {
-            rawLinePointIds[currentLayer]->InsertNextId(originalLine->GetPointId(currentPointIndex));
-            finishedLinePointIds.push_back(rawLinePointIds[currentLayer]);
-            rawLinePointIds.pop_back();
             --currentLayer;
-            pointInChannel = true;
           }
+          pointInChannel = true;
         }
       }
+    }
 
-      // Add the remaining line to the finished list.
-      for (int currentLineIndex=0; currentLineIndex < rawLinePointIds.size(); ++currentLineIndex)
+    // Seal the lines and add them to the new lines.
+    for (int keyholeLineIndex = 0; keyholeLineIndex < numberOfKeyholeLines; ++keyholeLineIndex)
+    {
+      std::vector<vtkIdType>& keyholeLine = keyholeLines[keyholeLineIndex];
+      if (!keyholeLine.empty() && keyholeLine.front() != keyholeLine.back())
       {
-        finishedLinePointIds.push_back(rawLinePointIds[currentLineIndex]);
-      }
-
-      // Seal the lines.
-      for (int currentLineIndex = 0; currentLineIndex < finishedLinePointIds.size(); ++currentLineIndex)
-      {
-        if (finishedLinePointIds[currentLineIndex]->GetId(0) != finishedLinePointIds[currentLineIndex]->GetId(finishedLinePointIds[currentLineIndex]->GetNumberOfIds()-1))
-        {
-          finishedLinePointIds[currentLineIndex]->InsertNextId(finishedLinePointIds[currentLineIndex]->GetId(0));
-        }
-
+        keyholeLine.push_back(keyholeLine.front());
       }
+      newLinePointIds.insert(newLinePointIds.end(), keyholeLine.begin(), keyholeLine.end());
+      newLineOffsets.push_back(newLinePointIds.size());
     }
   }
 
-  vtkSmartPointer<vtkCellArray> outputLines = vtkSmartPointer<vtkCellArray>::New();
-  outputLines->Initialize();
-  inputROIPoints->DeleteCells();
-  for (int currentLineIndex = 0; currentLineIndex < newLines.size(); ++currentLineIndex)
-  {
-    outputLines->InsertNextCell(newLines[currentLineIndex]);
-  }
-  inputROIPoints->SetLines(outputLines);
-  inputROIPoints->BuildCells();
+  // Replace the lines with the modified lines.
+  this->Internal->LinePointIds.swap(newLinePointIds);
+  this->Internal->LineOffsets.swap(newLineOffsets);
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::SetLinesCounterClockwise(vtkPolyData* inputROIPoints)
+void vtkPlanarContourToClosedSurfaceConversionRule::SetLinesCounterClockwise()
 {
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("inputROIPoints: Invalid vtkPolyData!");
-    return;
-  }
-
-  int numberOfLines = inputROIPoints->GetNumberOfLines();
-
-  std::vector<vtkSmartPointer<vtkLine> > newLines;
-
+  int numberOfLines = this->Internal->GetNumberOfLines();
   for(int lineIndex=0 ; lineIndex < numberOfLines; ++lineIndex)
   {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputROIPoints->GetCell(lineIndex));
-
-    vtkSmartPointer<vtkPoints> currentPoints = currentLine->GetPoints();
-
-    if (IsLineClockwise(inputROIPoints, currentLine))
-    {
-      vtkSmartPointer<vtkLine> newLine = vtkSmartPointer<vtkLine>::New();
-      vtkSmartPointer<vtkIdList> newLineIds = newLine->GetPointIds();
-      newLineIds->Initialize();
-
-      this->ReverseLine(currentLine, newLine);
-      newLines.push_back(newLine);
-
-    }
-    else
+    vtkIdType* linePointIds = this->Internal->GetLinePointIds(lineIndex);
+    int numberOfPointsInLine = this->Internal->GetNumberOfPointsInLine(lineIndex);
+    if (this->IsLineClockwise(linePointIds, numberOfPointsInLine))
     {
-      newLines.push_back(currentLine);
+      this->ReverseLine(linePointIds, numberOfPointsInLine);
     }
   }
-
-  // Replace the lines in the input data with the modified lines.
-  vtkSmartPointer<vtkCellArray> outputLines = vtkSmartPointer<vtkCellArray>::New();
-  outputLines->Initialize();
-  inputROIPoints->DeleteCells();
-  for (int currentLineIndex = 0; currentLineIndex < newLines.size(); ++currentLineIndex)
-  {
-    outputLines->InsertNextCell(newLines[currentLineIndex]);
-  }
-  inputROIPoints->SetLines(outputLines);
-  inputROIPoints->BuildCells();
-
 }
 
 //----------------------------------------------------------------------------
-bool vtkPlanarContourToClosedSurfaceConversionRule::IsLineClockwise(vtkPolyData* inputROIPoints, vtkLine* line)
+bool vtkPlanarContourToClosedSurfaceConversionRule::IsLineClockwise(const vtkIdType* linePointIds, int numberOfPoints)
 {
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("IsLineClockwise: Invalid vtkPolyData!");
-    return false;
-  }
-
-  if (!line)
+  if (!linePointIds)
   {
-    vtkErrorMacro("IsLineClockwise: Invalid vtkLine!");
+    vtkErrorMacro("IsLineClockwise: Invalid point ID list!");
     return false;
   }
 
-  int numberOfPoints = line->GetNumberOfPoints();
-
   // Calculate twice the area of the line.
   double areaSum = 0;
 
   for (int pointIndex=0; pointIndex < numberOfPoints-1; ++pointIndex)
   {
-    double point1[3];
-    inputROIPoints->GetPoint(line->GetPointId(pointIndex), point1);
-
-    double point2[3];
-    inputROIPoints->GetPoint(line->GetPointId(pointIndex+1), point2);
+    const double* point1 = this->Internal->GetPoint(linePointIds[pointIndex]);
+    const double* point2 = this->Internal->GetPoint(linePointIds[pointIndex+1]);
 
     areaSum += (point2[0]-point1[0])*(point2[1]+point1[1]);
   }
@@ -790,43 +1100,24 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::IsLineClockwise(vtkPolyData*
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::ReverseLine(vtkLine* originalLine, vtkLine* newLine)
+void vtkPlanarContourToClosedSurfaceConversionRule::ReverseLine(vtkIdType* linePointIds, int numberOfPoints)
 {
-  if (!originalLine)
-  {
-    vtkErrorMacro("ReverseLine: Invalid vtkLine!");
-    return;
-  }
-
-  if (!newLine)
+  if (!linePointIds)
   {
-    vtkErrorMacro("ReverseLine: Invalid vtkLine!");
+    vtkErrorMacro("ReverseLine: Invalid point ID list!");
     return;
   }
 
-  int numberOfPoints = originalLine->GetNumberOfPoints();
-
-  vtkSmartPointer<vtkIdList> newPoints = newLine->GetPointIds();
-
-  for (int pointInLineIndex = numberOfPoints-1; pointInLineIndex >= 0; pointInLineIndex--)
-  {
-    newPoints->InsertNextId(originalLine->GetPointId(pointInLineIndex));
-  }
+  std::reverse(linePointIds, linePointIds + numberOfPoints);
 }
 
 //----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetNumberOfLinesOnPlane(vtkPolyData* inputROIPoints, int numberOfLines, int originalLineIndex)
+int vtkPlanarContourToClosedSurfaceConversionRule::GetNumberOfLinesOnPlane(int numberOfLines, int originalLineIndex)
 {
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("GetNumberOfLinesOnPlane: Invalid vtkPolyData!");
-    return 0;
-  }
-
-  double lineZ = inputROIPoints->GetCell(originalLineIndex)->GetBounds()[4]; // z-value
+  double lineZ = this->Internal->GetLineBounds(originalLineIndex)[4]; // z-value
 
   int currentLineIndex = originalLineIndex+1;
-  while (currentLineIndex < numberOfLines && inputROIPoints->GetCell(currentLineIndex)->GetBounds()[4] == lineZ)
+  while (currentLineIndex < numberOfLines && this->Internal->GetLineBounds(currentLineIndex)[4] == lineZ)
   {
     currentLineIndex ++;
   }
@@ -834,26 +1125,10 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetNumberOfLinesOnPlane(vtkPo
 }
 
 //----------------------------------------------------------------------------
-bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(vtkLine* line1, vtkLine* line2)
+bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(int line1Index, int line2Index)
 {
-  if (!line1)
-  {
-    vtkErrorMacro("DoLinesOverlap: Invalid vtkLine!");
-    return false;
-  }
-
-  if (!line2)
-  {
-    vtkErrorMacro("DoLinesOverlap: Invalid vtkLine!");
-    return false;
-  }
-
-  double bounds1[6];
-  line1->GetBounds(bounds1);
-
-
-  double bounds2[6];
-  line2->GetBounds(bounds2);
+  const double* bounds1 = this->Internal->GetLineBounds(line1Index);
+  const double* bounds2 = this->Internal->GetLineBounds(line2Index);
 
   return bounds1[0] < bounds2[1] &&
          bounds1[1] > bounds2[0] &&
@@ -862,26 +1137,19 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(vtkLine* line
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkIdList* points, int numberOfPoints, int currentLineIndex, std::vector< int > overlappingLines, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine)
+void vtkPlanarContourToClosedSurfaceConversionRule::Branch(const vtkIdType* points, int numberOfPoints, int currentLineIndex, const std::vector< int >& overlappingLines, std::vector<vtkIdType>& outputLinePointIds)
 {
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("Branch: Invalid vtkPolyData!");
-    return;
-  }
+  outputLinePointIds.clear();
 
   if (!points)
   {
-    vtkErrorMacro("Branch: Invalid vtkIdList!");
+    vtkErrorMacro("Branch: Invalid point ID list!");
     return;
   }
-  
-  vtkSmartPointer<vtkIdList> outputLinePointIds = outputLine->GetPointIds();
-  outputLinePointIds->Initialize();
 
   if (overlappingLines.size() == 1)
   {
-    outputLinePointIds->DeepCopy(points);
+    outputLinePointIds.assign(points, points + numberOfPoints);
     return;
   }
 
@@ -891,12 +1159,15 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
   for (int currentPointIndex = 0; currentPointIndex < numberOfPoints; ++currentPointIndex)
   {
     double currentPoint[3] = {0,0,0};
-    inputROIPoints->GetPoint(points->GetId(currentPointIndex), currentPoint);
+    const double* point = this->Internal->GetPoint(points[currentPointIndex]);
+    currentPoint[0] = point[0];
+    currentPoint[1] = point[1];
+    currentPoint[2] = point[2];
 
     // See if the point's closest branch is the input branch.
-    if (this->GetClosestBranch(inputROIPoints, currentPoint, overlappingLines, pointLocators, lineIdLists) == currentLineIndex)
+    if (this->GetClosestBranch(currentPoint, overlappingLines) == currentLineIndex)
     {
-      outputLinePointIds->InsertNextId(points->GetId(currentPointIndex));
+      outputLinePointIds.push_back(points[currentPointIndex]);
       prev = true;
     }
     else
@@ -904,33 +1175,27 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
       if (prev)
       {
         // Add one extra point to close up the surface.
-        outputLinePointIds->InsertNextId(points->GetId(currentPointIndex));
+        outputLinePointIds.push_back(points[currentPointIndex]);
       }
       prev = false;
     }
   }
-  int dividedNumberOfPoints = outputLine->GetNumberOfPoints();
+  int dividedNumberOfPoints = outputLinePointIds.size();
   if (dividedNumberOfPoints > 1)
   {
     // Determine if the trunk was originally a closed contour.
-    bool closed = (points->GetId(0) == points->GetId(numberOfPoints-1));
-    if (closed && (outputLinePointIds->GetId(0) != outputLinePointIds->GetId(dividedNumberOfPoints-1)))
+    bool closed = (points[0] == points[numberOfPoints-1]);
+    if (closed && (outputLinePointIds[0] != outputLinePointIds[dividedNumberOfPoints-1]))
     {
       // Make the new one a closed contour as well.
-      outputLinePointIds->InsertNextId(outputLinePointIds->GetId(0));
+      outputLinePointIds.push_back(outputLinePointIds[0]);
     }
   }
 }
 
 //----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< int > overlappingLines,  std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists)
+int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(double* originalPoint, const std::vector< int >& overlappingLines)
 {
-
-  if (!inputROIPoints)
-  {
-    vtkErrorMacro("GetClosestBranch: Invalid vtkPolyData!");
-  }
-
   // No need to check if there is only one overlapping line.
   if (overlappingLines.size() == 1)
   {
@@ -942,39 +1207,33 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData*
 
   for (int currentOverlapIndex = 0; currentOverlapIndex < overlappingLines.size(); ++currentOverlapIndex)
   {
-    
-    int closestPointId = pointLocators[currentOverlapIndex]->FindClosestPoint(originalPoint);
+    int lineIndex = overlappingLines[currentOverlapIndex];
+    int closestPointId = this->Internal->GetLinePointLocator(lineIndex)->FindClosestPoint(originalPoint);
+    if (closestPointId < 0)
+    {
+      continue;
+    }
 
-    double currentPoint[3] = {0,0,0};
-    inputROIPoints->GetPoint(lineIdLists[currentOverlapIndex]->GetId(closestPointId), currentPoint);
+    const double* currentPoint = this->Internal->GetPoint(this->Internal->GetLinePointIds(lineIndex)[closestPointId]);
 
     double currentLineDistance2 = vtkMath::Distance2BetweenPoints(currentPoint, originalPoint);
 
     if (currentLineDistance2 < minimumDistance2)
     {
       minimumDistance2 = currentLineDistance2;
-      closestLineIndex = overlappingLines[currentOverlapIndex];
-
+      closestLineIndex = lineIndex;
     }
-
   }
 
   return closestLineIndex;
-
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::SealMesh(vtkPolyData* inputROIPoints, vtkCellArray* inputLines, vtkCellArray* outputPolygons, std::vector< bool > lineTriganulatedToAbove, std::vector< bool > lineTriganulatedToBelow)
+void vtkPlanarContourToClosedSurfaceConversionRule::SealMesh(vtkScratchArena* arena, int numberOfLines, vtkCellArray* outputPolygons)
 {
-  if (!inputROIPoints)
+  if (!arena)
   {
-    vtkErrorMacro("SealMesh: Invalid vtkPolyData!");
-    return;
-  }
-
-  if (!inputLines)
-  {
-    vtkErrorMacro("SealMesh: Invalid vtkCellArray!");
+    vtkErrorMacro("SealMesh: Invalid scratch arena!");
     return;
   }
 
@@ -984,81 +1243,68 @@ void vtkPlanarContourToClosedSurfaceConversionRule::SealMesh(vtkPolyData* inputR
     return;
   }
 
-  int numberOfLines = inputLines->GetNumberOfCells();
-
-  double lineSpacing = this->GetSpacingBetweenLines(inputROIPoints);
+  double lineSpacing = this->GetSpacingBetweenLines();
 
   for(int currentLineIndex = 0; currentLineIndex < numberOfLines; ++currentLineIndex)
   {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputROIPoints->GetCell(currentLineIndex));
+    // The line point IDs are not changed by creating the external lines (only points are added)
+    const vtkIdType* currentLinePointIds = this->Internal->GetLinePointIds(currentLineIndex);
+    int numberOfPointsInCurrentLine = this->Internal->GetNumberOfPointsInLine(currentLineIndex);
+    if (numberOfPointsInCurrentLine < 2)
+    {
+      continue;
+    }
 
-    if (!lineTriganulatedToAbove[currentLineIndex])
+    if (!this->Internal->LineTriangulatedToAbove[currentLineIndex])
     {
-      vtkSmartPointer<vtkLine> externalLine = vtkSmartPointer<vtkLine>::New();
-      vtkSmartPointer<vtkIdList> externalIds = vtkSmartPointer<vtkIdList>::New();
-      externalIds->Initialize();
-
-      this->CreateExternalLine(inputROIPoints, currentLine, externalLine, externalIds, lineSpacing);
-      this->TriangulateLine(inputROIPoints, externalLine, externalIds, outputPolygons);
-      this->TriangulateContours(inputROIPoints, 
-                                currentLine->GetPointIds(), currentLine->GetNumberOfPoints(),
-                                externalIds, externalLine->GetNumberOfPoints(),
+      this->CreateExternalLine(arena, currentLinePointIds, numberOfPointsInCurrentLine, lineSpacing);
+      this->TriangulateLine(arena, outputPolygons);
+      this->TriangulateContours(arena,
+                                currentLinePointIds, numberOfPointsInCurrentLine,
+                                &arena->ExternalLinePointIds[0], arena->ExternalLinePointIds.size(),
                                 outputPolygons);
     }
 
-    if (!lineTriganulatedToBelow[currentLineIndex])
+    if (!this->Internal->LineTriangulatedToBelow[currentLineIndex])
     {
-      vtkSmartPointer<vtkLine> externalLine = vtkSmartPointer<vtkLine>::New();
-      vtkSmartPointer<vtkIdList> externalIds = vtkSmartPointer<vtkIdList>::New();
-      externalIds->Initialize();
-
-      this->CreateExternalLine(inputROIPoints, currentLine, externalLine, externalIds, -lineSpacing);
-      this->TriangulateLine(inputROIPoints, externalLine, externalIds, outputPolygons);
-      this->TriangulateContours(inputROIPoints, 
-                                currentLine->GetPointIds(), currentLine->GetNumberOfPoints(),
-                                externalIds, externalLine->GetNumberOfPoints(),
+      this->CreateExternalLine(arena, currentLinePointIds, numberOfPointsInCurrentLine, -lineSpacing);
+      this->TriangulateLine(arena, outputPolygons);
+      this->TriangulateContours(arena,
+                                currentLinePointIds, numberOfPointsInCurrentLine,
+                                &arena->ExternalLinePointIds[0], arena->ExternalLinePointIds.size(),
                                 outputPolygons);
     }
   }
 
 }
 
-double vtkPlanarContourToClosedSurfaceConversionRule::GetSpacingBetweenLines(vtkPolyData* inputROIPoints)
+//----------------------------------------------------------------------------
+double vtkPlanarContourToClosedSurfaceConversionRule::GetSpacingBetweenLines()
 {
-  if (!inputROIPoints)
+  if (this->Internal->GetNumberOfLines() < 2
+    || this->Internal->GetNumberOfPointsInLine(0) == 0 || this->Internal->GetNumberOfPointsInLine(1) == 0)
   {
-    vtkErrorMacro("GetSpacingBetweenLines: Invalid vtkPolyData!");
     return 0;
   }
 
-  vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-  line1->DeepCopy(inputROIPoints->GetCell(0));
-  double pointOnLine1[3] = {0,0,0};
-  inputROIPoints->GetPoint(line1->GetPointId(0), pointOnLine1);
-  
-  vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-  line2->DeepCopy(inputROIPoints->GetCell(1));
-  double pointOnLine2[3] = {0,0,0};
-  inputROIPoints->GetPoint(line2->GetPointId(0), pointOnLine2);
+  const double* pointOnLine1 = this->Internal->GetPoint(this->Internal->GetLinePointIds(0)[0]);
+  const double* pointOnLine2 = this->Internal->GetPoint(this->Internal->GetLinePointIds(1)[0]);
 
   return std::abs(pointOnLine1[2] - pointOnLine2[2]);
-
 }
 
 //----------------------------------------------------------------------------
-bool vtkPlanarContourToClosedSurfaceConversionRule::IsPointOnLine(vtkIdList* pointIds, vtkIdType originalPointId)
+bool vtkPlanarContourToClosedSurfaceConversionRule::IsPointOnLine(const vtkIdType* pointIds, int numberOfPoints, vtkIdType originalPointId)
 {
   if (!pointIds)
   {
-    vtkErrorMacro("IsPointOnLine: Invalid vtkIdList!");
+    vtkErrorMacro("IsPointOnLine: Invalid point ID list!");
     return false;
   }
 
-  int numberOfPoints = pointIds->GetNumberOfIds();
   for (int currentPointId = 0; currentPointId < numberOfPoints; ++currentPointId)
   {
-    if (pointIds->GetId(currentPointId) == originalPointId)
+    if (pointIds[currentPointId] == originalPointId)
     {
       return true;
     }
@@ -1067,114 +1313,92 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::IsPointOnLine(vtkIdList* poi
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::CreateExternalLine(vtkPolyData* inputROIPoints, vtkLine* inputLine, vtkLine* outputLine, vtkIdList* outputLinePointIds, double lineSpacing)
+void vtkPlanarContourToClosedSurfaceConversionRule::CreateExternalLine(vtkScratchArena* arena, const vtkIdType* inputLinePointIds, int numberOfPoints, double lineSpacing)
 {
-  
-  if (!inputROIPoints)
+  if (!arena)
   {
-    vtkErrorMacro("CreateExternalLine: invalid vtkPolyData");
+    vtkErrorMacro("CreateExternalLine: Invalid scratch arena!");
     return;
   }
 
-  if (!inputLine)
-  {
-    vtkErrorMacro("CreateExternalLine: invalid vtkLine");
-    return;
-  }
+  std::vector<vtkIdType>& outputLinePointIds = arena->ExternalLinePointIds;
+  std::vector<double>& outputLineCoordinates = arena->ExternalLineCoordinates;
+  outputLinePointIds.clear();
+  outputLineCoordinates.clear();
 
-  if (!outputLinePointIds)
+  if (!inputLinePointIds || numberOfPoints < 2)
   {
-    vtkErrorMacro("CreateExternalLine: Invalid vtkIdList!");
+    vtkErrorMacro("CreateExternalLine: Invalid line!");
+    return;
   }
 
-  vtkSmartPointer<vtkCellArray> lines = inputROIPoints->GetLines();
-  lines->InsertNextCell(outputLine);
-  
-  int numberOfPoints = inputLine->GetNumberOfPoints();
-
-  vtkSmartPointer<vtkPoints> inputPoints = inputROIPoints->GetPoints();
-  
-  vtkSmartPointer<vtkPoints> inputLinePoints = inputLine->GetPoints();
-  vtkSmartPointer<vtkPoints> outputPoints = outputLine->GetPoints();
-  outputPoints->Initialize();
-
-  vtkSmartPointer<vtkIdList> outputPointIds = outputLine->GetPointIds();
-  outputPointIds->Initialize();
-
   for (int currentLocation=0; currentLocation < numberOfPoints-1; ++currentLocation)
   {
-    double currentPoint[3] = {0,0,0};
-    inputLinePoints->GetPoint(currentLocation, currentPoint);
+    // Copy the coordinates, as inserting the new point invalidates the pointer
+    const double* currentPoint = this->Internal->GetPoint(inputLinePointIds[currentLocation]);
 
     double outputPoint[3] = {0,0,0};
     outputPoint[0] = currentPoint[0];
     outputPoint[1] = currentPoint[1];
     outputPoint[2] = currentPoint[2] + lineSpacing/2;
 
-    outputPoints->InsertNextPoint(outputPoint);
-    outputPointIds->InsertNextId(currentLocation);
-
-    int inputPointIndex = inputPoints->InsertNextPoint(outputPoint);
-    outputLinePointIds->InsertNextId(inputPointIndex);
-
+    outputLineCoordinates.insert(outputLineCoordinates.end(), outputPoint, outputPoint + 3);
+    outputLinePointIds.push_back(this->Internal->InsertNextPoint(outputPoint));
   }
-  outputPointIds->InsertNextId(outputPointIds->GetId(0));
-  outputLinePointIds->InsertNextId(outputLinePointIds->GetId(0));
 
+  // Close the line
+  outputLinePointIds.push_back(outputLinePointIds[0]);
+  outputLineCoordinates.insert(outputLineCoordinates.end(), outputLineCoordinates.begin(), outputLineCoordinates.begin() + 3);
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateLine(vtkPolyData* inputROIPoints, vtkLine* inputLine, vtkIdList* inputLinePointIds, vtkCellArray* outputPolys)
+void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateLine(vtkScratchArena* arena, vtkCellArray* outputPolys)
 {
-  if (!inputROIPoints)
+  if (!arena)
   {
-    vtkErrorMacro("TriangulateLine: Invalid vtkPolyData!");
+    vtkErrorMacro("TriangulateLine: Invalid scratch arena!");
     return;
   }
 
-  if (!inputLine)
-  {
-   vtkErrorMacro("TriangulateLine: Invalid vtkLine!");
-   return;
-  }
-
   if (!outputPolys)
   {
    vtkErrorMacro("TriangulateLine: Invalid vtkCellArray!");
    return;
   }
 
-  if (!inputLinePointIds)
+  const std::vector<vtkIdType>& inputLinePointIds = arena->ExternalLinePointIds;
+  const std::vector<double>& inputLineCoordinates = arena->ExternalLineCoordinates;
+
+  // The last point of the closed line is not passed to the triangulation
+  int numberOfPoints = inputLinePointIds.size();
+  int numberOfDistinctPoints = numberOfPoints - 1;
+  if (numberOfDistinctPoints < 3)
   {
-    vtkErrorMacro("TriangulateLine: Invalid vtkIdList!");
+    // Nothing to triangulate
+    return;
   }
 
-  int numberOfPoints = inputLine->GetNumberOfPoints();
-  vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New(); 
-  linePolyData->SetPoints(inputLine->GetPoints());
-
-  vtkSmartPointer<vtkPolyData> boundary = vtkSmartPointer<vtkPolyData>::New();
-  boundary->SetPoints(linePolyData->GetPoints());
+  arena->InitializeDelaunay();
+  arena->DelaunayPoints->SetNumberOfPoints(numberOfDistinctPoints);
+  for (int pointIndex = 0; pointIndex < numberOfDistinctPoints; ++pointIndex)
+  {
+    arena->DelaunayPoints->SetPoint(pointIndex, &inputLineCoordinates[3*pointIndex]);
+  }
+  arena->DelaunayPoints->Modified();
+  arena->DelaunayInput->Modified();
 
   // Use vtkDelaunay2D to triangulate the line and produce new polygons
-  vtkSmartPointer<vtkDelaunay2D> delaunay = vtkSmartPointer<vtkDelaunay2D>::New();
-
-#if (VTK_MAJOR_VERSION <= 5)
-  delaunay->SetInput(linePolyData);
-  delaunay->SetSource(boundary);
-#else
-  delaunay->SetInputData(linePolyData);
-  delaunay->SetSourceData(boundary);
-#endif
-  delaunay->Update();
+  arena->Delaunay->Modified();
+  arena->Delaunay->Update();
 
-  vtkSmartPointer<vtkPolyData> output = delaunay->GetOutput();
-  vtkSmartPointer<vtkCellArray> newPolygons = output->GetPolys();
+  vtkPolyData* output = arena->Delaunay->GetOutput();
+  vtkCellArray* newPolygons = output->GetPolys();
 
   // Check each new polygon to see if it is inside the line.
   int numberOfPolygons = output->GetNumberOfPolys();
-  vtkSmartPointer<vtkIdList> currentPolygonIds = vtkSmartPointer<vtkIdList>::New();
+  vtkIdList* currentPolygonIds = arena->PolygonPointIds;
 
+  newPolygons->InitTraversal();
   for(int currentPolygon = 0; currentPolygon < numberOfPolygons; ++currentPolygon)
   {
     newPolygons->GetNextCell(currentPolygonIds);
@@ -1184,8 +1408,7 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateLine(vtkPolyData*
     float y = 0;
     for (int coordinate = 0; coordinate < 3; ++coordinate)
     {
-      double currentPoint[3] = {0,0,0};
-      inputROIPoints->GetPoint(inputLinePointIds->GetId(currentPolygonIds->GetId(coordinate)), currentPoint);
+      const double* currentPoint = this->Internal->GetPoint(inputLinePointIds[currentPolygonIds->GetId(coordinate)]);
       x += currentPoint[0];
       y += currentPoint[1];
     }
@@ -1194,47 +1417,49 @@ void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateLine(vtkPolyData*
     double centerPoint[2] = {x, y};
 
     // Check to see if the center of the polyon is inside the line.
-    if (this->IsPointInsideLine(inputROIPoints, inputLine, centerPoint))
+    if (this->IsPointInsideLine(&inputLineCoordinates[0], numberOfPoints, centerPoint))
     {
-      outputPolys->InsertNextCell(3);
-      outputPolys->InsertCellPoint(inputLinePointIds->GetId(currentPolygonIds->GetId(0)));
-      outputPolys->InsertCellPoint(inputLinePointIds->GetId(currentPolygonIds->GetId(1)));
-      outputPolys->InsertCellPoint(inputLinePointIds->GetId(currentPolygonIds->GetId(2)));
+      vtkIdType triangle[3] =
+        {
+        inputLinePointIds[currentPolygonIds->GetId(0)],
+        inputLinePointIds[currentPolygonIds->GetId(1)],
+        inputLinePointIds[currentPolygonIds->GetId(2)]
+        };
+      outputPolys->InsertNextCell(3, triangle);
     }
   }
 }
 
 //----------------------------------------------------------------------------
-bool vtkPlanarContourToClosedSurfaceConversionRule::IsPointInsideLine(vtkPolyData* inputROIPoints, vtkLine* inputLine, double* inputPoint)
+bool vtkPlanarContourToClosedSurfaceConversionRule::IsPointInsideLine(const double* lineCoordinates, int numberOfPoints, double* inputPoint)
 {
-  if (!inputROIPoints)
+  if (!lineCoordinates || numberOfPoints < 1)
   {
-    vtkErrorMacro("IsPointInsideLine: Invalid vtkPolyData!");
+    vtkErrorMacro("IsPointInsideLine: Invalid line!");
     return false;
   }
 
-  if (!inputLine)
+  // Create a ray that starts outside the polygon and goes to the point being checked.
+  double minimumX = lineCoordinates[0];
+  double minimumY = lineCoordinates[1];
+  for (int pointIndex = 1; pointIndex < numberOfPoints; ++pointIndex)
   {
-    vtkErrorMacro("IsPointInsideLine: Invalid vtkLine!");
-    return false;
+    minimumX = std::min(minimumX, lineCoordinates[3*pointIndex]);
+    minimumY = std::min(minimumY, lineCoordinates[3*pointIndex+1]);
   }
 
-  // Create a ray that starts outside the polygon and goes to the point being checked.
-  double bounds[6];
-  inputLine->GetBounds(bounds);
-
-  double ray[4] = {bounds[0]-10, bounds[2]-10, inputPoint[0], inputPoint[1]};
+  double ray[4] = {minimumX-10, minimumY-10, inputPoint[0], inputPoint[1]};
 
   // Check all of the edges to see if they intersect.
   int numberOfIntersections = 0;
-  for(int currentPointId = 0; currentPointId < inputLine->GetNumberOfPoints()-1; ++currentPointId)
+  for(int currentPointId = 0; currentPointId < numberOfPoints-1; ++currentPointId)
   {
     double edge[4];
-    edge[0] = inputLine->GetPoints()->GetPoint(inputLine->GetPointId(currentPointId))[0];
-    edge[1] = inputLine->GetPoints()->GetPoint(inputLine->GetPointId(currentPointId))[1];
+    edge[0] = lineCoordinates[3*currentPointId];
+    edge[1] = lineCoordinates[3*currentPointId+1];
 
-    edge[2] = inputLine->GetPoints()->GetPoint(inputLine->GetPointId(currentPointId+1))[0];
-    edge[3] = inputLine->GetPoints()->GetPoint(inputLine->GetPointId(currentPointId+1))[1];
+    edge[2] = lineCoordinates[3*(currentPointId+1)];
+    edge[3] = lineCoordinates[3*(currentPointId+1)+1];
 
     // Check to see if the point is on either end of the edge.
     if ((inputPoint[0] == edge[0] && inputPoint[1] == edge[1]) ||
@@ -28,13 +28,10 @@
 #include "vtkSegmentationCoreConfigure.h"
 
 // VTK includes
-#include "vtkPointLocator.h"
+#include "vtkMultiThreader.h"
 
 class vtkPolyData;
-class vtkIdList;
 class vtkCellArray;
-class vtkLine;
-class vtkPoints;
 
 /// \ingroup SegmentationCore
 /// \brief Convert planar contour representation (vtkPolyData type) to
@@ -47,6 +44,11 @@ class vtkPoints;
 class vtkSegmentationCore_EXPORT vtkPlanarContourToClosedSurfaceConversionRule
   : public vtkSegmentationConverterRule
 {
+public:
+  /// Conversion parameter: number of threads triangulating the pairs of consecutive contour planes.
+  /// Value of 1 means serial execution, 0 means the default number of threads of the system.
+  static const std::string GetNumberOfThreadsParameterName() { return "Number of threads"; };
+
 public:
   static vtkPlanarContourToClosedSurfaceConversionRule *New();
   vtkTypeMacro(vtkPlanarContourToClosedSurfaceConversionRule, vtkSegmentationConverterRule );
@@ -80,59 +82,81 @@ public:
   /// Human-readable name of the target representation
   virtual const char* GetTargetRepresentationName() { return vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(); };
 
+  /// Get time spent in the last conversion (in seconds)
+  vtkGetMacro(LastConversionTime, double);
+
 protected:
+  class vtkInternal;
+  class vtkScratchArena;
+
   vtkPlanarContourToClosedSurfaceConversionRule();
   virtual ~vtkPlanarContourToClosedSurfaceConversionRule();
 
+  /// Collect the pairs of consecutive planes and the overlapping lines between them
+  void FindPlanePairs();
+
+  /// Connect the overlapping lines of a pair of consecutive planes.
+  /// Only reads shared data, and writes the triangulated flags of the lines in the pair,
+  /// so pairs can be processed concurrently with separate scratch arenas and output arrays.
+  void TriangulatePlanePair(vtkScratchArena*, int, vtkCellArray*);
+
+  /// Triangulate all plane pairs on multiple threads. Triangles are added to the output
+  /// in the order of the plane pairs, so the result is the same as with serial execution.
+  void TriangulatePlanePairsParallel(int, vtkCellArray*);
+
+  /// Thread function processing every N-th plane pair (N being the number of threads)
+  static VTK_THREAD_RETURN_TYPE TriangulatePlanePairsThreadFunction(void*);
+
   /// Construct a surface triangulation using a dynamic programming algorithm.
-  void TriangulateContours(vtkPolyData*, vtkIdList*, int, vtkIdList*, int, vtkCellArray*);
+  void TriangulateContours(vtkScratchArena*, const vtkIdType*, int, const vtkIdType*, int, vtkCellArray*);
 
   /// Find the index of the last point in a contour.
   int GetEndLoop(int, int, bool);
 
   /// Find the point on the given line that is closest to the given point.
-  int GetClosestPoint(vtkPolyData*, double*, vtkIdList*, int);
+  int GetClosestPoint(const double*, const vtkIdType*, int);
 
   /// Remove the keyholes from the contours.
-  void FixKeyholes(vtkPolyData*, int, int, int);
+  void FixKeyholes(vtkScratchArena*, int, int);
 
-  /// Set all of the lines to be oriented in the clockwise direction.
-  void SetLinesCounterClockwise(vtkPolyData*);
+  /// Set all of the lines to be oriented in the counter-clockwise direction.
+  void SetLinesCounterClockwise();
 
   /// Determine if a line runs in a clockwise orientation.
-  bool IsLineClockwise(vtkPolyData*, vtkLine*);
+  bool IsLineClockwise(const vtkIdType*, int);
 
-  /// Reverse the orientation of a line from clockwise to counter-clockwise and vice versa.
-  void ReverseLine(vtkLine*, vtkLine*);
+  /// Reverse the orientation of a line from clockwise to counter-clockwise and vice versa (in place).
+  void ReverseLine(vtkIdType*, int);
 
   /// Determine the number of contours that share the same Z-coordinates.
-  int GetNumberOfLinesOnPlane(vtkPolyData*, int, int);
+  int GetNumberOfLinesOnPlane(int, int);
 
   /// Determine if two contours overlap in the XY axis.
-  bool DoLinesOverlap(vtkLine*, vtkLine*);
+  bool DoLinesOverlap(int, int);
 
   /// Create a branching pattern for overlapping contours.
-  void Branch(vtkPolyData*, vtkIdList*, int, int, std::vector< int >, std::vector<vtkSmartPointer<vtkPointLocator> >, std::vector<vtkSmartPointer<vtkIdList> >, vtkLine*);
-  
+  void Branch(const vtkIdType*, int, int, const std::vector<int>&, std::vector<vtkIdType>&);
+
   /// Find the branch closest from the point on the trunk
-  int GetClosestBranch(vtkPolyData*, double*, std::vector< int >, std::vector<vtkSmartPointer<vtkPointLocator> >, std::vector<vtkSmartPointer<vtkIdList> >);
+  int GetClosestBranch(double*, const std::vector<int>&);
 
   /// Seal the exterior contours of the mesh.
-  void SealMesh(vtkPolyData*, vtkCellArray*, vtkCellArray*, std::vector< bool >, std::vector< bool >);
+  void SealMesh(vtkScratchArena*, int, vtkCellArray*);
 
-  double GetSpacingBetweenLines(vtkPolyData*);
+  double GetSpacingBetweenLines();
 
   /// Check to see if the given point is on the line
-  bool IsPointOnLine(vtkIdList*, vtkIdType);
+  bool IsPointOnLine(const vtkIdType*, int, vtkIdType);
 
   /// Create an additional contour on the exterior of the surface to compensate for slice thickness.
-  void CreateExternalLine(vtkPolyData*, vtkLine*, vtkLine*, vtkIdList*, double);
+  /// The point IDs and coordinates of the new contour are stored in the scratch arena.
+  void CreateExternalLine(vtkScratchArena*, const vtkIdType*, int, double);
 
-  /// Triangulate the interior of a contour on the xy plane.
-  void TriangulateLine(vtkPolyData*, vtkLine*, vtkIdList*, vtkCellArray*);
+  /// Triangulate the interior of the external contour (stored in the scratch arena) on the xy plane.
+  void TriangulateLine(vtkScratchArena*, vtkCellArray*);
 
-  /// Determine if a point is on the interior of a line.
-  bool IsPointInsideLine(vtkPolyData*, vtkLine*, double[]);
+  /// Determine if a point is on the interior of a closed line given by its point coordinates.
+  bool IsPointInsideLine(const double*, int, double[]);
 
   /// Determine if two line segments intersect.
   bool DoLineSegmentsIntersect(double[], double[]);
@@ -143,6 +167,13 @@ protected:
   /// Find the index of the next point in the contour.
   int GetPreviousLocation(int, int, bool);
 
+protected:
+  /// Contour points and lines of the current conversion in flat arrays
+  vtkInternal* Internal;
+
+  /// Time spent in the last conversion (in seconds)
+  double LastConversionTime;
+
 private:
   vtkPlanarContourToClosedSurfaceConversionRule(const vtkPlanarContourToClosedSurfaceConversionRule&); // Not implemented
   void operator=(const vtkPlanarContourToClosedSurfaceConversionRule&);               // Not implemented
@@ -30,6 +30,12 @@
 #include <vtkSmartPointer.h>
 #include <vtkMath.h>
 #include <vtkDataSet.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkCellArray.h>
 
 // STD includes
 #include <sstream>
@@ -38,6 +44,56 @@
 //----------------------------------------------------------------------------
 const double vtkSegment::SEGMENT_COLOR_VALUE_INVALID[4] = {0.5, 0.5, 0.5, 1.0};
 
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Determine if any array of a field data is shared with other objects
+  bool IsFieldDataShared(vtkFieldData* fieldData)
+  {
+    if (!fieldData)
+    {
+      return false;
+    }
+    for (int arrayIndex=0; arrayIndex<fieldData->GetNumberOfArrays(); ++arrayIndex)
+    {
+      vtkAbstractArray* array = fieldData->GetAbstractArray(arrayIndex);
+      if (array && array->GetReferenceCount() > 1)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Duplicate the arrays of data set attributes if any of them is shared
+  bool DetachSharedAttributes(vtkDataSetAttributes* attributes)
+  {
+    if (!IsFieldDataShared(attributes))
+    {
+      return false;
+    }
+    // Shallow copy of the duplicate keeps the active attributes (scalars, normals, etc.)
+    vtkSmartPointer<vtkDataSetAttributes> attributesCopy = vtkSmartPointer<vtkDataSetAttributes>::Take(attributes->NewInstance());
+    attributesCopy->DeepCopy(attributes);
+    attributes->ShallowCopy(attributesCopy);
+    return true;
+  }
+
+  /// Duplicate a non-empty cell array if it is shared
+  /// \return True if the cell array was duplicated
+  bool DetachSharedCellArray(vtkCellArray* cells, vtkSmartPointer<vtkCellArray>& cellsCopy)
+  {
+    if ( !cells || cells->GetNumberOfCells() == 0
+      || (cells->GetReferenceCount() == 1 && cells->GetData()->GetReferenceCount() == 1) )
+    {
+      return false;
+    }
+    cellsCopy = vtkSmartPointer<vtkCellArray>::New();
+    cellsCopy->DeepCopy(cells);
+    return true;
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSegment);
 
@@ -48,6 +104,9 @@ vtkSegment::vtkSegment()
   this->DefaultColor[0] = 0.5;
   this->DefaultColor[1] = 0.5;
   this->DefaultColor[2] = 0.5;
+
+  vtkMath::UninitializeBounds(this->CachedBounds);
+  this->CachedBoundsMTime = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -71,6 +130,16 @@ void vtkSegment::PrintSelf(ostream& os, vtkIndent indent)
   {
     os << indent << "  " << reprIt->first << "\n";
   }
+  std::set<std::string>::iterator evictedIt;
+  for (evictedIt=this->EvictedRepresentationNames.begin(); evictedIt!=this->EvictedRepresentationNames.end(); ++evictedIt)
+  {
+    os << indent << "  " << (*evictedIt) << " (evicted)\n";
+  }
+  std::set<std::string>::iterator deferredIt;
+  for (deferredIt=this->DeferredRepresentationNames.begin(); deferredIt!=this->DeferredRepresentationNames.end(); ++deferredIt)
+  {
+    os << indent << "  " << (*deferredIt) << " (deferred)\n";
+  }
 
   std::vector<std::string>::iterator tagIt;
   os << indent << "Tags:\n";
@@ -86,10 +155,17 @@ bool vtkSegment::GetModifiedSinceRead(const vtkTimeStamp& storedTime)
   RepresentationMap::iterator reprIt;
   for (reprIt=this->Representations.begin(); reprIt!=this->Representations.end(); ++reprIt)
   {
-    if (reprIt->second && reprIt->second->GetMTime() > storedTime)
+    if (!reprIt->second || reprIt->second->GetMTime() <= storedTime)
     {
-      return true;
+      continue;
     }
+    // Loading or regenerating the data on request does not modify the segment
+    std::map<std::string, unsigned long>::iterator loadedTimeIt = this->RepresentationLoadedTimes.find(reprIt->first);
+    if (loadedTimeIt != this->RepresentationLoadedTimes.end() && reprIt->second->GetMTime() <= loadedTimeIt->second)
+    {
+      continue;
+    }
+    return true;
   }
   return false;
 }
@@ -119,6 +195,18 @@ void vtkSegment::WriteXML(ostream& of, int nIndent)
 
 //----------------------------------------------------------------------------
 void vtkSegment::DeepCopy(vtkSegment* aSegment)
+{
+  this->CopySegment(aSegment, false);
+}
+
+//----------------------------------------------------------------------------
+void vtkSegment::ShallowCopy(vtkSegment* aSegment)
+{
+  this->CopySegment(aSegment, true);
+}
+
+//----------------------------------------------------------------------------
+void vtkSegment::CopySegment(vtkSegment* aSegment, bool shareRepresentationData)
 {
   if (!aSegment)
   {
@@ -130,7 +218,15 @@ void vtkSegment::DeepCopy(vtkSegment* aSegment)
   this->SetDefaultColor(aSegment->DefaultColor);
   this->Tags = aSegment->Tags;
 
-  // Deep copy representations
+  // Data of deferred representations needs to be loaded, as the copy cannot request it
+  std::set<std::string> deferredRepresentationNames = aSegment->DeferredRepresentationNames;
+  for (std::set<std::string>::iterator deferredIt = deferredRepresentationNames.begin();
+    deferredIt != deferredRepresentationNames.end(); ++deferredIt)
+  {
+    aSegment->GetRepresentation(*deferredIt);
+  }
+
+  // Copy representations. Shared data is duplicated when requested for writing (copy-on-write)
   RepresentationMap::iterator reprIt;
   for (reprIt=aSegment->Representations.begin(); reprIt!=aSegment->Representations.end(); ++reprIt)
   {
@@ -138,13 +234,27 @@ void vtkSegment::DeepCopy(vtkSegment* aSegment)
       vtkSegmentationConverterFactory::GetInstance()->ConstructRepresentationObjectByClass( reprIt->second->GetClassName() );
     if (!representationCopy)
     {
-      vtkErrorMacro("DeepCopy: Unable to construct representation type class '" << reprIt->second->GetClassName() << "'");
+      vtkErrorMacro("CopySegment: Unable to construct representation type class '" << reprIt->second->GetClassName() << "'");
       return;
     }
-    representationCopy->DeepCopy(reprIt->second);
+    if (shareRepresentationData)
+    {
+      representationCopy->ShallowCopy(reprIt->second);
+    }
+    else
+    {
+      representationCopy->DeepCopy(reprIt->second);
+    }
     this->AddRepresentation(reprIt->first, representationCopy);
     representationCopy->Delete(); // Release ownership to segment only
   }
+
+  // Evicted representations are still contained, they are regenerated in the copy when requested
+  std::set<std::string>::iterator evictedIt;
+  for (evictedIt=aSegment->EvictedRepresentationNames.begin(); evictedIt!=aSegment->EvictedRepresentationNames.end(); ++evictedIt)
+  {
+    this->EvictRepresentation(*evictedIt);
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -152,19 +262,38 @@ void vtkSegment::DeepCopy(vtkSegment* aSegment)
 //---------------------------------------------------------------------------
 void vtkSegment::GetBounds(double bounds[6])
 {
-  vtkMath::UninitializeBounds(bounds);
-
+  // Data sets cache their own bounds based on their modified time, so only the union needs to be
+  // cached here. It is recomputed if a representation is added, removed, evicted or modified.
+  unsigned long boundsMTime = this->GetMTime();
   RepresentationMap::iterator reprIt;
   for (reprIt=this->Representations.begin(); reprIt!=this->Representations.end(); ++reprIt)
   {
-    vtkDataSet* representationDataSet = vtkDataSet::SafeDownCast(reprIt->second);
-    if (representationDataSet)
+    if (reprIt->second.GetPointer() && reprIt->second->GetMTime() > boundsMTime)
     {
-      double representationBounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
-      vtkMath::UninitializeBounds(representationBounds);
-      vtkSegment::ExtendBounds(representationBounds, bounds);
+      boundsMTime = reprIt->second->GetMTime();
     }
   }
+
+  if (boundsMTime != this->CachedBoundsMTime)
+  {
+    vtkMath::UninitializeBounds(this->CachedBounds);
+    for (reprIt=this->Representations.begin(); reprIt!=this->Representations.end(); ++reprIt)
+    {
+      vtkDataSet* representationDataSet = vtkDataSet::SafeDownCast(reprIt->second);
+      if (representationDataSet)
+      {
+        double representationBounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+        representationDataSet->GetBounds(representationBounds);
+        vtkSegment::ExtendBounds(representationBounds, this->CachedBounds);
+      }
+    }
+    this->CachedBoundsMTime = boundsMTime;
+  }
+
+  for (int i=0; i<6; ++i)
+  {
+    bounds[i] = this->CachedBounds[i];
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -172,39 +301,231 @@ vtkDataObject* vtkSegment::GetRepresentation(std::string name)
 {
   // Use find function instead of operator[] not to create empty representation if it is missing
   RepresentationMap::iterator reprIt = this->Representations.find(name);
-  if (reprIt != this->Representations.end())
+  if (reprIt == this->Representations.end())
   {
-    return reprIt->second.GetPointer();
+    if (!this->EvictedRepresentationNames.erase(name))
+    {
+      return NULL;
+    }
+
+    // Representation has been evicted, ask the owner segmentation to regenerate it
+    this->InvokeEvent(vtkSegment::RepresentationRequestedEvent, (void*)name.c_str());
+    reprIt = this->Representations.find(name);
+    if (reprIt == this->Representations.end())
+    {
+      vtkErrorMacro("GetRepresentation: Failed to regenerate evicted representation " << name);
+      return NULL;
+    }
+    this->RepresentationLoadedTimes[name] = reprIt->second->GetMTime();
   }
-  else
+  else if (this->DeferredRepresentationNames.erase(name))
   {
-    return NULL;
+    // Data of the representation has not been loaded yet, ask the observer to load it
+    this->InvokeEvent(vtkSegment::RepresentationDataRequestedEvent, (void*)name.c_str());
+    reprIt = this->Representations.find(name);
+    if (reprIt == this->Representations.end())
+    {
+      return NULL;
+    }
+    this->RepresentationLoadedTimes[name] = reprIt->second->GetMTime();
   }
+
+  this->RepresentationAccessTimes[name].Modified();
+  return reprIt->second.GetPointer();
+}
+
+//---------------------------------------------------------------------------
+vtkDataObject* vtkSegment::GetWritableRepresentation(std::string name)
+{
+  vtkDataObject* representation = this->GetRepresentation(name);
+  vtkSegment::DetachSharedRepresentationData(representation);
+  return representation;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegment::DetachSharedRepresentationData(vtkDataObject* representation)
+{
+  vtkDataSet* dataSet = vtkDataSet::SafeDownCast(representation);
+  if (!dataSet)
+  {
+    return false;
+  }
+
+  // Attributes (e.g. voxels of images, normals of surfaces)
+  bool detached = DetachSharedAttributes(dataSet->GetPointData());
+  detached = DetachSharedAttributes(dataSet->GetCellData()) || detached;
+
+  // Points
+  vtkPointSet* pointSet = vtkPointSet::SafeDownCast(dataSet);
+  if ( pointSet && pointSet->GetPoints()
+    && (pointSet->GetPoints()->GetReferenceCount() > 1 || pointSet->GetPoints()->GetData()->GetReferenceCount() > 1) )
+  {
+    vtkSmartPointer<vtkPoints> pointsCopy = vtkSmartPointer<vtkPoints>::New();
+    pointsCopy->DeepCopy(pointSet->GetPoints());
+    pointSet->SetPoints(pointsCopy);
+    detached = true;
+  }
+
+  // Cells
+  vtkPolyData* polyData = vtkPolyData::SafeDownCast(dataSet);
+  if (polyData)
+  {
+    bool cellsDetached = false;
+    vtkSmartPointer<vtkCellArray> cellsCopy;
+    if (DetachSharedCellArray(polyData->GetVerts(), cellsCopy))
+    {
+      polyData->SetVerts(cellsCopy);
+      cellsDetached = true;
+    }
+    if (DetachSharedCellArray(polyData->GetLines(), cellsCopy))
+    {
+      polyData->SetLines(cellsCopy);
+      cellsDetached = true;
+    }
+    if (DetachSharedCellArray(polyData->GetPolys(), cellsCopy))
+    {
+      polyData->SetPolys(cellsCopy);
+      cellsDetached = true;
+    }
+    if (DetachSharedCellArray(polyData->GetStrips(), cellsCopy))
+    {
+      polyData->SetStrips(cellsCopy);
+      cellsDetached = true;
+    }
+    if (cellsDetached)
+    {
+      // Cell and link lookup structures may also be shared, they are rebuilt when needed
+      polyData->DeleteCells();
+      polyData->DeleteLinks();
+      detached = true;
+    }
+  }
+
+  return detached;
 }
 
 //---------------------------------------------------------------------------
 void vtkSegment::AddRepresentation(std::string name, vtkDataObject* representation)
 {
-  if (this->GetRepresentation(name) == representation)
+  // Look up the map directly, so that an evicted representation is not regenerated just to be replaced
+  RepresentationMap::iterator reprIt = this->Representations.find(name);
+  if (reprIt != this->Representations.end() && reprIt->second.GetPointer() == representation)
   {
     return;
   }
 
+  this->EvictedRepresentationNames.erase(name);
+  this->DeferredRepresentationNames.erase(name);
+  this->RepresentationLoadedTimes.erase(name);
+  this->RepresentationAccessTimes[name].Modified();
   this->Representations[name] = representation;
   representation->Register(this); // Otherwise the representation object may get deleted (and then crashes in vtkSegmentation::SegmentModified)
   this->Modified();
 }
 
+//---------------------------------------------------------------------------
+void vtkSegment::AddDeferredRepresentation(std::string name, vtkDataObject* representation)
+{
+  if (!representation)
+  {
+    return;
+  }
+  this->AddRepresentation(name, representation);
+  this->DeferredRepresentationNames.insert(name);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegment::IsRepresentationDeferred(std::string name)
+{
+  return (this->DeferredRepresentationNames.find(name) != this->DeferredRepresentationNames.end());
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegment::HasRepresentation(std::string name)
+{
+  return (this->Representations.find(name) != this->Representations.end() || this->IsRepresentationEvicted(name));
+}
+
+//---------------------------------------------------------------------------
+vtkDataObject* vtkSegment::GetRepresentationObject(std::string name)
+{
+  RepresentationMap::iterator reprIt = this->Representations.find(name);
+  if (reprIt == this->Representations.end())
+  {
+    return NULL;
+  }
+  return reprIt->second.GetPointer();
+}
+
 //---------------------------------------------------------------------------
 void vtkSegment::RemoveRepresentation(std::string name)
 {
-  vtkDataObject* representation = this->GetRepresentation(name);
-  if (representation)
+  bool evicted = (this->EvictedRepresentationNames.erase(name) > 0);
+  this->DeferredRepresentationNames.erase(name);
+  this->RepresentationAccessTimes.erase(name);
+  this->RepresentationLoadedTimes.erase(name);
+
+  RepresentationMap::iterator reprIt = this->Representations.find(name);
+  if (reprIt != this->Representations.end())
   {
-    this->Representations.erase(name);
+    vtkDataObject* representation = reprIt->second.GetPointer();
+    this->Representations.erase(reprIt);
     representation->UnRegister(this);
     this->Modified();
   }
+  else if (evicted)
+  {
+    this->Modified();
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSegment::EvictRepresentation(std::string name)
+{
+  RepresentationMap::iterator reprIt = this->Representations.find(name);
+  if (reprIt == this->Representations.end())
+  {
+    // Representation is only created when requested
+    this->EvictedRepresentationNames.insert(name);
+    return;
+  }
+  if (this->IsRepresentationDeferred(name))
+  {
+    // Data has not been loaded, there is nothing to release
+    return;
+  }
+
+  vtkDataObject* representation = reprIt->second.GetPointer();
+  this->Representations.erase(reprIt);
+  representation->UnRegister(this);
+  this->EvictedRepresentationNames.insert(name);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegment::IsRepresentationEvicted(std::string name)
+{
+  return (this->EvictedRepresentationNames.find(name) != this->EvictedRepresentationNames.end());
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSegment::GetRepresentationAccessTime(std::string name)
+{
+  if (this->Representations.find(name) == this->Representations.end())
+  {
+    return 0;
+  }
+  return this->RepresentationAccessTimes[name].GetMTime();
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSegment::GetRepresentationMemorySize(std::string name)
+{
+  RepresentationMap::iterator reprIt = this->Representations.find(name);
+  if (reprIt == this->Representations.end() || !reprIt->second.GetPointer())
+  {
+    return 0;
+  }
+  return reprIt->second->GetActualMemorySize();
 }
 
 //---------------------------------------------------------------------------
@@ -218,6 +539,7 @@ void vtkSegment::RemoveAllRepresentations(std::string exceptionRepresentationNam
       RepresentationMap::iterator erasedIt = reprIt;
       vtkDataObject* representation = this->Representations[reprIt->first].GetPointer();
       ++reprIt;
+      this->RepresentationLoadedTimes.erase(erasedIt->first);
       this->Representations.erase(erasedIt);
       representation->UnRegister(this); // Not just call RemoveRepresentation to avoid multiple Modified calls
     }
@@ -226,6 +548,21 @@ void vtkSegment::RemoveAllRepresentations(std::string exceptionRepresentationNam
       ++reprIt;
     }
   }
+
+  // Evicted representations are removed as well
+  bool exceptionEvicted = this->IsRepresentationEvicted(exceptionRepresentationName);
+  this->EvictedRepresentationNames.clear();
+  if (exceptionEvicted)
+  {
+    this->EvictedRepresentationNames.insert(exceptionRepresentationName);
+  }
+  bool exceptionDeferred = this->IsRepresentationDeferred(exceptionRepresentationName);
+  this->DeferredRepresentationNames.clear();
+  if (exceptionDeferred)
+  {
+    this->DeferredRepresentationNames.insert(exceptionRepresentationName);
+  }
+
   this->Modified();
 }
 
@@ -239,6 +576,8 @@ void vtkSegment::GetContainedRepresentationNames(std::vector<std::string>& repre
   {
     representationNames.push_back(reprIt->first);
   }
+  representationNames.insert(representationNames.end(),
+    this->EvictedRepresentationNames.begin(), this->EvictedRepresentationNames.end());
 }
 
 //---------------------------------------------------------------------------
@@ -269,6 +608,25 @@ void vtkSegment::GetTags(std::vector<std::string> &tags)
 // Global RAS in the form (Xmin, Xmax, Ymin, Ymax, Zmin, Zmax)
 void vtkSegment::ExtendBounds(double partialBounds[6], double globalBounds[6])
 {
+  if ( partialBounds[0] > partialBounds[1]
+    || partialBounds[2] > partialBounds[3]
+    || partialBounds[4] > partialBounds[5] )
+  {
+    // Partial bounds are uninitialized
+    return;
+  }
+  if ( globalBounds[0] > globalBounds[1]
+    || globalBounds[2] > globalBounds[3]
+    || globalBounds[4] > globalBounds[5] )
+  {
+    // Global bounds are uninitialized
+    for (int i=0; i<6; ++i)
+    {
+      globalBounds[i] = partialBounds[i];
+    }
+    return;
+  }
+
   if (partialBounds[0] < globalBounds[0] )
   {
     globalBounds[0] = partialBounds[0];
@@ -26,9 +26,12 @@
 #include <vtkSmartPointer.h>
 #include <vtkDataObject.h>
 
+#include <vtkTimeStamp.h>
+
 // STD includes
 #include <vector>
 #include <map>
+#include <set>
 
 // Segmentation includes
 #include "vtkSegmentationCoreConfigure.h"
@@ -39,6 +42,16 @@ class vtkSegmentationCore_EXPORT vtkSegment : public vtkObject
   typedef std::map<std::string, vtkSmartPointer<vtkDataObject> > RepresentationMap;
 
 public:
+  enum
+  {
+    /// Fired when an evicted representation is requested (\sa EvictRepresentation), so that the owner
+    /// segmentation can regenerate it. Call data is the name of the requested representation (const char*)
+    RepresentationRequestedEvent = 62200,
+    /// Fired when a deferred representation is requested first (\sa AddDeferredRepresentation), so that its data
+    /// can be loaded. Call data is the name of the requested representation (const char*)
+    RepresentationDataRequestedEvent
+  };
+
   static const double SEGMENT_COLOR_VALUE_INVALID[4];
 
   static vtkSegment* New();
@@ -48,10 +61,18 @@ public:
   /// Write this node's information to a MRML file in XML format. 
   void WriteXML(ostream& of, int nIndent);
 
-  /// Deep copy one segment into another
+  /// Deep copy one segment into another. The data of the representations is duplicated.
   virtual void DeepCopy(vtkSegment* aSegment);
 
+  /// Copy one segment into another, sharing the data of the representations between the two segments.
+  /// Only use it if the copy is not modified, or if the data is modified in place only via
+  /// \sa GetWritableRepresentation, which duplicates the shared data first (copy-on-write).
+  /// Replacing the data (e.g. by a filter output) does not affect the other segment.
+  virtual void ShallowCopy(vtkSegment* aSegment);
+
   /// Get bounding box in global RAS in the form (xmin,xmax, ymin,ymax, zmin,zmax).
+  /// The bounds are cached, and only recomputed if the segment or any of its representations is modified.
+  /// Bounds are uninitialized (\sa vtkMath::UninitializeBounds) if no representation has valid bounds.
   virtual void GetBounds(double bounds[6]);
 
   /// Returns true if the node (default behavior) or the internal data are modified
@@ -59,25 +80,76 @@ public:
   /// Note: The MTime of the internal data is used to know if it has been modified.
   /// So if you invoke one of the data modified events without calling Modified() on the
   /// internal data, GetModifiedSinceRead() won't return true.
+  /// Loading deferred and regenerating evicted representations on request does not count as modification.
   /// \sa vtkMRMLStorableNode::GetModifiedSinceRead()
   bool GetModifiedSinceRead(const vtkTimeStamp& storedTime);
 
-  /// Utility function to get extended bounds
+  /// Utility function to get extended bounds. Uninitialized bounds are ignored in partialBounds,
+  /// and replaced by partialBounds in globalBounds.
   /// \param partialBounds New bounds with which the globalBounds will be extended if necessary
   /// \param globalBounds Global bounds to be extended with partialBounds
   static void ExtendBounds(double partialBounds[6], double globalBounds[6]);
 
   /// Get representation of a given type. This class is not responsible for conversion, only storage!
+  /// If the representation has been evicted, then \sa RepresentationRequestedEvent is invoked to have it regenerated.
   /// \param name Representation name
   /// \return The specified representation object, NULL if not present
   vtkDataObject* GetRepresentation(std::string name);
 
+  /// Get representation of a given type for modifying its data in place. If the data of the representation
+  /// is shared with another object (e.g. a shallow copy of the segment), then it is duplicated first (copy-on-write)
+  /// \param name Representation name
+  /// \return The specified representation object, NULL if not present
+  vtkDataObject* GetWritableRepresentation(std::string name);
+
+  /// Duplicate the data arrays of a representation object that are shared with other objects,
+  /// so that the representation can be modified in place without affecting the others.
+  /// \return True if any data was duplicated
+  static bool DetachSharedRepresentationData(vtkDataObject* representation);
+
   /// Add representation
   void AddRepresentation(std::string type, vtkDataObject* representation);
 
+  /// Add representation whose data is not available yet (e.g. it has not been loaded from file). The representation
+  /// object only needs to contain properties that are cheap to get (e.g. geometry of an image, which determines the bounds).
+  /// \sa RepresentationDataRequestedEvent is invoked when the representation is first requested, so that the observer can
+  /// fill in the data before \sa GetRepresentation returns. The data needs to be set in place in the representation object
+  /// without invoking modified event, as the object may already be observed by the segmentation.
+  void AddDeferredRepresentation(std::string name, vtkDataObject* representation);
+
+  /// Determine if the data of a representation has not been requested since it was added as deferred
+  bool IsRepresentationDeferred(std::string name);
+
+  /// Determine if a representation is contained by the segment, without regenerating or loading it
+  bool HasRepresentation(std::string name);
+
+  /// Get representation object without regenerating it if evicted or loading its data if deferred.
+  /// The data of the returned object may not be available, so it should only be used for managing
+  /// the object itself (e.g. observing it)
+  /// \return The specified representation object, NULL if not present or evicted
+  vtkDataObject* GetRepresentationObject(std::string name);
+
   /// Remove representation of given type
   void RemoveRepresentation(std::string name);
 
+  /// Release the data of a representation to free memory. The representation is still considered to be
+  /// contained by the segment, and it is regenerated by the owner segmentation when requested next time.
+  /// No modified event is invoked, as the content of the segment does not change logically.
+  /// If the representation is not present, then it is marked as evicted, so that it is only created when
+  /// requested (e.g. to defer conversions after lazy loading).
+  void EvictRepresentation(std::string name);
+
+  /// Determine if a representation has been evicted and has not been regenerated since
+  bool IsRepresentationEvicted(std::string name);
+
+  /// Get the time the representation was last accessed (\sa GetRepresentation) or added.
+  /// The value is comparable to modified times of VTK objects. Returns 0 if the representation is not present
+  unsigned long GetRepresentationAccessTime(std::string name);
+
+  /// Get memory used by a representation in kibibytes (\sa vtkDataObject::GetActualMemorySize)
+  /// Returns 0 if the representation is not present or has been evicted
+  unsigned long GetRepresentationMemorySize(std::string name);
+
   /// Remove all representations except one if specified. Fires only one Modified event
   /// \param exceptionRepresentationName Exception name that will not be removed (e.g. invalidate non-master representations), empty by default
   void RemoveAllRepresentations(std::string exceptionRepresentationName="");
@@ -91,7 +163,7 @@ public:
   /// Get tags
   void GetTags(std::vector<std::string> &tags);
 
-  /// Get representation names present in this segment in an output string vector
+  /// Get representation names present in this segment in an output string vector (including evicted representations)
   void GetContainedRepresentationNames(std::vector<std::string>& representationNames);
 
 public:
@@ -106,10 +178,28 @@ protected:
   ~vtkSegment();
   void operator=(const vtkSegment&);
 
+  /// Copy properties and representations of another segment
+  /// \param shareRepresentationData If true, then representation data is shared with the other segment,
+  ///   otherwise it is duplicated
+  void CopySegment(vtkSegment* aSegment, bool shareRepresentationData);
+
 protected:
   /// Stored representations. Map from type string to data object
   RepresentationMap Representations;
 
+  /// Names of the representations that have been evicted to free memory (\sa EvictRepresentation)
+  std::set<std::string> EvictedRepresentationNames;
+
+  /// Names of the representations whose data has not been requested since added (\sa AddDeferredRepresentation)
+  std::set<std::string> DeferredRepresentationNames;
+
+  /// Time of the last access of each representation, used for evicting the least recently used ones
+  std::map<std::string, vtkTimeStamp> RepresentationAccessTimes;
+
+  /// Modified time of the representations right after their data was loaded (deferred) or regenerated (evicted)
+  /// on request. These representations are only considered modified since read if they changed after that.
+  std::map<std::string, unsigned long> RepresentationLoadedTimes;
+
   /// Name (e.g. segment label in DICOM Segmentation Object)
   /// This is the default identifier of the segment within segmentation, so needs to be unique within a segmentation
   char* Name;
@@ -121,6 +211,12 @@ protected:
 
   /// Tags (for grouping and selection)
   std::vector<std::string> Tags;
+
+  /// Bounds computed in the last \sa GetBounds call
+  double CachedBounds[6];
+
+  /// Latest modified time of the segment and its representations when the cached bounds were computed
+  unsigned long CachedBoundsMTime;
 };
 
 #endif // __vtkSegment_h
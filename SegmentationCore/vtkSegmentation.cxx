@@ -42,11 +42,67 @@
 #include <vtkTransform.h>
 #include <vtkPolyData.h>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkGridTransform.h>
+#include <vtkTimerLog.h>
+#include <vtkTimeStamp.h>
 
 // STD includes
 #include <sstream>
 #include <algorithm>
 #include <functional>
+#include <set>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Memory budget of the derived representations of all segmentations in kibibytes, 0 if unlimited
+  unsigned long DerivedRepresentationMemoryBudget = 0;
+
+  /// Time of the last enforcement of the memory budget. Representations accessed since then are not evicted.
+  vtkTimeStamp& GetLastBudgetEnforcementTime()
+  {
+    static vtkTimeStamp lastBudgetEnforcementTime;
+    return lastBudgetEnforcementTime;
+  }
+
+  /// All segmentation instances in the process, which share the derived representation memory budget
+  std::set<vtkSegmentation*>& GetSegmentationInstances()
+  {
+    static std::set<vtkSegmentation*> segmentationInstances;
+    return segmentationInstances;
+  }
+
+  /// Derived representation that is candidate for eviction
+  struct EvictionCandidate
+  {
+    unsigned long AccessTime;
+    unsigned long MemorySize;
+    vtkSegment* Segment;
+    std::string RepresentationName;
+
+    bool operator<(const EvictionCandidate& other) const
+    {
+      return this->AccessTime < other.AccessTime;
+    }
+  };
+
+  /// Get the cheapest path from paths found from different source representations for the same data.
+  /// Unlike \sa vtkSegmentationConverter::GetCheapestPath the cost is not limited, as the data-aware
+  /// cost of many segments may exceed the cost of a disabled rule (those paths are excluded by the converter)
+  vtkSegmentationConverter::ConversionPathType GetCheapestDataAwarePath(const vtkSegmentationConverter::ConversionPathAndCostListType& pathsCosts)
+  {
+    vtkSegmentationConverter::ConversionPathAndCostListType::const_iterator cheapestPathIt = pathsCosts.end();
+    for (vtkSegmentationConverter::ConversionPathAndCostListType::const_iterator pathIt = pathsCosts.begin(); pathIt != pathsCosts.end(); ++pathIt)
+    {
+      if ( cheapestPathIt == pathsCosts.end() || pathIt->second < cheapestPathIt->second
+        || (pathIt->second == cheapestPathIt->second && pathIt->first.size() < cheapestPathIt->first.size()) )
+      {
+        cheapestPathIt = pathIt;
+      }
+    }
+    return (cheapestPathIt != pathsCosts.end() ? cheapestPathIt->first : vtkSegmentationConverter::ConversionPathType());
+  }
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSegmentation);
@@ -67,19 +123,31 @@ vtkSegmentation::vtkSegmentation()
 {
   this->MasterRepresentationName = NULL;
   this->Converter = vtkSegmentationConverter::New();
+  this->BatchLevel = 0;
+  vtkMath::UninitializeBounds(this->CachedBounds);
+  this->CachedBoundsValid = false;
+  this->NonLinearTransformApproximation = false;
 
   this->SegmentCallbackCommand = vtkCallbackCommand::New();
   this->SegmentCallbackCommand->SetClientData( reinterpret_cast<void *>(this) );
   this->SegmentCallbackCommand->SetCallback( vtkSegmentation::OnSegmentModified );
 
+  this->SegmentRepresentationRequestedCallbackCommand = vtkCallbackCommand::New();
+  this->SegmentRepresentationRequestedCallbackCommand->SetClientData( reinterpret_cast<void *>(this) );
+  this->SegmentRepresentationRequestedCallbackCommand->SetCallback( vtkSegmentation::OnSegmentRepresentationRequested );
+
   this->MasterRepresentationCallbackCommand = vtkCallbackCommand::New();
   this->MasterRepresentationCallbackCommand->SetClientData( reinterpret_cast<void *>(this) );
   this->MasterRepresentationCallbackCommand->SetCallback( vtkSegmentation::OnMasterRepresentationModified );
+
+  GetSegmentationInstances().insert(this);
 }
 
 //----------------------------------------------------------------------------
 vtkSegmentation::~vtkSegmentation()
 {
+  GetSegmentationInstances().erase(this);
+
   // Properly remove all segments
   std::vector<std::string> segmentIds;
   this->GetSegmentIDs(segmentIds);
@@ -98,6 +166,13 @@ vtkSegmentation::~vtkSegmentation()
     this->SegmentCallbackCommand = NULL;
   }
 
+  if (this->SegmentRepresentationRequestedCallbackCommand)
+  {
+    this->SegmentRepresentationRequestedCallbackCommand->SetClientData(NULL);
+    this->SegmentRepresentationRequestedCallbackCommand->Delete();
+    this->SegmentRepresentationRequestedCallbackCommand = NULL;
+  }
+
   if (this->MasterRepresentationCallbackCommand)
   {
     this->MasterRepresentationCallbackCommand->SetClientData(NULL);
@@ -137,6 +212,18 @@ void vtkSegmentation::ReadXMLAttributes(const char** atts)
 
 //----------------------------------------------------------------------------
 void vtkSegmentation::DeepCopy(vtkSegmentation* aSegmentation)
+{
+  this->CopySegmentation(aSegmentation, false);
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentation::ShallowCopy(vtkSegmentation* aSegmentation)
+{
+  this->CopySegmentation(aSegmentation, true);
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentation::CopySegmentation(vtkSegmentation* aSegmentation, bool shareRepresentationData)
 {
   if (!aSegmentation)
   {
@@ -145,17 +232,27 @@ void vtkSegmentation::DeepCopy(vtkSegmentation* aSegmentation)
 
   // Copy properties
   this->SetMasterRepresentationName(aSegmentation->GetMasterRepresentationName());
+  this->SetNonLinearTransformApproximation(aSegmentation->GetNonLinearTransformApproximation());
 
   // Copy conversion parameters
   this->Converter->DeepCopy(aSegmentation->Converter);
 
-  // Deep copy segments list
+  // Copy segments list, keeping the segment IDs
+  this->StartBatch();
   for (SegmentMap::iterator it = aSegmentation->Segments.begin(); it != aSegmentation->Segments.end(); ++it)
   {
     vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
-    segment->DeepCopy(it->second);
-    this->AddSegment(segment);
+    if (shareRepresentationData)
+    {
+      segment->ShallowCopy(it->second);
+    }
+    else
+    {
+      segment->DeepCopy(it->second);
+    }
+    this->AddSegment(segment, it->first);
   }
+  this->EndBatch();
 }
 
 //----------------------------------------------------------------------------
@@ -170,6 +267,7 @@ void vtkSegmentation::PrintSelf(ostream& os, vtkIndent indent)
   Superclass::PrintSelf(os,indent);
 
   os << indent << "MasterRepresentationName:  " << (this->MasterRepresentationName ? this->MasterRepresentationName : "NULL") << "\n";
+  os << indent << "NonLinearTransformApproximation:  " << (this->NonLinearTransformApproximation ? "true" : "false") << "\n";
 
   for (SegmentMap::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
   {
@@ -184,17 +282,25 @@ void vtkSegmentation::PrintSelf(ostream& os, vtkIndent indent)
 //---------------------------------------------------------------------------
 void vtkSegmentation::GetBounds(double bounds[6])
 {
-  vtkMath::UninitializeBounds(bounds);
-
-  for (SegmentMap::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
+  if (!this->CachedBoundsValid)
   {
-    double segmentBounds[6];
-    vtkMath::UninitializeBounds(segmentBounds);
+    vtkMath::UninitializeBounds(this->CachedBounds);
+    for (SegmentMap::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
+    {
+      double segmentBounds[6];
+      vtkMath::UninitializeBounds(segmentBounds);
 
-    vtkSegment* segment = it->second;
-    segment->GetBounds(segmentBounds);
+      vtkSegment* segment = it->second;
+      segment->GetBounds(segmentBounds);
+
+      vtkSegment::ExtendBounds(segmentBounds, this->CachedBounds);
+    }
+    this->CachedBoundsValid = true;
+  }
 
-    vtkSegment::ExtendBounds(segmentBounds, bounds);
+  for (int i=0; i<6; ++i)
+  {
+    bounds[i] = this->CachedBounds[i];
   }
 }
 
@@ -220,10 +326,20 @@ void vtkSegmentation::SetMasterRepresentationName(const char* representationName
   if ( this->MasterRepresentationName == NULL && representationName == NULL) { return;}
   if ( this->MasterRepresentationName && representationName && (!strcmp(this->MasterRepresentationName,representationName))) { return;}
 
+  // Make sure the new master representation is present in all segments, as it may have been evicted to
+  // free memory, and it could not be regenerated after the master representation is changed
+  if (this->MasterRepresentationName && representationName)
+  {
+    for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
+    {
+      segmentIt->second->GetRepresentation(representationName);
+    }
+  }
+
   // Remove observation of old master representation in all segments
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
   {
-    vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentation(this->MasterRepresentationName);
+    vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentationObject(this->MasterRepresentationName);
     if (masterRepresentation)
     {
       vtkEventBroker::GetInstance()->RemoveObservations(
@@ -250,7 +366,7 @@ void vtkSegmentation::SetMasterRepresentationName(const char* representationName
   // Add observation of new master representation in all segments
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
   {
-    vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentation(this->MasterRepresentationName);
+    vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentationObject(this->MasterRepresentationName);
     if (masterRepresentation)
     {
       vtkEventBroker::GetInstance()->AddObservation(
@@ -261,6 +377,7 @@ void vtkSegmentation::SetMasterRepresentationName(const char* representationName
 
   // Invalidate all representations other than the master.
   // These representations will be automatically converted later on demand.
+  this->CachedBoundsValid = false;
   if (this->MasterRepresentationName)
   {
     this->InvalidateNonMasterRepresentations();
@@ -268,7 +385,7 @@ void vtkSegmentation::SetMasterRepresentationName(const char* representationName
 
   // Invoke events
   this->Modified();
-  this->InvokeEvent(vtkSegmentation::MasterRepresentationModified, this);
+  this->InvokeOrCollectEvent(vtkSegmentation::MasterRepresentationModified);
 }
 
 //---------------------------------------------------------------------------
@@ -312,6 +429,9 @@ bool vtkSegmentation::AddSegment(vtkSegment* segment, std::string segmentId/*=""
   // Observe segment underlying data for changes
   vtkEventBroker::GetInstance()->AddObservation(
     segment, vtkCommand::ModifiedEvent, this, this->SegmentCallbackCommand );
+  // Observe requests of evicted representations. The event broker is not used, because
+  // the representation must be regenerated before the request returns
+  segment->AddObserver(vtkSegment::RepresentationRequestedEvent, this->SegmentRepresentationRequestedCallbackCommand);
 
   // Get representation names contained by the added segment
   std::vector<std::string> containedRepresentationNamesInAddedSegment;
@@ -320,22 +440,24 @@ bool vtkSegmentation::AddSegment(vtkSegment* segment, std::string segmentId/*=""
   // Perform necessary conversions if needed on the added segment:
   // 1. If the segment can be added, and it does not contain the master representation,
   // then the master representation is converted using the cheapest available path.
-  if (!segment->GetRepresentation(this->MasterRepresentationName))
+  // Representations are not accessed unless needed, as that would load deferred representations.
+  if (!segment->HasRepresentation(this->MasterRepresentationName))
   {
-    // Collect all available paths to master representation
+    // Collect the cheapest paths to master representation from each contained representation
     vtkSegmentationConverter::ConversionPathAndCostListType allPathsToMaster;
     for (std::vector<std::string>::iterator reprIt = containedRepresentationNamesInAddedSegment.begin();
       reprIt != containedRepresentationNamesInAddedSegment.end(); ++reprIt)
     {
-      vtkSegmentationConverter::ConversionPathAndCostListType pathsFromCurrentRepresentationToMaster;
-      this->Converter->GetPossibleConversions((*reprIt), this->MasterRepresentationName, pathsFromCurrentRepresentationToMaster);
-      // Append paths from current representation to master to all found paths to master
-      allPathsToMaster.insert( allPathsToMaster.end(),
-        pathsFromCurrentRepresentationToMaster.begin(), pathsFromCurrentRepresentationToMaster.end() );
+      std::vector<vtkDataObject*> sourceRepresentations(1, segment->GetRepresentation(*reprIt));
+      vtkSegmentationConverter::ConversionPathAndCostType pathFromCurrentRepresentationToMaster;
+      if (this->Converter->GetCheapestConversionPath((*reprIt), this->MasterRepresentationName,
+        pathFromCurrentRepresentationToMaster, &sourceRepresentations))
+      {
+        allPathsToMaster.push_back(pathFromCurrentRepresentationToMaster);
+      }
     }
     // Get cheapest path from any representation to master and try to convert
-    vtkSegmentationConverter::ConversionPathType cheapestPath =
-      vtkSegmentationConverter::GetCheapestPath(allPathsToMaster);
+    vtkSegmentationConverter::ConversionPathType cheapestPath = GetCheapestDataAwarePath(allPathsToMaster);
     if (cheapestPath.empty() || !this->ConvertSegmentUsingPath(segment, cheapestPath))
     {
       // Return if cannot convert to master representation
@@ -358,30 +480,28 @@ bool vtkSegmentation::AddSegment(vtkSegment* segment, std::string segmentId/*=""
       reprIt != containedRepresentationNamesInFirstSegment.end(); ++reprIt)
     {
       // If representation exists then there is nothing to do
-      if (segment->GetRepresentation(*reprIt))
+      if (segment->HasRepresentation(*reprIt))
       {
         continue;
       }
 
       // Convert using the cheapest available path
-      vtkSegmentationConverter::ConversionPathAndCostListType pathsToCurrentRepresentation;
-      this->Converter->GetPossibleConversions(this->MasterRepresentationName, (*reprIt), pathsToCurrentRepresentation);
-      vtkSegmentationConverter::ConversionPathType cheapestPath =
-        vtkSegmentationConverter::GetCheapestPath(pathsToCurrentRepresentation);
-      if (cheapestPath.empty())
+      std::vector<vtkDataObject*> sourceRepresentations(1, segment->GetRepresentation(this->MasterRepresentationName));
+      vtkSegmentationConverter::ConversionPathAndCostType cheapestPathCost;
+      if (!this->Converter->GetCheapestConversionPath(this->MasterRepresentationName, (*reprIt), cheapestPathCost, &sourceRepresentations))
       {
         vtkErrorMacro("AddSegment: Unable to perform conversion!"); // Sanity check, it should never happen
         return false;
       }
       // Perform conversion
-      this->ConvertSegmentUsingPath(segment, cheapestPath);
+      this->ConvertSegmentUsingPath(segment, cheapestPathCost.first);
     }
 
     // Remove representations that do not exist in this segmentation
     for (std::vector<std::string>::iterator reprIt = containedRepresentationNamesInAddedSegment.begin();
       reprIt != containedRepresentationNamesInAddedSegment.end(); ++reprIt)
     {
-      if (!firstSegment->GetRepresentation(*reprIt))
+      if (!firstSegment->HasRepresentation(*reprIt))
       {
         segment->RemoveRepresentation(*reprIt);
       }
@@ -403,7 +523,7 @@ bool vtkSegmentation::AddSegment(vtkSegment* segment, std::string segmentId/*=""
   this->Segments[key] = segment;
 
   // Add observation of master representation in new segment
-  vtkDataObject* masterRepresentation = segment->GetRepresentation(this->MasterRepresentationName);
+  vtkDataObject* masterRepresentation = segment->GetRepresentationObject(this->MasterRepresentationName);
   if (masterRepresentation)
   {
     // Observe segment's master representation
@@ -413,11 +533,14 @@ bool vtkSegmentation::AddSegment(vtkSegment* segment, std::string segmentId/*=""
   }
 
   // Fire segment added event
-  const char* segmentIdChars = key.c_str();
-  this->InvokeEvent(vtkSegmentation::SegmentAdded, (void*)segmentIdChars);
+  this->CachedBoundsValid = false;
+  this->InvokeOrCollectEvent(vtkSegmentation::SegmentAdded, key);
 
   this->Modified();
 
+  // Derived representations may have been created by the conversions
+  vtkSegmentation::EnforceDerivedRepresentationMemoryBudget();
+
   return true;
 }
 
@@ -469,8 +592,9 @@ void vtkSegmentation::RemoveSegment(SegmentMap::iterator segmentIt)
   // Remove observation of segment modified event
   vtkEventBroker::GetInstance()->RemoveObservations(
     segmentIt->second.GetPointer(), vtkCommand::ModifiedEvent, this, this->SegmentCallbackCommand );
+  segmentIt->second->RemoveObserver(this->SegmentRepresentationRequestedCallbackCommand);
   // Remove observation of master representation of removed segment
-  vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentation(this->MasterRepresentationName);
+  vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentationObject(this->MasterRepresentationName);
   if (masterRepresentation)
   {
     vtkEventBroker::GetInstance()->RemoveObservations(
@@ -480,6 +604,7 @@ void vtkSegmentation::RemoveSegment(SegmentMap::iterator segmentIt)
 
   // Remove segment
   this->Segments.erase(segmentIt);
+  this->CachedBoundsValid = false;
 
   // If the segmentation became empty then clear master representation
   //TODO: Any bad consequences? Otherwise the representation table will show a master representation with no data underneath
@@ -489,7 +614,7 @@ void vtkSegmentation::RemoveSegment(SegmentMap::iterator segmentIt)
   }
   
   // Fire segment removed event
-  this->InvokeEvent(vtkSegmentation::SegmentRemoved, (void*)segmentId.c_str());
+  this->InvokeOrCollectEvent(vtkSegmentation::SegmentRemoved, segmentId);
 
   this->Modified();
 }
@@ -507,6 +632,9 @@ void vtkSegmentation::OnSegmentModified(vtkObject* caller,
     return;
   }
 
+  // Representations of the segment may have changed
+  self->CachedBoundsValid = false;
+
   // Invoke segment modified event, but do not invoke general modified event
   std::string segmentId = self->GetSegmentIdBySegment(callerSegment);
   if (segmentId.empty())
@@ -514,8 +642,34 @@ void vtkSegmentation::OnSegmentModified(vtkObject* caller,
     // Segment is modified before actually having been added to the segmentation (within AddSegment)
     return;
   }
-  const char* segmentIdChars = segmentId.c_str();
-  self->InvokeEvent(vtkSegmentation::SegmentModified, (void*)(segmentIdChars));
+  self->InvokeOrCollectEvent(vtkSegmentation::SegmentModified, segmentId);
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentation::OnSegmentRepresentationRequested(vtkObject* caller,
+                                                       unsigned long vtkNotUsed(eid),
+                                                       void* clientData,
+                                                       void* callData)
+{
+  vtkSegmentation* self = reinterpret_cast<vtkSegmentation*>(clientData);
+  vtkSegment* callerSegment = reinterpret_cast<vtkSegment*>(caller);
+  const char* representationName = reinterpret_cast<const char*>(callData);
+  if (!self || !callerSegment || !representationName || !self->MasterRepresentationName)
+  {
+    return;
+  }
+
+  // Regenerate the evicted representation from the master representation.
+  // Evicted representations along the path are regenerated recursively when accessed by the conversion.
+  std::vector<vtkDataObject*> sourceRepresentations(1, callerSegment->GetRepresentation(self->MasterRepresentationName));
+  vtkSegmentationConverter::ConversionPathAndCostType cheapestPathCost;
+  if ( !sourceRepresentations[0]
+    || !self->Converter->GetCheapestConversionPath(self->MasterRepresentationName, representationName, cheapestPathCost, &sourceRepresentations) )
+  {
+    vtkErrorWithObjectMacro(self, "OnSegmentRepresentationRequested: Unable to regenerate representation " << representationName << " from master representation!");
+    return;
+  }
+  self->ConvertSegmentUsingPath(callerSegment, cheapestPathCost.first);
 }
 
 //---------------------------------------------------------------------------
@@ -532,9 +686,10 @@ void vtkSegmentation::OnMasterRepresentationModified(vtkObject* vtkNotUsed(calle
 
   // Invalidate all representations other than the master.
   // These representations will be automatically converted later on demand.
+  self->CachedBoundsValid = false;
   self->InvalidateNonMasterRepresentations();
 
-  self->InvokeEvent(vtkSegmentation::MasterRepresentationModified, self);
+  self->InvokeOrCollectEvent(vtkSegmentation::MasterRepresentationModified);
 
   self->Modified();
 }
@@ -596,6 +751,99 @@ void vtkSegmentation::GetSegmentIDs(std::vector<std::string> &segmentIds)
   }
 }
 
+//---------------------------------------------------------------------------
+void vtkSegmentation::StartBatch()
+{
+  ++this->BatchLevel;
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentation::EndBatch()
+{
+  if (this->BatchLevel <= 0)
+  {
+    vtkErrorMacro("EndBatch: No batch of modifications is in progress!");
+    return;
+  }
+  if (--this->BatchLevel > 0)
+  {
+    return;
+  }
+
+  // Reset collected changes before invoking the event so that observers can start new batches
+  BatchModifiedEventData batchModifiedData;
+  std::swap(batchModifiedData, this->BatchModifiedData);
+  if (!batchModifiedData.IsEmpty())
+  {
+    this->InvokeEvent(vtkSegmentation::SegmentsBatchModified, (void*)(&batchModifiedData));
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentation::InvokeOrCollectEvent(unsigned long event, const std::string& name/*=""*/)
+{
+  if (this->BatchLevel <= 0)
+  {
+    if (event == vtkSegmentation::MasterRepresentationModified)
+    {
+      this->InvokeEvent(event, this);
+    }
+    else
+    {
+      this->InvokeEvent(event, (void*)(name.c_str()));
+    }
+    return;
+  }
+
+  std::vector<std::string>& added = this->BatchModifiedData.AddedSegmentIDs;
+  std::vector<std::string>& removed = this->BatchModifiedData.RemovedSegmentIDs;
+  std::vector<std::string>& modified = this->BatchModifiedData.ModifiedSegmentIDs;
+  std::vector<std::string>& created = this->BatchModifiedData.CreatedRepresentationNames;
+  switch (event)
+  {
+  case vtkSegmentation::SegmentAdded:
+    if (std::find(added.begin(), added.end(), name) == added.end())
+    {
+      added.push_back(name);
+    }
+    break;
+  case vtkSegmentation::SegmentRemoved:
+    {
+    // Segments added and removed within the batch are not reported at all
+    std::vector<std::string>::iterator addedIt = std::find(added.begin(), added.end(), name);
+    if (addedIt != added.end())
+    {
+      added.erase(addedIt);
+    }
+    else if (std::find(removed.begin(), removed.end(), name) == removed.end())
+    {
+      removed.push_back(name);
+    }
+    modified.erase(std::remove(modified.begin(), modified.end(), name), modified.end());
+    }
+    break;
+  case vtkSegmentation::SegmentModified:
+    // Modification of segments added within the batch is implied
+    if ( std::find(added.begin(), added.end(), name) == added.end()
+      && std::find(modified.begin(), modified.end(), name) == modified.end() )
+    {
+      modified.push_back(name);
+    }
+    break;
+  case vtkSegmentation::RepresentationCreated:
+    if (std::find(created.begin(), created.end(), name) == created.end())
+    {
+      created.push_back(name);
+    }
+    break;
+  case vtkSegmentation::MasterRepresentationModified:
+    this->BatchModifiedData.MasterRepresentationModified = true;
+    break;
+  default:
+    vtkErrorMacro("InvokeOrCollectEvent: Unsupported event " << event);
+  }
+}
+
 //---------------------------------------------------------------------------
 void vtkSegmentation::GetSegmentIDs(vtkStringArray* segmentIds)
 {
@@ -626,13 +874,15 @@ void vtkSegmentation::ApplyLinearTransform(vtkAbstractTransform* transform)
 
   // Apply linear transform for each segment:
   // Harden transform on master representation if poly data, apply directions if oriented image data
+  // Master representation modified events of the segments are collected into one event
+  this->StartBatch();
   for (SegmentMap::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
   {
     vtkDataObject* currentMasterRepresentation = it->second->GetRepresentation(this->MasterRepresentationName);
     if (!currentMasterRepresentation)
     {
       vtkErrorMacro("ApplyLinearTransform: Cannot get master representation (" << (this->MasterRepresentationName ? this->MasterRepresentationName : "NULL") << ") from segment!");
-      return;
+      break;
     }
 
     vtkPolyData* currentMasterRepresentationPolyData = vtkPolyData::SafeDownCast(currentMasterRepresentation);
@@ -660,6 +910,7 @@ void vtkSegmentation::ApplyLinearTransform(vtkAbstractTransform* transform)
       vtkErrorMacro("ApplyLinearTransform: Representation data type '" << currentMasterRepresentation->GetClassName() << "' not supported!");
     }
   }
+  this->EndBatch();
 }
 
 //---------------------------------------------------------------------------
@@ -673,17 +924,34 @@ void vtkSegmentation::ApplyNonLinearTransform(vtkAbstractTransform* transform)
     vtkWarningMacro("ApplyNonLinearTransform: Linear input transform is detected in function that should only handle non-linear transforms!");
   }
 
+  // If approximation is requested, then sample the transform and its inverse into displacement grids once for all
+  // segments, so that the (potentially very expensive) non-linear transform does not need to be evaluated for each
+  // point and voxel of each segment. Otherwise the transform is evaluated exactly.
+  // Must be done before transforming the reference image geometry, as the grid is created in the original space.
+  vtkSmartPointer<vtkGridTransform> gridTransform = vtkSmartPointer<vtkGridTransform>::New();
+  vtkSmartPointer<vtkGridTransform> inverseGridTransform = vtkSmartPointer<vtkGridTransform>::New();
+  vtkAbstractTransform* segmentTransform = transform;
+  vtkAbstractTransform* segmentInverseTransform = NULL;
+  if ( this->NonLinearTransformApproximation
+    && this->SampleNonLinearTransformToGrids(transform, gridTransform, inverseGridTransform) )
+  {
+    segmentTransform = gridTransform;
+    segmentInverseTransform = inverseGridTransform;
+  }
+
   // Apply transform on reference image geometry conversion parameter (to preserve validity of merged labelmap)
   this->Converter->ApplyTransformOnReferenceImageGeometry(transform);
 
   // Harden transform on master representation (both image data and poly data) for each segment individually
+  // Master representation modified events of the segments are collected into one event
+  this->StartBatch();
   for (SegmentMap::iterator it = this->Segments.begin(); it != this->Segments.end(); ++it)
   {
     vtkDataObject* currentMasterRepresentation = it->second->GetRepresentation(this->MasterRepresentationName);
     if (!currentMasterRepresentation)
     {
       vtkErrorMacro("ApplyNonLinearTransform: Cannot get master representation (" << (this->MasterRepresentationName ? this->MasterRepresentationName : "NULL") << ") from segment!");
-      return;
+      break;
     }
 
     vtkPolyData* currentMasterRepresentationPolyData = vtkPolyData::SafeDownCast(currentMasterRepresentation);
@@ -697,20 +965,86 @@ void vtkSegmentation::ApplyNonLinearTransform(vtkAbstractTransform* transform)
 #else
       transformFilter->SetInputData(currentMasterRepresentationPolyData);
 #endif
-      transformFilter->SetTransform(transform);
+      transformFilter->SetTransform(segmentTransform);
       transformFilter->Update();
       currentMasterRepresentationPolyData->DeepCopy(transformFilter->GetOutput());
     }
     // Oriented image data
     else if (currentMasterRepresentationOrientedImageData)
     {
-      vtkOrientedImageDataResample::TransformOrientedImage(currentMasterRepresentationOrientedImageData, transform);
+      vtkOrientedImageDataResample::TransformOrientedImage(currentMasterRepresentationOrientedImageData, segmentTransform, false, segmentInverseTransform);
     }
     else
     {
       vtkErrorMacro("ApplyLinearTransform: Representation data type '" << currentMasterRepresentation->GetClassName() << "' not supported!");
     }
   }
+  this->EndBatch();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSegmentation::SampleNonLinearTransformToGrids(vtkAbstractTransform* transform, vtkGridTransform* gridTransform, vtkGridTransform* inverseGridTransform)
+{
+  if (!transform || !gridTransform || !inverseGridTransform)
+  {
+    return false;
+  }
+
+  double bounds[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+  this->GetBounds(bounds);
+  if (!vtkMath::AreBoundsInitialized(bounds))
+  {
+    return false;
+  }
+
+  // Use the resolution of the reference image geometry (that is the resolution of the labelmaps) if available,
+  // but limit the grid size, as the displacements are smooth and finer sampling would only cost memory
+  double referenceSpacing[3] = {0.0, 0.0, 0.0};
+  vtkSmartPointer<vtkOrientedImageData> geometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (this->Converter->GetConversionParameterAsImageGeometry(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), geometryImage))
+  {
+    geometryImage->GetSpacing(referenceSpacing);
+  }
+  const int maximumGridDimension = 128;
+  double gridSpacing[3] = {1.0, 1.0, 1.0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    gridSpacing[axis] = std::max( fabs(referenceSpacing[axis]), (bounds[2*axis+1]-bounds[2*axis]) / (maximumGridDimension-1) );
+    if (gridSpacing[axis] <= 0.0)
+    {
+      gridSpacing[axis] = 1.0;
+    }
+    // Pad the bounds so that voxels at the boundary of the labelmaps are covered as well
+    bounds[2*axis] -= 2.0 * gridSpacing[axis];
+    bounds[2*axis+1] += 2.0 * gridSpacing[axis];
+  }
+  if (!vtkOrientedImageDataResample::SampleTransformToGrid(transform, bounds, gridSpacing, gridTransform))
+  {
+    vtkErrorMacro("SampleNonLinearTransformToGrids: Failed to sample transform");
+    return false;
+  }
+
+  // The inverse grid covers the transformed region, which is determined using the sampled forward transform
+  vtkSmartPointer<vtkOrientedImageData> gridRegionImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  gridRegionImage->SetOrigin(bounds[0], bounds[2], bounds[4]);
+  gridRegionImage->SetSpacing(gridSpacing);
+  gridRegionImage->SetExtent( 0, (int)ceil((bounds[1]-bounds[0])/gridSpacing[0]),
+                              0, (int)ceil((bounds[3]-bounds[2])/gridSpacing[1]),
+                              0, (int)ceil((bounds[5]-bounds[4])/gridSpacing[2]) );
+  double transformedBounds[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+  vtkOrientedImageDataResample::TransformOrientedImageDataBounds(gridRegionImage, gridTransform, transformedBounds);
+  double inverseGridSpacing[3] = {1.0, 1.0, 1.0};
+  for (int axis=0; axis<3; ++axis)
+  {
+    inverseGridSpacing[axis] = std::max( gridSpacing[axis], (transformedBounds[2*axis+1]-transformedBounds[2*axis]) / (maximumGridDimension-1) );
+  }
+  if (!vtkOrientedImageDataResample::SampleTransformToGrid(transform->GetInverse(), transformedBounds, inverseGridSpacing, inverseGridTransform))
+  {
+    vtkErrorMacro("SampleNonLinearTransformToGrids: Failed to sample inverse transform");
+    return false;
+  }
+
+  return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -752,8 +1086,13 @@ bool vtkSegmentation::ConvertSegmentUsingPath(vtkSegment* segment, vtkSegmentati
         currentConversionRule->ConstructRepresentationObjectByRepresentation(currentConversionRule->GetTargetRepresentationName()) );
     }
 
-    // Perform conversion step
-    currentConversionRule->Convert(sourceRepresentation, targetRepresentation);
+    // Perform conversion step. Measure its duration to calibrate the cost model of the rule
+    double conversionStartTime = vtkTimerLog::GetUniversalTime();
+    if (currentConversionRule->Convert(sourceRepresentation, targetRepresentation))
+    {
+      currentConversionRule->AddConversionTimeMeasurement(vtkSegmentationConverterRule::GetRepresentationSize(sourceRepresentation),
+        (vtkTimerLog::GetUniversalTime() - conversionStartTime) * 1000.0);
+    }
 
     // Add representation to segment
     segment->AddRepresentation(currentConversionRule->GetTargetRepresentationName(), targetRepresentation);
@@ -762,6 +1101,84 @@ bool vtkSegmentation::ConvertSegmentUsingPath(vtkSegment* segment, vtkSegmentati
   return true;
 }
 
+//-----------------------------------------------------------------------------
+bool vtkSegmentation::ConvertSegmentsUsingPath(std::vector<vtkSegment*>& segments, vtkSegmentationConverter::ConversionPathType path, bool overwriteExisting/*=false*/)
+{
+  // Execute each conversion step in the selected path for all segments
+  vtkSegmentationConverter::ConversionPathType::iterator pathIt;
+  for (pathIt = path.begin(); pathIt != path.end(); ++pathIt)
+  {
+    vtkSegmentationConverterRule* currentConversionRule = (*pathIt);
+    if (!currentConversionRule)
+    {
+      vtkErrorMacro("ConvertSegmentsUsingPath: Invalid converter rule!");
+      return false;
+    }
+
+    // Collect source and target representations of the segments that need conversion in this step
+    std::vector<vtkSegment*> convertedSegments;
+    std::vector<vtkDataObject*> sourceRepresentations;
+    std::vector<vtkDataObject*> targetRepresentations;
+    std::vector< vtkSmartPointer<vtkDataObject> > targetRepresentationsHolder;
+    for (std::vector<vtkSegment*>::iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+    {
+      vtkSegment* segment = (*segmentIt);
+      if (!segment)
+      {
+        continue;
+      }
+
+      // Get target representation.
+      // If target representation exists and we do not overwrite existing representations,
+      // then no conversion is necessary with this conversion rule
+      vtkSmartPointer<vtkDataObject> targetRepresentation = segment->GetRepresentation(
+        currentConversionRule->GetTargetRepresentationName() );
+      if (targetRepresentation.GetPointer() && !overwriteExisting)
+      {
+        continue;
+      }
+      // Create an empty target representation if it does not exist
+      if (!targetRepresentation.GetPointer())
+      {
+        targetRepresentation = vtkSmartPointer<vtkDataObject>::Take(
+          currentConversionRule->ConstructRepresentationObjectByRepresentation(currentConversionRule->GetTargetRepresentationName()) );
+      }
+
+      convertedSegments.push_back(segment);
+      sourceRepresentations.push_back(segment->GetRepresentation(currentConversionRule->GetSourceRepresentationName()));
+      targetRepresentations.push_back(targetRepresentation);
+      targetRepresentationsHolder.push_back(targetRepresentation);
+    }
+    if (convertedSegments.empty())
+    {
+      continue;
+    }
+
+    // Perform conversion step on all segments. Measure its duration to calibrate the cost model of the rule
+    // (average duration for the average input size, which is consistent with a linear cost model)
+    double conversionStartTime = vtkTimerLog::GetUniversalTime();
+    if (currentConversionRule->ConvertMultiple(sourceRepresentations, targetRepresentations))
+    {
+      double sumOfInputSizes = 0.0;
+      for (std::vector<vtkDataObject*>::iterator reprIt = sourceRepresentations.begin(); reprIt != sourceRepresentations.end(); ++reprIt)
+      {
+        sumOfInputSizes += vtkSegmentationConverterRule::GetRepresentationSize(*reprIt);
+      }
+      double numberOfConvertedSegments = (double)convertedSegments.size();
+      currentConversionRule->AddConversionTimeMeasurement(sumOfInputSizes / numberOfConvertedSegments,
+        (vtkTimerLog::GetUniversalTime() - conversionStartTime) * 1000.0 / numberOfConvertedSegments);
+    }
+
+    // Add representations to segments
+    for (unsigned int index=0; index<convertedSegments.size(); ++index)
+    {
+      convertedSegments[index]->AddRepresentation(currentConversionRule->GetTargetRepresentationName(), targetRepresentations[index]);
+    }
+  }
+
+  return true;
+}
+
 //---------------------------------------------------------------------------
 bool vtkSegmentation::CreateRepresentation(const std::string& targetRepresentationName, bool alwaysConvert/*=false*/)
 {
@@ -796,46 +1213,53 @@ bool vtkSegmentation::CreateRepresentation(const std::string& targetRepresentati
     }
   }
 
-  // Get conversion path with lowest cost.
+  // Get conversion path with lowest cost for the data of the segments.
   // If always convert, then only consider conversions from master, otherwise consider all available representations
-  vtkSegmentationConverter::ConversionPathAndCostListType pathCosts;
+  std::vector<std::string> representationNames;
   if (alwaysConvert)
   {
-    this->Converter->GetPossibleConversions(this->MasterRepresentationName, targetRepresentationName, pathCosts);
+    representationNames.push_back(this->MasterRepresentationName);
   }
   else
   {
-    vtkSegmentationConverter::ConversionPathAndCostListType currentPathCosts;
-    std::vector<std::string> representationNames;
     this->GetContainedRepresentationNames(representationNames);
-    for (std::vector<std::string>::iterator reprIt=representationNames.begin(); reprIt!=representationNames.end(); ++reprIt)
+  }
+  vtkSegmentationConverter::ConversionPathAndCostListType pathCosts;
+  for (std::vector<std::string>::iterator reprIt=representationNames.begin(); reprIt!=representationNames.end(); ++reprIt)
+  {
+    std::vector<vtkDataObject*> sourceRepresentations;
+    for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
     {
-      this->Converter->GetPossibleConversions((*reprIt), targetRepresentationName, currentPathCosts);
-      for (vtkSegmentationConverter::ConversionPathAndCostListType::const_iterator pathIt = currentPathCosts.begin(); pathIt != currentPathCosts.end(); ++pathIt)
-      {
-        pathCosts.push_back(*pathIt);
-      }
+      sourceRepresentations.push_back(segmentIt->second->GetRepresentation(*reprIt));
+    }
+    vtkSegmentationConverter::ConversionPathAndCostType currentPathCost;
+    if (this->Converter->GetCheapestConversionPath((*reprIt), targetRepresentationName, currentPathCost, &sourceRepresentations))
+    {
+      pathCosts.push_back(currentPathCost);
     }
   }
   // Get cheapest path from found conversion paths
-  vtkSegmentationConverter::ConversionPathType cheapestPath = vtkSegmentationConverter::GetCheapestPath(pathCosts);
+  vtkSegmentationConverter::ConversionPathType cheapestPath = GetCheapestDataAwarePath(pathCosts);
   if (cheapestPath.empty())
   {
     return false;
   }
 
   // Perform conversion on all segments (no overwrites)
+  std::vector<vtkSegment*> segments;
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
   {
-    if (!this->ConvertSegmentUsingPath(segmentIt->second, cheapestPath, alwaysConvert))
-    {
-      vtkErrorMacro("CreateRepresentation: Conversion failed!");
-      return false;
-    }
+    segments.push_back(segmentIt->second);
   }
+  if (!this->ConvertSegmentsUsingPath(segments, cheapestPath, alwaysConvert))
+  {
+    vtkErrorMacro("CreateRepresentation: Conversion failed!");
+    return false;
+  }
+
+  this->InvokeOrCollectEvent(vtkSegmentation::RepresentationCreated, targetRepresentationName);
 
-  const char* targetRepresentationNameChars = targetRepresentationName.c_str();
-  this->InvokeEvent(vtkSegmentation::RepresentationCreated, (void*)targetRepresentationNameChars);
+  vtkSegmentation::EnforceDerivedRepresentationMemoryBudget();
   return true;
 }
 
@@ -863,17 +1287,20 @@ bool vtkSegmentation::CreateRepresentation(const std::string& targetRepresentati
   this->Converter->SetConversionParameters(parameters);
 
   // Perform conversion on all segments (do overwrites)
+  std::vector<vtkSegment*> segments;
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
   {
-    if (!this->ConvertSegmentUsingPath(segmentIt->second, path, true))
-    {
-      vtkErrorMacro("CreateRepresentation: Conversion failed!");
-      return false;
-    }
+    segments.push_back(segmentIt->second);
   }
+  if (!this->ConvertSegmentsUsingPath(segments, path, true))
+  {
+    vtkErrorMacro("CreateRepresentation: Conversion failed!");
+    return false;
+  }
+
+  this->InvokeOrCollectEvent(vtkSegmentation::RepresentationCreated, targetRepresentationName);
 
-  const char* targetRepresentationNameChars = targetRepresentationName.c_str();
-  this->InvokeEvent(vtkSegmentation::RepresentationCreated, (void*)targetRepresentationNameChars);
+  vtkSegmentation::EnforceDerivedRepresentationMemoryBudget();
   return true;
 }
 
@@ -889,6 +1316,123 @@ vtkDataObject* vtkSegmentation::GetSegmentRepresentation(std::string segmentId,
   return segment->GetRepresentation(representationName);
 }
 
+//---------------------------------------------------------------------------
+void vtkSegmentation::SetDerivedRepresentationMemoryBudget(unsigned long budget)
+{
+  DerivedRepresentationMemoryBudget = budget;
+  vtkSegmentation::EnforceDerivedRepresentationMemoryBudget();
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSegmentation::GetDerivedRepresentationMemoryBudget()
+{
+  return DerivedRepresentationMemoryBudget;
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSegmentation::GetTotalDerivedRepresentationMemorySize()
+{
+  unsigned long memorySize = 0;
+  std::set<vtkSegmentation*>& segmentations = GetSegmentationInstances();
+  for (std::set<vtkSegmentation*>::iterator segmentationIt = segmentations.begin(); segmentationIt != segmentations.end(); ++segmentationIt)
+  {
+    memorySize += (*segmentationIt)->GetRepresentationMemorySize();
+  }
+  return memorySize;
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentation::EnforceDerivedRepresentationMemoryBudget()
+{
+  // Representations accessed since the previous enforcement (including the ones created by the current
+  // conversion) may still be used by the caller through raw pointers, so they are kept.
+  // The time is updated even without a budget, so that it is valid when a budget is set.
+  unsigned long protectedAccessTime = GetLastBudgetEnforcementTime().GetMTime();
+  GetLastBudgetEnforcementTime().Modified();
+  if (DerivedRepresentationMemoryBudget == 0)
+  {
+    return;
+  }
+
+  // Collect derived representations of all segmentations
+  std::vector<EvictionCandidate> candidates;
+  unsigned long memorySize = 0;
+  std::set<vtkSegmentation*>& segmentations = GetSegmentationInstances();
+  for (std::set<vtkSegmentation*>::iterator segmentationIt = segmentations.begin(); segmentationIt != segmentations.end(); ++segmentationIt)
+  {
+    vtkSegmentation* segmentation = (*segmentationIt);
+    if (!segmentation->MasterRepresentationName)
+    {
+      continue;
+    }
+    for (SegmentMap::iterator segmentIt = segmentation->Segments.begin(); segmentIt != segmentation->Segments.end(); ++segmentIt)
+    {
+      std::vector<std::string> representationNames;
+      segmentIt->second->GetContainedRepresentationNames(representationNames);
+      for (std::vector<std::string>::iterator reprIt = representationNames.begin(); reprIt != representationNames.end(); ++reprIt)
+      {
+        if ( !reprIt->compare(segmentation->MasterRepresentationName)
+          || segmentIt->second->IsRepresentationEvicted(*reprIt) )
+        {
+          continue;
+        }
+        EvictionCandidate candidate;
+        candidate.AccessTime = segmentIt->second->GetRepresentationAccessTime(*reprIt);
+        candidate.MemorySize = segmentIt->second->GetRepresentationMemorySize(*reprIt);
+        candidate.Segment = segmentIt->second;
+        candidate.RepresentationName = (*reprIt);
+        candidates.push_back(candidate);
+        memorySize += candidate.MemorySize;
+      }
+    }
+  }
+  if (memorySize <= DerivedRepresentationMemoryBudget)
+  {
+    return;
+  }
+
+  // Evict least recently used representations until the memory usage is within budget
+  std::sort(candidates.begin(), candidates.end());
+  for (std::vector<EvictionCandidate>::iterator candidateIt = candidates.begin();
+    candidateIt != candidates.end() && memorySize > DerivedRepresentationMemoryBudget; ++candidateIt)
+  {
+    if (candidateIt->AccessTime > protectedAccessTime)
+    {
+      // Candidates are sorted by access time, so all remaining ones are protected
+      break;
+    }
+    candidateIt->Segment->EvictRepresentation(candidateIt->RepresentationName);
+    memorySize -= candidateIt->MemorySize;
+  }
+}
+
+//---------------------------------------------------------------------------
+unsigned long vtkSegmentation::GetRepresentationMemorySize(const std::string& representationName/*=""*/)
+{
+  unsigned long memorySize = 0;
+  for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
+  {
+    if (!representationName.empty())
+    {
+      memorySize += segmentIt->second->GetRepresentationMemorySize(representationName);
+      continue;
+    }
+
+    // All derived representations
+    std::vector<std::string> representationNames;
+    segmentIt->second->GetContainedRepresentationNames(representationNames);
+    for (std::vector<std::string>::iterator reprIt = representationNames.begin(); reprIt != representationNames.end(); ++reprIt)
+    {
+      if (this->MasterRepresentationName && !reprIt->compare(this->MasterRepresentationName))
+      {
+        continue;
+      }
+      memorySize += segmentIt->second->GetRepresentationMemorySize(*reprIt);
+    }
+  }
+  return memorySize;
+}
+
 //---------------------------------------------------------------------------
 void vtkSegmentation::InvalidateNonMasterRepresentations()
 {
@@ -899,10 +1443,12 @@ void vtkSegmentation::InvalidateNonMasterRepresentations()
   }
 
   // Iterate through all segments and remove all representations that are not the master representation
+  this->StartBatch();
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
   {
     segmentIt->second->RemoveAllRepresentations(this->MasterRepresentationName);
   }
+  this->EndBatch();
 }
 
 //---------------------------------------------------------------------------
@@ -1040,7 +1586,7 @@ bool vtkSegmentation::AddEmptySegment(std::string segmentId/*=""*/)
 }
 
 //-----------------------------------------------------------------------------
-bool vtkSegmentation::CopySegmentFromSegmentation(vtkSegmentation* fromSegmentation, std::string segmentId, bool removeFromSource/*=false*/)
+bool vtkSegmentation::CopySegmentFromSegmentation(vtkSegmentation* fromSegmentation, std::string segmentId, bool removeFromSource/*=false*/, bool shareRepresentationData/*=false*/)
 {
   if (!fromSegmentation || segmentId.empty())
   {
@@ -1076,7 +1622,14 @@ bool vtkSegmentation::CopySegmentFromSegmentation(vtkSegmentation* fromSegmentat
   if (!removeFromSource)
   {
     vtkSmartPointer<vtkSegment> segmentCopy = vtkSmartPointer<vtkSegment>::New();
-    segmentCopy->DeepCopy(segment);
+    if (shareRepresentationData)
+    {
+      segmentCopy->ShallowCopy(segment);
+    }
+    else
+    {
+      segmentCopy->DeepCopy(segment);
+    }
     if (!this->AddSegment(segmentCopy, segmentId))
     {
       vtkErrorMacro("CopySegmentFromSegmentation: Failed to add segment '" << segmentId << "' to segmentation!");
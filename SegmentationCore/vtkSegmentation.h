@@ -27,6 +27,7 @@
 
 // STD includes
 #include <map>
+#include <vector>
 
 // SegmentationCore includes
 #include "vtkSegment.h"
@@ -36,6 +37,7 @@
 #include "vtkSegmentationCoreConfigure.h"
 
 class vtkAbstractTransform;
+class vtkGridTransform;
 class vtkCallbackCommand;
 class vtkStringArray;
 
@@ -57,9 +59,39 @@ public:
     /// Fired if segment is modified
     SegmentModified,
     /// Fired if representations are created on conversion
-    RepresentationCreated
+    RepresentationCreated,
+    /// Fired at the end of a batch of modifications (\sa EndBatch) instead of the individual events above.
+    /// Call data is a pointer to a \sa BatchModifiedEventData object listing the changes, which is only valid during the call
+    SegmentsBatchModified
   };
 
+//BTX
+  /// Changes collected during a batch of modifications, passed as call data of \sa SegmentsBatchModified
+  struct BatchModifiedEventData
+  {
+    BatchModifiedEventData() : MasterRepresentationModified(false) { };
+
+    /// Determine if any change was made during the batch
+    bool IsEmpty() const
+    {
+      return AddedSegmentIDs.empty() && RemovedSegmentIDs.empty() && ModifiedSegmentIDs.empty()
+        && CreatedRepresentationNames.empty() && !MasterRepresentationModified;
+    };
+
+    /// IDs of the segments added in the batch (and not removed since)
+    std::vector<std::string> AddedSegmentIDs;
+    /// IDs of the segments that existed before the batch and were removed.
+    /// If a segment is removed then added with the same ID, then it is listed both as removed and added
+    std::vector<std::string> RemovedSegmentIDs;
+    /// IDs of the segments that existed before the batch and were modified
+    std::vector<std::string> ModifiedSegmentIDs;
+    /// Names of the representations created by conversion
+    std::vector<std::string> CreatedRepresentationNames;
+    /// Flag indicating that the master representation was modified in any of the segments
+    bool MasterRepresentationModified;
+  };
+//ETX
+
   /// Container type for segments. Maps segment IDs to segment objects
   typedef std::map<std::string, vtkSmartPointer<vtkSegment> > SegmentMap;
 
@@ -74,13 +106,19 @@ public:
   /// Write this node's information to a MRML file in XML format. 
   virtual void WriteXML(ostream& of, int indent);
 
-  /// Deep copy one segmentation into another
+  /// Deep copy one segmentation into another. The data of the segment representations is duplicated.
   virtual void DeepCopy(vtkSegmentation* aSegmentation);
 
+  /// Copy one segmentation into another, sharing the data of the segment representations between the two.
+  /// Meant for temporary copies that are only read or converted. Representation data may only be modified
+  /// in place via \sa vtkSegment::GetWritableRepresentation, which duplicates the shared data first.
+  virtual void ShallowCopy(vtkSegmentation* aSegmentation);
+
   /// Copy conversion parameters from another segmentation
   virtual void CopyConversionParameters(vtkSegmentation* aSegmentation);
 
   /// Get bounding box in global RAS in the form (xmin,xmax, ymin,ymax, zmin,zmax).
+  /// The bounds are cached, and only recomputed after segments are added, removed or modified.
   virtual void GetBounds(double bounds[6]);
 
   /// Apply a linear transform on the master representation of the segments. The others will be invalidated
@@ -89,8 +127,17 @@ public:
 
   /// Apply a non-linear transform on the master representation of the segments. The others will be invalidated
   /// Harden transform both if oriented image data and poly data.
+  /// The transform is evaluated exactly unless \sa NonLinearTransformApproximation is enabled.
   virtual void ApplyNonLinearTransform(vtkAbstractTransform* transform);
 
+  /// If enabled, then \sa ApplyNonLinearTransform samples the transform and its inverse into displacement grids
+  /// once and hardens the grids on the segments instead of the original transform. This is much faster for
+  /// expensive transforms, but the displacements are interpolated from a grid of limited resolution.
+  /// Off by default (the transform is evaluated exactly for each point and voxel).
+  vtkGetMacro(NonLinearTransformApproximation, bool);
+  vtkSetMacro(NonLinearTransformApproximation, bool);
+  vtkBooleanMacro(NonLinearTransformApproximation, bool);
+
   /// Returns true if the node (default behavior) or the internal data are modified
   /// since read/written.
   /// Note: The MTime of the internal data is used to know if it has been modified.
@@ -142,6 +189,18 @@ public:
   /// Get IDs for all contained segments
   void GetSegmentIDs(std::vector<std::string> &segmentIds);
 
+  /// Start a batch of modifications. Until the matching \sa EndBatch call the SegmentAdded, SegmentRemoved,
+  /// SegmentModified, RepresentationCreated and MasterRepresentationModified events are not invoked, but
+  /// the changes are collected and a single SegmentsBatchModified event is invoked at the end of the batch.
+  /// Batches can be nested, the event is invoked when the outermost batch ends.
+  void StartBatch();
+
+  /// End a batch of modifications started by \sa StartBatch
+  void EndBatch();
+
+  /// Determine if a batch of modifications is in progress
+  bool IsBatchInProgress() { return this->BatchLevel > 0; };
+
   /// Get IDs for all contained segments, for python compatibility
   void GetSegmentIDs(vtkStringArray* segmentIds);
 
@@ -162,8 +221,11 @@ public:
   /// \param segmentId ID of segment to copy
   /// \param removeFromSource If true, then delete segment from source segmentation after copying.
   ///                        Default value is false.
+  /// \param shareRepresentationData If true, then the copied segment shares the data of its representations
+  ///   with the source segment (\sa vtkSegment::ShallowCopy). Only use it if the copy is read or converted only,
+  ///   or its data is modified in place via \sa vtkSegment::GetWritableRepresentation. Default value is false.
   /// \return Success flag
-  bool CopySegmentFromSegmentation(vtkSegmentation* fromSegmentation, std::string segmentId, bool removeFromSource=false);
+  bool CopySegmentFromSegmentation(vtkSegmentation* fromSegmentation, std::string segmentId, bool removeFromSource=false, bool shareRepresentationData=false);
 
 // Representation related methods
 public:
@@ -244,6 +306,34 @@ public:
   /// Such a string can be constructed in a segmentation object using /sa SerializeAllConversionParameters
   void DeserializeConversionParameters(std::string conversionParametersString);
 
+// Memory management of derived representations
+public:
+  /// Set memory budget for the derived (non-master) representations of all segmentations in the process, in kibibytes.
+  /// If the budget is exceeded after a conversion, then the least recently used derived representations are evicted
+  /// (\sa vtkSegment::EvictRepresentation), and they are regenerated from the master representation when requested again.
+  /// Representations accessed since the previous enforcement of the budget are not evicted, so a raw pointer
+  /// returned by \sa vtkSegment::GetRepresentation stays valid until the end of the next call that adds a segment
+  /// or creates a representation. When a budget is set, pointers to derived representations must not be kept
+  /// longer than that without holding a reference. 0 means unlimited (default)
+  static void SetDerivedRepresentationMemoryBudget(unsigned long budget);
+
+  /// Get memory budget for the derived representations in kibibytes. 0 means unlimited
+  static unsigned long GetDerivedRepresentationMemoryBudget();
+
+  /// Get memory used by the derived representations of all segmentations in the process in kibibytes
+  static unsigned long GetTotalDerivedRepresentationMemorySize();
+
+  /// Evict the least recently used derived representations of all segmentations in the process
+  /// until their memory usage is within the budget. Representations accessed since the previous
+  /// call are kept even if the budget is exceeded
+  static void EnforceDerivedRepresentationMemoryBudget();
+
+  /// Get memory used by a representation in all segments of this segmentation in kibibytes.
+  /// Data shared between segmentations (\sa vtkSegment::DeepCopy) is counted in each of them.
+  /// \param representationName Name of the representation. If empty, then the memory used by all
+  ///   derived representations is returned
+  unsigned long GetRepresentationMemorySize(const std::string& representationName="");
+
 // Get/set methods
 public:
   /// Get master representation name
@@ -262,10 +352,34 @@ protected:
   /// \return Success flag
   bool ConvertSegmentUsingPath(vtkSegment* segment, vtkSegmentationConverter::ConversionPathType path, bool overwriteExisting=false);
 
+  /// Convert multiple segments along a specified path. Each conversion step is performed for all
+  /// segments at once, so that rules can process the segments together (\sa vtkSegmentationConverterRule::ConvertMultiple)
+  /// \param segments Segments to convert
+  /// \param path Path to do the conversion along
+  /// \param overwriteExisting If true then do each conversion step regardless the target representation
+  ///   exists. If false then skip those conversion steps that would overwrite existing representation
+  /// \return Success flag
+  bool ConvertSegmentsUsingPath(std::vector<vtkSegment*>& segments, vtkSegmentationConverter::ConversionPathType path, bool overwriteExisting=false);
+
   /// Remove segment by iterator. The two \sa RemoveSegment methods call this function after
   /// finding the iterator based on their different input arguments.
   void RemoveSegment(SegmentMap::iterator segmentIt);
 
+  /// Sample a non-linear transform and its inverse into displacement grids covering all segments, so that
+  /// hardening the transform on the segments needs only trilinear lookups (\sa ApplyNonLinearTransform,
+  /// \sa NonLinearTransformApproximation).
+  /// The grid resolution is that of the reference image geometry, limited to a maximum grid size.
+  /// \param transform Transform to sample
+  /// \param gridTransform Output grid transform approximating the input transform
+  /// \param inverseGridTransform Output grid transform approximating the inverse of the input transform
+  /// \return Success flag. Fails if the segmentation is empty
+  bool SampleNonLinearTransformToGrids(vtkAbstractTransform* transform, vtkGridTransform* gridTransform, vtkGridTransform* inverseGridTransform);
+
+  /// Invoke segment or representation related event, or collect it if a batch of modifications is in progress
+  /// \param event Event ID (\sa SegmentAdded, SegmentRemoved, SegmentModified, RepresentationCreated, MasterRepresentationModified)
+  /// \param name Segment ID or representation name, depending on the event
+  void InvokeOrCollectEvent(unsigned long event, const std::string& name="");
+
   /// Generate unique segment ID. If argument is empty then a new ID will be generated in the form "SegmentN",
   /// where N is the number of segments. If argument is unique it is returned unchanged. If there is a segment
   /// with the given name, then it is postfixed by "_1"
@@ -276,6 +390,10 @@ protected:
   /// It calls Modified on the segmentation and rebuilds observations on the master representation of each segment
   static void OnSegmentModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
 
+  /// Callback function invoked when an evicted representation is requested from a segment.
+  /// It regenerates the representation from the master representation using the cheapest path
+  static void OnSegmentRepresentationRequested(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+
   /// Callback function observing the master representation of each segment
   /// It fires a \sa MasterRepresentationModifiedEvent if master representation is changed in ANY segment
   static void OnMasterRepresentationModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
@@ -285,6 +403,11 @@ protected:
   ~vtkSegmentation();
   void operator=(const vtkSegmentation&);
 
+  /// Copy properties, conversion parameters and segments of another segmentation
+  /// \param shareRepresentationData If true, then representation data is shared with the segments of the
+  ///   other segmentation, otherwise it is duplicated
+  void CopySegmentation(vtkSegmentation* aSegmentation, bool shareRepresentationData);
+
   /// Container of segments that belong to this segmentation
   SegmentMap Segments;
 
@@ -300,8 +423,28 @@ protected:
   /// Command handling segment modified events
   vtkCallbackCommand* SegmentCallbackCommand;
 
+  /// Command handling representation requests of segments
+  vtkCallbackCommand* SegmentRepresentationRequestedCallbackCommand;
+
   /// Command handling master representation modified events
   vtkCallbackCommand* MasterRepresentationCallbackCommand;
+
+  /// Nesting level of batch modifications (\sa StartBatch)
+  int BatchLevel;
+
+  /// Bounds of all segments computed in the last \sa GetBounds call
+  double CachedBounds[6];
+
+  /// Flag indicating that the cached bounds are valid. Reset when segments are added, removed or modified
+  bool CachedBoundsValid;
+
+  /// Flag determining whether non-linear transforms are approximated by displacement grids when hardened
+  bool NonLinearTransformApproximation;
+
+//BTX
+  /// Changes collected during the current batch of modifications
+  BatchModifiedEventData BatchModifiedData;
+//ETX
 };
 
 #endif // __vtkSegmentation_h
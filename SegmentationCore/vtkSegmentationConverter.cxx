@@ -33,6 +33,8 @@ Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
 #include <vtkTransform.h>
 
 // STD includes
+#include <algorithm>
+#include <climits>
 #include <sstream>
 
 //----------------------------------------------------------------------------
@@ -116,6 +118,19 @@ std::string vtkSegmentationConverter::SerializeImageGeometry(vtkMatrix4x4* geome
     return "";
   }
 
+  int extent[6] = {0,-1,0,-1,0,-1};
+  imageData->GetExtent(extent);
+  return vtkSegmentationConverter::SerializeImageGeometry(geometryMatrix, extent);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSegmentationConverter::SerializeImageGeometry(vtkMatrix4x4* geometryMatrix, const int extent[6])
+{
+  if (!geometryMatrix)
+  {
+    return "";
+  }
+
   std::stringstream geometryStream;
   for (int i=0; i<4; i++)
   {
@@ -125,8 +140,6 @@ std::string vtkSegmentationConverter::SerializeImageGeometry(vtkMatrix4x4* geome
     }
   }
 
-  int extent[6] = {0,-1,0,-1,0,-1};
-  imageData->GetExtent(extent);
   for (int i=0; i<6; i++)
   {
     geometryStream << extent[i] << SERIALIZED_GEOMETRY_SEPARATOR;
@@ -294,6 +307,70 @@ std::string vtkSegmentationConverter::GetConversionParameterDescription(const st
   return "";
 }
 
+//----------------------------------------------------------------------------
+bool vtkSegmentationConverter::GetConversionParameterAsDouble(const std::string& name, double& value)
+{
+  ConverterRulesListType::iterator ruleIt;
+  for (ruleIt = this->ConverterRules.begin(); ruleIt != this->ConverterRules.end(); ++ruleIt)
+  {
+    if ((*ruleIt)->HasConversionParameter(name))
+    {
+      return (*ruleIt)->GetConversionParameterAsDouble(name, value);
+    }
+  }
+
+  vtkErrorMacro("GetConversionParameterAsDouble: Conversion parameter '" << name << "' not found in converter rules!");
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentationConverter::GetConversionParameterAsImageGeometry(const std::string& name, vtkOrientedImageData* geometryImageData)
+{
+  ConverterRulesListType::iterator ruleIt;
+  for (ruleIt = this->ConverterRules.begin(); ruleIt != this->ConverterRules.end(); ++ruleIt)
+  {
+    if ((*ruleIt)->HasConversionParameter(name))
+    {
+      return (*ruleIt)->GetConversionParameterAsImageGeometry(name, geometryImageData);
+    }
+  }
+
+  vtkErrorMacro("GetConversionParameterAsImageGeometry: Conversion parameter '" << name << "' not found in converter rules!");
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationConverter::SetConversionParameterAsImageGeometry(const std::string& name, vtkOrientedImageData* geometryImageData)
+{
+  if (!geometryImageData)
+  {
+    vtkErrorMacro("SetConversionParameterAsImageGeometry: Invalid geometry image data!");
+    return;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> geometryMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  geometryImageData->GetImageToWorldMatrix(geometryMatrix);
+  int extent[6] = {0,-1,0,-1,0,-1};
+  geometryImageData->GetExtent(extent);
+
+  // Set conversion parameter to each converter having that parameter
+  bool parameterFound = false;
+  ConverterRulesListType::iterator ruleIt;
+  for (ruleIt = this->ConverterRules.begin(); ruleIt != this->ConverterRules.end(); ++ruleIt)
+  {
+    if ((*ruleIt)->HasConversionParameter(name))
+    {
+      (*ruleIt)->SetConversionParameterAsImageGeometry(name, geometryMatrix, extent);
+      parameterFound = true;
+    }
+  }
+
+  if (!parameterFound)
+  {
+    vtkErrorMacro("SetConversionParameterAsImageGeometry: Conversion parameter '" << name << "' not found in converter rules!");
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkSegmentationConverter::ConversionPathType vtkSegmentationConverter::GetCheapestPath(const ConversionPathAndCostListType &pathsCosts)
 {
@@ -326,8 +403,214 @@ vtkSegmentationConverter::ConversionPathType vtkSegmentationConverter::GetCheape
 void vtkSegmentationConverter::GetPossibleConversions(const std::string& sourceRepresentationName, const std::string& targetRepresentationName, ConversionPathAndCostListType &pathsCosts)
 {
   pathsCosts.clear();
-  std::set<std::string> skipRepresentations;
-  this->FindPath(sourceRepresentationName, targetRepresentationName, pathsCosts, skipRepresentations);
+
+  // Enumerate paths only once for each representation pair, as it is exponential in the number of rules
+  std::pair<std::string, std::string> representationPair(sourceRepresentationName, targetRepresentationName);
+  PossibleConversionsCacheType::iterator cacheIt = this->PossibleConversionsCache.find(representationPair);
+  if (cacheIt == this->PossibleConversionsCache.end())
+  {
+    ConversionPathAndCostListType foundPathsCosts;
+    std::set<std::string> skipRepresentations;
+    this->FindPath(sourceRepresentationName, targetRepresentationName, foundPathsCosts, skipRepresentations);
+    cacheIt = this->PossibleConversionsCache.insert(std::make_pair(representationPair, foundPathsCosts)).first;
+  }
+  pathsCosts = cacheIt->second;
+
+  // Update costs, as the cost models of the rules may have been calibrated since the paths were found
+  for (ConversionPathAndCostListType::iterator pathIt = pathsCosts.begin(); pathIt != pathsCosts.end(); ++pathIt)
+  {
+    pathIt->second = 0;
+    for (ConversionPathType::iterator ruleIt = pathIt->first.begin(); ruleIt != pathIt->first.end(); ++ruleIt)
+    {
+      pathIt->second += (*ruleIt)->GetConversionCost();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentationConverter::GetCheapestConversionPath(const std::string& sourceRepresentationName, const std::string& targetRepresentationName,
+  ConversionPathAndCostType& pathCost, std::vector<vtkDataObject*>* sourceRepresentations/*=NULL*/)
+{
+  pathCost.first.clear();
+  pathCost.second = 0;
+  if (sourceRepresentationName == targetRepresentationName)
+  {
+    return false;
+  }
+
+  std::map<std::string, ConversionPathAndCostType> dataAwareCheapestPathsCosts;
+  std::map<std::string, ConversionPathAndCostType>* cheapestPathsCosts = NULL;
+  if (sourceRepresentations && !sourceRepresentations->empty())
+  {
+    // Costs depend on the data, so the table cannot be used
+    this->FindCheapestPaths(sourceRepresentationName, sourceRepresentations, dataAwareCheapestPathsCosts);
+    cheapestPathsCosts = &dataAwareCheapestPathsCosts;
+  }
+  else
+  {
+    // Recompute table if the cost of any rule may have changed since it was computed
+    for (ConverterRulesListType::iterator ruleIt = this->ConverterRules.begin(); ruleIt != this->ConverterRules.end(); ++ruleIt)
+    {
+      if ((*ruleIt)->GetMTime() > this->CheapestPathTableTime.GetMTime())
+      {
+        this->UpdateCheapestPathTable();
+        break;
+      }
+    }
+    CheapestPathTableType::iterator tableIt = this->CheapestPathTable.find(sourceRepresentationName);
+    if (tableIt == this->CheapestPathTable.end())
+    {
+      return false;
+    }
+    cheapestPathsCosts = &(tableIt->second);
+  }
+
+  std::map<std::string, ConversionPathAndCostType>::iterator pathCostIt = cheapestPathsCosts->find(targetRepresentationName);
+  if (pathCostIt == cheapestPathsCosts->end())
+  {
+    return false;
+  }
+
+  // Paths containing disabled rules are not used
+  for (ConversionPathType::iterator ruleIt = pathCostIt->second.first.begin(); ruleIt != pathCostIt->second.first.end(); ++ruleIt)
+  {
+    if ((*ruleIt)->GetConversionCost() >= vtkSegmentationConverterRule::GetConversionInfiniteCost())
+    {
+      return false;
+    }
+  }
+
+  pathCost = pathCostIt->second;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationConverter::FindCheapestPaths(const std::string& sourceRepresentationName, std::vector<vtkDataObject*>* sourceRepresentations,
+  std::map<std::string, ConversionPathAndCostType>& cheapestPathsCosts)
+{
+  cheapestPathsCosts.clear();
+  if (sourceRepresentations && sourceRepresentations->empty())
+  {
+    sourceRepresentations = NULL;
+  }
+  double numberOfSegments = (sourceRepresentations ? (double)sourceRepresentations->size() : 1.0);
+  double infiniteCost = (double)vtkSegmentationConverterRule::GetConversionInfiniteCost();
+
+  // Cost, number of conversions, and last rule of the cheapest path found so far to each representation
+  std::map<std::string, double> costs;
+  std::map<std::string, unsigned int> numbersOfConversions;
+  std::map<std::string, vtkSegmentationConverterRule*> lastRules;
+  std::set<std::string> visitedRepresentationNames;
+  costs[sourceRepresentationName] = 0.0;
+  numbersOfConversions[sourceRepresentationName] = 0;
+
+  while (true)
+  {
+    // Get the unvisited representation with the cheapest path
+    std::string currentRepresentationName;
+    double currentCost = 0.0;
+    unsigned int currentNumberOfConversions = 0;
+    bool unvisitedRepresentationFound = false;
+    for (std::map<std::string, double>::iterator costIt = costs.begin(); costIt != costs.end(); ++costIt)
+    {
+      if (visitedRepresentationNames.find(costIt->first) != visitedRepresentationNames.end())
+      {
+        continue;
+      }
+      unsigned int numberOfConversions = numbersOfConversions[costIt->first];
+      if ( !unvisitedRepresentationFound || costIt->second < currentCost
+        || (costIt->second == currentCost && numberOfConversions < currentNumberOfConversions) )
+      {
+        currentRepresentationName = costIt->first;
+        currentCost = costIt->second;
+        currentNumberOfConversions = numberOfConversions;
+        unvisitedRepresentationFound = true;
+      }
+    }
+    if (!unvisitedRepresentationFound)
+    {
+      break;
+    }
+    visitedRepresentationNames.insert(currentRepresentationName);
+
+    RepresentationToRepresentationToRuleMapType::iterator graphIt = this->RulesGraph.find(currentRepresentationName);
+    if (graphIt == this->RulesGraph.end())
+    {
+      // dead end, no more rules from here
+      continue;
+    }
+    for (RulesListType::iterator ruleIt = graphIt->second.begin(); ruleIt != graphIt->second.end(); ++ruleIt)
+    {
+      vtkSegmentationConverterRule* rule = (*ruleIt);
+      std::string ruleTargetRepresentationName(rule->GetTargetRepresentationName());
+      if (visitedRepresentationNames.find(ruleTargetRepresentationName) != visitedRepresentationNames.end())
+      {
+        continue;
+      }
+
+      // Disabled rules are not used. Their cost cannot be compared to the weighted cost of
+      // enabled rules, which may exceed the infinite cost for many segments.
+      double ruleCost = (double)rule->GetConversionCost();
+      if (ruleCost >= infiniteCost)
+      {
+        continue;
+      }
+
+      // Only the data of the source representations is available, so the cost of further steps
+      // is the data-independent cost for each segment
+      if (sourceRepresentations && currentRepresentationName == sourceRepresentationName)
+      {
+        ruleCost = 0.0;
+        for (std::vector<vtkDataObject*>::iterator reprIt = sourceRepresentations->begin(); reprIt != sourceRepresentations->end(); ++reprIt)
+        {
+          ruleCost += (double)rule->GetConversionCost(*reprIt);
+        }
+      }
+      else
+      {
+        ruleCost *= numberOfSegments;
+      }
+
+      double newCost = currentCost + ruleCost;
+      unsigned int newNumberOfConversions = currentNumberOfConversions + 1;
+      std::map<std::string, double>::iterator targetCostIt = costs.find(ruleTargetRepresentationName);
+      if ( targetCostIt == costs.end() || newCost < targetCostIt->second
+        || (newCost == targetCostIt->second && newNumberOfConversions < numbersOfConversions[ruleTargetRepresentationName]) )
+      {
+        costs[ruleTargetRepresentationName] = newCost;
+        numbersOfConversions[ruleTargetRepresentationName] = newNumberOfConversions;
+        lastRules[ruleTargetRepresentationName] = rule;
+      }
+    }
+  }
+
+  // Assemble paths by walking back from each reached representation
+  for (std::map<std::string, vtkSegmentationConverterRule*>::iterator lastRuleIt = lastRules.begin(); lastRuleIt != lastRules.end(); ++lastRuleIt)
+  {
+    ConversionPathAndCostType& pathCost = cheapestPathsCosts[lastRuleIt->first];
+    pathCost.second = (unsigned int)std::min(costs[lastRuleIt->first], (double)UINT_MAX);
+    std::string representationName = lastRuleIt->first;
+    while (representationName != sourceRepresentationName)
+    {
+      vtkSegmentationConverterRule* rule = lastRules[representationName];
+      pathCost.first.push_back(rule);
+      representationName = rule->GetSourceRepresentationName();
+    }
+    std::reverse(pathCost.first.begin(), pathCost.first.end());
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationConverter::UpdateCheapestPathTable()
+{
+  this->CheapestPathTable.clear();
+  std::set<std::string> representationNames;
+  this->GetAvailableRepresentationNames(representationNames);
+  for (std::set<std::string>::iterator reprIt = representationNames.begin(); reprIt != representationNames.end(); ++reprIt)
+  {
+    this->FindCheapestPaths(*reprIt, NULL, this->CheapestPathTable[*reprIt]);
+  }
+  this->CheapestPathTableTime.Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -449,6 +732,10 @@ void vtkSegmentationConverter::RebuildRulesGraph()
   {
     this->RulesGraph[ruleIt->GetPointer()->GetSourceRepresentationName()].push_back(ruleIt->GetPointer());
   }
+
+  // Paths need to be found again in the new graph
+  this->PossibleConversionsCache.clear();
+  this->UpdateCheapestPathTable();
 }
 
 //----------------------------------------------------------------------------
@@ -532,11 +819,8 @@ void vtkSegmentationConverter::ApplyTransformOnReferenceImageGeometry(vtkAbstrac
     return;
   }
   // Get current reference geometry parameter
-  std::string geometryString = this->GetConversionParameter(vtkSegmentationConverter::GetReferenceImageGeometryParameterName());
-
-  // Deserialize parameter string into oriented image data
   vtkSmartPointer<vtkOrientedImageData> geometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
-  if (!vtkSegmentationConverter::DeserializeImageGeometry(geometryString, geometryImage))
+  if (!this->GetConversionParameterAsImageGeometry(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), geometryImage))
   {
     vtkErrorMacro("ApplyTransformOnReferenceImageGeometry: Failed to get reference image geometry");
     return;
@@ -546,12 +830,5 @@ void vtkSegmentationConverter::ApplyTransformOnReferenceImageGeometry(vtkAbstrac
   vtkOrientedImageDataResample::TransformOrientedImage(geometryImage, transform, true);
 
   // Set reference image geometry parameter from oriented image data
-  std::string newGeometryString = vtkSegmentationConverter::SerializeImageGeometry(geometryImage);
-  if (newGeometryString.empty())
-  {
-    vtkErrorMacro("ApplyTransformOnReferenceImageGeometry: Failed to serialize new image geometry");
-    return;
-  }
-  this->SetConversionParameter(
-    vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), newGeometryString );
+  this->SetConversionParameterAsImageGeometry(vtkSegmentationConverter::GetReferenceImageGeometryParameterName(), geometryImage);
 }
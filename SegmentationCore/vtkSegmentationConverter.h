@@ -24,6 +24,7 @@
 // VTK includes
 #include <vtkObject.h>
 #include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
 
 // STD includes
 #include <map>
@@ -37,6 +38,7 @@
 #include "vtkSegmentationConverterRule.h"
 
 class vtkAbstractTransform;
+class vtkDataObject;
 class vtkSegment;
 class vtkMatrix4x4;
 class vtkImageData;
@@ -76,8 +78,22 @@ public:
   /// Get all representations supported by the converter
   void GetAvailableRepresentationNames(std::set<std::string>& representationNames);
 
-  /// Get all possible conversions between two representations
+  /// Get all possible conversions between two representations.
+  /// The paths are cached until the rules graph is rebuilt, the costs are always up-to-date.
   void GetPossibleConversions(const std::string& sourceRepresentationName, const std::string& targetRepresentationName, ConversionPathAndCostListType &pathsCosts);
+
+  /// Get the cheapest conversion path between two representations.
+  /// Without source representations the path is looked up from the table of cheapest paths between all
+  /// representation pairs, which is computed when the rules graph is rebuilt or the rule costs change.
+  /// \param sourceRepresentationName Representation to convert from
+  /// \param targetRepresentationName Representation to convert to
+  /// \param pathCost Output cheapest path and its cost
+  /// \param sourceRepresentations Source representations of the segments to convert. If specified, then the
+  ///   cost of the first conversion step is estimated from the data of each segment, the other steps are
+  ///   weighted by the number of segments.
+  /// \return True if a path was found whose cost does not exceed the cost of a disabled rule, false otherwise
+  bool GetCheapestConversionPath(const std::string& sourceRepresentationName, const std::string& targetRepresentationName,
+    ConversionPathAndCostType& pathCost, std::vector<vtkDataObject*>* sourceRepresentations=NULL);
   
   /// Get all conversion parameters used by the selected conversion path
   void GetConversionParametersForPath(vtkSegmentationConverterRule::ConversionParameterListType& conversionParameters, const ConversionPathType& path);
@@ -99,6 +115,22 @@ public:
   /// Note: all parameters with the same name should contain the same value
   std::string GetConversionParameterDescription(const std::string& description);
 
+  /// Get a floating point conversion parameter value from first rule containing this parameter.
+  /// The rules cache the parsed value, so the parameter string is only parsed again if it changes.
+  /// \return Success flag. False if the parameter is not found, empty, or not a number
+  bool GetConversionParameterAsDouble(const std::string& name, double& value);
+
+  /// Get an image geometry conversion parameter from first rule containing this parameter.
+  /// The rules cache the parsed geometry, so the parameter string is only parsed again if it changes.
+  /// \param geometryImageData Oriented image data whose geometry and extent are set from the parameter
+  /// \return Success flag. False if the parameter is not found, empty, or cannot be parsed
+  bool GetConversionParameterAsImageGeometry(const std::string& name, vtkOrientedImageData* geometryImageData);
+
+  /// Set an image geometry conversion parameter to all rules having this parameter.
+  /// The parameter string is serialized right away, so readers of the string always see the new geometry.
+  /// The geometry is also cached in the rules, so using it later does not require parsing the string.
+  void SetConversionParameterAsImageGeometry(const std::string& name, vtkOrientedImageData* geometryImageData);
+
   /// Serialize all conversion parameters.
   /// The resulting string can be parsed in a segmentation converter object using /sa DeserializeConversionParameters
   std::string SerializeAllConversionParameters();
@@ -123,6 +155,9 @@ public:
   /// Utility function for serializing geometry of a complete geometry matrix and regular image data (providing only dimensions)
   static std::string SerializeImageGeometry(vtkMatrix4x4* geometryMatrix, vtkImageData* imageData);
 
+  /// Utility function for serializing geometry of a complete geometry matrix and an extent
+  static std::string SerializeImageGeometry(vtkMatrix4x4* geometryMatrix, const int extent[6]);
+
   /// Utility function for de-serializing reference image geometry into a dummy oriented image data
   /// \param geometryString String containing the serialized image geometry
   /// \param orientedImageData Dummy oriented image data containing the de-serialized geometry information
@@ -140,9 +175,21 @@ public:
   static double DeserializeFloatingPointConversionParameter(std::string parameterString);
 
 protected:
-  /// Build a graph from ConverterRules list to facilitate faster finding of rules from a specific representation
+  /// Build a graph from ConverterRules list to facilitate faster finding of rules from a specific representation.
+  /// Also computes the cheapest paths between all pairs of representations.
   void RebuildRulesGraph();
 
+  /// Compute the cheapest paths between all pairs of representations using the data-independent rule costs
+  void UpdateCheapestPathTable();
+
+  /// Find the cheapest paths from a representation to all other representations (Dijkstra's algorithm).
+  /// Among paths with the same cost the one with fewer conversions is chosen.
+  /// \param sourceRepresentationName Representation to convert from
+  /// \param sourceRepresentations Source representations of the segments to convert for data-aware costs. Optional
+  /// \param cheapestPathsCosts Output map of target representation name to the cheapest path and cost
+  void FindCheapestPaths(const std::string& sourceRepresentationName, std::vector<vtkDataObject*>* sourceRepresentations,
+    std::map<std::string, ConversionPathAndCostType>& cheapestPathsCosts);
+
   /// Find a transform path between the specified coordinate frames.
   /// \param sourceRepresentationName representation to convert from
   /// \param targetRepresentationName representation to convert to
@@ -172,6 +219,17 @@ protected:
 
   /// Source representation to target representation rule graph
   RepresentationToRepresentationToRuleMapType RulesGraph;
+
+  /// Cheapest path and cost for each source (first) and target (second) representation
+  typedef std::map<std::string, std::map<std::string, ConversionPathAndCostType> > CheapestPathTableType;
+  /// Cheapest paths between all pairs of representations, using data-independent costs
+  CheapestPathTableType CheapestPathTable;
+  /// Time when the cheapest path table was computed. Recomputed if any rule is modified later (e.g. cost model calibrated)
+  vtkTimeStamp CheapestPathTableTime;
+
+  /// Cache of all possible conversion paths for each source and target representation pair
+  typedef std::map<std::pair<std::string, std::string>, ConversionPathAndCostListType> PossibleConversionsCacheType;
+  PossibleConversionsCacheType PossibleConversionsCache;
 };
 
 #endif // __vtkSegmentationConverter_h
@@ -20,12 +20,26 @@
 
 // Segmentations includes
 #include "vtkSegmentationConverterRule.h"
+#include "vtkSegmentationConverter.h"
+#include "vtkOrientedImageData.h"
 
 // VTK includes
 #include <vtkObjectFactory.h>
+#include <vtkDataSet.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <sstream>
 
 //----------------------------------------------------------------------------
 vtkSegmentationConverterRule::vtkSegmentationConverterRule()
+  : NumberOfConversionTimeMeasurements(0)
+  , SumOfInputSizes(0.0)
+  , SumOfSquaredInputSizes(0.0)
+  , SumOfConversionTimes(0.0)
+  , SumOfInputSizeConversionTimeProducts(0.0)
 {
 }
 
@@ -33,6 +47,8 @@ vtkSegmentationConverterRule::vtkSegmentationConverterRule()
 vtkSegmentationConverterRule::~vtkSegmentationConverterRule()
 {
   this->ConversionParameters.clear();
+  this->ParsedDoubleConversionParameters.clear();
+  this->ParsedImageGeometryConversionParameters.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -40,9 +56,107 @@ vtkSegmentationConverterRule* vtkSegmentationConverterRule::Clone()
 {
   vtkSegmentationConverterRule* clone = this->CreateRuleInstance();
   clone->ConversionParameters = this->ConversionParameters;
+  clone->NumberOfConversionTimeMeasurements = this->NumberOfConversionTimeMeasurements;
+  clone->SumOfInputSizes = this->SumOfInputSizes;
+  clone->SumOfSquaredInputSizes = this->SumOfSquaredInputSizes;
+  clone->SumOfConversionTimes = this->SumOfConversionTimes;
+  clone->SumOfInputSizeConversionTimeProducts = this->SumOfInputSizeConversionTimeProducts;
   return clone;
 }
 
+//----------------------------------------------------------------------------
+double vtkSegmentationConverterRule::GetRepresentationSize(vtkDataObject* representation)
+{
+  // Number of points of an image data is the number of voxels
+  vtkDataSet* dataSet = vtkDataSet::SafeDownCast(representation);
+  if (!dataSet)
+  {
+    return 0.0;
+  }
+  return (double)dataSet->GetNumberOfPoints();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationConverterRule::AddConversionTimeMeasurement(double inputSize, double conversionTime)
+{
+  if (inputSize < 0.0 || conversionTime < 0.0)
+  {
+    return;
+  }
+
+  this->NumberOfConversionTimeMeasurements++;
+  this->SumOfInputSizes += inputSize;
+  this->SumOfSquaredInputSizes += inputSize * inputSize;
+  this->SumOfConversionTimes += conversionTime;
+  this->SumOfInputSizeConversionTimeProducts += inputSize * conversionTime;
+
+  // Cost changes, so converters need to update their conversion path tables
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationConverterRule::ResetConversionTimeMeasurements()
+{
+  this->NumberOfConversionTimeMeasurements = 0;
+  this->SumOfInputSizes = 0.0;
+  this->SumOfSquaredInputSizes = 0.0;
+  this->SumOfConversionTimes = 0.0;
+  this->SumOfInputSizeConversionTimeProducts = 0.0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkSegmentationConverterRule::EstimateConversionCost(vtkDataObject* sourceRepresentation, unsigned int defaultCost)
+{
+  if (this->NumberOfConversionTimeMeasurements == 0)
+  {
+    return defaultCost;
+  }
+
+  double numberOfMeasurements = (double)this->NumberOfConversionTimeMeasurements;
+  double meanInputSize = this->SumOfInputSizes / numberOfMeasurements;
+  double meanConversionTime = this->SumOfConversionTimes / numberOfMeasurements;
+  double estimatedCost = meanConversionTime;
+
+  // Fit conversion time = constantCost + costPerElement * inputSize if the measurements
+  // were made on inputs of different sizes, otherwise use the average conversion time
+  double inputSizeVariance = this->SumOfSquaredInputSizes / numberOfMeasurements - meanInputSize * meanInputSize;
+  if (sourceRepresentation && inputSizeVariance > 1.0)
+  {
+    double covariance = this->SumOfInputSizeConversionTimeProducts / numberOfMeasurements - meanInputSize * meanConversionTime;
+    double costPerElement = covariance / inputSizeVariance;
+    if (costPerElement > 0.0)
+    {
+      double constantCost = std::max(0.0, meanConversionTime - costPerElement * meanInputSize);
+      estimatedCost = constantCost + costPerElement * vtkSegmentationConverterRule::GetRepresentationSize(sourceRepresentation);
+    }
+  }
+
+  // Keep the estimate below the cost of disabled rules, and above zero so that paths with fewer conversions are preferred
+  estimatedCost = std::min(estimatedCost, (double)(vtkSegmentationConverterRule::GetConversionInfiniteCost() - 1));
+  return std::max(1u, (unsigned int)(estimatedCost + 0.5));
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentationConverterRule::ConvertMultiple(std::vector<vtkDataObject*>& sourceRepresentations, std::vector<vtkDataObject*>& targetRepresentations)
+{
+  if (sourceRepresentations.size() != targetRepresentations.size())
+  {
+    vtkErrorMacro("ConvertMultiple: Number of source and target representations differ!");
+    return false;
+  }
+
+  bool success = true;
+  for (unsigned int index=0; index<sourceRepresentations.size(); ++index)
+  {
+    if (!this->Convert(sourceRepresentations[index], targetRepresentations[index]))
+    {
+      success = false;
+    }
+  }
+  return success;
+}
+
 //----------------------------------------------------------------------------
 void vtkSegmentationConverterRule::GetRuleConversionParameters(ConversionParameterListType& conversionParameters)
 {
@@ -82,3 +196,85 @@ bool vtkSegmentationConverterRule::HasConversionParameter(const std::string& nam
 {
   return (this->ConversionParameters.count(name) > 0);
 }
+
+//----------------------------------------------------------------------------
+bool vtkSegmentationConverterRule::GetConversionParameterAsDouble(const std::string& name, double& value)
+{
+  const std::string& parameterString = this->ConversionParameters[name].first;
+  std::map<std::string, std::pair<std::string, double> >::iterator parsedIt = this->ParsedDoubleConversionParameters.find(name);
+  if (parsedIt != this->ParsedDoubleConversionParameters.end() && parsedIt->second.first == parameterString)
+  {
+    value = parsedIt->second.second;
+    return true;
+  }
+
+  std::stringstream ss;
+  ss << parameterString;
+  double parsedValue = 0.0;
+  ss >> parsedValue;
+  if (parameterString.empty() || ss.fail())
+  {
+    return false;
+  }
+
+  this->ParsedDoubleConversionParameters[name] = std::make_pair(parameterString, parsedValue);
+  value = parsedValue;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentationConverterRule::GetConversionParameterAsImageGeometry(const std::string& name, vtkOrientedImageData* geometryImageData)
+{
+  if (!geometryImageData)
+  {
+    return false;
+  }
+
+  const std::string& parameterString = this->ConversionParameters[name].first;
+  if (parameterString.empty())
+  {
+    return false;
+  }
+
+  // Parse the parameter only if it has changed since it was last parsed
+  ParsedImageGeometry& parsedGeometry = this->ParsedImageGeometryConversionParameters[name];
+  vtkSmartPointer<vtkMatrix4x4> geometryMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (parsedGeometry.ParsedString != parameterString)
+  {
+    if (!vtkSegmentationConverter::DeserializeImageGeometry(parameterString, geometryMatrix, parsedGeometry.Extent))
+    {
+      this->ParsedImageGeometryConversionParameters.erase(name);
+      return false;
+    }
+    parsedGeometry.ParsedString = parameterString;
+    vtkMatrix4x4::DeepCopy(parsedGeometry.GeometryMatrix, geometryMatrix);
+  }
+  else
+  {
+    geometryMatrix->DeepCopy(parsedGeometry.GeometryMatrix);
+  }
+
+  geometryImageData->SetGeometryFromImageToWorldMatrix(geometryMatrix);
+  geometryImageData->SetExtent(parsedGeometry.Extent);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationConverterRule::SetConversionParameterAsImageGeometry(const std::string& name, vtkMatrix4x4* geometryMatrix, const int extent[6])
+{
+  if (!geometryMatrix)
+  {
+    return;
+  }
+
+  ParsedImageGeometry parsedGeometry;
+  parsedGeometry.ParsedString = vtkSegmentationConverter::SerializeImageGeometry(geometryMatrix, extent);
+  vtkMatrix4x4::DeepCopy(parsedGeometry.GeometryMatrix, geometryMatrix);
+  for (int i=0; i<6; ++i)
+  {
+    parsedGeometry.Extent[i] = extent[i];
+  }
+
+  this->ConversionParameters[name].first = parsedGeometry.ParsedString;
+  this->ParsedImageGeometryConversionParameters[name] = parsedGeometry;
+}
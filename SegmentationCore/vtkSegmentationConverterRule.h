@@ -29,8 +29,11 @@
 // STD includes
 #include <map>
 #include <string>
+#include <vector>
 
 class vtkDataObject;
+class vtkMatrix4x4;
+class vtkOrientedImageData;
 
 /// Helper macro for supporting cloning of rules
 #ifndef vtkSegmentationConverterRuleNewMacro
@@ -82,18 +85,41 @@ public:
 
   /// Update the target representation based on the source representation
   virtual bool Convert(vtkDataObject* sourceRepresentation, vtkDataObject* targetRepresentation) = 0;
+
+  /// Update the target representations of multiple segments based on their source representations.
+  /// The two lists need to be of the same size, the element with the same index belonging to the same segment.
+  /// The default implementation calls \sa Convert for each segment. Rules that can take advantage of
+  /// processing multiple segments together (e.g. one pass over a common geometry) may override it.
+  /// \return True if all conversions succeeded
+  virtual bool ConvertMultiple(std::vector<vtkDataObject*>& sourceRepresentations, std::vector<vtkDataObject*>& targetRepresentations);
   
   /// Get the cost of the conversion.
   /// \return Expected duration of the conversion in milliseconds. If the arguments are omitted, then a rough average can be
   ///   given just to indicate the relative computational cost of the algorithm. If the objects are given, then a more educated
   ///   guess can be made based on the object properties (dimensions, number of points, etc).
+  ///   The default implementation uses the cost model calibrated by the measured conversion times (\sa EstimateConversionCost)
   virtual unsigned int GetConversionCost(vtkDataObject* sourceRepresentation=NULL, vtkDataObject* targetRepresentation=NULL)
     {
-    (void)(sourceRepresentation); // unused
     (void)(targetRepresentation); // unused
-    return 100;
+    return this->EstimateConversionCost(sourceRepresentation, 100);
     };
 
+  /// Record the measured duration of a conversion performed by this rule to calibrate its cost model.
+  /// \param inputSize Size of the source representation (\sa GetRepresentationSize). If multiple segments
+  ///   were converted together, then it is the average size and the duration is the average duration
+  /// \param conversionTime Duration of the conversion in milliseconds
+  void AddConversionTimeMeasurement(double inputSize, double conversionTime);
+
+  /// Forget all measured conversion times, so that the default cost is used again
+  void ResetConversionTimeMeasurements();
+
+  /// Get number of conversion time measurements that the cost model is calibrated with
+  vtkGetMacro(NumberOfConversionTimeMeasurements, unsigned int);
+
+  /// Get the size of a representation object used by the cost model:
+  /// number of voxels for images, number of points for poly data, 0 otherwise
+  static double GetRepresentationSize(vtkDataObject* representation);
+
   /// Human-readable name of the converter rule
   virtual const char* GetName() = 0;
   
@@ -119,11 +145,32 @@ public:
   /// Determine if the rule has a parameter with a certain name
   bool HasConversionParameter(const std::string& name);
 
+  /// Get a conversion parameter value as a floating point number.
+  /// The parsed value is cached, so the string is only parsed again if the parameter has changed.
+  /// \return Success flag. False if the parameter is empty or is not a number
+  bool GetConversionParameterAsDouble(const std::string& name, double& value);
+
+  /// Get an image geometry conversion parameter (e.g. \sa vtkSegmentationConverter::GetReferenceImageGeometryParameterName).
+  /// The parsed geometry is cached, so the string is only parsed again if the parameter has changed.
+  /// \param geometryImageData Oriented image data whose geometry and extent are set from the parameter
+  /// \return Success flag. False if the parameter is empty or cannot be parsed
+  bool GetConversionParameterAsImageGeometry(const std::string& name, vtkOrientedImageData* geometryImageData);
+
+  /// Set an image geometry conversion parameter. The parameter string is serialized right away,
+  /// and the geometry is cached so that it does not need to be parsed when used
+  void SetConversionParameterAsImageGeometry(const std::string& name, vtkMatrix4x4* geometryMatrix, const int extent[6]);
+
 protected:
   vtkSegmentationConverterRule();
   ~vtkSegmentationConverterRule();
   void operator=(const vtkSegmentationConverterRule&);
 
+  /// Estimate the cost of the conversion using a linear model (constant cost plus cost per input element)
+  /// fitted to the measured conversion times. Subclasses should call it from \sa GetConversionCost.
+  /// \param sourceRepresentation Source representation. If omitted, then the average measured conversion time is returned
+  /// \param defaultCost Cost returned if no conversion times have been measured yet
+  unsigned int EstimateConversionCost(vtkDataObject* sourceRepresentation, unsigned int defaultCost);
+
 protected:
   /// Dictionary of conversion parameters in form of name -> default value, description.
   /// Each conversion rule defines its required/possible conversion parameters,
@@ -132,6 +179,26 @@ protected:
   /// custom value, but for new segmentations, it is initially the default.
   ConversionParameterListType ConversionParameters;
 
+  /// Parsed floating point conversion parameters: name -> (parameter string the value was parsed from, value)
+  std::map<std::string, std::pair<std::string, double> > ParsedDoubleConversionParameters;
+
+  /// Parsed image geometry conversion parameter. Valid as long as the parameter string equals the parsed string
+  struct ParsedImageGeometry
+  {
+    std::string ParsedString;
+    double GeometryMatrix[16];
+    int Extent[6];
+  };
+  /// Parsed image geometry conversion parameters by name
+  std::map<std::string, ParsedImageGeometry> ParsedImageGeometryConversionParameters;
+
+  /// Sums for the least squares fit of the conversion time to the input size (cost model)
+  unsigned int NumberOfConversionTimeMeasurements;
+  double SumOfInputSizes;
+  double SumOfSquaredInputSizes;
+  double SumOfConversionTimes;
+  double SumOfInputSizeConversionTimeProducts;
+
   friend class vtkSegmentationConverter;
 };
 
@@ -27,6 +27,24 @@
 #include <vtkPolyDataCollection.h>
 #include <vtkIntArray.h>
 
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Orders poly data indices by the minimum X coordinate of their bounding boxes
+  struct BoundsMinimumXLess
+  {
+    BoundsMinimumXLess(const std::vector<double>& bounds) : Bounds(bounds) { };
+    bool operator()(unsigned int index1, unsigned int index2) const
+    {
+      return this->Bounds[6*index1] < this->Bounds[6*index2];
+    }
+    const std::vector<double>& Bounds;
+  };
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTopologicalHierarchy);
 
@@ -44,6 +62,9 @@ vtkTopologicalHierarchy::vtkTopologicalHierarchy()
   this->ContainConstraintFactor = 0.0;
 
   this->MaximumLevel = 7;
+
+  this->LastContainConstraintFactor = 0.0;
+  this->LastOutputLevelsMTime = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -68,7 +89,7 @@ vtkIntArray* vtkTopologicalHierarchy::GetOutputLevels()
 //----------------------------------------------------------------------------
 bool vtkTopologicalHierarchy::Contains(vtkPolyData* polyOut, vtkPolyData* polyIn)
 {
-  if (!polyOut || !polyOut)
+  if (!polyOut || !polyIn)
   {
     vtkErrorMacro("Contains: Empty input parameters!");
     return false;
@@ -80,6 +101,12 @@ bool vtkTopologicalHierarchy::Contains(vtkPolyData* polyOut, vtkPolyData* polyIn
   double extentIn[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
   polyIn->GetBounds(extentIn);
 
+  return this->ContainsBounds(extentOut, extentIn);
+}
+
+//----------------------------------------------------------------------------
+bool vtkTopologicalHierarchy::ContainsBounds(const double extentOut[6], const double extentIn[6])
+{
   if ( extentOut[0] < extentIn[0] - this->ContainConstraintFactor * (extentOut[1]-extentOut[0])
     && extentOut[1] > extentIn[1] + this->ContainConstraintFactor * (extentOut[1]-extentOut[0])
     && extentOut[2] < extentIn[2] - this->ContainConstraintFactor * (extentOut[3]-extentOut[2])
@@ -93,6 +120,31 @@ bool vtkTopologicalHierarchy::Contains(vtkPolyData* polyOut, vtkPolyData* polyIn
   return false;
 }
 
+//----------------------------------------------------------------------------
+bool vtkTopologicalHierarchy::IsOutputUpToDate()
+{
+  unsigned int numberOfPolyData = this->InputPolyDataCollection->GetNumberOfItems();
+  if ( this->LastInputPolyDataMTimes.size() != numberOfPolyData
+    || this->LastContainConstraintFactor != this->ContainConstraintFactor
+    || this->LastOutputLevelsMTime != this->OutputLevels->GetMTime()
+    || this->OutputLevels->GetNumberOfTuples() != static_cast<vtkIdType>(numberOfPolyData) )
+  {
+    return false;
+  }
+
+  for (unsigned int polyIndex=0; polyIndex<numberOfPolyData; ++polyIndex)
+  {
+    vtkPolyData* poly = vtkPolyData::SafeDownCast(this->InputPolyDataCollection->GetItemAsObject(polyIndex));
+    if ( !poly || poly != this->LastInputPolyDataMTimes[polyIndex].first
+      || poly->GetMTime() != this->LastInputPolyDataMTimes[polyIndex].second )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkTopologicalHierarchy::Update()
 {
@@ -102,10 +154,19 @@ void vtkTopologicalHierarchy::Update()
     return;
   }
 
+  // Nothing to do if the inputs have not changed since the last update
+  if (this->IsOutputUpToDate())
+  {
+    return;
+  }
+
+  this->LastInputPolyDataMTimes.clear();
   this->OutputLevels->Initialize();
   unsigned int numberOfPolyData = this->InputPolyDataCollection->GetNumberOfItems();
 
-  // Check input polydata collection
+  // Check input polydata collection and get the bounding boxes
+  std::vector<double> bounds(6*numberOfPolyData, 0.0);
+  std::vector<std::pair<vtkPolyData*, unsigned long> > inputPolyDataMTimes(numberOfPolyData);
   for (unsigned int polyOutIndex=0; polyOutIndex<numberOfPolyData; ++polyOutIndex)
   {
     vtkPolyData* polyOut = vtkPolyData::SafeDownCast(this->InputPolyDataCollection->GetItemAsObject(polyOutIndex));
@@ -114,6 +175,32 @@ void vtkTopologicalHierarchy::Update()
       vtkErrorMacro("Update: Input collection contains invalid object at item " << polyOutIndex);
       return;
     }
+    polyOut->GetBounds(&(bounds[6*polyOutIndex]));
+    inputPolyDataMTimes[polyOutIndex] = std::make_pair(polyOut, polyOut->GetMTime());
+  }
+
+  // Sort the poly data with valid bounds by the minimum X coordinate, so that for each poly data only
+  // the ones with X range inside its own X range need to be checked for containment. Empty poly data
+  // (with uninitialized bounds) cannot be sorted this way, they are checked against every poly data.
+  std::vector<unsigned int> sortedIndices;
+  std::vector<unsigned int> invalidBoundsIndices;
+  for (unsigned int polyIndex=0; polyIndex<numberOfPolyData; ++polyIndex)
+  {
+    const double* currentBounds = &(bounds[6*polyIndex]);
+    if (currentBounds[0] > currentBounds[1] || currentBounds[2] > currentBounds[3] || currentBounds[4] > currentBounds[5])
+    {
+      invalidBoundsIndices.push_back(polyIndex);
+    }
+    else
+    {
+      sortedIndices.push_back(polyIndex);
+    }
+  }
+  std::sort(sortedIndices.begin(), sortedIndices.end(), BoundsMinimumXLess(bounds));
+  std::vector<double> sortedMinimumX(sortedIndices.size());
+  for (unsigned int sortedIndex=0; sortedIndex<sortedIndices.size(); ++sortedIndex)
+  {
+    sortedMinimumX[sortedIndex] = bounds[6*sortedIndices[sortedIndex]];
   }
 
   std::vector<std::vector<int> > containedPolyData(numberOfPolyData);
@@ -122,23 +209,28 @@ void vtkTopologicalHierarchy::Update()
   this->OutputLevels->FillComponent(0, -1);
 
   // Step 1: Set level of polydata containing no other polydata to 0
-  this->InputPolyDataCollection->InitTraversal();
   for (unsigned int polyOutIndex=0; polyOutIndex<numberOfPolyData; ++polyOutIndex)
   {
-    vtkPolyData* polyOut = vtkPolyData::SafeDownCast(this->InputPolyDataCollection->GetItemAsObject(polyOutIndex));
-
-    for (unsigned int polyInIndex=0; polyInIndex<numberOfPolyData; ++polyInIndex)
+    const double* boundsOut = &(bounds[6*polyOutIndex]);
+
+    // Contained poly data must have its minimum X in the open range (lowerX, upperX)
+    double gapX = this->ContainConstraintFactor * (boundsOut[1]-boundsOut[0]);
+    double lowerX = boundsOut[0] + gapX;
+    double upperX = boundsOut[1] - gapX;
+    unsigned int sortedIndex = std::upper_bound(sortedMinimumX.begin(), sortedMinimumX.end(), lowerX) - sortedMinimumX.begin();
+    for ( ; sortedIndex < sortedIndices.size() && sortedMinimumX[sortedIndex] < upperX; ++sortedIndex)
     {
-      if (polyOutIndex==polyInIndex)
+      unsigned int polyInIndex = sortedIndices[sortedIndex];
+      if (polyInIndex != polyOutIndex && this->ContainsBounds(boundsOut, &(bounds[6*polyInIndex])))
       {
-        continue;
+        containedPolyData[polyOutIndex].push_back(polyInIndex);
       }
-
-      vtkPolyData* polyIn = vtkPolyData::SafeDownCast(this->InputPolyDataCollection->GetItemAsObject(polyInIndex));
-
-      if (this->Contains(polyOut, polyIn))
+    }
+    for (std::vector<unsigned int>::iterator invalidIt = invalidBoundsIndices.begin(); invalidIt != invalidBoundsIndices.end(); ++invalidIt)
+    {
+      if ((*invalidIt) != polyOutIndex && this->ContainsBounds(boundsOut, &(bounds[6*(*invalidIt)])))
       {
-        containedPolyData[polyOutIndex].push_back(polyInIndex);
+        containedPolyData[polyOutIndex].push_back(*invalidIt);
       }
     }
 
@@ -169,26 +261,9 @@ void vtkTopologicalHierarchy::Update()
       //   The level that is to be set cannot be lower than the current level value, because then we would
       //   already have assigned it in the previous iterations.
       bool allContainedPolydataHasLevelValueAssigned = true;
-      for (unsigned int polyInIndex=0; polyInIndex<numberOfPolyData; ++polyInIndex)
+      for (std::vector<int>::iterator it=containedPolyData[polyOutIndex].begin(); it!=containedPolyData[polyOutIndex].end(); ++it)
       {
-        if (polyOutIndex==polyInIndex)
-        {
-          continue;
-        }
-        bool isContained = false;
-        for (std::vector<int>::iterator it=containedPolyData[polyOutIndex].begin(); it!=containedPolyData[polyOutIndex].end(); ++it)
-        {
-          if ((*it) == polyInIndex)
-          {
-            isContained = true;
-          }
-        }
-        if (!isContained)
-        {
-          continue;
-        }
-
-        if (outputLevelsSnapshot->GetValue(polyInIndex) == -1)
+        if (outputLevelsSnapshot->GetValue(*it) == -1)
         {
           allContainedPolydataHasLevelValueAssigned = false;
           break;
@@ -212,6 +287,12 @@ void vtkTopologicalHierarchy::Update()
       this->OutputLevels->SetValue(polyOutIndex, this->MaximumLevel);
     }
   }
+
+  // Store inputs of the computed hierarchy
+  this->OutputLevels->Modified();
+  this->LastInputPolyDataMTimes = inputPolyDataMTimes;
+  this->LastContainConstraintFactor = this->ContainConstraintFactor;
+  this->LastOutputLevelsMTime = this->OutputLevels->GetMTime();
 }
 
 //----------------------------------------------------------------------------
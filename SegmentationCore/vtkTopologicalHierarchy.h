@@ -30,6 +30,9 @@
 
 #include "vtkSegmentationCoreConfigure.h"
 
+// STD includes
+#include <vector>
+
 class vtkIntArray;
 
 //BTX
@@ -57,6 +60,8 @@ public:
   /// their bounding boxes.
   /// This function has to be explicitly called!
   /// Output can be get using GetOutputLevels()
+  /// The levels are not recomputed if the input poly data objects (and their modified times)
+  /// and the constraint factor are the same as in the last update.
   virtual void Update();
 
   /// Set input poly data collection
@@ -76,6 +81,13 @@ protected:
   /// /sa ContainConstraintFactor
   bool Contains(vtkPolyData* polyOut, vtkPolyData* polyIn);
 
+  /// Determines if the bounding box boundsOut contains boundsIn considering the constraint factor
+  /// /sa ContainConstraintFactor
+  bool ContainsBounds(const double boundsOut[6], const double boundsIn[6]);
+
+  /// Determines if the input poly data and parameters are the same as in the last update
+  bool IsOutputUpToDate();
+
   /// Determines if there are empty entries in the output level array
   bool OutputContainsEmptyLevels();
 
@@ -99,6 +111,16 @@ protected:
   /// Maximum level that can be assigned to a poly data
   unsigned int MaximumLevel;
 
+  /// Input poly data objects and their modified times at the last update. Used to skip
+  /// recomputing the hierarchy if the inputs have not changed
+  std::vector<std::pair<vtkPolyData*, unsigned long> > LastInputPolyDataMTimes;
+
+  /// Constraint factor used in the last update
+  double LastContainConstraintFactor;
+
+  /// Modified time of the output level array after the last update
+  unsigned long LastOutputLevelsMTime;
+
 protected:
   vtkTopologicalHierarchy();
   ~vtkTopologicalHierarchy();
@@ -828,6 +828,9 @@ bool vtkSlicerSegmentationsModuleLogic::ImportLabelmapToSegmentationNode(vtkMRML
   //TODO: pending resolution of bug http://www.na-mic.org/Bug/view.php?id=1822,
   //   run the thresholding in single threaded mode to avoid data corruption observed on mac release builds
   threshold->SetNumberOfThreads(1);
+
+  // Observers are notified about the imported segments at once
+  segmentationNode->GetSegmentation()->StartBatch();
   for (int label = lowLabel; label <= highLabel; ++label)
   {
 #if (VTK_MAJOR_VERSION <= 5)
@@ -898,6 +901,7 @@ bool vtkSlicerSegmentationsModuleLogic::ImportLabelmapToSegmentationNode(vtkMRML
 
     segmentationNode->GetSegmentation()->AddSegment(segment);
   } // for each label
+  segmentationNode->GetSegmentation()->EndBatch();
 
   return true;
 }
@@ -911,11 +915,12 @@ vtkDataObject* vtkSlicerSegmentationsModuleLogic::CreateRepresentationForOneSegm
     return NULL;
   }
 
-  // Temporarily duplicate selected segment to only convert them, not the whole segmentation (to save time)
+  // Temporarily duplicate selected segment to only convert them, not the whole segmentation (to save time).
+  // Conversion does not modify the source representation, so the copy can share the data with the segment
   vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
   segmentationCopy->SetMasterRepresentationName(segmentation->GetMasterRepresentationName());
   segmentationCopy->CopyConversionParameters(segmentation);
-  segmentationCopy->CopySegmentFromSegmentation(segmentation, segmentID);
+  segmentationCopy->CopySegmentFromSegmentation(segmentation, segmentID, false, true);
   if (!segmentationCopy->CreateRepresentation(representationName, true))
   {
     vtkErrorWithObjectMacro(segmentation, "CreateRepresentationForOneSegment: Failed to convert segment " << segmentID << " to " << representationName);
@@ -939,7 +944,7 @@ vtkDataObject* vtkSlicerSegmentationsModuleLogic::CreateRepresentationForOneSegm
 }
 
 //-----------------------------------------------------------------------------
-bool vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(vtkMRMLTransformableNode* transformableNode, vtkOrientedImageData* orientedImageData)
+bool vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(vtkMRMLTransformableNode* transformableNode, vtkOrientedImageData* orientedImageData, bool deferResampling/*=false*/)
 {
   if (!transformableNode || !orientedImageData)
   {
@@ -961,7 +966,14 @@ bool vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(
   }
 
   // Transform oriented image data
-  vtkOrientedImageDataResample::TransformOrientedImage(orientedImageData, nodeToWorldTransform);
+  if (deferResampling)
+  {
+    vtkOrientedImageDataResample::TransformOrientedImageDeferred(orientedImageData, nodeToWorldTransform);
+  }
+  else
+  {
+    vtkOrientedImageDataResample::TransformOrientedImage(orientedImageData, nodeToWorldTransform);
+  }
 
   return true;
 }
@@ -143,13 +143,18 @@ public:
   /// Useful if only one segment is processed, and we do not want to convert all segments to a certain
   /// segmentation to save time.
   /// Note: Need to take ownership of the created object! For example using vtkSmartPointer<vtkDataObject>::Take
+  /// Note: If the segment already contains the representation, then the returned object shares its data. Call
+  ///   \sa vtkSegment::DetachSharedRepresentationData on it before modifying it in place.
   /// \return Representation of the specified segment if found or can be created, NULL otherwise
   static vtkDataObject* CreateRepresentationForOneSegment(vtkSegmentation* segmentation, std::string segmentID, std::string representationName);
 
   /// Apply the parent transform of a node to an oriented image data.
   /// Useful if we want to get a labelmap representation of a segmentation in the proper geometry for processing.
+  /// \param deferResampling If true, then a non-linear transform is only recorded on the image and applied in the next resampling
+  ///   (\sa vtkOrientedImageDataResample::TransformOrientedImageDeferred), so that the voxels are interpolated only once.
+  ///   Only use it if the image is resampled afterwards. False by default
   /// \return Success flag
-  static bool ApplyParentTransformToOrientedImageData(vtkMRMLTransformableNode* transformableNode, vtkOrientedImageData* orientedImageData);
+  static bool ApplyParentTransformToOrientedImageData(vtkMRMLTransformableNode* transformableNode, vtkOrientedImageData* orientedImageData, bool deferResampling=false);
 
   /// Get transform between a representation node (e.g. labelmap or model) and a segmentation node.
   /// Useful if we want to add a representation to a segment, and we want to make sure that the segment will be located the same place
@@ -50,7 +50,12 @@ vtkMRMLSegmentationDisplayNode::vtkMRMLSegmentationDisplayNode()
 {
   this->PreferredPolyDataDisplayRepresentationName = NULL;
   this->EnableTransparencyInColorTable = false;
+  this->Visibility2DFill = true;
+  this->Visibility2DOutline = true;
+  this->Opacity2DFill = 0.5;
+  this->Opacity2DOutline = 1.0;
   this->SliceIntersectionVisibility = true;
+  this->TopologicalHierarchy = vtkTopologicalHierarchy::New();
 
   this->SegmentationDisplayProperties.clear();
 }
@@ -60,6 +65,12 @@ vtkMRMLSegmentationDisplayNode::~vtkMRMLSegmentationDisplayNode()
 {
   this->SetPreferredPolyDataDisplayRepresentationName(NULL);
   this->SegmentationDisplayProperties.clear();
+
+  if (this->TopologicalHierarchy)
+  {
+    this->TopologicalHierarchy->Delete();
+    this->TopologicalHierarchy = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -72,6 +83,11 @@ void vtkMRMLSegmentationDisplayNode::WriteXML(ostream& of, int nIndent)
 
   of << indent << " EnableTransparencyInColorTable=\"" << (this->EnableTransparencyInColorTable ? "true" : "false") << "\"";
 
+  of << indent << " Visibility2DFill=\"" << (this->Visibility2DFill ? "true" : "false") << "\"";
+  of << indent << " Visibility2DOutline=\"" << (this->Visibility2DOutline ? "true" : "false") << "\"";
+  of << indent << " Opacity2DFill=\"" << this->Opacity2DFill << "\"";
+  of << indent << " Opacity2DOutline=\"" << this->Opacity2DOutline << "\"";
+
   of << indent << " SegmentationDisplayProperties=\"";
   for (SegmentDisplayPropertiesMap::iterator propIt = this->SegmentationDisplayProperties.begin();
     propIt != this->SegmentationDisplayProperties.end(); ++propIt)
@@ -110,6 +126,26 @@ void vtkMRMLSegmentationDisplayNode::ReadXMLAttributes(const char** atts)
     {
       this->EnableTransparencyInColorTable = (strcmp(attValue,"true") ? false : true);
     }
+    else if (!strcmp(attName, "Visibility2DFill")) 
+    {
+      this->Visibility2DFill = (strcmp(attValue,"true") ? false : true);
+    }
+    else if (!strcmp(attName, "Visibility2DOutline")) 
+    {
+      this->Visibility2DOutline = (strcmp(attValue,"true") ? false : true);
+    }
+    else if (!strcmp(attName, "Opacity2DFill")) 
+    {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->Opacity2DFill;
+    }
+    else if (!strcmp(attName, "Opacity2DOutline")) 
+    {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->Opacity2DOutline;
+    }
     else if (!strcmp(attName, "SegmentationDisplayProperties")) 
     {
       std::stringstream ss;
@@ -159,6 +195,11 @@ void vtkMRMLSegmentationDisplayNode::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << " EnableTransparencyInColorTable:   " << (this->EnableTransparencyInColorTable ? "true" : "false") << "\n";
 
+  os << indent << " Visibility2DFill:   " << (this->Visibility2DFill ? "true" : "false") << "\n";
+  os << indent << " Visibility2DOutline:   " << (this->Visibility2DOutline ? "true" : "false") << "\n";
+  os << indent << " Opacity2DFill:   " << this->Opacity2DFill << "\n";
+  os << indent << " Opacity2DOutline:   " << this->Opacity2DOutline << "\n";
+
   os << indent << " SegmentationDisplayProperties:\n";
   for (SegmentDisplayPropertiesMap::iterator propIt = this->SegmentationDisplayProperties.begin();
     propIt != this->SegmentationDisplayProperties.end(); ++propIt)
@@ -456,10 +497,9 @@ bool vtkMRMLSegmentationDisplayNode::CalculateAutoOpacitiesForSegments()
     
 
   // Set opacities according to topological hierarchy levels
-  vtkSmartPointer<vtkTopologicalHierarchy> topologicalHierarchy = vtkSmartPointer<vtkTopologicalHierarchy>::New();
-  topologicalHierarchy->SetInputPolyDataCollection(segmentPolyDataCollection);
-  topologicalHierarchy->Update();
-  vtkIntArray* levels = topologicalHierarchy->GetOutputLevels();
+  this->TopologicalHierarchy->SetInputPolyDataCollection(segmentPolyDataCollection);
+  this->TopologicalHierarchy->Update();
+  vtkIntArray* levels = this->TopologicalHierarchy->GetOutputLevels();
 
   // Determine number of levels
   int numberOfLevels = 0;
@@ -23,6 +23,7 @@
 
 class vtkMRMLColorTableNode;
 class vtkVector3d;
+class vtkTopologicalHierarchy;
 
 /// \ingroup Segmentations
 /// \brief MRML node for representing segmentation display attributes.
@@ -86,6 +87,22 @@ public:
   /// Set enable transparency flag boolean functions
   vtkBooleanMacro(EnableTransparencyInColorTable, bool);
 
+  /// Get/Set visibility of the segment fill in slice views.
+  /// The fill is only shown if the segments are displayed from the binary labelmap in the slice views.
+  vtkGetMacro(Visibility2DFill, bool);
+  vtkSetMacro(Visibility2DFill, bool);
+  vtkBooleanMacro(Visibility2DFill, bool);
+  /// Get/Set visibility of the segment outline (slice intersection) in slice views
+  vtkGetMacro(Visibility2DOutline, bool);
+  vtkSetMacro(Visibility2DOutline, bool);
+  vtkBooleanMacro(Visibility2DOutline, bool);
+  /// Get/Set opacity of the segment fill in slice views
+  vtkGetMacro(Opacity2DFill, double);
+  vtkSetClampMacro(Opacity2DFill, double, 0.0, 1.0);
+  /// Get/Set opacity of the segment outline in slice views
+  vtkGetMacro(Opacity2DOutline, double);
+  vtkSetClampMacro(Opacity2DOutline, double, 0.0, 1.0);
+
 public:
   /// Create color table node for segmentation
   /// First two values are fixed: 0=Background, 1=Invalid
@@ -172,6 +189,18 @@ protected:
   /// Flag determining whether transparency is allowed in the color table
   /// (thus the merged labelmap)
   bool EnableTransparencyInColorTable;
+
+  /// Flags determining whether the fill and the outline of the segments are shown in slice views
+  bool Visibility2DFill;
+  bool Visibility2DOutline;
+
+  /// Opacity of the fill and the outline of the segments in slice views
+  double Opacity2DFill;
+  double Opacity2DOutline;
+
+  /// Topological hierarchy used for calculating automatic opacities. Kept so that the hierarchy
+  /// is only recomputed if the segment poly data have changed since the last calculation
+  vtkTopologicalHierarchy* TopologicalHierarchy;
 };
 
 #endif
@@ -46,6 +46,8 @@ Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
 #include <vtkHomogeneousTransform.h>
 #include <vtkTransform.h>
 #include <vtkLookupTable.h>
+#include <vtkMultiThreader.h>
+#include <vtkPointData.h>
 
 // STD includes
 #include <algorithm>
@@ -57,6 +59,224 @@ Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
 
 // STD includes
 #include <algorithm>
+#include <cstring>
+#include <map>
+
+// Minimum number of merged labelmap voxels per thread when painting segments into the merged labelmap
+static const vtkIdType MINIMUM_NUMBER_OF_MERGED_VOXELS_PER_THREAD = 262144;
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Segment labelmap to be painted into the merged labelmap
+  struct MergedSegment
+  {
+    vtkSmartPointer<vtkOrientedImageData> Labelmap;
+    /// Painted region: effective extent of the labelmap clipped to the merged labelmap extent
+    int Extent[6];
+    unsigned short Label;
+  };
+
+  /// Data shared by the threads painting the merged labelmap (\sa PaintMergedLabelmapThreadFunction)
+  struct MergedLabelmapPaintData
+  {
+    vtkImageData* MergedImage;
+    std::vector<MergedSegment>* Segments;
+    /// Region of the merged labelmap to paint. Segment extents are within this region
+    int PaintExtent[6];
+    int NumberOfSlabs;
+  };
+
+  //----------------------------------------------------------------------------
+  /// Extend an extent to contain another one
+  void UnionExtent(int extent[6], const int otherExtent[6])
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      extent[2*axis] = std::min(extent[2*axis], otherExtent[2*axis]);
+      extent[2*axis+1] = std::max(extent[2*axis+1], otherExtent[2*axis+1]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Clip an extent to a clipping extent. Returns false if the clipped extent is empty
+  bool ClipExtent(int extent[6], const int clipExtent[6])
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      extent[2*axis] = std::max(extent[2*axis], clipExtent[2*axis]);
+      extent[2*axis+1] = std::min(extent[2*axis+1], clipExtent[2*axis+1]);
+    }
+    return (extent[0] <= extent[1] && extent[2] <= extent[3] && extent[4] <= extent[5]);
+  }
+
+  //----------------------------------------------------------------------------
+  /// Determine if an extent contains another extent
+  bool ContainsExtent(const int extent[6], const int containedExtent[6])
+  {
+    for (int axis=0; axis<3; ++axis)
+    {
+      if (containedExtent[2*axis] < extent[2*axis] || containedExtent[2*axis+1] > extent[2*axis+1])
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// Fill a region of the merged labelmap with a label
+  void FillMergedLabelmap(vtkImageData* mergedImage, const int extent[6], unsigned short label)
+  {
+    int mergedExtent[6] = {0,-1,0,-1,0,-1};
+    mergedImage->GetExtent(mergedExtent);
+    bool unsignedShort = (mergedImage->GetScalarType() == VTK_UNSIGNED_SHORT);
+    vtkIdType rowLength = extent[1] - extent[0] + 1;
+    if ( extent[0] == mergedExtent[0] && extent[1] == mergedExtent[1]
+      && extent[2] == mergedExtent[2] && extent[3] == mergedExtent[3] )
+    {
+      // Region of whole slices is contiguous in memory
+      rowLength *= (vtkIdType)(extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+      void* regionPtr = mergedImage->GetScalarPointer(extent[0], extent[2], extent[4]);
+      if (unsignedShort)
+      {
+        std::fill_n(static_cast<unsigned short*>(regionPtr), rowLength, label);
+      }
+      else
+      {
+        memset(regionPtr, (unsigned char)label, rowLength);
+      }
+      return;
+    }
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        void* rowPtr = mergedImage->GetScalarPointer(extent[0], j, k);
+        if (unsignedShort)
+        {
+          std::fill_n(static_cast<unsigned short*>(rowPtr), rowLength, label);
+        }
+        else
+        {
+          memset(rowPtr, (unsigned char)label, rowLength);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class TSegment, class TMerged>
+  void PaintSegmentTemplate(vtkImageData* labelmap, TSegment* vtkNotUsed(segmentTypePtr), vtkImageData* mergedImage, TMerged* vtkNotUsed(mergedTypePtr),
+    int extent[6], TMerged label)
+  {
+    vtkIdType rowLength = extent[1] - extent[0] + 1;
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        TSegment* segmentRowPtr = static_cast<TSegment*>(labelmap->GetScalarPointer(extent[0], j, k));
+        TMerged* mergedRowPtr = static_cast<TMerged*>(mergedImage->GetScalarPointer(extent[0], j, k));
+        for (vtkIdType i = 0; i < rowLength; ++i)
+        {
+          if (segmentRowPtr[i] != 0)
+          {
+            mergedRowPtr[i] = label;
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Paint the non-zero voxels of a segment labelmap within an extent into the merged labelmap
+  template <class TMerged>
+  void PaintSegment(vtkImageData* labelmap, vtkImageData* mergedImage, TMerged* mergedTypePtr, int extent[6], unsigned short label)
+  {
+    switch (labelmap->GetScalarType())
+    {
+      case VTK_UNSIGNED_CHAR:
+        PaintSegmentTemplate(labelmap, (unsigned char*)NULL, mergedImage, mergedTypePtr, extent, static_cast<TMerged>(label));
+        break;
+      case VTK_UNSIGNED_SHORT:
+        PaintSegmentTemplate(labelmap, (unsigned short*)NULL, mergedImage, mergedTypePtr, extent, static_cast<TMerged>(label));
+        break;
+      case VTK_SHORT:
+        PaintSegmentTemplate(labelmap, (short*)NULL, mergedImage, mergedTypePtr, extent, static_cast<TMerged>(label));
+        break;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /// Paint all segments into a slab of slices of the merged labelmap. Segments are painted in order in each slab,
+  /// so segments later in the list overwrite earlier ones regardless of the number of threads
+  VTK_THREAD_RETURN_TYPE PaintMergedLabelmapThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    MergedLabelmapPaintData* data = static_cast<MergedLabelmapPaintData*>(threadInfo->UserData);
+    int slabIndex = threadInfo->ThreadID;
+    if (!data || slabIndex >= data->NumberOfSlabs)
+    {
+      return VTK_THREAD_RETURN_VALUE;
+    }
+
+    int numberOfSlices = data->PaintExtent[5] - data->PaintExtent[4] + 1;
+    int firstSlice = data->PaintExtent[4] + (int)((vtkIdType)numberOfSlices * slabIndex / data->NumberOfSlabs);
+    int lastSlice = data->PaintExtent[4] + (int)((vtkIdType)numberOfSlices * (slabIndex+1) / data->NumberOfSlabs) - 1;
+
+    for (std::vector<MergedSegment>::iterator segmentIt = data->Segments->begin(); segmentIt != data->Segments->end(); ++segmentIt)
+    {
+      int slabExtent[6] = { segmentIt->Extent[0], segmentIt->Extent[1], segmentIt->Extent[2], segmentIt->Extent[3],
+        std::max(segmentIt->Extent[4], firstSlice), std::min(segmentIt->Extent[5], lastSlice) };
+      if (slabExtent[4] > slabExtent[5])
+      {
+        continue;
+      }
+      if (data->MergedImage->GetScalarType() == VTK_UNSIGNED_SHORT)
+      {
+        PaintSegment(segmentIt->Labelmap, data->MergedImage, (unsigned short*)NULL, slabExtent, segmentIt->Label);
+      }
+      else
+      {
+        PaintSegment(segmentIt->Labelmap, data->MergedImage, (unsigned char*)NULL, slabExtent, segmentIt->Label);
+      }
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+class vtkMRMLSegmentationNode::vtkInternal
+{
+public:
+  /// Region of the merged labelmap painted by a segment, in the index space of the common labelmap geometry
+  struct PaintedSegment
+  {
+    unsigned short Label;
+    int Extent[6];
+  };
+  typedef std::map<std::string, PaintedSegment> PaintedSegmentMap;
+
+  vtkInternal()
+  {
+    this->Clear();
+  }
+
+  void Clear()
+  {
+    this->Valid = false;
+    this->CommonGeometryString.clear();
+    this->PaintedSegments.clear();
+  }
+
+  /// Set if the whole merged labelmap has been painted and the painted regions are recorded
+  bool Valid;
+  /// Geometry of the merged labelmap
+  std::string CommonGeometryString;
+  /// Painted regions of the visible, non-empty segments
+  PaintedSegmentMap PaintedSegments;
+};
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSegmentationNode);
@@ -84,6 +304,12 @@ vtkMRMLSegmentationNode::vtkMRMLSegmentationNode()
   this->RepresentationCreatedCallbackCommand->SetClientData( reinterpret_cast<void *>(this) );
   this->RepresentationCreatedCallbackCommand->SetCallback( vtkMRMLSegmentationNode::OnRepresentationCreated );
 
+  this->SegmentsBatchModifiedCallbackCommand = vtkCallbackCommand::New();
+  this->SegmentsBatchModifiedCallbackCommand->SetClientData( reinterpret_cast<void *>(this) );
+  this->SegmentsBatchModifiedCallbackCommand->SetCallback( vtkMRMLSegmentationNode::OnSegmentsBatchModified );
+
+  this->Internal = new vtkInternal();
+
   // Create empty segmentations object
   this->Segmentation = NULL;
   vtkSmartPointer<vtkSegmentation> segmentation = vtkSmartPointer<vtkSegmentation>::New();
@@ -95,6 +321,9 @@ vtkMRMLSegmentationNode::~vtkMRMLSegmentationNode()
 {
   this->SetAndObserveSegmentation(NULL);
 
+  delete this->Internal;
+  this->Internal = NULL;
+
   if (this->MasterRepresentationCallbackCommand)
   {
     this->MasterRepresentationCallbackCommand->SetClientData(NULL);
@@ -129,6 +358,13 @@ vtkMRMLSegmentationNode::~vtkMRMLSegmentationNode()
     this->RepresentationCreatedCallbackCommand->Delete();
     this->RepresentationCreatedCallbackCommand = NULL;
   }
+
+  if (this->SegmentsBatchModifiedCallbackCommand)
+  {
+    this->SegmentsBatchModifiedCallbackCommand->SetClientData(NULL);
+    this->SegmentsBatchModifiedCallbackCommand->Delete();
+    this->SegmentsBatchModifiedCallbackCommand = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -244,10 +480,15 @@ void vtkMRMLSegmentationNode::SetAndObserveSegmentation(vtkSegmentation* segment
       this->Segmentation, vtkSegmentation::SegmentModified, this, this->SegmentModifiedCallbackCommand );
     vtkEventBroker::GetInstance()->RemoveObservations(
       this->Segmentation, vtkSegmentation::RepresentationCreated, this, this->RepresentationCreatedCallbackCommand );
+    vtkEventBroker::GetInstance()->RemoveObservations(
+      this->Segmentation, vtkSegmentation::SegmentsBatchModified, this, this->SegmentsBatchModifiedCallbackCommand );
   }
 
   this->SetSegmentation(segmentation);
 
+  // Painted regions of the merged labelmap refer to the segments of the previous segmentation
+  this->Internal->Clear();
+
   // Observe segment's master representation
   if (this->Segmentation)
   {
@@ -261,6 +502,8 @@ void vtkMRMLSegmentationNode::SetAndObserveSegmentation(vtkSegmentation* segment
       this->Segmentation, vtkSegmentation::SegmentModified, this, this->SegmentModifiedCallbackCommand );
     vtkEventBroker::GetInstance()->AddObservation(
       this->Segmentation, vtkSegmentation::RepresentationCreated, this, this->RepresentationCreatedCallbackCommand );
+    vtkEventBroker::GetInstance()->AddObservation(
+      this->Segmentation, vtkSegmentation::SegmentsBatchModified, this, this->SegmentsBatchModifiedCallbackCommand );
   }
 }
 
@@ -317,10 +560,10 @@ void vtkMRMLSegmentationNode::OnSegmentAdded(vtkObject* vtkNotUsed(caller), unsi
     return;
   }
 
-  // Re-generate merged labelmap with the added segment
+  // Update merged labelmap with the added segment
   if (self->HasMergedLabelmap())
   {
-    self->ReGenerateDisplayedMergedLabelmap();
+    self->UpdateDisplayedMergedLabelmap(std::vector<std::string>(1, segmentId));
   }
 
   // Invoke node event
@@ -347,34 +590,15 @@ void vtkMRMLSegmentationNode::OnSegmentRemoved(vtkObject* vtkNotUsed(caller), un
   char* segmentId = reinterpret_cast<char*>(callData);
 
   // Remove display properties
-  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(self->GetDisplayNode());
-  if (displayNode)
+  if (!self->RemoveSegmentDisplayProperties(segmentId))
   {
-    // Remove entry from segment display properties
-    displayNode->RemoveSegmentDisplayProperties(segmentId);
-
-    // Remove segment entry from color table
-    vtkMRMLColorTableNode* colorTableNode = vtkMRMLColorTableNode::SafeDownCast(displayNode->GetColorNode());
-    if (!colorTableNode)
-    {
-      vtkErrorWithObjectMacro(self, "vtkMRMLSegmentationNode::OnSegmentRemoved: No color table node associated with segmentation!");
-      return;
-    }
-    int colorIndex = colorTableNode->GetColorIndexByName(segmentId);
-    if (colorIndex < 0)
-    {
-      vtkErrorWithObjectMacro(self, "vtkMRMLSegmentationNode::OnSegmentRemoved: No color table entry found for segment " << segmentId);
-      return;
-    }
-    colorTableNode->SetColor(colorIndex,vtkMRMLSegmentationDisplayNode::GetSegmentationColorNameRemoved(),
-      vtkSegment::SEGMENT_COLOR_VALUE_INVALID[0], vtkSegment::SEGMENT_COLOR_VALUE_INVALID[1],
-      vtkSegment::SEGMENT_COLOR_VALUE_INVALID[2], vtkSegment::SEGMENT_COLOR_VALUE_INVALID[3] );
+    return;
   }
 
-  // Re-generate merged labelmap without the removed segment
+  // Update merged labelmap without the removed segment
   if (self->HasMergedLabelmap())
   {
-    self->ReGenerateDisplayedMergedLabelmap();
+    self->UpdateDisplayedMergedLabelmap(std::vector<std::string>(1, segmentId));
   }
 
   // Invoke node event
@@ -512,6 +736,88 @@ void vtkMRMLSegmentationNode::OnNodeReferenceAdded(vtkMRMLNodeReference *referen
   Superclass::OnNodeReferenceAdded(reference);
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationNode::OnSegmentsBatchModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid), void* clientData, void* callData)
+{
+  vtkMRMLSegmentationNode* self = reinterpret_cast<vtkMRMLSegmentationNode*>(clientData);
+  vtkSegmentation::BatchModifiedEventData* batchModifiedData = reinterpret_cast<vtkSegmentation::BatchModifiedEventData*>(callData);
+  if (!self || !batchModifiedData)
+  {
+    return;
+  }
+  if (!self->Segmentation)
+  {
+    vtkErrorWithObjectMacro(self, "vtkMRMLSegmentationNode::OnSegmentsBatchModified: No segmentation in segmentation node!");
+    return;
+  }
+
+  // Update display properties of all added and removed segments with one display node modified event
+  bool importing = (self->Scene && self->Scene->IsImporting());
+  bool segmentsAddedOrRemoved = !batchModifiedData->RemovedSegmentIDs.empty()
+    || (!importing && !batchModifiedData->AddedSegmentIDs.empty());
+  if (segmentsAddedOrRemoved)
+  {
+    vtkMRMLDisplayNode* displayNode = self->GetDisplayNode();
+    int wasModifyingDisplayNode = (displayNode ? displayNode->StartModify() : 0);
+
+    std::vector<std::string>::iterator segmentIdIt;
+    for (segmentIdIt = batchModifiedData->RemovedSegmentIDs.begin(); segmentIdIt != batchModifiedData->RemovedSegmentIDs.end(); ++segmentIdIt)
+    {
+      self->RemoveSegmentDisplayProperties(*segmentIdIt);
+    }
+    if (!importing)
+    {
+      for (segmentIdIt = batchModifiedData->AddedSegmentIDs.begin(); segmentIdIt != batchModifiedData->AddedSegmentIDs.end(); ++segmentIdIt)
+      {
+        if (!self->AddSegmentDisplayProperties(*segmentIdIt))
+        {
+          vtkErrorWithObjectMacro(self, "vtkMRMLSegmentationNode::OnSegmentsBatchModified: Failed to add display properties for segment " << (*segmentIdIt));
+        }
+      }
+    }
+
+    if (displayNode)
+    {
+      displayNode->EndModify(wasModifyingDisplayNode);
+    }
+  }
+
+  // Reset supported write file types
+  if (batchModifiedData->MasterRepresentationModified)
+  {
+    vtkMRMLSegmentationStorageNode* storageNode =  vtkMRMLSegmentationStorageNode::SafeDownCast(self->GetStorageNode());
+    if (storageNode)
+    {
+      storageNode->ResetSupportedWriteFileTypes();
+    }
+  }
+
+  // Update merged labelmap only once for all the changes. Only the regions of the added and removed segments
+  // need to be repainted, unless representations were created
+  bool representationsCreated = !batchModifiedData->CreatedRepresentationNames.empty();
+  if (!importing && (segmentsAddedOrRemoved || representationsCreated) && self->HasMergedLabelmap())
+  {
+    if (representationsCreated)
+    {
+      self->ReGenerateDisplayedMergedLabelmap();
+    }
+    else
+    {
+      std::vector<std::string> changedSegmentIDs(batchModifiedData->AddedSegmentIDs);
+      changedSegmentIDs.insert(changedSegmentIDs.end(), batchModifiedData->RemovedSegmentIDs.begin(), batchModifiedData->RemovedSegmentIDs.end());
+      self->UpdateDisplayedMergedLabelmap(changedSegmentIDs);
+    }
+  }
+
+  // Invoke node event. The event data is only valid during the call, so it is not deferred as custom modified events
+  self->InvokeEvent(vtkSegmentation::SegmentsBatchModified, callData);
+
+  if (segmentsAddedOrRemoved || representationsCreated)
+  {
+    self->Modified();
+  }
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLSegmentationNode::OnNodeReferenceModified(vtkMRMLNodeReference *reference)
 {
@@ -581,6 +887,39 @@ bool vtkMRMLSegmentationNode::AddSegmentDisplayProperties(std::string segmentId)
   return true;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationNode::RemoveSegmentDisplayProperties(std::string segmentId)
+{
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(this->GetDisplayNode());
+  if (!displayNode)
+  {
+    // Nothing to remove
+    return true;
+  }
+
+  // Remove entry from segment display properties
+  displayNode->RemoveSegmentDisplayProperties(segmentId);
+
+  // Remove segment entry from color table
+  vtkMRMLColorTableNode* colorTableNode = vtkMRMLColorTableNode::SafeDownCast(displayNode->GetColorNode());
+  if (!colorTableNode)
+  {
+    vtkErrorMacro("RemoveSegmentDisplayProperties: No color table node associated with segmentation!");
+    return false;
+  }
+  int colorIndex = colorTableNode->GetColorIndexByName(segmentId.c_str());
+  if (colorIndex < 0)
+  {
+    vtkErrorMacro("RemoveSegmentDisplayProperties: No color table entry found for segment " << segmentId);
+    return false;
+  }
+  colorTableNode->SetColor(colorIndex,vtkMRMLSegmentationDisplayNode::GetSegmentationColorNameRemoved(),
+    vtkSegment::SEGMENT_COLOR_VALUE_INVALID[0], vtkSegment::SEGMENT_COLOR_VALUE_INVALID[1],
+    vtkSegment::SEGMENT_COLOR_VALUE_INVALID[2], vtkSegment::SEGMENT_COLOR_VALUE_INVALID[3] );
+
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLSegmentationNode::ResetSegmentDisplayProperties()
 {
@@ -709,6 +1048,7 @@ vtkImageData* vtkMRMLSegmentationNode::GetImageData()
   }
 
   bool mergeNecessary = false;
+  std::vector<std::string> changedSegmentIDs;
 
   // Create image data if it does not exist
   vtkImageData* imageData = Superclass::GetImageData();
@@ -720,7 +1060,8 @@ vtkImageData* vtkMRMLSegmentationNode::GetImageData()
     mergeNecessary = true;
   }
 
-  // Merge labelmap if merge time is older than segment modified time
+  // Merge labelmap if merge time is older than segment modified time.
+  // Only the regions of the modified segments need to be merged again.
   if (!mergeNecessary && this->Segmentation)
   {
     vtkSegmentation::SegmentMap segmentMap = this->Segmentation->GetSegments();
@@ -733,11 +1074,11 @@ vtkImageData* vtkMRMLSegmentationNode::GetImageData()
       {
         if (masterRepresentation->GetMTime() > this->LabelmapMergeTime.GetMTime())
         {
-          mergeNecessary = true;
-          break;
+          changedSegmentIDs.push_back(segmentIt->first);
         }
       }
     }
+    mergeNecessary = !changedSegmentIDs.empty();
   }
 
   // Perform merging if necessary
@@ -745,7 +1086,8 @@ vtkImageData* vtkMRMLSegmentationNode::GetImageData()
   {
     if (this->Segmentation->ContainsRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
     {
-      bool success = this->GenerateDisplayedMergedLabelmap(imageData);
+      bool success = ( changedSegmentIDs.empty() ? this->GenerateDisplayedMergedLabelmap(imageData)
+        : this->UpdateDisplayedMergedLabelmap(changedSegmentIDs) );
       if (!success)
       {
         vtkErrorMacro("GetImageData: Failed to create merged labelmap for 2D visualization!");
@@ -779,7 +1121,7 @@ bool vtkMRMLSegmentationNode::HasMergedLabelmap()
 bool vtkMRMLSegmentationNode::GenerateDisplayedMergedLabelmap(vtkImageData* imageData)
 {
   vtkSmartPointer<vtkMatrix4x4> mergedImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  if (this->GenerateMergedLabelmap(imageData, mergedImageToWorldMatrix))
+  if (this->PaintMergedLabelmap(imageData, mergedImageToWorldMatrix, std::vector<std::string>(), NULL, this->Internal))
   {
     // Save common labelmap geometry in segmentation node
     this->SetIJKToRASMatrix(mergedImageToWorldMatrix);
@@ -792,32 +1134,153 @@ bool vtkMRMLSegmentationNode::GenerateDisplayedMergedLabelmap(vtkImageData* imag
 
     return true;
   }
-  
+
+  this->Internal->Clear();
   return false;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationNode::UpdateDisplayedMergedLabelmap(const std::vector<std::string>& changedSegmentIDs)
+{
+  vtkImageData* imageData = Superclass::GetImageData();
+  if (!imageData || !this->Segmentation)
+  {
+    return false;
+  }
+  if (!this->Segmentation->ContainsRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
+  {
+    this->ReGenerateDisplayedMergedLabelmap();
+    return true;
+  }
+  if (!this->Internal->Valid || changedSegmentIDs.empty())
+  {
+    return this->GenerateDisplayedMergedLabelmap(imageData);
+  }
+
+  // Segments modified since the last merge need to be repainted as well
+  std::vector<std::string> updatedSegmentIDs(changedSegmentIDs);
+  vtkSegmentation::SegmentMap segmentMap = this->Segmentation->GetSegments();
+  for (vtkSegmentation::SegmentMap::iterator segmentIt = segmentMap.begin(); segmentIt != segmentMap.end(); ++segmentIt)
+  {
+    vtkDataObject* masterRepresentation = segmentIt->second->GetRepresentation(this->Segmentation->GetMasterRepresentationName());
+    if ( masterRepresentation && masterRepresentation->GetMTime() > this->LabelmapMergeTime.GetMTime()
+      && std::find(updatedSegmentIDs.begin(), updatedSegmentIDs.end(), segmentIt->first) == updatedSegmentIDs.end() )
+    {
+      updatedSegmentIDs.push_back(segmentIt->first);
+    }
+  }
+
+  vtkSmartPointer<vtkOrientedImageData> commonGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  vtkSegmentationConverter::DeserializeImageGeometry(this->Internal->CommonGeometryString, commonGeometryImage);
+  int referenceExtent[6] = {0,-1,0,-1,0,-1};
+  commonGeometryImage->GetExtent(referenceExtent);
+
+  // The update region is the union of the regions covered by the changed segments before and after the change
+  int updateExtent[6] = {VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN, VTK_INT_MAX, VTK_INT_MIN};
+  for (std::vector<std::string>::iterator segmentIdIt = updatedSegmentIDs.begin(); segmentIdIt != updatedSegmentIDs.end(); ++segmentIdIt)
+  {
+    // Region painted by the segment in the previous merge. Forget it, so that the segment is considered changed when painting
+    vtkInternal::PaintedSegmentMap::iterator paintedSegmentIt = this->Internal->PaintedSegments.find(*segmentIdIt);
+    if (paintedSegmentIt != this->Internal->PaintedSegments.end())
+    {
+      UnionExtent(updateExtent, paintedSegmentIt->second.Extent);
+      this->Internal->PaintedSegments.erase(paintedSegmentIt);
+    }
+
+    // Region covered by the segment now
+    vtkSegment* segment = this->Segmentation->GetSegment(*segmentIdIt);
+    vtkOrientedImageData* labelmap = ( segment ? vtkOrientedImageData::SafeDownCast(
+      segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) : NULL );
+    if (!labelmap)
+    {
+      continue;
+    }
+    if ( labelmap->GetPendingTransform()
+      || !vtkOrientedImageDataResample::DoGeometriesMatch(commonGeometryImage, labelmap) )
+    {
+      // The covered region is only known after resampling, which is done for the whole labelmap anyway
+      return this->GenerateDisplayedMergedLabelmap(imageData);
+    }
+    int effectiveExtent[6] = {0,-1,0,-1,0,-1};
+    if (vtkOrientedImageDataResample::CalculateEffectiveExtent(labelmap, effectiveExtent))
+    {
+      UnionExtent(updateExtent, effectiveExtent);
+    }
+  }
+  if (!ClipExtent(updateExtent, referenceExtent))
+  {
+    // Changed segments are empty and were empty before
+    this->LabelmapMergeTime.Modified();
+    return true;
+  }
+
+  // The displayed merged labelmap is shifted to start at zero, so paint into an image that shares its voxels
+  // but has the extent of the common geometry. Changing the extent of the displayed image itself would invoke events.
+  int imageDimensions[3] = {0,0,0};
+  imageData->GetDimensions(imageDimensions);
+  int referenceDimensions[3] = {0,0,0};
+  commonGeometryImage->GetDimensions(referenceDimensions);
+  if ( imageDimensions[0] != referenceDimensions[0] || imageDimensions[1] != referenceDimensions[1]
+    || imageDimensions[2] != referenceDimensions[2] || !imageData->GetPointData()->GetScalars() )
+  {
+    return this->GenerateDisplayedMergedLabelmap(imageData);
+  }
+  vtkSmartPointer<vtkImageData> mergedImageData = vtkSmartPointer<vtkImageData>::New();
+  mergedImageData->SetExtent(referenceExtent);
+#if (VTK_MAJOR_VERSION <= 5)
+  mergedImageData->SetScalarType(imageData->GetScalarType());
+  mergedImageData->SetNumberOfScalarComponents(1);
+#endif
+  mergedImageData->GetPointData()->SetScalars(imageData->GetPointData()->GetScalars());
+
+  vtkSmartPointer<vtkMatrix4x4> mergedImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (!this->PaintMergedLabelmap(mergedImageData, mergedImageToWorldMatrix, std::vector<std::string>(), updateExtent, this->Internal))
+  {
+    // Geometry, labels or visibility of the segments changed
+    return this->GenerateDisplayedMergedLabelmap(imageData);
+  }
+
+  // Save labelmap merge timestamp before notifying about the change, so that the image is not merged again
+  this->LabelmapMergeTime.Modified();
+  imageData->Modified();
+
+  return true;
+}
+
 //---------------------------------------------------------------------------
 bool vtkMRMLSegmentationNode::GenerateMergedLabelmap(vtkImageData* mergedImageData, vtkMatrix4x4* mergedImageToWorldMatrix, const std::vector<std::string>& segmentIDs/*=std::vector<std::string>()*/)
+{
+  return this->PaintMergedLabelmap(mergedImageData, mergedImageToWorldMatrix, segmentIDs, NULL, NULL);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationNode::PaintMergedLabelmap(vtkImageData* mergedImageData, vtkMatrix4x4* mergedImageToWorldMatrix,
+  const std::vector<std::string>& segmentIDs, const int* updateExtent, vtkInternal* mergeState)
 {
   if (!mergedImageData)
   {
-    vtkErrorMacro("GenerateMergedLabelmap: Invalid image data!");
+    vtkErrorMacro("PaintMergedLabelmap: Invalid image data!");
     return false;
   }
   if (!mergedImageToWorldMatrix)
   {
-    vtkErrorMacro("GenerateMergedLabelmap: Invalid geometry matrix!");
+    vtkErrorMacro("PaintMergedLabelmap: Invalid geometry matrix!");
     return false;
   }
   // If segmentation is missing or empty then we cannot create a merged image data
   if (!this->Segmentation)
   {
-    vtkErrorMacro("GenerateMergedLabelmap: Invalid segmentation!");
+    vtkErrorMacro("PaintMergedLabelmap: Invalid segmentation!");
     return false;
   }
   if (!this->Segmentation->ContainsRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
   {
-    vtkErrorMacro("GenerateMergedLabelmap: Segmentation does not contain binary labelmap representation!");
+    vtkErrorMacro("PaintMergedLabelmap: Segmentation does not contain binary labelmap representation!");
+    return false;
+  }
+  if (updateExtent && !mergeState)
+  {
+    vtkErrorMacro("PaintMergedLabelmap: Merge state is needed for updating a region of the merged labelmap!");
     return false;
   }
 
@@ -838,65 +1301,95 @@ bool vtkMRMLSegmentationNode::GenerateMergedLabelmap(vtkImageData* mergedImageDa
 
   // Determine common labelmap geometry that will be used for the merged labelmap
   std::string commonGeometryString = this->Segmentation->DetermineCommonLabelmapGeometry(mergedSegmentIDs);
+  if (updateExtent && (!mergeState->Valid || commonGeometryString.compare(mergeState->CommonGeometryString)))
+  {
+    return false;
+  }
   vtkSmartPointer<vtkOrientedImageData> commonGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
   vtkSegmentationConverter::DeserializeImageGeometry(commonGeometryString, commonGeometryImage);
 
   commonGeometryImage->GetImageToWorldMatrix(mergedImageToWorldMatrix);
-  int referenceDimensions[3] = {0,0,0};
-  commonGeometryImage->GetDimensions(referenceDimensions);
   int referenceExtent[6] = {0,-1,0,-1,0,-1};
   commonGeometryImage->GetExtent(referenceExtent);
 
-  // Allocate image data if empty or if reference extent changed
+  // Get color table node. Labels of the segments are their indices in the color table
+  vtkMRMLColorTableNode* colorTableNode = NULL;
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(this->GetDisplayNode());
+  if (displayNode)
+  {
+    colorTableNode = vtkMRMLColorTableNode::SafeDownCast(displayNode->GetColorNode());
+  }
+
+  // Use unsigned short labels if there are more colors than fit in unsigned char (large atlases)
+  int mergedScalarType = VTK_UNSIGNED_CHAR;
+  if (colorTableNode && colorTableNode->GetNumberOfColors() > VTK_UNSIGNED_CHAR_MAX + 1)
+  {
+    mergedScalarType = VTK_UNSIGNED_SHORT;
+  }
+
+  // Allocate image data if empty or if reference extent or scalar type changed
   int imageDataExtent[6] = {0,-1,0,-1,0,-1};
   mergedImageData->GetExtent(imageDataExtent);
   if ( imageDataExtent[0] != referenceExtent[0] || imageDataExtent[1] != referenceExtent[1] || imageDataExtent[2] != referenceExtent[2]
-    || imageDataExtent[3] != referenceExtent[3] || imageDataExtent[4] != referenceExtent[4] || imageDataExtent[5] != referenceExtent[5] )
+    || imageDataExtent[3] != referenceExtent[3] || imageDataExtent[4] != referenceExtent[4] || imageDataExtent[5] != referenceExtent[5]
+    || !mergedImageData->GetPointData()->GetScalars() || mergedImageData->GetScalarType() != mergedScalarType )
   {
+    if (updateExtent)
+    {
+      return false;
+    }
     mergedImageData->SetExtent(referenceExtent);
 #if (VTK_MAJOR_VERSION <= 5)
-    mergedImageData->SetScalarType(VTK_UNSIGNED_CHAR);
+    mergedImageData->SetScalarType(mergedScalarType);
     mergedImageData->SetNumberOfScalarComponents(1);
     mergedImageData->AllocateScalars();
 #else
-    mergedImageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    mergedImageData->AllocateScalars(mergedScalarType, 1);
 #endif
   }
-
-  // Paint the image data background first
-  unsigned short backgroundColor = vtkMRMLSegmentationDisplayNode::GetSegmentationColorIndexBackground();
-  unsigned char* mergedImagePtr = (unsigned char*)mergedImageData->GetScalarPointerForExtent(referenceExtent);
-  if (!mergedImagePtr)
+  if (!mergedImageData->GetScalarPointerForExtent(referenceExtent))
   {
     return false; // Setting the extent may invoke this function again via ImageDataModified, in which case the pointer is NULL
   }
-  for (vtkIdType i=0; i<mergedImageData->GetNumberOfPoints(); ++i)
-  {
-    (*mergedImagePtr) = backgroundColor;
-    ++mergedImagePtr;
-  }
 
-  // Skip the rest if there are no segments
-  if (this->Segmentation->GetNumberOfSegments() == 0)
+  // Region to paint
+  int paintExtent[6] = { referenceExtent[0], referenceExtent[1], referenceExtent[2], referenceExtent[3], referenceExtent[4], referenceExtent[5] };
+  if (updateExtent && !ClipExtent(paintExtent, updateExtent))
   {
     return true;
   }
+  unsigned short backgroundColor = vtkMRMLSegmentationDisplayNode::GetSegmentationColorIndexBackground();
 
-  // Get color table node
-  vtkMRMLColorTableNode* colorTableNode = NULL;
-  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(this->GetDisplayNode());
-  if (displayNode)
+  // Paint only the background if there are no segments
+  if (this->Segmentation->GetNumberOfSegments() == 0 || !colorTableNode)
   {
-    // Add entry in color table for segment
-    colorTableNode = vtkMRMLColorTableNode::SafeDownCast(displayNode->GetColorNode());
-    if (!colorTableNode)
+    if (updateExtent)
     {
-      vtkErrorMacro("GenerateMergedLabelmap: No color table node associated with segmentation!");
       return false;
     }
+    FillMergedLabelmap(mergedImageData, paintExtent, backgroundColor);
+    if (mergeState)
+    {
+      mergeState->Clear();
+    }
+    if (this->Segmentation->GetNumberOfSegments() == 0)
+    {
+      if (mergeState)
+      {
+        mergeState->Valid = true;
+        mergeState->CommonGeometryString = commonGeometryString;
+      }
+      return true;
+    }
+    vtkErrorMacro("PaintMergedLabelmap: No color table node associated with segmentation!");
+    return false;
   }
 
-  // Create merged labelmap. Use color table to determine labels for segments
+  // Collect the segments to merge in the order of their labels, so that segments with higher label are painted over the others.
+  // All segments are collected before the merged labelmap is changed, so that an update can be rejected without side effects.
+  std::vector<MergedSegment> mergedSegments;
+  vtkInternal::PaintedSegmentMap newlyPaintedSegments;
+  unsigned int numberOfUnchangedSegments = 0;
   for (unsigned short colorIndex = 2; colorIndex < colorTableNode->GetNumberOfColors(); ++colorIndex) // Color index starts from 2 (0 is background, 1 is invalid)
   {
     std::string segmentId(colorTableNode->GetColorName(colorIndex));
@@ -933,7 +1426,7 @@ bool vtkMRMLSegmentationNode::GenerateMergedLabelmap(vtkImageData* mergedImageDa
     vtkSegment* currentSegment = this->Segmentation->GetSegment(segmentId);
     if (!currentSegment)
     {
-      vtkErrorMacro("GenerateMergedLabelmap: Mismatch in color names and segment IDs!");
+      vtkErrorMacro("PaintMergedLabelmap: Mismatch in color names and segment IDs!");
       continue;
     }
     vtkOrientedImageData* representationBinaryLabelmap = vtkOrientedImageData::SafeDownCast(
@@ -943,88 +1436,124 @@ bool vtkMRMLSegmentationNode::GenerateMergedLabelmap(vtkImageData* mergedImageDa
       continue;
     }
 
-    // Set oriented image data used for merging to the representation (may change later if resampling is needed)
-    vtkOrientedImageData* binaryLabelmap = representationBinaryLabelmap;
-
-    // If labelmap geometries (spacings and directions) do not match reference then resample temporarily
-    vtkSmartPointer<vtkOrientedImageData> resampledBinaryLabelmap;
-    if (!vtkOrientedImageDataResample::DoGeometriesMatch(commonGeometryImage, representationBinaryLabelmap))
+    int segmentLabelScalarType = representationBinaryLabelmap->GetScalarType();
+    if ( segmentLabelScalarType != VTK_UNSIGNED_CHAR
+      && segmentLabelScalarType != VTK_UNSIGNED_SHORT
+      && segmentLabelScalarType != VTK_SHORT )
     {
-      resampledBinaryLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+      vtkWarningMacro("PaintMergedLabelmap: Segment " << segmentId << " cannot be merged! Binary labelmap scalar type must be unsigned char, unsighed short, or short!");
+      continue;
+    }
+
+    MergedSegment mergedSegment;
+    mergedSegment.Label = colorIndex;
+    mergedSegment.Labelmap = representationBinaryLabelmap;
 
-      // Resample segment labelmap for merging
-      if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(representationBinaryLabelmap, mergedImageToWorldMatrix, resampledBinaryLabelmap))
+    // The painted region of segments unchanged since the previous merge is known, others are resampled if needed
+    // and their effective extent is calculated
+    bool segmentUnchanged = false;
+    if (updateExtent)
+    {
+      vtkInternal::PaintedSegmentMap::iterator paintedSegmentIt = mergeState->PaintedSegments.find(segmentId);
+      if (paintedSegmentIt != mergeState->PaintedSegments.end())
       {
-        continue;
+        if (paintedSegmentIt->second.Label != colorIndex)
+        {
+          return false;
+        }
+        segmentUnchanged = true;
+        ++numberOfUnchangedSegments;
+        std::copy(paintedSegmentIt->second.Extent, paintedSegmentIt->second.Extent + 6, mergedSegment.Extent);
+        if (!ClipExtent(mergedSegment.Extent, paintExtent))
+        {
+          continue;
+        }
       }
-
-      // Use resampled labelmap for merging
-      binaryLabelmap = resampledBinaryLabelmap;
     }
 
-    // Copy image data voxels into merged labelmap with the proper color index
-    int labelmapExtent[6] = {0,-1,0,-1,0,-1};
-    binaryLabelmap->GetExtent(labelmapExtent);
-    int labelmapDimensions[3] = {0,0,0};
-    binaryLabelmap->GetDimensions(labelmapDimensions);
-    int labelmapCoordinates[3] = {0,0,0};
-    long residualIndex = 0;
-
-    int segmentLabelScalarType = binaryLabelmap->GetScalarType();
-    if ( segmentLabelScalarType != VTK_UNSIGNED_CHAR
-      && segmentLabelScalarType != VTK_UNSIGNED_SHORT
-      && segmentLabelScalarType != VTK_SHORT )
+    // If labelmap geometries (spacings and directions) do not match reference then resample temporarily.
+    // Only the effective extent of the labelmap is resampled.
+    if ( representationBinaryLabelmap->GetPendingTransform()
+      || !vtkOrientedImageDataResample::DoGeometriesMatch(commonGeometryImage, representationBinaryLabelmap) )
     {
-      vtkWarningMacro("GenerateMergedLabelmap: Segment " << segmentId << " cannot be merged! Binary labelmap scalar type must be unsigned char, unsighed short, or short!");
-      continue;
+      mergedSegment.Labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+      if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceGeometry(representationBinaryLabelmap, mergedImageToWorldMatrix, mergedSegment.Labelmap))
+      {
+        continue;
+      }
     }
-    void* voidScalarPointer = binaryLabelmap->GetScalarPointer();
-    unsigned char* labelmapPtrUChar = (unsigned char*)voidScalarPointer;
-    unsigned short* labelmapPtrUShort = (unsigned short*)voidScalarPointer;
-    short* labelmapPtrShort = (short*)voidScalarPointer;
-
-    mergedImagePtr = (unsigned char*)mergedImageData->GetScalarPointer();
-    unsigned char* imagePtrMax = mergedImagePtr + referenceDimensions[0]*referenceDimensions[1]*referenceDimensions[2];
-    for (long i=0; i<binaryLabelmap->GetNumberOfPoints(); ++i)
+
+    if (!segmentUnchanged)
     {
-      // Get labelmap color at voxel
-      unsigned short color = 0;
-      if (segmentLabelScalarType == VTK_UNSIGNED_CHAR)
+      // Only the effective extent of the labelmap within the merged labelmap is painted
+      if ( !vtkOrientedImageDataResample::CalculateEffectiveExtent(mergedSegment.Labelmap, mergedSegment.Extent)
+        || !ClipExtent(mergedSegment.Extent, referenceExtent) )
       {
-        color = (*labelmapPtrUChar);
+        continue;
       }
-      else if (segmentLabelScalarType == VTK_UNSIGNED_SHORT)
+      if (mergeState)
       {
-        color = (*labelmapPtrUShort);
+        vtkInternal::PaintedSegment& paintedSegment = newlyPaintedSegments[segmentId];
+        paintedSegment.Label = colorIndex;
+        std::copy(mergedSegment.Extent, mergedSegment.Extent + 6, paintedSegment.Extent);
       }
-      else if (segmentLabelScalarType == VTK_SHORT)
+      if (updateExtent && !ContainsExtent(paintExtent, mergedSegment.Extent))
       {
-        color = (*labelmapPtrShort);
+        // Segment not painted in the previous merge reaches outside the update region
+        return false;
       }
+    }
 
-      // Get labelmap coordinates
-      labelmapCoordinates[2] = i / (labelmapDimensions[1]*labelmapDimensions[0]);
-      residualIndex = i - labelmapCoordinates[2]*labelmapDimensions[1]*labelmapDimensions[0];
-      labelmapCoordinates[1] = residualIndex / labelmapDimensions[0];
-      residualIndex -= labelmapCoordinates[1]*labelmapDimensions[0];
-      labelmapCoordinates[0] = residualIndex;
-
-      // Apply extent offset and current offset
-      unsigned char* offsetImagePtr = mergedImagePtr +
-                                      (labelmapExtent[4]-referenceExtent[4]+labelmapCoordinates[2]) * referenceDimensions[1]*referenceDimensions[0] +
-                                      (labelmapExtent[2]-referenceExtent[2]+labelmapCoordinates[1]) * referenceDimensions[0] +
-                                      (labelmapExtent[0]-referenceExtent[0]+labelmapCoordinates[0]);
-
-      // Paint merged labelmap voxel if foreground and in extent
-      if ( color != backgroundColor
-        && offsetImagePtr >= mergedImagePtr && offsetImagePtr < imagePtrMax )
-      {
-        (*offsetImagePtr) = colorIndex;
-      }
+    mergedSegments.push_back(mergedSegment);
+  }
+  if (updateExtent && numberOfUnchangedSegments != mergeState->PaintedSegments.size())
+  {
+    // Some segments painted in the previous merge are now hidden or not in the color table
+    return false;
+  }
 
-      ++labelmapPtrUChar;
-      ++labelmapPtrUShort;
-      ++labelmapPtrShort;
+  // Paint the background of the region first
+  FillMergedLabelmap(mergedImageData, paintExtent, backgroundColor);
+
+  // Paint the segments into slabs of slices of the merged labelmap region in parallel. Each slab is painted by one thread,
+  // in the order of the segments, so the result is the same as painting the segments one after the other
+  MergedLabelmapPaintData data;
+  data.MergedImage = mergedImageData;
+  data.Segments = &mergedSegments;
+  std::copy(paintExtent, paintExtent + 6, data.PaintExtent);
+  vtkIdType numberOfPaintedVoxels = (vtkIdType)(paintExtent[1]-paintExtent[0]+1) * (paintExtent[3]-paintExtent[2]+1) * (paintExtent[5]-paintExtent[4]+1);
+  int numberOfPaintedSlices = paintExtent[5] - paintExtent[4] + 1;
+  data.NumberOfSlabs = (int)std::min( (vtkIdType)vtkMultiThreader::GetGlobalDefaultNumberOfThreads(),
+    numberOfPaintedVoxels / MINIMUM_NUMBER_OF_MERGED_VOXELS_PER_THREAD );
+  data.NumberOfSlabs = std::max(1, std::min(data.NumberOfSlabs, std::min(numberOfPaintedSlices, (int)VTK_MAX_THREADS)));
+  if (data.NumberOfSlabs < 2)
+  {
+    vtkMultiThreader::ThreadInfo threadInfo;
+    threadInfo.ThreadID = 0;
+    threadInfo.NumberOfThreads = 1;
+    threadInfo.UserData = &data;
+    PaintMergedLabelmapThreadFunction(&threadInfo);
+  }
+  else
+  {
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(data.NumberOfSlabs);
+    threader->SetSingleMethod(PaintMergedLabelmapThreadFunction, &data);
+    threader->SingleMethodExecute();
+  }
+
+  // Record the painted regions
+  if (mergeState)
+  {
+    if (!updateExtent)
+    {
+      mergeState->Clear();
+      mergeState->Valid = true;
+      mergeState->CommonGeometryString = commonGeometryString;
+    }
+    for (vtkInternal::PaintedSegmentMap::iterator paintedSegmentIt = newlyPaintedSegments.begin(); paintedSegmentIt != newlyPaintedSegments.end(); ++paintedSegmentIt)
+    {
+      mergeState->PaintedSegments[paintedSegmentIt->first] = paintedSegmentIt->second;
     }
   }
 
@@ -38,6 +38,8 @@ class vtkMRMLSubjectHierarchyNode;
 /// \ingroup Segmentations
 class VTK_SLICER_SEGMENTATIONS_MODULE_MRML_EXPORT vtkMRMLSegmentationNode : public vtkMRMLLabelMapVolumeNode
 {
+  class vtkInternal;
+
 public:
   // Define constants
   static const char* GetSegmentIDAttributeName() { return "segmentID"; };
@@ -111,7 +113,10 @@ public:
   vtkMRMLSubjectHierarchyNode* GetSegmentSubjectHierarchyNode(std::string segmentID);
 
 //BTX
-  /// Build merged labelmap of the binary labelmap representations of the specified segments
+  /// Build merged labelmap of the binary labelmap representations of the specified segments.
+  /// The label of each segment is its index in the segmentation color table. The merged labelmap is unsigned short
+  /// if the color table has more than 256 entries, unsigned char otherwise. Only the effective extent of each segment
+  /// is painted, on multiple threads. Where segments overlap, the one with the highest label is visible.
   /// \param mergedImageData Output image data for the merged labelmap image data
   /// \param mergedImageToWorldMatrix Image to world matrix for the output labelmap
   ///    (can be set to a volume node or to an oriented image data)
@@ -143,9 +148,26 @@ protected:
   /// Build merged labelmap for 2D labelmap display from all contained segments
   virtual bool GenerateDisplayedMergedLabelmap(vtkImageData* imageData);
 
+  /// Update merged labelmap for 2D labelmap display after the given segments changed (were modified, added or removed).
+  /// Only the region covered by the changed segments before and after the change is repainted from all segments.
+  /// If the merged labelmap geometry or the labels of the other segments changed, then the whole merged labelmap is regenerated
+  virtual bool UpdateDisplayedMergedLabelmap(const std::vector<std::string>& changedSegmentIDs);
+
+  /// Paint segments into a merged labelmap (\sa GenerateMergedLabelmap)
+  /// \param updateExtent Region to repaint in the index space of the common labelmap geometry. If NULL, then the whole
+  ///   merged labelmap is generated. Otherwise the merged labelmap needs to be allocated with the common geometry already
+  /// \param mergeState Regions painted by the segments in the previous merge. Segments in it are considered unchanged.
+  ///   Required for updating a region, optional otherwise. Updated with the newly painted segments
+  /// \return Success flag. When updating a region, the merged labelmap is not changed if the update is not possible
+  virtual bool PaintMergedLabelmap(vtkImageData* mergedImageData, vtkMatrix4x4* mergedImageToWorldMatrix,
+    const std::vector<std::string>& segmentIDs, const int* updateExtent, vtkInternal* mergeState);
+
   /// Add display properties for segment with given ID
   virtual bool AddSegmentDisplayProperties(std::string segmentId);
 
+  /// Remove display properties of segment with given ID, and mark its color table entry as removed
+  virtual bool RemoveSegmentDisplayProperties(std::string segmentId);
+
   /// Reset all display related data. Called when display node reference is added or modified
   virtual void ResetSegmentDisplayProperties();
 
@@ -179,6 +201,10 @@ protected:
   /// Forwards event from the node.
   static void OnRepresentationCreated(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
 
+  /// Callback function observing the aggregated event of a batch of segmentation modifications.
+  /// Updates display properties of the added and removed segments at once, and forwards event from the node.
+  static void OnSegmentsBatchModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
+
 protected:
   vtkMRMLSegmentationNode();
   ~vtkMRMLSegmentationNode();
@@ -191,6 +217,9 @@ protected:
   /// Keep track of merged labelmap modification time
   vtkTimeStamp LabelmapMergeTime;
 
+  /// Regions of the displayed merged labelmap painted by each segment, for updating only the changed regions
+  vtkInternal* Internal;
+
   /// Command handling master representation modified events
   vtkCallbackCommand* MasterRepresentationCallbackCommand;
 
@@ -205,6 +234,9 @@ protected:
 
   /// Command handling representation created event
   vtkCallbackCommand* RepresentationCreatedCallbackCommand;
+
+  /// Command handling segments batch modified event
+  vtkCallbackCommand* SegmentsBatchModifiedCallbackCommand;
 };
 
 #endif // __vtkMRMLSegmentationNode_h
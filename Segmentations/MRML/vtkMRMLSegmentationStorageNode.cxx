@@ -40,10 +40,18 @@
 #include <vtkMultiBlockDataSet.h>
 #include <vtkXMLMultiBlockDataWriter.h>
 #include <vtkXMLMultiBlockDataReader.h>
+#include <vtkXMLPolyDataWriter.h>
+#include <vtkZLibDataCompressor.h>
 #include <vtksys/SystemTools.hxx>
 #include <vtkInformation.h>
 #include <vtkInformationIntegerVectorKey.h>
 #include <vtkInformationStringKey.h>
+#include <vtkCommand.h>
+#include <vtkMultiThreader.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkWeakPointer.h>
+#include <vtk_zlib.h>
 
 // ITK includes
 #include <itkImageFileWriter.h>
@@ -55,8 +63,28 @@
 #include <itkMetaDataObject.h>
 
 // STL & C++ includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iterator>
+#include <map>
 #include <sstream>
+#include <set>
+#include <vector>
+
+// Memory mapping includes
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 //----------------------------------------------------------------------------
 static const std::string SERIALIZATION_SEPARATOR = "|";
@@ -68,24 +96,870 @@ static const std::string SEGMENT_EXTENT = "Extent";
 static const std::string MASTER_REPRESENTATION = "MasterRepresentation";
 static const std::string CONVERSION_PARAMETERS = "ConversionParameters";
 static const std::string CONTAINED_REPRESENTATION_NAMES = "ContainedRepresentationNames";
+static const std::string LAYOUT = "Layout";
+static const std::string LAYOUT_SPARSE = "Sparse";
+static const std::string GEOMETRY = "Geometry";
+static const std::string SEGMENT_OFFSET = "Offset";
+static const std::string SEGMENT_COMPRESSED_OFFSET = "CompressedOffset";
+
+// Maximum number of voxels in one row of the sparse layout image. The voxels of all segments are stored
+// in one contiguous buffer, which is split into rows so that no image axis becomes too long
+static const vtkIdType SPARSE_LAYOUT_ROW_LENGTH = 1048576;
+
+// Size of the chunks in which compressed data is read when loading segments on demand
+static const vtkIdType LAZY_LOADING_CHUNK_SIZE = 262144;
+
+// Maximum size of the chunks that are compressed independently when compressing on multiple threads
+static const vtkIdType PARALLEL_COMPRESSION_CHUNK_SIZE = 4194304;
+
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Get the settings and metadata that affect the stored voxels of all segments in a file in sparse layout.
+  /// The stored state of a file is only reused for writing if these have not changed (\sa IncrementalWrite)
+  std::string GetSparseLayoutWriteSettings(vtkMRMLSegmentationStorageNode* storageNode, const char* masterRepresentation)
+  {
+    std::stringstream ssWriteSettings;
+    ssWriteSettings << storageNode->GetUseCompression() << storageNode->GetParallelCompression() << storageNode->GetFastCompression()
+      << (masterRepresentation ? masterRepresentation : "");
+    return ssWriteSettings.str();
+  }
+
+  /// Get metadata key of a segment property (properties are prefixed by the segment index)
+  std::string GetSegmentMetaDataKey(int segmentIndex, const std::string& key)
+  {
+    std::stringstream ssKey;
+    ssKey << segmentIndex << key;
+    return ssKey.str();
+  }
+
+  /// Copy voxels of an image within an extent to a contiguous unsigned char buffer
+  template <class T>
+  void CopyExtentToBuffer(vtkImageData* image, T* scalarTypePtr, int extent[6], unsigned char* bufferPtr)
+  {
+    vtkIdType rowLength = extent[1] - extent[0] + 1;
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        T* rowPtr = static_cast<T*>(image->GetScalarPointer(extent[0], j, k));
+        for (vtkIdType i = 0; i < rowLength; ++i)
+        {
+          bufferPtr[i] = static_cast<unsigned char>(rowPtr[i]);
+        }
+        bufferPtr += rowLength;
+      }
+    }
+  }
+
+  /// Copy voxels of a binary labelmap within its effective extent to a contiguous unsigned char buffer
+  void CopySegmentVoxelsToBuffer(vtkImageData* labelmap, int effectiveExtent[6], unsigned char* bufferPtr)
+  {
+    if (!labelmap || effectiveExtent[1] < effectiveExtent[0])
+    {
+      return;
+    }
+    switch (labelmap->GetScalarType())
+    {
+      case VTK_UNSIGNED_CHAR:
+        CopyExtentToBuffer(labelmap, (unsigned char*)NULL, effectiveExtent, bufferPtr);
+        break;
+      case VTK_UNSIGNED_SHORT:
+        CopyExtentToBuffer(labelmap, (unsigned short*)NULL, effectiveExtent, bufferPtr);
+        break;
+      case VTK_SHORT:
+        CopyExtentToBuffer(labelmap, (short*)NULL, effectiveExtent, bufferPtr);
+        break;
+    }
+  }
+
+  /// Get number of voxels in an extent (zero if the extent is empty)
+  vtkIdType GetNumberOfVoxelsInExtent(int extent[6])
+  {
+    if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+    {
+      return 0;
+    }
+    return (vtkIdType)(extent[1]-extent[0]+1) * (extent[3]-extent[2]+1) * (extent[5]-extent[4]+1);
+  }
+
+  /// Read properties of a segment stored in sparse layout from the metadata
+  /// \return False if there is no segment with the given index
+  bool ReadSparseSegmentMetaData(const itk::MetaDataDictionary& metadata, int segmentIndex, vtkSegment* segment,
+    std::string& segmentId, int extent[6], vtkIdType& offset)
+  {
+    if (!itk::ExposeMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_ID).c_str(), segmentId))
+    {
+      return false;
+    }
+
+    std::string segmentName;
+    itk::ExposeMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_NAME).c_str(), segmentName);
+    segment->SetName(segmentName.c_str());
+
+    std::string defaultColorValue;
+    itk::ExposeMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_DEFAULT_COLOR).c_str(), defaultColorValue);
+    std::stringstream ssDefaultColorValue;
+    ssDefaultColorValue << defaultColorValue;
+    double defaultColor[3] = {0.0,0.0,0.0};
+    ssDefaultColorValue >> defaultColor[0] >> defaultColor[1] >> defaultColor[2];
+    segment->SetDefaultColor(defaultColor);
+
+    std::string extentValue;
+    itk::ExposeMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_EXTENT).c_str(), extentValue);
+    std::stringstream ssExtentValue;
+    ssExtentValue << extentValue;
+    extent[0] = extent[2] = extent[4] = 0;
+    extent[1] = extent[3] = extent[5] = -1;
+    ssExtentValue >> extent[0] >> extent[1] >> extent[2] >> extent[3] >> extent[4] >> extent[5];
+
+    std::string offsetValue;
+    itk::ExposeMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_OFFSET).c_str(), offsetValue);
+    std::stringstream ssOffsetValue;
+    ssOffsetValue << offsetValue;
+    offset = 0;
+    ssOffsetValue >> offset;
+
+    // Tags are separated by the serialization separator (\sa WriteSparseBinaryLabelmapRepresentation)
+    std::string tagsValue;
+    itk::ExposeMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_TAGS).c_str(), tagsValue);
+    size_t tagStart = 0;
+    size_t separatorPosition = tagsValue.find(SERIALIZATION_SEPARATOR);
+    while (separatorPosition != std::string::npos)
+    {
+      segment->AddTag(tagsValue.substr(tagStart, separatorPosition - tagStart));
+      tagStart = separatorPosition + SERIALIZATION_SEPARATOR.size();
+      separatorPosition = tagsValue.find(SERIALIZATION_SEPARATOR, tagStart);
+    }
+
+    return true;
+  }
+
+  /// Create binary labelmap of a segment stored in sparse layout, without allocating its voxels
+  vtkSmartPointer<vtkOrientedImageData> CreateSparseSegmentLabelmap(vtkOrientedImageData* geometryImage, int extent[6])
+  {
+    double directions[3][3] = {{1.0,0.0,0.0},{0.0,1.0,0.0},{0.0,0.0,1.0}};
+    geometryImage->GetDirections(directions);
+
+    vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    labelmap->SetDirections(directions);
+    labelmap->SetOrigin(geometryImage->GetOrigin());
+    labelmap->SetSpacing(geometryImage->GetSpacing());
+    labelmap->SetExtent(extent);
+#if (VTK_MAJOR_VERSION <= 5)
+    labelmap->SetScalarType(VTK_UNSIGNED_CHAR);
+    labelmap->SetNumberOfScalarComponents(1);
+#endif
+    return labelmap;
+  }
+
+  /// Find the data in a NRRD file that contains the data after the header (not in a separate file).
+  /// Only raw and gzip encoding are supported.
+  /// \param dataOffset Position of the first byte of the data in the file
+  /// \param gzipEncoding Output flag indicating whether the data is gzip compressed
+  /// \return Success flag
+  bool GetNrrdDataLocation(const std::string& path, std::streamoff& dataOffset, bool& gzipEncoding)
+  {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    std::string line;
+    if (!std::getline(file, line) || line.compare(0, 4, "NRRD"))
+    {
+      return false;
+    }
+
+    bool encodingFound = false;
+    gzipEncoding = false;
+    while (std::getline(file, line))
+    {
+      if (!line.empty() && line[line.size()-1] == '\r')
+      {
+        line.erase(line.size()-1);
+      }
+      if (line.empty())
+      {
+        // Header is terminated by an empty line
+        dataOffset = file.tellg();
+        return encodingFound;
+      }
+
+      // Only fields are of interest, comments and key-value pairs (separated by ":=") are skipped
+      size_t separatorPosition = line.find(": ");
+      if (line[0] == '#' || separatorPosition == std::string::npos || line.find(":=") < separatorPosition)
+      {
+        continue;
+      }
+      std::string field = line.substr(0, separatorPosition);
+      std::string value = line.substr(separatorPosition + 2);
+      if (!field.compare("encoding"))
+      {
+        if (!value.compare("raw"))
+        {
+          gzipEncoding = false;
+        }
+        else if (!value.compare("gzip") || !value.compare("gz"))
+        {
+          gzipEncoding = true;
+        }
+        else
+        {
+          return false;
+        }
+        encodingFound = true;
+      }
+      else if ( !field.compare("data file") || !field.compare("datafile")
+        || !field.compare("line skip") || !field.compare("lineskip")
+        || !field.compare("byte skip") || !field.compare("byteskip") )
+      {
+        // Detached or skipped data is not supported
+        return false;
+      }
+    }
+    return false;
+  }
+
+  /// Read a range of the data of a NRRD file
+  /// \param dataOffset Position of the data in the file (\sa GetNrrdDataLocation)
+  /// \param gzipEncoding Flag indicating whether the data is gzip compressed. Compressed data before the range
+  ///          needs to be decompressed, but it is done in chunks, so only the read range is kept in memory
+  /// \param compressedOffset Position of the gzip member starting at the read range within the compressed data,
+  ///          negative if unknown. Decompression starts there instead of at the beginning of the data if known
+  /// \param offset Position of the first byte to read within the (decompressed) data
+  /// \param length Number of bytes to read
+  /// \param buffer Output buffer
+  /// \return Success flag
+  bool ReadNrrdDataRange(const std::string& path, std::streamoff dataOffset, bool gzipEncoding,
+    vtkIdType compressedOffset, vtkIdType offset, vtkIdType length, unsigned char* buffer)
+  {
+    if (length == 0)
+    {
+      return true;
+    }
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+    {
+      return false;
+    }
+
+    if (!gzipEncoding)
+    {
+      file.seekg(dataOffset + (std::streamoff)offset);
+      file.read(reinterpret_cast<char*>(buffer), length);
+      return (file.gcount() == length);
+    }
+
+    // Decompress data until the end of the requested range. Segments written on multiple threads start
+    // a new gzip member (\sa CompressGzipMembers), so their decompression can start at that member
+    vtkIdType position = 0; // Position in the decompressed data
+    if (compressedOffset >= 0)
+    {
+      file.seekg(dataOffset + (std::streamoff)compressedOffset);
+      position = offset;
+    }
+    else
+    {
+      file.seekg(dataOffset);
+    }
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15+32) != Z_OK) // Detect gzip header automatically
+    {
+      return false;
+    }
+    std::vector<unsigned char> compressedChunk(LAZY_LOADING_CHUNK_SIZE);
+    std::vector<unsigned char> skippedChunk(LAZY_LOADING_CHUNK_SIZE);
+    int status = Z_OK;
+    while (position < offset + length && status == Z_OK)
+    {
+      if (stream.avail_in == 0)
+      {
+        file.read(reinterpret_cast<char*>(&compressedChunk[0]), LAZY_LOADING_CHUNK_SIZE);
+        stream.avail_in = (uInt)file.gcount();
+        stream.next_in = &compressedChunk[0];
+        if (stream.avail_in == 0)
+        {
+          break;
+        }
+      }
+      // Data before the requested range is decompressed into a scratch buffer and discarded
+      if (position < offset)
+      {
+        stream.next_out = &skippedChunk[0];
+        stream.avail_out = (uInt)std::min(LAZY_LOADING_CHUNK_SIZE, offset - position);
+      }
+      else
+      {
+        stream.next_out = buffer + (position - offset);
+        stream.avail_out = (uInt)std::min((vtkIdType)VTK_INT_MAX, offset + length - position);
+      }
+      uInt availableOutput = stream.avail_out;
+      status = inflate(&stream, Z_NO_FLUSH);
+      position += (vtkIdType)(availableOutput - stream.avail_out);
+      if (status == Z_STREAM_END)
+      {
+        // Data compressed on multiple threads consists of concatenated gzip members (\sa CompressGzipMembers)
+        status = inflateReset(&stream);
+      }
+    }
+    inflateEnd(&stream);
+    return (position >= offset + length);
+  }
+
+  /// Data shared by the threads compressing a buffer (\sa CompressGzipMembers)
+  struct GzipCompressionData
+  {
+    const unsigned char* Data;
+    const std::vector<vtkIdType>* ChunkOffsets;
+    const std::vector<vtkIdType>* ChunkLengths;
+    int Level;
+    int Strategy;
+    int NumberOfThreads;
+    std::vector< std::vector<unsigned char> > Members;
+    std::vector<int> Success;
+  };
+
+  /// Compress a chunk of data into a complete gzip member
+  bool CompressGzipMember(const unsigned char* data, vtkIdType length, int level, int strategy, std::vector<unsigned char>& member)
+  {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15+16, 8, strategy) != Z_OK) // Write gzip header and trailer
+    {
+      return false;
+    }
+    // Some zlib versions do not include the size of the gzip header and trailer in the bound
+    member.resize(deflateBound(&stream, (uLong)length) + 32);
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = (uInt)length;
+    stream.next_out = &member[0];
+    stream.avail_out = (uInt)member.size();
+    int status = deflate(&stream, Z_FINISH);
+    member.resize(stream.total_out);
+    deflateEnd(&stream);
+    return (status == Z_STREAM_END);
+  }
+
+  VTK_THREAD_RETURN_TYPE CompressGzipMembersThreadFunction(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    GzipCompressionData* data = static_cast<GzipCompressionData*>(threadInfo->UserData);
+    if (!data)
+    {
+      return VTK_THREAD_RETURN_VALUE;
+    }
+    // Chunks are distributed among the threads in an interleaved order
+    int numberOfChunks = (int)data->Members.size();
+    for (int chunkIndex = threadInfo->ThreadID; chunkIndex < numberOfChunks; chunkIndex += data->NumberOfThreads)
+    {
+      data->Success[chunkIndex] = CompressGzipMember(data->Data + (*data->ChunkOffsets)[chunkIndex], (*data->ChunkLengths)[chunkIndex],
+        data->Level, data->Strategy, data->Members[chunkIndex]) ? 1 : 0;
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  /// Split a range of a buffer into chunks to be compressed (\sa CompressGzipMembers). The chunk boundaries only depend
+  /// on the range, not on the number of threads, so that the written file is always the same
+  void AddCompressionChunks(vtkIdType offset, vtkIdType length, std::vector<vtkIdType>& chunkOffsets, std::vector<vtkIdType>& chunkLengths)
+  {
+    for (vtkIdType chunkOffset = offset; chunkOffset < offset + length; chunkOffset += PARALLEL_COMPRESSION_CHUNK_SIZE)
+    {
+      chunkOffsets.push_back(chunkOffset);
+      chunkLengths.push_back(std::min(PARALLEL_COMPRESSION_CHUNK_SIZE, offset + length - chunkOffset));
+    }
+  }
+
+  /// Compress chunks of data into gzip members on multiple threads. Each chunk is compressed into a separate gzip member.
+  /// Concatenated gzip members are decompressed by gzip readers as one stream.
+  /// \param chunkOffsets Position of the chunks in the buffer (\sa AddCompressionChunks)
+  /// \param chunkLengths Length of the chunks
+  /// \param level Deflate compression level
+  /// \param strategy Deflate compression strategy
+  /// \param members Output compressed chunks
+  /// \return Success flag
+  bool CompressGzipMembers(const unsigned char* buffer, const std::vector<vtkIdType>& chunkOffsets, const std::vector<vtkIdType>& chunkLengths,
+    int level, int strategy, std::vector< std::vector<unsigned char> >& members)
+  {
+    int numberOfChunks = (int)chunkOffsets.size();
+    if (numberOfChunks == 0)
+    {
+      members.clear();
+      return true;
+    }
+    GzipCompressionData data;
+    data.Data = buffer;
+    data.ChunkOffsets = &chunkOffsets;
+    data.ChunkLengths = &chunkLengths;
+    data.Level = level;
+    data.Strategy = strategy;
+    data.NumberOfThreads = std::min( std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), numberOfChunks), (int)VTK_MAX_THREADS );
+    data.Members.resize(numberOfChunks);
+    data.Success.resize(numberOfChunks, 0);
+
+    if (data.NumberOfThreads < 2)
+    {
+      vtkMultiThreader::ThreadInfo threadInfo;
+      threadInfo.ThreadID = 0;
+      threadInfo.NumberOfThreads = 1;
+      threadInfo.UserData = &data;
+      CompressGzipMembersThreadFunction(&threadInfo);
+    }
+    else
+    {
+      vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+      threader->SetNumberOfThreads(data.NumberOfThreads);
+      threader->SetSingleMethod(CompressGzipMembersThreadFunction, &data);
+      threader->SingleMethodExecute();
+    }
+
+    if (std::find(data.Success.begin(), data.Success.end(), 0) != data.Success.end())
+    {
+      return false;
+    }
+    members.swap(data.Members);
+    return true;
+  }
+
+  /// Write a NRRD key/value pair. Backslashes and line breaks are escaped the same way as by the NRRD library
+  void WriteNrrdKeyValue(std::ostream& out, const std::string& key, const std::string& value)
+  {
+    std::string escapedValue;
+    escapedValue.reserve(value.size());
+    for (std::string::const_iterator charIt = value.begin(); charIt != value.end(); ++charIt)
+    {
+      if (*charIt == '\\')
+      {
+        escapedValue += "\\\\";
+      }
+      else if (*charIt == '\n')
+      {
+        escapedValue += "\\n";
+      }
+      else
+      {
+        escapedValue += (*charIt);
+      }
+    }
+    out << key << ":=" << escapedValue << "\n";
+  }
+
+  /// Set data mode and compressor of a VTK XML writer
+  void SetXMLWriterCompression(vtkXMLWriter* writer, bool useCompression, bool fastCompression)
+  {
+    if (useCompression)
+    {
+      writer->SetDataModeToBinary();
+      writer->SetCompressorTypeToZLib();
+      vtkZLibDataCompressor* compressor = vtkZLibDataCompressor::SafeDownCast(writer->GetCompressor());
+      if (compressor && fastCompression)
+      {
+        compressor->SetCompressionLevel(Z_BEST_SPEED);
+      }
+    }
+    else
+    {
+      writer->SetDataModeToAscii();
+      writer->SetCompressorTypeToNone();
+    }
+  }
+
+  /// Load the voxels of a segment from a file in sparse layout when its binary labelmap is first requested
+  /// (\sa vtkSegment::AddDeferredRepresentation)
+  class SparseSegmentLabelmapLoader : public vtkCommand
+  {
+  public:
+    static SparseSegmentLabelmapLoader* New()
+    {
+      return new SparseSegmentLabelmapLoader;
+    }
+
+    virtual void Execute(vtkObject* caller, unsigned long eventId, void* callData)
+    {
+      vtkSegment* segment = vtkSegment::SafeDownCast(caller);
+      const char* representationName = reinterpret_cast<const char*>(callData);
+      if ( !segment || eventId != vtkSegment::RepresentationDataRequestedEvent || !representationName
+        || strcmp(representationName, vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) )
+      {
+        return;
+      }
+      vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(segment->GetRepresentationObject(representationName));
+      if (!labelmap)
+      {
+        return;
+      }
+
+      int extent[6] = {0,-1,0,-1,0,-1};
+      labelmap->GetExtent(extent);
+      vtkIdType numberOfVoxels = GetNumberOfVoxelsInExtent(extent);
+      vtkSmartPointer<vtkUnsignedCharArray> scalars = vtkSmartPointer<vtkUnsignedCharArray>::New();
+      scalars->SetNumberOfComponents(1);
+      scalars->SetNumberOfTuples(numberOfVoxels);
+      if (!ReadNrrdDataRange(this->Path, this->DataOffset, this->GzipEncoding, this->CompressedSegmentOffset,
+        this->SegmentOffset, numberOfVoxels, scalars->GetPointer(0)))
+      {
+        vtkErrorWithObjectMacro(segment, "SparseSegmentLabelmapLoader: Failed to load voxels of segment " << (segment->GetName() ? segment->GetName() : "")
+          << " from file " << this->Path);
+        scalars->FillComponent(0, 0.0);
+      }
+
+      // Set voxels in place, as the labelmap is already observed by the segmentation. This invokes no event on
+      // the labelmap, but its modified time is updated. The segment records that time after the load, so loading
+      // does not make the segmentation modified since read (\sa vtkSegment::GetModifiedSinceRead)
+      labelmap->GetPointData()->SetScalars(scalars);
+
+      // Voxels are only loaded once
+      segment->RemoveObserver(this);
+    }
+
+    std::string Path;
+    std::streamoff DataOffset;
+    bool GzipEncoding;
+    vtkIdType SegmentOffset;
+    /// Position of the compressed voxels of the segment within the data, negative if unknown
+    vtkIdType CompressedSegmentOffset;
+
+  protected:
+    SparseSegmentLabelmapLoader()
+      : DataOffset(0)
+      , GzipEncoding(false)
+      , SegmentOffset(0)
+      , CompressedSegmentOffset(-1)
+    {
+    }
+  };
+
+  class MappedUnsignedCharArray;
+
+  /// Memory mapping of a file. The mapped pages are copied on first write, so the file itself is never modified.
+  /// The file must not be modified by others while it is mapped.
+  class SegmentationFileMapping : public vtkObject
+  {
+  public:
+    static SegmentationFileMapping* New()
+    {
+      return new SegmentationFileMapping;
+    }
+    vtkTypeMacro(SegmentationFileMapping, vtkObject);
+
+    /// Map the entire file
+    /// \return Success flag
+    bool Map(const std::string& path);
+
+    unsigned char* GetData() { return this->Data; };
+    vtkIdType GetSize() { return this->Size; };
+
+    /// Register array that uses the mapped data
+    void AddArray(MappedUnsignedCharArray* array) { this->Arrays.insert(array); };
+    /// Unregister array that no longer uses the mapped data
+    void RemoveArray(MappedUnsignedCharArray* array) { this->Arrays.erase(array); };
+
+    /// Copy the data of all arrays that use the mapping of a file into memory owned by the arrays, so that
+    /// the file is released. Needs to be called before the file is overwritten.
+    static void DetachArrays(const std::string& path);
+
+  protected:
+    SegmentationFileMapping()
+      : Data(NULL)
+      , Size(0)
+    {
+      GetInstances().insert(this);
+    }
+    ~SegmentationFileMapping()
+    {
+      GetInstances().erase(this);
+      if (this->Data)
+      {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        UnmapViewOfFile(this->Data);
+#else
+        munmap(this->Data, (size_t)this->Size);
+#endif
+      }
+    }
+
+    /// Existing file mappings, used for finding the mappings of a file
+    static std::set<SegmentationFileMapping*>& GetInstances()
+    {
+      static std::set<SegmentationFileMapping*> instances;
+      return instances;
+    }
+
+  protected:
+    std::string Path;
+    unsigned char* Data;
+    vtkIdType Size;
+    std::set<MappedUnsignedCharArray*> Arrays;
+  };
+
+  /// Unsigned char array that uses a range of a mapped file as data (\sa SegmentationFileMapping).
+  /// The array keeps the mapping alive until it is destroyed or detached.
+  class MappedUnsignedCharArray : public vtkUnsignedCharArray
+  {
+  public:
+    static MappedUnsignedCharArray* New()
+    {
+      return new MappedUnsignedCharArray;
+    }
+    vtkTypeMacro(MappedUnsignedCharArray, vtkUnsignedCharArray);
+
+    /// Use a range of a mapped file as the data of the array
+    void SetMappedData(SegmentationFileMapping* mapping, vtkIdType offset, vtkIdType numberOfValues)
+    {
+      this->Detach();
+      this->SetArray(mapping->GetData() + offset, numberOfValues, 1); // Mapped data is not freed by the array
+      this->Mapping = mapping;
+      mapping->AddArray(this);
+    }
+
+    /// Copy the mapped data into memory owned by the array and release the mapping
+    void Detach()
+    {
+      if (!this->Mapping)
+      {
+        return;
+      }
+      // Data may have already been reallocated by the array (e.g. when resized)
+      unsigned char* data = this->GetPointer(0);
+      vtkIdType numberOfValues = this->GetMaxId() + 1;
+      if (data >= this->Mapping->GetData() && data < this->Mapping->GetData() + this->Mapping->GetSize())
+      {
+        unsigned char* dataCopy = static_cast<unsigned char*>(malloc(std::max(numberOfValues, (vtkIdType)1)));
+        memcpy(dataCopy, data, numberOfValues);
+        this->SetArray(dataCopy, numberOfValues, 0);
+      }
+      this->Mapping->RemoveArray(this);
+      this->Mapping = NULL;
+    }
+
+  protected:
+    MappedUnsignedCharArray()
+    {
+    }
+    ~MappedUnsignedCharArray()
+    {
+      if (this->Mapping)
+      {
+        this->Mapping->RemoveArray(this);
+      }
+    }
+
+  protected:
+    vtkSmartPointer<SegmentationFileMapping> Mapping;
+  };
+
+  //----------------------------------------------------------------------------
+  bool SegmentationFileMapping::Map(const std::string& path)
+  {
+    if (this->Data)
+    {
+      return false;
+    }
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+      return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0 || (unsigned long long)fileSize.QuadPart > (size_t)-1)
+    {
+      CloseHandle(fileHandle);
+      return false;
+    }
+    // The view keeps the file and the mapping open
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(fileHandle);
+    if (!mappingHandle)
+    {
+      return false;
+    }
+    void* data = MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mappingHandle);
+    if (!data)
+    {
+      return false;
+    }
+    this->Size = (vtkIdType)fileSize.QuadPart;
+#else
+    int fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+      return false;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0 || (unsigned long long)fileStatus.st_size > (size_t)-1)
+    {
+      close(fileDescriptor);
+      return false;
+    }
+    // Private mapping: written pages are copied, the file is not changed. The mapping keeps the file open
+    void* data = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (data == MAP_FAILED)
+    {
+      return false;
+    }
+    this->Size = (vtkIdType)fileStatus.st_size;
+#endif
+    this->Data = static_cast<unsigned char*>(data);
+    this->Path = vtksys::SystemTools::CollapseFullPath(path.c_str());
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void SegmentationFileMapping::DetachArrays(const std::string& path)
+  {
+    std::string fullPath = vtksys::SystemTools::CollapseFullPath(path.c_str());
+    std::set<SegmentationFileMapping*> instances = GetInstances();
+    for (std::set<SegmentationFileMapping*>::iterator mappingIt = instances.begin(); mappingIt != instances.end(); ++mappingIt)
+    {
+      if ((*mappingIt)->Path != fullPath)
+      {
+        continue;
+      }
+      // Keep the mapping alive while its arrays are detached
+      vtkSmartPointer<SegmentationFileMapping> mapping = (*mappingIt);
+      std::set<MappedUnsignedCharArray*> arrays = mapping->Arrays;
+      for (std::set<MappedUnsignedCharArray*>::iterator arrayIt = arrays.begin(); arrayIt != arrays.end(); ++arrayIt)
+      {
+        (*arrayIt)->Detach();
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+/// State of the file that was last written or read by the storage node. Used for writing only the data of the segments
+/// that have been modified since then (\sa IncrementalWrite)
+class vtkMRMLSegmentationStorageNode::vtkInternal
+{
+public:
+  /// Data of a segment as it is stored in the file
+  struct SegmentEntry
+  {
+    SegmentEntry()
+      : HasCompressedChunks(false)
+    {
+      this->DefaultColor[0] = this->DefaultColor[1] = this->DefaultColor[2] = 0.0;
+      this->Extent[0] = this->Extent[2] = this->Extent[4] = 0;
+      this->Extent[1] = this->Extent[3] = this->Extent[5] = -1;
+    }
+
+    /// Stored master representation. It is compared by identity, so that replaced representations are detected
+    vtkWeakPointer<vtkDataObject> MasterRepresentation;
+    std::string Name;
+    double DefaultColor[3];
+    /// Effective extent of the stored binary labelmap in sparse layout
+    int Extent[6];
+    /// Compressed voxels of the stored binary labelmap in sparse layout (\sa CompressGzipMembers)
+    std::vector< std::vector<unsigned char> > CompressedChunks;
+    /// Flag indicating whether the compressed voxels are available. They are only kept when the segment is written
+    /// with parallel compression, segments that are read are compressed again when written
+    bool HasCompressedChunks;
+  };
+  typedef std::map<std::string, SegmentEntry> SegmentEntryMap;
+
+  vtkInternal()
+    : FileModifiedTime(0)
+    , FileLength(0)
+  {
+  }
+
+  /// Forget the stored state, so that the next write is complete
+  void Clear()
+  {
+    this->Path.clear();
+    this->Settings.clear();
+    this->SegmentIDs.clear();
+    this->Segments.clear();
+    this->Geometry = NULL;
+  }
+
+  /// Record the state of a file after it has been written or read
+  /// \param settings Settings and metadata that affect the data of all segments in the file
+  void SetFile(const std::string& path, const std::string& settings)
+  {
+    this->Path = vtksys::SystemTools::CollapseFullPath(path.c_str());
+    this->Settings = settings;
+    this->FileModifiedTime = vtksys::SystemTools::ModifiedTime(path.c_str());
+    this->FileLength = vtksys::SystemTools::FileLength(path.c_str());
+    this->Time.Modified();
+  }
+
+  /// Determine if the stored state describes a file, and the file has not been changed since it was written or read
+  bool IsValid(const std::string& path, const std::string& settings)
+  {
+    return ( !this->Path.empty() && this->Path == vtksys::SystemTools::CollapseFullPath(path.c_str()) && this->Settings == settings
+      && vtksys::SystemTools::FileExists(path.c_str())
+      && vtksys::SystemTools::ModifiedTime(path.c_str()) == this->FileModifiedTime
+      && vtksys::SystemTools::FileLength(path.c_str()) == this->FileLength );
+  }
+
+  /// Record a binary labelmap segment read from a file in sparse layout
+  /// \param extent Effective extent of the segment as stored in the file
+  void AddSparseSegment(const std::string& segmentId, vtkOrientedImageData* labelmap, const int extent[6])
+  {
+    SegmentEntry& segmentEntry = this->Segments[segmentId];
+    segmentEntry.MasterRepresentation = labelmap;
+    std::copy(extent, extent+6, segmentEntry.Extent);
+    this->SegmentIDs.push_back(segmentId);
+  }
+
+  /// Get the stored entry of a segment if its master representation has not been modified since it was stored
+  SegmentEntry* GetUnmodifiedSegmentEntry(const std::string& segmentId, vtkDataObject* masterRepresentation)
+  {
+    SegmentEntryMap::iterator entryIt = this->Segments.find(segmentId);
+    if ( entryIt == this->Segments.end() || !masterRepresentation
+      || entryIt->second.MasterRepresentation.GetPointer() != masterRepresentation
+      || masterRepresentation->GetMTime() > this->Time )
+    {
+      return NULL;
+    }
+    return &(entryIt->second);
+  }
+
+public:
+  std::string Path;
+  std::string Settings;
+  long FileModifiedTime;
+  unsigned long FileLength;
+  vtkTimeStamp Time;
+  /// Segment IDs in the order they are stored in the file
+  std::vector<std::string> SegmentIDs;
+  SegmentEntryMap Segments;
+  /// Common geometry of the binary labelmaps stored in sparse layout
+  vtkSmartPointer<vtkOrientedImageData> Geometry;
+};
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSegmentationStorageNode);
 
 //----------------------------------------------------------------------------
 vtkMRMLSegmentationStorageNode::vtkMRMLSegmentationStorageNode()
+  : SparseLayout(1)
+  , LazyLoading(0)
+  , MemoryMapping(0)
+  , ParallelCompression(1)
+  , FastCompression(0)
+  , IncrementalWrite(1)
 {
+  this->Internal = new vtkInternal();
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLSegmentationStorageNode::~vtkMRMLSegmentationStorageNode()
 {
+  delete this->Internal;
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLSegmentationStorageNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   vtkMRMLStorageNode::PrintSelf(os,indent);
+  os << indent << "SparseLayout: " << this->SparseLayout << "\n";
+  os << indent << "LazyLoading: " << this->LazyLoading << "\n";
+  os << indent << "MemoryMapping: " << this->MemoryMapping << "\n";
+  os << indent << "ParallelCompression: " << this->ParallelCompression << "\n";
+  os << indent << "FastCompression: " << this->FastCompression << "\n";
+  os << indent << "IncrementalWrite: " << this->IncrementalWrite << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -101,6 +975,31 @@ void vtkMRMLSegmentationStorageNode::ReadXMLAttributes(const char** atts)
   {
     attName = *(atts++);
     attValue = *(atts++);
+
+    if (!strcmp(attName, "sparseLayout"))
+    {
+      this->SparseLayout = (strcmp(attValue,"true") ? 0 : 1);
+    }
+    else if (!strcmp(attName, "lazyLoading"))
+    {
+      this->LazyLoading = (strcmp(attValue,"true") ? 0 : 1);
+    }
+    else if (!strcmp(attName, "memoryMapping"))
+    {
+      this->MemoryMapping = (strcmp(attValue,"true") ? 0 : 1);
+    }
+    else if (!strcmp(attName, "parallelCompression"))
+    {
+      this->ParallelCompression = (strcmp(attValue,"true") ? 0 : 1);
+    }
+    else if (!strcmp(attName, "fastCompression"))
+    {
+      this->FastCompression = (strcmp(attValue,"true") ? 0 : 1);
+    }
+    else if (!strcmp(attName, "incrementalWrite"))
+    {
+      this->IncrementalWrite = (strcmp(attValue,"true") ? 0 : 1);
+    }
   }
 
   this->EndModify(disabledModify);
@@ -111,6 +1010,13 @@ void vtkMRMLSegmentationStorageNode::WriteXML(ostream& of, int nIndent)
 {
   Superclass::WriteXML(of, nIndent);
   vtkIndent indent(nIndent);
+
+  of << indent << " sparseLayout=\"" << (this->SparseLayout ? "true" : "false") << "\"";
+  of << indent << " lazyLoading=\"" << (this->LazyLoading ? "true" : "false") << "\"";
+  of << indent << " memoryMapping=\"" << (this->MemoryMapping ? "true" : "false") << "\"";
+  of << indent << " parallelCompression=\"" << (this->ParallelCompression ? "true" : "false") << "\"";
+  of << indent << " fastCompression=\"" << (this->FastCompression ? "true" : "false") << "\"";
+  of << indent << " incrementalWrite=\"" << (this->IncrementalWrite ? "true" : "false") << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -122,6 +1028,12 @@ void vtkMRMLSegmentationStorageNode::Copy(vtkMRMLNode *anode)
 
   Superclass::Copy(anode);
   vtkMRMLSegmentationStorageNode *node = (vtkMRMLSegmentationStorageNode *) anode;
+  this->SetSparseLayout(node->GetSparseLayout());
+  this->SetLazyLoading(node->GetLazyLoading());
+  this->SetMemoryMapping(node->GetMemoryMapping());
+  this->SetParallelCompression(node->GetParallelCompression());
+  this->SetFastCompression(node->GetFastCompression());
+  this->SetIncrementalWrite(node->GetIncrementalWrite());
 
   this->EndModify(disabledModify);
 }
@@ -248,6 +1160,9 @@ int vtkMRMLSegmentationStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     return 0;
   }
 
+  // Segments are written entirely after reading, unless the state of the read file is recorded
+  this->Internal->Clear();
+
   // Try to read as labelmap first then as poly data
   if (this->ReadBinaryLabelmapRepresentation(segmentationNode->GetSegmentation(), fullName))
   {
@@ -279,6 +1194,12 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkSegmenta
     return 0;
   }
 
+  // Only read the header if segments are loaded on demand or mapped. Read the entire file if the file does not support it
+  if ((this->LazyLoading || this->MemoryMapping) && this->ReadBinaryLabelmapRepresentationLazy(segmentation, path))
+  {
+    return 1;
+  }
+
   // Read 4D NRRD image file
   typedef itk::ImageFileReader<BinaryLabelmap4DImageType> FileReaderType;
   FileReaderType::Pointer reader = FileReaderType::New();
@@ -315,6 +1236,28 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkSegmenta
   std::string containedRepresentationNames;
   itk::ExposeMetaData<std::string>(metadata, CONTAINED_REPRESENTATION_NAMES.c_str(), containedRepresentationNames);
 
+  // Sparse layout: each segment only stores its own extent
+  std::string layout;
+  itk::ExposeMetaData<std::string>(metadata, LAYOUT.c_str(), layout);
+  if (layout == LAYOUT_SPARSE)
+  {
+    segmentation->StartBatch();
+    BinaryLabelmap4DImageType::SizeType bufferSize = allSegmentLabelmapsImage->GetLargestPossibleRegion().GetSize();
+    vtkIdType bufferLength = (vtkIdType)bufferSize[0] * bufferSize[1] * bufferSize[2] * bufferSize[3];
+    bool success = this->ReadSparseSegmentLabelmaps(segmentation, metadata, allSegmentLabelmapsImage->GetBufferPointer(), bufferLength);
+    this->CreateRepresentationsBySerializedNames(segmentation, containedRepresentationNames);
+    segmentation->EndBatch();
+    if (!success)
+    {
+      vtkErrorMacro("ReadBinaryLabelmapRepresentation: Failed to read segments from file " << path);
+      this->Internal->Clear();
+      return 0;
+    }
+    // Record the state of the file, so that only the modified segments are processed when written to the same file
+    this->Internal->SetFile(path, GetSparseLayoutWriteSettings(this, segmentation->GetMasterRepresentationName()));
+    return 1;
+  }
+
   // Get image properties
   BinaryLabelmap4DImageType::RegionType itkRegion = allSegmentLabelmapsImage->GetLargestPossibleRegion();
   BinaryLabelmap4DImageType::PointType itkOrigin = allSegmentLabelmapsImage->GetOrigin();
@@ -332,7 +1275,8 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkSegmenta
     }
   }
 
-  // Read segment binary labelmaps
+  // Read segment binary labelmaps. Observers are notified about the loaded segments at once
+  segmentation->StartBatch();
   for (int segmentIndex = itkRegion.GetIndex()[3]; segmentIndex < itkRegion.GetIndex()[3]+itkRegion.GetSize()[3]; ++segmentIndex)
   {
     // Create segment
@@ -363,78 +1307,289 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkSegmenta
     ssDefaultColorValue >> currentSegmentDefaultColor[0] >> currentSegmentDefaultColor[1] >> currentSegmentDefaultColor[2];
     currentSegment->SetDefaultColor(currentSegmentDefaultColor);
 
-    std::stringstream ssExtentKey;
-    ssExtentKey << segmentIndex << SEGMENT_EXTENT;
-    std::string extentKey = ssExtentKey.str();
-    std::string extentValue;
-    itk::ExposeMetaData<std::string>(metadata, extentKey.c_str(), extentValue);
-    std::stringstream ssExtentValue;
-    ssExtentValue << extentValue;
-    int currentSegmentExtent[6] = {0,-1,0,-1,0,-1};
-    ssExtentValue >> currentSegmentExtent[0] >> currentSegmentExtent[1] >> currentSegmentExtent[2] >> currentSegmentExtent[3] >> currentSegmentExtent[4] >> currentSegmentExtent[5];
+    std::stringstream ssExtentKey;
+    ssExtentKey << segmentIndex << SEGMENT_EXTENT;
+    std::string extentKey = ssExtentKey.str();
+    std::string extentValue;
+    itk::ExposeMetaData<std::string>(metadata, extentKey.c_str(), extentValue);
+    std::stringstream ssExtentValue;
+    ssExtentValue << extentValue;
+    int currentSegmentExtent[6] = {0,-1,0,-1,0,-1};
+    ssExtentValue >> currentSegmentExtent[0] >> currentSegmentExtent[1] >> currentSegmentExtent[2] >> currentSegmentExtent[3] >> currentSegmentExtent[4] >> currentSegmentExtent[5];
+
+    //TODO: Parse tags with key SEGMENT_TAGS
+
+    // Create binary labelmap volume
+    vtkSmartPointer<vtkOrientedImageData> currentBinaryLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    currentBinaryLabelmap->SetOrigin(origin);
+    currentBinaryLabelmap->SetSpacing(spacing);
+    currentBinaryLabelmap->SetDirections(directions);
+    currentBinaryLabelmap->SetExtent(currentSegmentExtent);
+#if (VTK_MAJOR_VERSION <= 5)
+    currentBinaryLabelmap->SetScalarType(VTK_UNSIGNED_CHAR);
+    currentBinaryLabelmap->SetNumberOfScalarComponents(1);
+    currentBinaryLabelmap->AllocateScalars();
+#else
+    currentBinaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+    unsigned char* labelmapPtr = (unsigned char*)currentBinaryLabelmap->GetScalarPointerForExtent(currentSegmentExtent);
+    
+    // Define ITK region for current segment
+    BinaryLabelmap4DImageType::RegionType segmentRegion;
+    BinaryLabelmap4DImageType::SizeType segmentRegionSize;
+    BinaryLabelmap4DImageType::IndexType segmentRegionIndex;
+    segmentRegionIndex[0] = segmentRegionIndex[1] = segmentRegionIndex[2] = 0;
+    segmentRegionIndex[3] = segmentIndex;
+    segmentRegionSize = itkRegion.GetSize();
+    segmentRegionSize[3] = 1;
+    segmentRegion.SetIndex(segmentRegionIndex);
+    segmentRegion.SetSize(segmentRegionSize);
+
+    // Iterate through current segment's region and read voxel values into segment labelmap
+    BinaryLabelmap4DIteratorType segmentLabelmapIterator(allSegmentLabelmapsImage, segmentRegion);
+    for (segmentLabelmapIterator.GoToBegin(); !segmentLabelmapIterator.IsAtEnd(); ++segmentLabelmapIterator)
+    {
+      // Skip region outside extent of current segment (consider common extent boundaries)
+      BinaryLabelmap4DImageType::IndexType segmentIndex = segmentLabelmapIterator.GetIndex();
+      if ( segmentIndex[0] + commonGeometryExtent[0] < currentSegmentExtent[0]
+        || segmentIndex[0] + commonGeometryExtent[0] > currentSegmentExtent[1]
+        || segmentIndex[1] + commonGeometryExtent[2] < currentSegmentExtent[2]
+        || segmentIndex[1] + commonGeometryExtent[2] > currentSegmentExtent[3]
+        || segmentIndex[2] + commonGeometryExtent[4] < currentSegmentExtent[4]
+        || segmentIndex[2] + commonGeometryExtent[4] > currentSegmentExtent[5] )
+      {
+        continue;
+      }
+
+      // Get voxel value
+      unsigned char voxelValue = segmentLabelmapIterator.Get();
+
+      // Set voxel value in current segment labelmap
+      (*labelmapPtr) = voxelValue;
+      ++labelmapPtr;
+    }
+
+    // Set loaded binary labelmap to segment
+    currentSegment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), currentBinaryLabelmap);
+
+    // Add segment to segmentation
+    segmentation->AddSegment(currentSegment, currentSegmentID);
+  }
+
+  // Create contained representations now that all the data is loaded
+  this->CreateRepresentationsBySerializedNames(segmentation, containedRepresentationNames);
+  segmentation->EndBatch();
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSegmentationStorageNode::ReadSparseSegmentLabelmaps(vtkSegmentation* segmentation, const itk::MetaDataDictionary& metadata,
+  const unsigned char* buffer, vtkIdType bufferLength)
+{
+  // Geometry of the segments is stored in the metadata, as the image itself only contains the segment voxels
+  std::string geometryString;
+  itk::ExposeMetaData<std::string>(metadata, GEOMETRY.c_str(), geometryString);
+  vtkSmartPointer<vtkOrientedImageData> commonGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (!vtkSegmentationConverter::DeserializeImageGeometry(geometryString, commonGeometryImage))
+  {
+    vtkErrorMacro("ReadSparseSegmentLabelmaps: Invalid segmentation geometry: " << geometryString);
+    return false;
+  }
+  this->Internal->Geometry = commonGeometryImage;
+
+  // Segments are read until there are no more segment IDs in the metadata
+  bool success = true;
+  for (int segmentIndex = 0; ; ++segmentIndex)
+  {
+    // Create segment
+    vtkSmartPointer<vtkSegment> currentSegment = vtkSmartPointer<vtkSegment>::New();
+    std::string currentSegmentID;
+    int currentSegmentExtent[6] = {0,-1,0,-1,0,-1};
+    vtkIdType currentSegmentOffset = 0;
+    if (!ReadSparseSegmentMetaData(metadata, segmentIndex, currentSegment, currentSegmentID, currentSegmentExtent, currentSegmentOffset))
+    {
+      break;
+    }
+
+    // Create binary labelmap volume. Empty segments are stored with an empty extent
+    vtkSmartPointer<vtkOrientedImageData> currentBinaryLabelmap = CreateSparseSegmentLabelmap(commonGeometryImage, currentSegmentExtent);
+#if (VTK_MAJOR_VERSION <= 5)
+    currentBinaryLabelmap->AllocateScalars();
+#else
+    currentBinaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+
+    // Voxels of the segment are stored contiguously in the same order as in the labelmap
+    vtkIdType numberOfVoxels = GetNumberOfVoxelsInExtent(currentSegmentExtent);
+    if (currentSegmentOffset < 0 || currentSegmentOffset + numberOfVoxels > bufferLength)
+    {
+      vtkErrorMacro("ReadSparseSegmentLabelmaps: Voxels of segment " << currentSegmentID << " are outside the stored image data");
+      success = false;
+      continue;
+    }
+    if (numberOfVoxels > 0)
+    {
+      memcpy(currentBinaryLabelmap->GetScalarPointer(), buffer + currentSegmentOffset, numberOfVoxels);
+    }
+
+    // Set loaded binary labelmap to segment
+    currentSegment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), currentBinaryLabelmap);
+
+    // Add segment to segmentation
+    segmentation->AddSegment(currentSegment, currentSegmentID);
+
+    // Record the segment as stored, so that its effective extent is reused when written to the same file (\sa IncrementalWrite)
+    this->Internal->AddSparseSegment(currentSegmentID, currentBinaryLabelmap, currentSegmentExtent);
+  }
+
+  return success;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentationLazy(vtkSegmentation* segmentation, std::string path)
+{
+  // Read header of the file
+  itk::NrrdImageIO::Pointer io = itk::NrrdImageIO::New();
+  if (!io->CanReadFile(path.c_str()))
+  {
+    return 0;
+  }
+  io->SetFileName(path.c_str());
+  try
+  {
+    io->ReadImageInformation();
+  }
+  catch (itk::ExceptionObject &error)
+  {
+    vtkDebugMacro("ReadBinaryLabelmapRepresentationLazy: Failed to read header of file " << path << ". Exception:\n" << error);
+    return 0;
+  }
+  const itk::MetaDataDictionary& metadata = io->GetMetaDataDictionary();
+
+  // Segments can only be loaded individually if they are stored in sparse layout and the data can be located in the file
+  std::string layout;
+  itk::ExposeMetaData<std::string>(metadata, LAYOUT.c_str(), layout);
+  std::streamoff dataOffset = 0;
+  bool gzipEncoding = false;
+  if ( layout != LAYOUT_SPARSE || io->GetComponentType() != itk::ImageIOBase::UCHAR
+    || !GetNrrdDataLocation(path, dataOffset, gzipEncoding) )
+  {
+    vtkDebugMacro("ReadBinaryLabelmapRepresentationLazy: Segments cannot be loaded on demand from file " << path);
+    return 0;
+  }
+
+  // Map the file if the voxels are stored uncompressed, otherwise they are loaded on demand if requested
+  vtkSmartPointer<SegmentationFileMapping> fileMapping;
+  if (this->MemoryMapping && !gzipEncoding)
+  {
+    fileMapping = vtkSmartPointer<SegmentationFileMapping>::New();
+    if (!fileMapping->Map(path))
+    {
+      vtkWarningMacro("ReadBinaryLabelmapRepresentationLazy: Failed to map file " << path << " to memory");
+      fileMapping = NULL;
+    }
+  }
+  if (!fileMapping && !this->LazyLoading)
+  {
+    return 0;
+  }
+
+  std::string geometryString;
+  itk::ExposeMetaData<std::string>(metadata, GEOMETRY.c_str(), geometryString);
+  vtkSmartPointer<vtkOrientedImageData> commonGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  if (!vtkSegmentationConverter::DeserializeImageGeometry(geometryString, commonGeometryImage))
+  {
+    vtkErrorMacro("ReadBinaryLabelmapRepresentationLazy: Invalid segmentation geometry: " << geometryString);
+    return 0;
+  }
 
-    //TODO: Parse tags with key SEGMENT_TAGS
+  // Header read succeeded, set master representation
+  segmentation->SetMasterRepresentationName(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+  // Read conversion parameters
+  std::string conversionParameters;
+  itk::ExposeMetaData<std::string>(metadata, CONVERSION_PARAMETERS.c_str(), conversionParameters);
+  segmentation->DeserializeConversionParameters(conversionParameters);
+  // Read contained representation names
+  std::string containedRepresentationNames;
+  itk::ExposeMetaData<std::string>(metadata, CONTAINED_REPRESENTATION_NAMES.c_str(), containedRepresentationNames);
 
-    // Create binary labelmap volume
-    vtkSmartPointer<vtkOrientedImageData> currentBinaryLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
-    currentBinaryLabelmap->SetOrigin(origin);
-    currentBinaryLabelmap->SetSpacing(spacing);
-    currentBinaryLabelmap->SetDirections(directions);
-    currentBinaryLabelmap->SetExtent(currentSegmentExtent);
-#if (VTK_MAJOR_VERSION <= 5)
-    currentBinaryLabelmap->SetScalarType(VTK_UNSIGNED_CHAR);
-    currentBinaryLabelmap->SetNumberOfScalarComponents(1);
-    currentBinaryLabelmap->AllocateScalars();
-#else
-    currentBinaryLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-#endif
-    unsigned char* labelmapPtr = (unsigned char*)currentBinaryLabelmap->GetScalarPointerForExtent(currentSegmentExtent);
-    
-    // Define ITK region for current segment
-    BinaryLabelmap4DImageType::RegionType segmentRegion;
-    BinaryLabelmap4DImageType::SizeType segmentRegionSize;
-    BinaryLabelmap4DImageType::IndexType segmentRegionIndex;
-    segmentRegionIndex[0] = segmentRegionIndex[1] = segmentRegionIndex[2] = 0;
-    segmentRegionIndex[3] = segmentIndex;
-    segmentRegionSize = itkRegion.GetSize();
-    segmentRegionSize[3] = 1;
-    segmentRegion.SetIndex(segmentRegionIndex);
-    segmentRegion.SetSize(segmentRegionSize);
+  // Create segments with labelmaps that use the voxels in the mapped file, or labelmaps
+  // that only contain the geometry and load the voxels when first requested
+  bool success = true;
+  segmentation->StartBatch();
+  for (int segmentIndex = 0; ; ++segmentIndex)
+  {
+    vtkSmartPointer<vtkSegment> currentSegment = vtkSmartPointer<vtkSegment>::New();
+    std::string currentSegmentID;
+    int currentSegmentExtent[6] = {0,-1,0,-1,0,-1};
+    vtkIdType currentSegmentOffset = 0;
+    if (!ReadSparseSegmentMetaData(metadata, segmentIndex, currentSegment, currentSegmentID, currentSegmentExtent, currentSegmentOffset))
+    {
+      break;
+    }
 
-    // Iterate through current segment's region and read voxel values into segment labelmap
-    BinaryLabelmap4DIteratorType segmentLabelmapIterator(allSegmentLabelmapsImage, segmentRegion);
-    for (segmentLabelmapIterator.GoToBegin(); !segmentLabelmapIterator.IsAtEnd(); ++segmentLabelmapIterator)
+    vtkSmartPointer<vtkOrientedImageData> currentBinaryLabelmap = CreateSparseSegmentLabelmap(commonGeometryImage, currentSegmentExtent);
+    if (fileMapping)
     {
-      // Skip region outside extent of current segment (consider common extent boundaries)
-      BinaryLabelmap4DImageType::IndexType segmentIndex = segmentLabelmapIterator.GetIndex();
-      if ( segmentIndex[0] + commonGeometryExtent[0] < currentSegmentExtent[0]
-        || segmentIndex[0] + commonGeometryExtent[0] > currentSegmentExtent[1]
-        || segmentIndex[1] + commonGeometryExtent[2] < currentSegmentExtent[2]
-        || segmentIndex[1] + commonGeometryExtent[2] > currentSegmentExtent[3]
-        || segmentIndex[2] + commonGeometryExtent[4] < currentSegmentExtent[4]
-        || segmentIndex[2] + commonGeometryExtent[4] > currentSegmentExtent[5] )
+      vtkIdType numberOfVoxels = GetNumberOfVoxelsInExtent(currentSegmentExtent);
+      vtkIdType fileOffset = (vtkIdType)dataOffset + currentSegmentOffset;
+      if (currentSegmentOffset < 0 || fileOffset + numberOfVoxels > fileMapping->GetSize())
       {
+        vtkErrorMacro("ReadBinaryLabelmapRepresentationLazy: Voxels of segment " << currentSegmentID << " are outside the stored image data");
+        success = false;
         continue;
       }
-
-      // Get voxel value
-      unsigned char voxelValue = segmentLabelmapIterator.Get();
-
-      // Set voxel value in current segment labelmap
-      (*labelmapPtr) = voxelValue;
-      ++labelmapPtr;
+      vtkSmartPointer<MappedUnsignedCharArray> scalars = vtkSmartPointer<MappedUnsignedCharArray>::New();
+      scalars->SetMappedData(fileMapping, fileOffset, numberOfVoxels);
+      currentBinaryLabelmap->GetPointData()->SetScalars(scalars);
+      currentSegment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), currentBinaryLabelmap);
+    }
+    else
+    {
+      vtkSmartPointer<SparseSegmentLabelmapLoader> loader = vtkSmartPointer<SparseSegmentLabelmapLoader>::New();
+      loader->Path = path;
+      loader->DataOffset = dataOffset;
+      loader->GzipEncoding = gzipEncoding;
+      loader->SegmentOffset = currentSegmentOffset;
+      // Files compressed on multiple threads store where the compressed voxels of each segment start. Without it,
+      // all data before the segment needs to be decompressed
+      std::string compressedOffsetValue;
+      if ( gzipEncoding && itk::ExposeMetaData<std::string>(metadata,
+        GetSegmentMetaDataKey(segmentIndex, SEGMENT_COMPRESSED_OFFSET).c_str(), compressedOffsetValue) )
+      {
+        std::stringstream ssCompressedOffsetValue;
+        ssCompressedOffsetValue << compressedOffsetValue;
+        vtkIdType compressedSegmentOffset = -1;
+        if (ssCompressedOffsetValue >> compressedSegmentOffset)
+        {
+          loader->CompressedSegmentOffset = compressedSegmentOffset;
+        }
+      }
+      currentSegment->AddObserver(vtkSegment::RepresentationDataRequestedEvent, loader);
+      currentSegment->AddDeferredRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), currentBinaryLabelmap);
     }
 
-    // Set loaded binary labelmap to segment
-    currentSegment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), currentBinaryLabelmap);
-
-    // Add segment to segmentation
     segmentation->AddSegment(currentSegment, currentSegmentID);
+
+    // Record the segment as stored, so that its effective extent is reused when written to the same file (\sa IncrementalWrite).
+    // Voxels that are not loaded yet are loaded before the file is overwritten, as they are compressed again
+    this->Internal->AddSparseSegment(currentSegmentID, currentBinaryLabelmap, currentSegmentExtent);
   }
 
-  // Create contained representations now that all the data is loaded
-  this->CreateRepresentationsBySerializedNames(segmentation, containedRepresentationNames);
+  // Contained representations are created from the master representation only when requested if loading lazily
+  this->CreateRepresentationsBySerializedNames(segmentation, containedRepresentationNames, this->LazyLoading != 0);
+  segmentation->EndBatch();
 
+  if (!success)
+  {
+    vtkErrorMacro("ReadBinaryLabelmapRepresentationLazy: Failed to read segments from file " << path);
+    this->Internal->Clear();
+    return 0;
+  }
+  // Record the state of the file, so that only the modified segments are processed when written to the same file
+  this->Internal->Geometry = commonGeometryImage;
+  this->Internal->SetFile(path, GetSparseLayoutWriteSettings(this, segmentation->GetMasterRepresentationName()));
   return 1;
 }
 
@@ -468,9 +1623,10 @@ int vtkMRMLSegmentationStorageNode::ReadPolyDataRepresentation(vtkSegmentation*
     return 0;
   }
 
-  // Read segment poly datas
+  // Read segment poly datas. Observers are notified about the loaded segments at once
   std::string containedRepresentationNames("");
   std::string conversionParameters("");
+  segmentation->StartBatch();
   for (int blockIndex=0; blockIndex<multiBlockDataset->GetNumberOfBlocks(); ++blockIndex)
   {
     // Get poly data representation
@@ -485,6 +1641,7 @@ int vtkMRMLSegmentationStorageNode::ReadPolyDataRepresentation(vtkSegmentation*
       if (!masterRepresentationArray)
       {
         vtkErrorMacro("ReadPolyDataRepresentation: Unable to find master representation for segmentation in file " << path);
+        segmentation->EndBatch();
         return 0;
       }
       segmentation->SetMasterRepresentationName(masterRepresentationArray->GetValue(0).c_str());
@@ -528,10 +1685,24 @@ int vtkMRMLSegmentationStorageNode::ReadPolyDataRepresentation(vtkSegmentation*
 
     // Add segment to segmentation
     segmentation->AddSegment(currentSegment, currentSegmentID);
+
+    // Record the segment as stored, so that only the modified segments are written to the same file (\sa IncrementalWrite)
+    vtkInternal::SegmentEntry& segmentEntry = this->Internal->Segments[currentSegmentID];
+    segmentEntry.MasterRepresentation = currentPolyData;
+    segmentEntry.Name = (currentSegment->GetName() ? currentSegment->GetName() : "");
+    currentSegment->GetDefaultColor(segmentEntry.DefaultColor);
+    this->Internal->SegmentIDs.push_back(currentSegmentID);
   }
 
   // Create contained representations now that all the data is loaded
   this->CreateRepresentationsBySerializedNames(segmentation, containedRepresentationNames);
+  segmentation->EndBatch();
+
+  std::stringstream ssWriteSettings;
+  ssWriteSettings << this->UseCompression << this->FastCompression << segmentation->GetMasterRepresentationName()
+    << SERIALIZATION_SEPARATOR << segmentation->SerializeAllConversionParameters()
+    << SERIALIZATION_SEPARATOR << this->SerializeContainedRepresentationNames(segmentation);
+  this->Internal->SetFile(path, ssWriteSettings.str());
 
   return 1;
 }
@@ -553,6 +1724,9 @@ int vtkMRMLSegmentationStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     return 0;
   }
 
+  // Voxels that are used directly from the mapped file need to be copied before the file is overwritten
+  SegmentationFileMapping::DetachArrays(fullName);
+
   // Write only master representation
   vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
   const char* masterRepresentation = segmentation->GetMasterRepresentationName();
@@ -588,6 +1762,15 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkSegment
     return 0;
   }
 
+  // Only store the effective extent of each segment if requested
+  if (this->SparseLayout)
+  {
+    return this->WriteSparseBinaryLabelmapRepresentation(segmentation, fullName);
+  }
+
+  // Segments are always written entirely in this layout
+  this->Internal->Clear();
+
   // Determine merged labelmap dimensions and properties
   std::string commonGeometryString = segmentation->DetermineCommonLabelmapGeometry();
   vtkSmartPointer<vtkOrientedImageData> commonGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
@@ -801,6 +1984,210 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkSegment
   itkLabelmapImage->SetMetaDataDictionary(metadata);
 
   // Write image file to disk
+  return this->WriteBinaryLabelmapImage(itkLabelmapImage, fullName);
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSegmentationStorageNode::WriteSparseBinaryLabelmapRepresentation(vtkSegmentation* segmentation, std::string fullName)
+{
+  const char* masterRepresentation = segmentation->GetMasterRepresentationName();
+
+  // Determine common geometry. Segments are resampled to it if necessary, but only the effective extent
+  // of each segment is stored, so the size of the data depends on the total volume of the segments
+  std::string commonGeometryString = segmentation->DetermineCommonLabelmapGeometry();
+  vtkSmartPointer<vtkOrientedImageData> commonGeometryImage = vtkSmartPointer<vtkOrientedImageData>::New();
+  vtkSegmentationConverter::DeserializeImageGeometry(commonGeometryString, commonGeometryImage);
+
+  // Create metadata dictionary
+  itk::MetaDataDictionary metadata;
+  itk::EncapsulateMetaData<std::string>(metadata, LAYOUT.c_str(), LAYOUT_SPARSE);
+  itk::EncapsulateMetaData<std::string>(metadata, GEOMETRY.c_str(), commonGeometryString);
+  // Save master representation name
+  itk::EncapsulateMetaData<std::string>(metadata, MASTER_REPRESENTATION.c_str(), masterRepresentation);
+  // Save conversion parameters
+  std::string conversionParameters = segmentation->SerializeAllConversionParameters();
+  itk::EncapsulateMetaData<std::string>(metadata, CONVERSION_PARAMETERS.c_str(), conversionParameters);
+  // Save created representation names so that they are re-created when loading
+  std::string containedRepresentationNames = this->SerializeContainedRepresentationNames(segmentation);
+  itk::EncapsulateMetaData<std::string>(metadata, CONTAINED_REPRESENTATION_NAMES.c_str(), containedRepresentationNames);
+
+  // The effective extent and the compressed voxels of the segments that have not been modified since they were written
+  // to the same file are reused (\sa IncrementalWrite). The metadata is small, it is always written.
+  bool compressedWrite = (this->UseCompression && this->ParallelCompression);
+  std::string writeSettings = GetSparseLayoutWriteSettings(this, masterRepresentation);
+  bool incrementalWrite = ( this->IncrementalWrite && this->Internal->IsValid(fullName, writeSettings)
+    && this->Internal->Geometry && vtkOrientedImageDataResample::DoGeometriesMatch(commonGeometryImage, this->Internal->Geometry) );
+  vtkInternal writtenFile;
+  std::vector<std::string>& segmentIDs = writtenFile.SegmentIDs;
+  vtkInternal::SegmentEntryMap& segmentEntries = writtenFile.Segments;
+
+  // Collect segment labelmaps and determine where their voxels are stored in the output
+  std::vector<vtkOrientedImageData*> segmentLabelmaps; // NULL if the stored compressed voxels are reused
+  std::vector<vtkIdType> segmentOffsets;
+  vtkIdType numberOfVoxels = 0;
+  vtkSegmentation::SegmentMap segmentMap = segmentation->GetSegments();
+  for (vtkSegmentation::SegmentMap::iterator segmentIt = segmentMap.begin(); segmentIt != segmentMap.end(); ++segmentIt)
+  {
+    std::string currentSegmentID = segmentIt->first;
+    vtkSegment* currentSegment = segmentIt->second.GetPointer();
+
+    // Get master representation from segment. The representation is not accessed if its stored voxels are reused,
+    // so that representations that are loaded on demand are not loaded (\sa LazyLoading)
+    vtkInternal::SegmentEntry* storedSegmentEntry = NULL;
+    if (incrementalWrite)
+    {
+      storedSegmentEntry = this->Internal->GetUnmodifiedSegmentEntry(currentSegmentID, currentSegment->GetRepresentationObject(masterRepresentation));
+    }
+    // Compressed voxels are only available if the segment was written, not if it was read
+    bool reuseCompressedVoxels = (storedSegmentEntry && compressedWrite && storedSegmentEntry->HasCompressedChunks);
+    vtkOrientedImageData* currentBinaryLabelmap = NULL;
+    if (!reuseCompressedVoxels)
+    {
+      currentBinaryLabelmap = vtkOrientedImageData::SafeDownCast(currentSegment->GetRepresentation(masterRepresentation));
+      if (!currentBinaryLabelmap)
+      {
+        vtkErrorMacro("WriteSparseBinaryLabelmapRepresentation: Failed to retrieve master representation from segment " << currentSegmentID);
+        continue;
+      }
+    }
+
+    int effectiveExtent[6] = {0,-1,0,-1,0,-1};
+    if (storedSegmentEntry)
+    {
+      // Geometry of the segment still matches the common geometry, the effective extent has not changed
+      std::copy(storedSegmentEntry->Extent, storedSegmentEntry->Extent+6, effectiveExtent);
+    }
+    else
+    {
+      // Resample current binary labelmap representation to common geometry if necessary
+      if (!vtkOrientedImageDataResample::DoGeometriesMatch(commonGeometryImage, currentBinaryLabelmap))
+      {
+        bool success = vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+          currentBinaryLabelmap, commonGeometryImage, currentBinaryLabelmap );
+        if (!success)
+        {
+          vtkWarningMacro("WriteSparseBinaryLabelmapRepresentation: Segment " << currentSegmentID << " cannot be resampled to common geometry!");
+          continue;
+        }
+      }
+
+      // Only a few scalar types are supported
+      int currentLabelScalarType = currentBinaryLabelmap->GetScalarType();
+      if ( currentLabelScalarType != VTK_UNSIGNED_CHAR
+        && currentLabelScalarType != VTK_UNSIGNED_SHORT
+        && currentLabelScalarType != VTK_SHORT )
+      {
+        vtkWarningMacro("WriteSparseBinaryLabelmapRepresentation: Segment " << currentSegmentID << " cannot be written! Binary labelmap scalar type must be unsigned char, unsighed short, or short!");
+        continue;
+      }
+
+      // Only the region containing non-zero voxels is stored. Empty segments are stored with an empty extent
+      vtkOrientedImageDataResample::CalculateEffectiveExtent(currentBinaryLabelmap, effectiveExtent);
+    }
+    vtkIdType currentNumberOfVoxels = GetNumberOfVoxelsInExtent(effectiveExtent);
+
+    // Set metadata for current segment
+    int segmentIndex = (int)segmentIDs.size();
+    itk::EncapsulateMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_ID).c_str(), currentSegmentID);
+    itk::EncapsulateMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_NAME).c_str(), std::string(currentSegment->GetName()));
+
+    std::stringstream ssDefaultColorValue;
+    ssDefaultColorValue << currentSegment->GetDefaultColor()[0] << " " << currentSegment->GetDefaultColor()[1] << " " << currentSegment->GetDefaultColor()[2];
+    itk::EncapsulateMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_DEFAULT_COLOR).c_str(), ssDefaultColorValue.str());
+
+    std::stringstream ssExtentValue;
+    ssExtentValue << effectiveExtent[0] << " " << effectiveExtent[1] << " " << effectiveExtent[2]
+      << " " << effectiveExtent[3] << " " << effectiveExtent[4] << " " << effectiveExtent[5];
+    itk::EncapsulateMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_EXTENT).c_str(), ssExtentValue.str());
+
+    std::stringstream ssOffsetValue;
+    ssOffsetValue << numberOfVoxels;
+    itk::EncapsulateMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_OFFSET).c_str(), ssOffsetValue.str());
+
+    // Each tag is followed by a separator, so empty tags are preserved. Tags must not contain the separator
+    std::vector<std::string> tags;
+    currentSegment->GetTags(tags);
+    std::stringstream ssTagsValue;
+    for (std::vector<std::string>::iterator tagIt = tags.begin(); tagIt != tags.end(); ++tagIt)
+    {
+      ssTagsValue << (*tagIt) << SERIALIZATION_SEPARATOR;
+    }
+    itk::EncapsulateMetaData<std::string>(metadata, GetSegmentMetaDataKey(segmentIndex, SEGMENT_TAGS).c_str(), ssTagsValue.str());
+
+    // Record the segment as stored. The master representation may have been replaced by resampling
+    vtkInternal::SegmentEntry& segmentEntry = segmentEntries[currentSegmentID];
+    segmentEntry.MasterRepresentation = currentSegment->GetRepresentationObject(masterRepresentation);
+    std::copy(effectiveExtent, effectiveExtent+6, segmentEntry.Extent);
+    if (reuseCompressedVoxels)
+    {
+      segmentEntry.CompressedChunks.swap(storedSegmentEntry->CompressedChunks);
+    }
+
+    segmentIDs.push_back(currentSegmentID);
+    segmentLabelmaps.push_back(reuseCompressedVoxels ? NULL : currentBinaryLabelmap);
+    segmentOffsets.push_back(numberOfVoxels);
+    numberOfVoxels += currentNumberOfVoxels;
+  } // For each segment
+
+  // The voxels of all segments are stored one after the other. The voxels are split into rows to keep the length
+  // of the axes limited. The image geometry is meaningless, the geometry of the segments is stored in the metadata
+  vtkIdType rowLength = std::max((vtkIdType)1, std::min(numberOfVoxels, SPARSE_LAYOUT_ROW_LENGTH));
+  vtkIdType numberOfRows = std::max((vtkIdType)1, (numberOfVoxels + rowLength - 1) / rowLength);
+
+  // Forget the previous state of the file, it is overwritten
+  this->Internal->Clear();
+
+  int success = 0;
+  if (compressedWrite)
+  {
+    success = this->WriteCompressedSparseBinaryLabelmapImage(metadata, rowLength, numberOfRows, segmentLabelmaps, &writtenFile, fullName);
+  }
+  else
+  {
+    BinaryLabelmap4DImageType::SizeType regionSize;
+    BinaryLabelmap4DImageType::IndexType regionIndex;
+    regionSize[0] = rowLength;
+    regionSize[1] = numberOfRows;
+    regionSize[2] = regionSize[3] = 1;
+    regionIndex.Fill(0);
+    BinaryLabelmap4DImageType::RegionType region;
+    region.SetSize(regionSize);
+    region.SetIndex(regionIndex);
+
+    BinaryLabelmap4DImageType::Pointer itkLabelmapImage = BinaryLabelmap4DImageType::New();
+    itkLabelmapImage->SetRegions(region);
+    itkLabelmapImage->Allocate();
+    // Only the padding at the end of the last row needs to be initialized
+    unsigned char* bufferPtr = itkLabelmapImage->GetBufferPointer();
+    memset(bufferPtr + numberOfVoxels, 0, rowLength * numberOfRows - numberOfVoxels);
+
+    // Copy voxels of the effective extents
+    for (unsigned int segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+    {
+      CopySegmentVoxelsToBuffer(segmentLabelmaps[segmentIndex], segmentEntries[segmentIDs[segmentIndex]].Extent,
+        bufferPtr + segmentOffsets[segmentIndex]);
+    }
+
+    // Set metadata to ITK image
+    itkLabelmapImage->SetMetaDataDictionary(metadata);
+
+    // Write image file to disk
+    success = this->WriteBinaryLabelmapImage(itkLabelmapImage, fullName);
+  }
+
+  if (success && this->IncrementalWrite)
+  {
+    this->Internal->Segments.swap(segmentEntries);
+    this->Internal->SegmentIDs.swap(segmentIDs);
+    this->Internal->Geometry = commonGeometryImage;
+    this->Internal->SetFile(fullName, writeSettings);
+  }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapImage(BinaryLabelmap4DImageType* itkLabelmapImage, std::string fullName)
+{
   itk::NrrdImageIO::Pointer io = itk::NrrdImageIO::New();
   io->SetFileType(itk::ImageIOBase::Binary);
 
@@ -824,6 +2211,124 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkSegment
   return 1;
 }
 
+//----------------------------------------------------------------------------
+int vtkMRMLSegmentationStorageNode::WriteCompressedSparseBinaryLabelmapImage(const itk::MetaDataDictionary& metadata,
+  vtkIdType rowLength, vtkIdType numberOfRows, const std::vector<vtkOrientedImageData*>& segmentLabelmaps,
+  vtkInternal* writtenFile, std::string fullName)
+{
+  const std::vector<std::string>& segmentIDs = writtenFile->SegmentIDs;
+  vtkInternal::SegmentEntryMap& segmentEntries = writtenFile->Segments;
+
+  // Collect the voxels of the segments that need to be compressed (the ones that have a labelmap), followed by the
+  // padding at the end of the last row. Voxels of each segment are compressed into separate gzip members,
+  // so that they can be reused in the next write
+  vtkIdType numberOfVoxels = 0;
+  std::vector<vtkIdType> bufferOffsets(1, 0);
+  for (unsigned int segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+  {
+    vtkIdType segmentNumberOfVoxels = GetNumberOfVoxelsInExtent(segmentEntries[segmentIDs[segmentIndex]].Extent);
+    numberOfVoxels += segmentNumberOfVoxels;
+    bufferOffsets.push_back(bufferOffsets.back() + (segmentLabelmaps[segmentIndex] ? segmentNumberOfVoxels : 0));
+  }
+  vtkIdType paddingLength = rowLength * numberOfRows - numberOfVoxels;
+  std::vector<unsigned char> buffer(std::max((vtkIdType)1, bufferOffsets.back() + paddingLength), 0);
+
+  std::vector<vtkIdType> chunkOffsets;
+  std::vector<vtkIdType> chunkLengths;
+  std::vector<unsigned int> chunkSegmentIndices; // Index of the segment of each chunk, number of segments for the padding
+  for (unsigned int segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+  {
+    CopySegmentVoxelsToBuffer(segmentLabelmaps[segmentIndex], segmentEntries[segmentIDs[segmentIndex]].Extent, &buffer[0] + bufferOffsets[segmentIndex]);
+    AddCompressionChunks(bufferOffsets[segmentIndex], bufferOffsets[segmentIndex+1] - bufferOffsets[segmentIndex], chunkOffsets, chunkLengths);
+    chunkSegmentIndices.resize(chunkOffsets.size(), segmentIndex);
+  }
+  AddCompressionChunks(bufferOffsets.back(), paddingLength, chunkOffsets, chunkLengths);
+  chunkSegmentIndices.resize(chunkOffsets.size(), (unsigned int)segmentIDs.size());
+
+  // Compress voxels
+  std::vector< std::vector<unsigned char> > compressedChunks;
+  int level = (this->FastCompression ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION);
+  int strategy = (this->FastCompression ? Z_RLE : Z_DEFAULT_STRATEGY);
+  if (!CompressGzipMembers(&buffer[0], chunkOffsets, chunkLengths, level, strategy, compressedChunks))
+  {
+    vtkErrorMacro("WriteCompressedSparseBinaryLabelmapImage: Failed to compress segmentation voxels");
+    return 0;
+  }
+  std::vector< std::vector<unsigned char> > paddingChunks;
+  for (unsigned int chunkIndex = 0; chunkIndex < compressedChunks.size(); ++chunkIndex)
+  {
+    unsigned int segmentIndex = chunkSegmentIndices[chunkIndex];
+    std::vector< std::vector<unsigned char> >& chunks = (segmentIndex < segmentIDs.size()
+      ? segmentEntries[segmentIDs[segmentIndex]].CompressedChunks : paddingChunks);
+    chunks.push_back(std::vector<unsigned char>());
+    chunks.back().swap(compressedChunks[chunkIndex]);
+  }
+  for (unsigned int segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+  {
+    segmentEntries[segmentIDs[segmentIndex]].HasCompressedChunks = true;
+  }
+
+  std::ofstream file(fullName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    vtkErrorMacro("Failed to write segmentation to file " << fullName);
+    return 0;
+  }
+
+  // Write header. Voxels are unsigned char, so the endianness does not need to be specified
+  file << "NRRD0004\n";
+  file << "# Complete NRRD file format specification at:\n";
+  file << "# http://teem.sourceforge.net/nrrd/format.html\n";
+  file << "type: unsigned char\n";
+  file << "dimension: 4\n";
+  file << "sizes: " << rowLength << " " << numberOfRows << " 1 1\n";
+  file << "encoding: gzip\n";
+  std::vector<std::string> keys = metadata.GetKeys();
+  for (std::vector<std::string>::iterator keyIt = keys.begin(); keyIt != keys.end(); ++keyIt)
+  {
+    std::string value;
+    if (itk::ExposeMetaData<std::string>(metadata, *keyIt, value))
+    {
+      WriteNrrdKeyValue(file, *keyIt, value);
+    }
+  }
+  // The compressed voxels of each segment start with a new gzip member. Store their position within the data,
+  // so that segments loaded on demand are decompressed from there (\sa LazyLoading)
+  vtkIdType compressedOffset = 0;
+  for (unsigned int segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+  {
+    std::stringstream ssCompressedOffsetValue;
+    ssCompressedOffsetValue << compressedOffset;
+    WriteNrrdKeyValue(file, GetSegmentMetaDataKey(segmentIndex, SEGMENT_COMPRESSED_OFFSET), ssCompressedOffsetValue.str());
+    std::vector< std::vector<unsigned char> >& chunks = segmentEntries[segmentIDs[segmentIndex]].CompressedChunks;
+    for (std::vector< std::vector<unsigned char> >::iterator chunkIt = chunks.begin(); chunkIt != chunks.end(); ++chunkIt)
+    {
+      compressedOffset += (vtkIdType)chunkIt->size();
+    }
+  }
+  // Header is terminated by an empty line
+  file << "\n";
+
+  // Write compressed voxels of the segments in order, then the padding
+  for (unsigned int segmentIndex = 0; segmentIndex <= segmentIDs.size(); ++segmentIndex)
+  {
+    std::vector< std::vector<unsigned char> >& chunks = (segmentIndex < segmentIDs.size()
+      ? segmentEntries[segmentIDs[segmentIndex]].CompressedChunks : paddingChunks);
+    for (std::vector< std::vector<unsigned char> >::iterator chunkIt = chunks.begin(); chunkIt != chunks.end(); ++chunkIt)
+    {
+      file.write(reinterpret_cast<const char*>(&(*chunkIt)[0]), chunkIt->size());
+    }
+  }
+  file.close();
+  if (file.fail())
+  {
+    vtkErrorMacro("Failed to write segmentation to file " << fullName);
+    return 0;
+  }
+
+  return 1;
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLSegmentationStorageNode::WritePolyDataRepresentation(vtkSegmentation* segmentation, std::string path)
 {
@@ -843,6 +2348,25 @@ int vtkMRMLSegmentationStorageNode::WritePolyDataRepresentation(vtkSegmentation*
     return 0;
   }
 
+  // Metadata stored in each segment file
+  std::string conversionParameters = segmentation->SerializeAllConversionParameters();
+  std::string containedRepresentationNames = this->SerializeContainedRepresentationNames(segmentation);
+
+  // If the same segments are stored in the file that was last written or read, and the metadata stored in each segment file
+  // is the same, then only the files of the modified segments are written. The multiblock file and the other segment files
+  // are kept (\sa IncrementalWrite)
+  std::stringstream ssWriteSettings;
+  ssWriteSettings << this->UseCompression << this->FastCompression << masterRepresentation
+    << SERIALIZATION_SEPARATOR << conversionParameters << SERIALIZATION_SEPARATOR << containedRepresentationNames;
+  vtkInternal writtenFile;
+  segmentation->GetSegmentIDs(writtenFile.SegmentIDs);
+  bool incrementalWrite = ( this->IncrementalWrite && this->Internal->IsValid(path, ssWriteSettings.str())
+    && this->Internal->SegmentIDs == writtenFile.SegmentIDs );
+  for (unsigned int segmentIndex = 0; incrementalWrite && segmentIndex < writtenFile.SegmentIDs.size(); ++segmentIndex)
+  {
+    incrementalWrite = vtksys::SystemTools::FileExists(this->GetPolyDataBlockFileName(path, segmentIndex).c_str());
+  }
+
   // Initialize dataset to write
   vtkSmartPointer<vtkMultiBlockDataSet> multiBlockDataset = vtkSmartPointer<vtkMultiBlockDataSet>::New();
   multiBlockDataset->SetNumberOfBlocks(segmentation->GetNumberOfSegments());
@@ -862,6 +2386,22 @@ int vtkMRMLSegmentationStorageNode::WritePolyDataRepresentation(vtkSegmentation*
       vtkErrorMacro("WritePolyDataRepresentation: Failed to retrieve master representation from segment " << currentSegmentID);
       continue;
     }
+
+    // Record the segment as stored. Segments that have not changed since they were stored are skipped
+    vtkInternal::SegmentEntry& segmentEntry = writtenFile.Segments[currentSegmentID];
+    segmentEntry.MasterRepresentation = currentPolyData;
+    segmentEntry.Name = (currentSegment->GetName() ? currentSegment->GetName() : "");
+    currentSegment->GetDefaultColor(segmentEntry.DefaultColor);
+    if (incrementalWrite)
+    {
+      vtkInternal::SegmentEntry* storedSegmentEntry = this->Internal->GetUnmodifiedSegmentEntry(currentSegmentID, currentPolyData);
+      if ( storedSegmentEntry && storedSegmentEntry->Name == segmentEntry.Name
+        && std::equal(segmentEntry.DefaultColor, segmentEntry.DefaultColor+3, storedSegmentEntry->DefaultColor) )
+      {
+        continue;
+      }
+    }
+
     // Make temporary duplicate of the poly data so that adding the metadata does not cause invalidating the other
     // representations (which is done when the master representation is modified)
     vtkSmartPointer<vtkPolyData> currentPolyDataCopy = vtkSmartPointer<vtkPolyData>::New();
@@ -896,7 +2436,6 @@ int vtkMRMLSegmentationStorageNode::WritePolyDataRepresentation(vtkSegmentation*
     //TODO: Store tags with key SEGMENT_TAGS
 
     // Save conversion parameters as metadata (save in each segment file)
-    std::string conversionParameters = segmentation->SerializeAllConversionParameters();
     vtkSmartPointer<vtkStringArray> conversionParametersArray = vtkSmartPointer<vtkStringArray>::New();
     conversionParametersArray->SetNumberOfValues(1);
     conversionParametersArray->SetValue(0,conversionParameters);
@@ -904,36 +2443,54 @@ int vtkMRMLSegmentationStorageNode::WritePolyDataRepresentation(vtkSegmentation*
     currentPolyDataCopy->GetFieldData()->AddArray(conversionParametersArray);
 
     // Save contained representation names as metadata (save in each segment file)
-    std::string containedRepresentationNames = this->SerializeContainedRepresentationNames(segmentation);
     vtkSmartPointer<vtkStringArray> containedRepresentationNamesArray = vtkSmartPointer<vtkStringArray>::New();
     containedRepresentationNamesArray->SetNumberOfValues(1);
     containedRepresentationNamesArray->SetValue(0,containedRepresentationNames);
     containedRepresentationNamesArray->SetName(CONTAINED_REPRESENTATION_NAMES.c_str());
     currentPolyDataCopy->GetFieldData()->AddArray(containedRepresentationNamesArray);
 
+    if (incrementalWrite)
+    {
+      // Overwrite only the file of the modified segment, at the location the multiblock writer puts it
+      vtkSmartPointer<vtkXMLPolyDataWriter> segmentWriter = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+      segmentWriter->SetInputData(currentPolyDataCopy);
+      segmentWriter->SetFileName(this->GetPolyDataBlockFileName(path, segmentIndex).c_str());
+      SetXMLWriterCompression(segmentWriter, this->UseCompression, this->FastCompression);
+      if (!segmentWriter->Write())
+      {
+        vtkErrorMacro("WritePolyDataRepresentation: Failed to write segment " << currentSegmentID << " to file " << segmentWriter->GetFileName());
+        this->Internal->Clear();
+        return 0;
+      }
+      continue;
+    }
+
     // Set segment poly data to dataset
     multiBlockDataset->SetBlock(segmentIndex, currentPolyDataCopy);
   }
 
-  // Write multiblock dataset to disk
-  vtkSmartPointer<vtkXMLMultiBlockDataWriter> writer = vtkSmartPointer<vtkXMLMultiBlockDataWriter>::New();
-  writer->SetInputData(multiBlockDataset);
-  writer->SetFileName(path.c_str());
-  if (this->UseCompression)
+  if (!incrementalWrite)
   {
-    writer->SetDataModeToBinary();
-    writer->SetCompressorTypeToZLib();
+    // Write multiblock dataset to disk
+    vtkSmartPointer<vtkXMLMultiBlockDataWriter> writer = vtkSmartPointer<vtkXMLMultiBlockDataWriter>::New();
+    writer->SetInputData(multiBlockDataset);
+    writer->SetFileName(path.c_str());
+    SetXMLWriterCompression(writer, this->UseCompression, this->FastCompression);
+    writer->Write();
   }
-  else
-  {
-    writer->SetDataModeToAscii();
-    writer->SetCompressorTypeToNone();
-  }
-  writer->Write();
 
   // Add all files to storage node (multiblock dataset writes segments to individual files in a separate folder)
   this->AddPolyDataFileNames(path, segmentation);
 
+  // Record the state of the written file
+  this->Internal->Clear();
+  if (this->IncrementalWrite)
+  {
+    this->Internal->Segments.swap(writtenFile.Segments);
+    this->Internal->SegmentIDs.swap(writtenFile.SegmentIDs);
+    this->Internal->SetFile(path, ssWriteSettings.str());
+  }
+
   return 1;
 }
 
@@ -948,18 +2505,24 @@ void vtkMRMLSegmentationStorageNode::AddPolyDataFileNames(std::string path, vtkS
 
   this->AddFileName(path.c_str());
 
-  std::string fileNameWithoutExtension = vtksys::SystemTools::GetFilenameWithoutLastExtension(path);
-  std::string parentDirectory = vtksys::SystemTools::GetParentDirectory(path);
-  std::string multiBlockDirectory = parentDirectory + "/" + fileNameWithoutExtension;
   for (int segmentIndex = 0; segmentIndex < segmentation->GetNumberOfSegments(); ++segmentIndex)
   {
-    std::stringstream ssSegmentFilePath;
-    ssSegmentFilePath << multiBlockDirectory << "/" << fileNameWithoutExtension << "_" << segmentIndex << ".vtp";
-    std::string segmentFilePath = ssSegmentFilePath.str();
+    std::string segmentFilePath = this->GetPolyDataBlockFileName(path, segmentIndex);
     this->AddFileName(segmentFilePath.c_str());
   }
 }
 
+//----------------------------------------------------------------------------
+std::string vtkMRMLSegmentationStorageNode::GetPolyDataBlockFileName(std::string path, int blockIndex)
+{
+  std::string fileNameWithoutExtension = vtksys::SystemTools::GetFilenameWithoutLastExtension(path);
+  std::string parentDirectory = vtksys::SystemTools::GetParentDirectory(path);
+  std::string multiBlockDirectory = parentDirectory + "/" + fileNameWithoutExtension;
+  std::stringstream ssSegmentFilePath;
+  ssSegmentFilePath << multiBlockDirectory << "/" << fileNameWithoutExtension << "_" << blockIndex << ".vtp";
+  return ssSegmentFilePath.str();
+}
+
 //----------------------------------------------------------------------------
 std::string vtkMRMLSegmentationStorageNode::SerializeContainedRepresentationNames(vtkSegmentation* segmentation)
 {
@@ -982,7 +2545,7 @@ std::string vtkMRMLSegmentationStorageNode::SerializeContainedRepresentationName
 }
 
 //----------------------------------------------------------------------------
-void vtkMRMLSegmentationStorageNode::CreateRepresentationsBySerializedNames(vtkSegmentation* segmentation, std::string representationNames)
+void vtkMRMLSegmentationStorageNode::CreateRepresentationsBySerializedNames(vtkSegmentation* segmentation, std::string representationNames, bool deferred/*=false*/)
 {
   if (!segmentation || segmentation->GetNumberOfSegments() == 0 || !segmentation->GetMasterRepresentationName())
   {
@@ -1002,7 +2565,16 @@ void vtkMRMLSegmentationStorageNode::CreateRepresentationsBySerializedNames(vtkS
     std::string representationName = representationNames.substr(0, separatorPosition);
 
     // Only create non-master representations
-    if (representationName.compare(masterRepresentation))
+    if (representationName.compare(masterRepresentation) && deferred)
+    {
+      // Mark representation as evicted in all segments, so that it is converted when requested
+      vtkSegmentation::SegmentMap segmentMap = segmentation->GetSegments();
+      for (vtkSegmentation::SegmentMap::iterator segmentIt = segmentMap.begin(); segmentIt != segmentMap.end(); ++segmentIt)
+      {
+        segmentIt->second->EvictRepresentation(representationName);
+      }
+    }
+    else if (representationName.compare(masterRepresentation))
     {
       segmentation->CreateRepresentation(representationName);
     }
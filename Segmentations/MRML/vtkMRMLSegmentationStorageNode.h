@@ -50,6 +50,8 @@ class VTK_SLICER_SEGMENTATIONS_MODULE_MRML_EXPORT vtkMRMLSegmentationStorageNode
   typedef itk::Image<unsigned char, 4> BinaryLabelmap4DImageType;
   typedef itk::ImageRegionIteratorWithIndex<BinaryLabelmap4DImageType> BinaryLabelmap4DIteratorType;
 
+  class vtkInternal;
+
 public:
   static vtkMRMLSegmentationStorageNode *New();
   vtkTypeMacro(vtkMRMLSegmentationStorageNode, vtkMRMLStorageNode);
@@ -78,6 +80,61 @@ public:
   /// Reset supported write file types. Called when master representation is changed
   void ResetSupportedWriteFileTypes();
 
+  /// Write binary labelmaps in sparse layout, in which only the effective extent (the region containing
+  /// non-zero voxels) of each segment is stored, instead of the common extent for all segments.
+  /// Reading and writing cost then depends on the total volume of the segments. On by default.
+  /// Files in both layouts can be read regardless of this flag.
+  vtkSetMacro(SparseLayout, int);
+  vtkGetMacro(SparseLayout, int);
+  vtkBooleanMacro(SparseLayout, int);
+
+  /// Only read the header and segment properties when reading binary labelmap segmentations, and load the voxels
+  /// of each segment when they are first accessed (\sa vtkSegment::AddDeferredRepresentation). Reduces load time
+  /// and memory usage if only some of the segments are used. The file must be available until all used segments are loaded.
+  /// Only supported for .seg.nrrd files in sparse layout (\sa SparseLayout), other files are read entirely.
+  /// In files compressed on multiple threads (\sa ParallelCompression) the position of the compressed voxels of each segment
+  /// is stored, so a segment is decompressed on its own. In other compressed files all data before the segment is decompressed.
+  /// Off by default.
+  vtkSetMacro(LazyLoading, int);
+  vtkGetMacro(LazyLoading, int);
+  vtkBooleanMacro(LazyLoading, int);
+
+  /// Map uncompressed binary labelmap segmentation files to memory when reading, and use the voxels in the mapped file
+  /// directly as segment labelmaps instead of copying them. The mapped pages are only read when accessed, and copied when
+  /// first written, so the file is never modified. The file must not be modified by other processes while it is mapped.
+  /// Only supported for .seg.nrrd files in sparse layout (\sa SparseLayout), other files are read entirely. Off by default.
+  vtkSetMacro(MemoryMapping, int);
+  vtkGetMacro(MemoryMapping, int);
+  vtkBooleanMacro(MemoryMapping, int);
+
+  /// Compress binary labelmap segmentation files on multiple threads if compression is enabled (\sa UseCompression).
+  /// The voxels are split into chunks that are compressed independently and stored as concatenated gzip members,
+  /// which standard gzip capable NRRD readers decode as a single stream. Only used for the sparse layout (\sa SparseLayout),
+  /// files in the common extent layout are compressed on a single thread. On by default.
+  vtkSetMacro(ParallelCompression, int);
+  vtkGetMacro(ParallelCompression, int);
+  vtkBooleanMacro(ParallelCompression, int);
+
+  /// Use the fastest compression settings when writing segmentation files: lowest deflate level with run-length
+  /// encoding strategy for binary labelmaps in sparse layout, lowest level for poly data. Files are larger but written
+  /// several times faster, which is useful for intermediate and cache files. The files remain readable by standard readers.
+  /// Off by default.
+  vtkSetMacro(FastCompression, int);
+  vtkGetMacro(FastCompression, int);
+  vtkBooleanMacro(FastCompression, int);
+
+  /// When writing to the same file that was last written or read by this storage node, only write the data of the segments
+  /// that have been modified since then. For multiblock files (.seg.vtm) only the files of the modified segments are written.
+  /// For binary labelmaps in sparse layout (\sa SparseLayout) the effective extent and the compressed voxels of unmodified
+  /// segments are reused, so that only the modified segments are scanned and compressed, at the cost of keeping the
+  /// compressed voxels in memory. Compressed voxels are only kept after writing, so after reading only the effective
+  /// extents are reused and all segments are compressed in the first write.
+  /// The written files are complete and do not depend on the previous state of the file.
+  /// On by default.
+  vtkSetMacro(IncrementalWrite, int);
+  vtkGetMacro(IncrementalWrite, int);
+  vtkBooleanMacro(IncrementalWrite, int);
+
 protected:
   /// Initialize all the supported read file types
   virtual void InitializeSupportedReadFileTypes();
@@ -94,6 +151,25 @@ protected:
   /// Write binary labelmap representation to file
   virtual int WriteBinaryLabelmapRepresentation(vtkSegmentation* segmentation, std::string path);
 
+  /// Write binary labelmap representation to file in sparse layout (\sa SparseLayout).
+  /// The voxels of the effective extents of the segments are stored one after the other. The geometry and
+  /// the offset and extent of each segment are stored in the metadata.
+  virtual int WriteSparseBinaryLabelmapRepresentation(vtkSegmentation* segmentation, std::string path);
+
+  /// Write image containing binary labelmap voxels and metadata to NRRD file
+  int WriteBinaryLabelmapImage(BinaryLabelmap4DImageType* itkLabelmapImage, std::string path);
+
+  /// Write binary labelmap voxels in sparse layout and metadata to gzip compressed NRRD file, compressing the voxels
+  /// on multiple threads (\sa ParallelCompression). The voxels of each segment are compressed separately, and the
+  /// compressed voxels of the segments without labelmap are taken from the stored state (\sa IncrementalWrite).
+  /// \param rowLength Size of the first axis of the image containing the voxels of all segments
+  /// \param numberOfRows Size of the second axis of the image
+  /// \param segmentLabelmaps Labelmap of each written segment, NULL if the compressed voxels of the segment are reused
+  /// \param writtenFile Segments in the order they are written, with their effective extent and stored compressed voxels.
+  ///          The compressed voxels of the segments are updated
+  int WriteCompressedSparseBinaryLabelmapImage(const itk::MetaDataDictionary& metadata, vtkIdType rowLength, vtkIdType numberOfRows,
+    const std::vector<vtkOrientedImageData*>& segmentLabelmaps, vtkInternal* writtenFile, std::string path);
+
   /// Write a poly data representation to file
   virtual int WritePolyDataRepresentation(vtkSegmentation* segmentation, std::string path);
 
@@ -103,6 +179,15 @@ protected:
   /// Read binary labelmap representation to file
   virtual int ReadBinaryLabelmapRepresentation(vtkSegmentation* segmentation, std::string path);
 
+  /// Read binary labelmap representation header from file and create segments that use the voxels in the mapped file
+  /// (\sa MemoryMapping) or load their voxels on demand (\sa LazyLoading).
+  /// Returns with failure without changing the segmentation if the file does not support it
+  virtual int ReadBinaryLabelmapRepresentationLazy(vtkSegmentation* segmentation, std::string path);
+
+  /// Create segments from the metadata and voxels read from a file in sparse layout (\sa WriteSparseBinaryLabelmapRepresentation)
+  bool ReadSparseSegmentLabelmaps(vtkSegmentation* segmentation, const itk::MetaDataDictionary& metadata,
+    const unsigned char* buffer, vtkIdType bufferLength);
+
   /// Read a poly data representation to file
   virtual int ReadPolyDataRepresentation(vtkSegmentation* segmentation, std::string path);
 
@@ -110,16 +195,42 @@ protected:
   /// (multiblock dataset writes segments to individual files in a separate folder)
   void AddPolyDataFileNames(std::string path, vtkSegmentation* segmentation);
 
+  /// Get the path of the file a block of a multiblock dataset is written to by the multiblock writer
+  std::string GetPolyDataBlockFileName(std::string path, int blockIndex);
+
   /// Serialize contained representation names in a string
   std::string SerializeContainedRepresentationNames(vtkSegmentation* segmentation);
 
   /// Create representations based on serialized representation names string
-  void CreateRepresentationsBySerializedNames(vtkSegmentation* segmentation, std::string representationNames);
+  /// \param deferred If true, then the representations are only converted when first requested
+  void CreateRepresentationsBySerializedNames(vtkSegmentation* segmentation, std::string representationNames, bool deferred=false);
 
 protected:
   vtkMRMLSegmentationStorageNode();
   ~vtkMRMLSegmentationStorageNode();
 
+protected:
+  /// Flag determining whether binary labelmaps are written in sparse layout
+  int SparseLayout;
+
+  /// Flag determining whether segment voxels are loaded on demand
+  int LazyLoading;
+
+  /// Flag determining whether uncompressed segmentation files are mapped to memory when reading
+  int MemoryMapping;
+
+  /// Flag determining whether binary labelmap segmentation files are compressed on multiple threads
+  int ParallelCompression;
+
+  /// Flag determining whether the fastest compression settings are used
+  int FastCompression;
+
+  /// Flag determining whether only the modified segments are written
+  int IncrementalWrite;
+
+  /// State of the file that was last written or read
+  vtkInternal* Internal;
+
 private:
   vtkMRMLSegmentationStorageNode(const vtkMRMLSegmentationStorageNode&);  /// Not implemented.
   void operator=(const vtkMRMLSegmentationStorageNode&);  /// Not implemented.
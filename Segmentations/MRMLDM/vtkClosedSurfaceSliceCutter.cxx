@@ -0,0 +1,337 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkClosedSurfaceSliceCutter.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+// Average number of triangles per bucket along the plane normal
+static const vtkIdType NUMBER_OF_TRIANGLES_PER_BUCKET = 32;
+// Maximum number of buckets along the plane normal
+static const vtkIdType MAXIMUM_NUMBER_OF_BUCKETS = 65536;
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkClosedSurfaceSliceCutter);
+
+//----------------------------------------------------------------------------
+vtkClosedSurfaceSliceCutter::vtkClosedSurfaceSliceCutter()
+{
+  this->Plane = NULL;
+  this->NumberOfCachedContours = 16;
+  this->Normal[0] = this->Normal[1] = this->Normal[2] = 0.0;
+  this->BucketsOrigin = 0.0;
+  this->BucketSize = 1.0;
+  this->TrianglesOnly = true;
+}
+
+//----------------------------------------------------------------------------
+vtkClosedSurfaceSliceCutter::~vtkClosedSurfaceSliceCutter()
+{
+  this->SetPlane(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkClosedSurfaceSliceCutter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Plane: " << this->Plane << "\n";
+  os << indent << "NumberOfCachedContours: " << this->NumberOfCachedContours << "\n";
+  os << indent << "NumberOfBuckets: " << this->Buckets.size() << "\n";
+  os << indent << "TrianglesOnly: " << (this->TrianglesOnly ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkClosedSurfaceSliceCutter::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (this->Plane)
+    {
+    mTime = std::max(mTime, (unsigned long)this->Plane->GetMTime());
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkClosedSurfaceSliceCutter::RequestData(
+  vtkInformation* vtkNotUsed(request), vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::SafeDownCast(inputVector[0]->GetInformationObject(0)->Get(vtkDataObject::DATA_OBJECT()));
+  vtkPolyData* output = vtkPolyData::SafeDownCast(outputVector->GetInformationObject(0)->Get(vtkDataObject::DATA_OBJECT()));
+  if (!input || !output)
+    {
+    vtkErrorMacro("RequestData: Invalid input or output!");
+    return 0;
+    }
+  if (!this->Plane)
+    {
+    vtkErrorMacro("RequestData: No cutting plane is set!");
+    return 0;
+    }
+
+  // Position of the plane along its unit normal
+  double normal[3] = {0.0,0.0,0.0};
+  this->Plane->GetNormal(normal);
+  if (vtkMath::Normalize(normal) == 0.0)
+    {
+    vtkErrorMacro("RequestData: Invalid cutting plane normal!");
+    return 0;
+    }
+  double offset = vtkMath::Dot(normal, this->Plane->GetOrigin());
+
+  // Sort the triangles again if the surface or the orientation of the plane changed
+  if ( input != this->Surface || input->GetMTime() > this->BucketsBuildTime.GetMTime()
+    || normal[0] != this->Normal[0] || normal[1] != this->Normal[1] || normal[2] != this->Normal[2] )
+    {
+    this->BuildBuckets(input, normal);
+    }
+
+  // Use cached contour if the plane was cut recently
+  for (std::list< std::pair< double, vtkSmartPointer<vtkPolyData> > >::iterator contourIt = this->CachedContours.begin();
+    contourIt != this->CachedContours.end(); ++contourIt)
+    {
+    if (contourIt->first == offset)
+      {
+      this->CachedContours.splice(this->CachedContours.begin(), this->CachedContours, contourIt);
+      output->ShallowCopy(contourIt->second);
+      return 1;
+      }
+    }
+
+  vtkSmartPointer<vtkPolyData> contour = vtkSmartPointer<vtkPolyData>::New();
+  if (this->TrianglesOnly)
+    {
+    this->CutSurface(input, offset, contour);
+    }
+  else
+    {
+    // Vertices, lines and polygons that are not triangles are cut as vtkCutter does
+    if (!this->Cutter)
+      {
+      this->Cutter = vtkSmartPointer<vtkCutter>::New();
+      }
+    this->Cutter->SetCutFunction(this->Plane);
+#if (VTK_MAJOR_VERSION <= 5)
+    this->Cutter->SetInput(input);
+#else
+    this->Cutter->SetInputData(input);
+#endif
+    this->Cutter->Update();
+    contour->DeepCopy(this->Cutter->GetOutput());
+    }
+  output->ShallowCopy(contour);
+
+  if (this->NumberOfCachedContours > 0)
+    {
+    this->CachedContours.push_front(std::make_pair(offset, contour));
+    while ((int)this->CachedContours.size() > this->NumberOfCachedContours)
+      {
+      this->CachedContours.pop_back();
+      }
+    }
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkClosedSurfaceSliceCutter::BuildBuckets(vtkPolyData* surface, const double normal[3])
+{
+  this->Surface = surface;
+  this->Normal[0] = normal[0];
+  this->Normal[1] = normal[1];
+  this->Normal[2] = normal[2];
+  this->TrianglePointIds.clear();
+  this->PointOffsets.clear();
+  this->Buckets.clear();
+  this->CachedContours.clear();
+  this->BucketsBuildTime.Modified();
+  this->TrianglesOnly = (surface->GetNumberOfVerts() == 0 && surface->GetNumberOfLines() == 0);
+
+  vtkPoints* points = surface->GetPoints();
+  if (!points || points->GetNumberOfPoints() == 0)
+    {
+    return;
+    }
+
+  // Triangulate strips as they are defined. Other polygons than triangles are cut by vtkCutter
+  vtkIdType numberOfPoints = 0;
+  vtkIdType* pointIds = NULL;
+  vtkCellArray* polys = surface->GetPolys();
+  for (polys->InitTraversal(); this->TrianglesOnly && polys->GetNextCell(numberOfPoints, pointIds); )
+    {
+    if (numberOfPoints != 3)
+      {
+      this->TrianglesOnly = false;
+      break;
+      }
+    this->TrianglePointIds.push_back(pointIds[0]);
+    this->TrianglePointIds.push_back(pointIds[1]);
+    this->TrianglePointIds.push_back(pointIds[2]);
+    }
+  if (!this->TrianglesOnly)
+    {
+    this->TrianglePointIds.clear();
+    return;
+    }
+  vtkCellArray* strips = surface->GetStrips();
+  for (strips->InitTraversal(); strips->GetNextCell(numberOfPoints, pointIds); )
+    {
+    for (vtkIdType i = 0; i + 2 < numberOfPoints; ++i)
+      {
+      this->TrianglePointIds.push_back(pointIds[i]);
+      this->TrianglePointIds.push_back(pointIds[i+1]);
+      this->TrianglePointIds.push_back(pointIds[i+2]);
+      }
+    }
+  vtkIdType numberOfTriangles = (vtkIdType)this->TrianglePointIds.size() / 3;
+  if (numberOfTriangles == 0)
+    {
+    return;
+    }
+
+  // Position of the points along the normal
+  this->PointOffsets.resize(points->GetNumberOfPoints());
+  double minimumOffset = VTK_DOUBLE_MAX;
+  double maximumOffset = VTK_DOUBLE_MIN;
+  for (vtkIdType pointId = 0; pointId < points->GetNumberOfPoints(); ++pointId)
+    {
+    double point[3] = {0.0,0.0,0.0};
+    points->GetPoint(pointId, point);
+    double pointOffset = vtkMath::Dot(normal, point);
+    this->PointOffsets[pointId] = pointOffset;
+    minimumOffset = std::min(minimumOffset, pointOffset);
+    maximumOffset = std::max(maximumOffset, pointOffset);
+    }
+
+  // Add each triangle to the buckets its range along the normal overlaps
+  vtkIdType numberOfBuckets = std::max((vtkIdType)1, std::min(MAXIMUM_NUMBER_OF_BUCKETS, numberOfTriangles / NUMBER_OF_TRIANGLES_PER_BUCKET));
+  this->BucketsOrigin = minimumOffset;
+  this->BucketSize = (maximumOffset > minimumOffset ? (maximumOffset - minimumOffset) / numberOfBuckets : 1.0);
+  this->Buckets.resize(numberOfBuckets);
+  for (vtkIdType triangleIndex = 0; triangleIndex < numberOfTriangles; ++triangleIndex)
+    {
+    const vtkIdType* trianglePointIds = &(this->TrianglePointIds[3*triangleIndex]);
+    double triangleMinimum = std::min(this->PointOffsets[trianglePointIds[0]],
+      std::min(this->PointOffsets[trianglePointIds[1]], this->PointOffsets[trianglePointIds[2]]));
+    double triangleMaximum = std::max(this->PointOffsets[trianglePointIds[0]],
+      std::max(this->PointOffsets[trianglePointIds[1]], this->PointOffsets[trianglePointIds[2]]));
+    vtkIdType firstBucket = std::min(numberOfBuckets - 1, (vtkIdType)((triangleMinimum - this->BucketsOrigin) / this->BucketSize));
+    vtkIdType lastBucket = std::min(numberOfBuckets - 1, (vtkIdType)((triangleMaximum - this->BucketsOrigin) / this->BucketSize));
+    for (vtkIdType bucketIndex = firstBucket; bucketIndex <= lastBucket; ++bucketIndex)
+      {
+      this->Buckets[bucketIndex].push_back(triangleIndex);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkClosedSurfaceSliceCutter::CutSurface(vtkPolyData* surface, double offset, vtkPolyData* contour)
+{
+  vtkSmartPointer<vtkPoints> contourPoints = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> contourLines = vtkSmartPointer<vtkCellArray>::New();
+  contour->SetPoints(contourPoints);
+  contour->SetLines(contourLines);
+
+  if (this->Buckets.empty() || offset < this->BucketsOrigin)
+    {
+    return;
+    }
+  vtkIdType bucketIndex = (vtkIdType)((offset - this->BucketsOrigin) / this->BucketSize);
+  if (bucketIndex >= (vtkIdType)this->Buckets.size())
+    {
+    // The plane touching the end of the surface is in the last bucket
+    if (offset > this->BucketsOrigin + this->BucketSize * this->Buckets.size())
+      {
+      return;
+      }
+    bucketIndex = (vtkIdType)this->Buckets.size() - 1;
+    }
+
+  // Points are created on the crossed edges, so that neighboring line segments share their end points.
+  // Points are classified as below the plane or not, and a point on the plane is used as the crossing of all of its edges.
+  vtkPoints* points = surface->GetPoints();
+  std::map< std::pair<vtkIdType, vtkIdType>, vtkIdType > edgeCrossingPointIds;
+  const std::vector<vtkIdType>& bucket = this->Buckets[bucketIndex];
+  for (std::vector<vtkIdType>::const_iterator triangleIt = bucket.begin(); triangleIt != bucket.end(); ++triangleIt)
+    {
+    const vtkIdType* trianglePointIds = &(this->TrianglePointIds[3*(*triangleIt)]);
+    double signedDistances[3] = {0.0,0.0,0.0};
+    bool below[3] = {false,false,false};
+    for (int i = 0; i < 3; ++i)
+      {
+      signedDistances[i] = this->PointOffsets[trianglePointIds[i]] - offset;
+      below[i] = (signedDistances[i] < 0.0);
+      }
+    if (below[0] == below[1] && below[1] == below[2])
+      {
+      continue;
+      }
+
+    vtkIdType lineSegmentPointIds[2] = {0,0};
+    int numberOfCrossings = 0;
+    for (int edge = 0; edge < 3 && numberOfCrossings < 2; ++edge)
+      {
+      int belowIndex = edge;
+      int aboveIndex = (edge + 1) % 3;
+      if (below[belowIndex] == below[aboveIndex])
+        {
+        continue;
+        }
+      if (!below[belowIndex])
+        {
+        std::swap(belowIndex, aboveIndex);
+        }
+      vtkIdType belowPointId = trianglePointIds[belowIndex];
+      vtkIdType abovePointId = trianglePointIds[aboveIndex];
+
+      std::pair<vtkIdType, vtkIdType> edgeKey = (signedDistances[aboveIndex] == 0.0
+        ? std::make_pair(abovePointId, abovePointId) : std::make_pair(belowPointId, abovePointId));
+      std::map< std::pair<vtkIdType, vtkIdType>, vtkIdType >::iterator crossingIt = edgeCrossingPointIds.find(edgeKey);
+      if (crossingIt == edgeCrossingPointIds.end())
+        {
+        double belowPoint[3] = {0.0,0.0,0.0};
+        double abovePoint[3] = {0.0,0.0,0.0};
+        points->GetPoint(belowPointId, belowPoint);
+        points->GetPoint(abovePointId, abovePoint);
+        double t = signedDistances[belowIndex] / (signedDistances[belowIndex] - signedDistances[aboveIndex]);
+        double crossingPoint[3] = { belowPoint[0] + t * (abovePoint[0] - belowPoint[0]),
+          belowPoint[1] + t * (abovePoint[1] - belowPoint[1]), belowPoint[2] + t * (abovePoint[2] - belowPoint[2]) };
+        crossingIt = edgeCrossingPointIds.insert(std::make_pair(edgeKey, contourPoints->InsertNextPoint(crossingPoint))).first;
+        }
+      lineSegmentPointIds[numberOfCrossings++] = crossingIt->second;
+      }
+
+    // Triangles touching the plane only at one point do not add a line segment
+    if (numberOfCrossings == 2 && lineSegmentPointIds[0] != lineSegmentPointIds[1])
+      {
+      contourLines->InsertNextCell(2, lineSegmentPointIds);
+      }
+    }
+}
@@ -0,0 +1,119 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkClosedSurfaceSliceCutter_h
+#define __vtkClosedSurfaceSliceCutter_h
+
+// VTK includes
+#include <vtkCutter.h>
+#include <vtkPlane.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "vtkSlicerSegmentationsModuleMRMLDisplayableManagerExport.h"
+
+/// \brief Cut a closed surface with a plane for showing segment contours in slice views.
+///
+/// For a surface made of triangles and triangle strips it produces the same contour line segments as vtkCutter
+/// with a plane (point data is not interpolated), but it is made for scrolling through slices: the triangles
+/// of the surface are bucketed by their position along the plane normal, so a cut only visits the triangles
+/// near the plane, and the contours of the last few planes are cached.
+/// The buckets and the cache are rebuilt when the input surface or the normal of the plane changes.
+/// Input containing other cells (vertices, lines or polygons that are not triangles) is cut by vtkCutter.
+///
+class VTK_SLICER_SEGMENTATIONS_MODULE_MRMLDISPLAYABLEMANAGER_EXPORT vtkClosedSurfaceSliceCutter : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkClosedSurfaceSliceCutter* New();
+  vtkTypeMacro(vtkClosedSurfaceSliceCutter, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set cutting plane
+  vtkSetObjectMacro(Plane, vtkPlane);
+  /// Get cutting plane
+  vtkGetObjectMacro(Plane, vtkPlane);
+
+  /// Set number of contours kept for recently cut planes. Default is 16
+  vtkSetMacro(NumberOfCachedContours, int);
+  /// Get number of contours kept for recently cut planes
+  vtkGetMacro(NumberOfCachedContours, int);
+
+  /// Modification time also considers the plane
+  unsigned long GetMTime();
+
+protected:
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+
+  /// Sort the triangles of the surface into buckets along the plane normal.
+  /// No buckets are built if the surface contains cells other than triangles and triangle strips
+  void BuildBuckets(vtkPolyData* surface, const double normal[3]);
+
+  /// Cut the triangles of the bucket containing the plane at the given position along the normal
+  void CutSurface(vtkPolyData* surface, double offset, vtkPolyData* contour);
+
+protected:
+  vtkClosedSurfaceSliceCutter();
+  virtual ~vtkClosedSurfaceSliceCutter();
+
+protected:
+  /// Cutting plane
+  vtkPlane* Plane;
+
+  /// Number of contours kept for recently cut planes
+  int NumberOfCachedContours;
+
+  /// Surface the buckets were built for
+  vtkWeakPointer<vtkPolyData> Surface;
+  /// Unit normal the buckets were built for
+  double Normal[3];
+  /// Time the buckets were built
+  vtkTimeStamp BucketsBuildTime;
+  /// Flag indicating whether the surface consists of triangles and triangle strips only, so the buckets are used
+  bool TrianglesOnly;
+  /// Cutter used for surfaces that contain other cells than triangles
+  vtkSmartPointer<vtkCutter> Cutter;
+
+  /// Point IDs of the triangles of the surface, three per triangle. Strips are triangulated
+  std::vector<vtkIdType> TrianglePointIds;
+  /// Position of the surface points along the normal
+  std::vector<double> PointOffsets;
+  /// Indices of the triangles overlapping each bucket
+  std::vector< std::vector<vtkIdType> > Buckets;
+  /// Position of the first bucket along the normal
+  double BucketsOrigin;
+  /// Size of the buckets along the normal
+  double BucketSize;
+
+  /// Recently cut contours with their plane position along the normal, most recent first
+  std::list< std::pair< double, vtkSmartPointer<vtkPolyData> > > CachedContours;
+
+private:
+  vtkClosedSurfaceSliceCutter(const vtkClosedSurfaceSliceCutter&); // Not implemented
+  void operator=(const vtkClosedSurfaceSliceCutter&);               // Not implemented
+};
+
+#endif
@@ -20,6 +20,7 @@
 
 // MRMLDisplayableManager includes
 #include "vtkMRMLSegmentationsDisplayableManager2D.h"
+#include "vtkClosedSurfaceSliceCutter.h"
 
 // MRML includes
 #include <vtkMRMLProceduralColorNode.h>
@@ -32,12 +33,20 @@
 
 // SegmentationCore includes
 #include "vtkSegmentation.h"
+#include "vtkOrientedImageData.h"
 
 // VTK includes
 #include <vtkActor2D.h>
 #include <vtkCallbackCommand.h>
 #include <vtkColorTransferFunction.h>
+#include <vtkContourFilter.h>
 #include <vtkEventBroker.h>
+#include <vtkImageConstantPad.h>
+#include <vtkImageData.h>
+#include <vtkImageMapToColors.h>
+#include <vtkImageMapper.h>
+#include <vtkImageReslice.h>
+#include <vtkLookupTable.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
@@ -49,17 +58,14 @@
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkWeakPointer.h>
-#include <vtkPointLocator.h>
 #include <vtkGeneralTransform.h>
 #include <vtkPointData.h>
 #include <vtkDataSetAttributes.h>
 
-// VTK includes: customization
-#include <vtkCutter.h>
-
 // STD includes
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <set>
 #include <map>
 
@@ -82,8 +88,17 @@ public:
     vtkSmartPointer<vtkTransformPolyDataFilter> Transformer;
     vtkSmartPointer<vtkTransformPolyDataFilter> ModelWarper;
     vtkSmartPointer<vtkPlane> Plane;
-    vtkSmartPointer<vtkCutter> Cutter;
+    vtkSmartPointer<vtkClosedSurfaceSliceCutter> Cutter;
     vtkSmartPointer<vtkGeneralTransform> NodeToWorld;
+    // Outline and fill of binary labelmap, shown if poly data representation is not available
+    vtkSmartPointer<vtkImageData> LabelmapIjk;
+    vtkSmartPointer<vtkGeneralTransform> SliceXYToLabelmapIjk;
+    vtkSmartPointer<vtkImageReslice> LabelmapReslice;
+    vtkSmartPointer<vtkContourFilter> LabelmapOutline;
+    vtkSmartPointer<vtkImageConstantPad> LabelmapFillPad;
+    vtkSmartPointer<vtkLookupTable> LabelmapFillLookupTable;
+    vtkSmartPointer<vtkImageMapToColors> LabelmapFillColors;
+    vtkSmartPointer<vtkActor2D> LabelmapFillActor;
     };
 
   typedef std::map<std::string, const Pipeline*> PipelineMapType;
@@ -99,6 +114,9 @@ public:
 
   // Transforms
   void UpdateDisplayableTransforms(vtkMRMLSegmentationNode *node);
+
+  // Segments
+  void UpdateSegments(vtkMRMLSegmentationNode* node, const std::set<std::string>& segmentIDs);
   void GetNodeTransformToWorld(vtkMRMLTransformableNode* node, vtkGeneralTransform* transformToWorld);
 
   // Slice Node
@@ -112,6 +130,7 @@ public:
   void UpdateDisplayNode(vtkMRMLSegmentationDisplayNode* displayNode);
   void UpdateSegmentPipelines(vtkMRMLSegmentationDisplayNode*, PipelineMapType&);
   void UpdateDisplayNodePipeline(vtkMRMLSegmentationDisplayNode*, PipelineMapType);
+  bool UpdateLabelmapPipeline(vtkMRMLSegmentationNode*, vtkOrientedImageData*, const Pipeline*);
   void RemoveDisplayNode(vtkMRMLSegmentationDisplayNode* displayNode);
 
   // Observations
@@ -308,6 +327,36 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayableTra
     }
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateSegments(vtkMRMLSegmentationNode* mNode, const std::set<std::string>& segmentIDs)
+{
+  // Add and remove segment pipelines, then update the pipelines of the given segments only
+  PipelinesCacheType::iterator pipelinesIter;
+  std::set<vtkMRMLSegmentationDisplayNode *> displayNodes = this->SegmentationToDisplayNodes[mNode];
+  std::set<vtkMRMLSegmentationDisplayNode *>::iterator dnodesIter;
+  for ( dnodesIter = displayNodes.begin(); dnodesIter != displayNodes.end(); dnodesIter++ )
+    {
+    if ( ((pipelinesIter = this->DisplayPipelines.find(*dnodesIter)) != this->DisplayPipelines.end()) )
+      {
+      this->UpdateSegmentPipelines(pipelinesIter->first, pipelinesIter->second);
+      PipelineMapType changedPipelines;
+      for (std::set<std::string>::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+        {
+        PipelineMapType::iterator pipelineIt = pipelinesIter->second.find(*segmentIdIt);
+        if (pipelineIt != pipelinesIter->second.end())
+          {
+          changedPipelines[pipelineIt->first] = pipelineIt->second;
+          this->GetNodeTransformToWorld(mNode, pipelineIt->second->NodeToWorld);
+          }
+        }
+      if (!changedPipelines.empty())
+        {
+        this->UpdateDisplayNodePipeline(pipelinesIter->first, changedPipelines);
+        }
+      }
+    }
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::RemoveDisplayNode(vtkMRMLSegmentationDisplayNode* displayNode)
 {
@@ -321,6 +370,7 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::RemoveDisplayNode(vt
     {
     const Pipeline* pipeline = pipelineIt->second;
     this->External->GetRenderer()->RemoveActor(pipeline->Actor);
+    this->External->GetRenderer()->RemoveActor(pipeline->LabelmapFillActor);
     delete pipeline;
     }
   this->DisplayPipelines.erase(pipelinesIter);
@@ -373,23 +423,56 @@ vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::CreateSegmentPipeline(std
   pipeline->Actor = vtkSmartPointer<vtkActor2D>::New();
   pipeline->TransformToSlice = vtkSmartPointer<vtkTransform>::New();
   pipeline->Transformer = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-  pipeline->Cutter = vtkSmartPointer<vtkCutter>::New();
+  pipeline->Cutter = vtkSmartPointer<vtkClosedSurfaceSliceCutter>::New();
   pipeline->NodeToWorld = vtkSmartPointer<vtkGeneralTransform>::New();
   pipeline->ModelWarper = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
   pipeline->Plane = vtkSmartPointer<vtkPlane>::New();
+  pipeline->LabelmapIjk = vtkSmartPointer<vtkImageData>::New();
+  pipeline->SliceXYToLabelmapIjk = vtkSmartPointer<vtkGeneralTransform>::New();
+  pipeline->LabelmapReslice = vtkSmartPointer<vtkImageReslice>::New();
+  pipeline->LabelmapOutline = vtkSmartPointer<vtkContourFilter>::New();
+  pipeline->LabelmapFillPad = vtkSmartPointer<vtkImageConstantPad>::New();
+  pipeline->LabelmapFillLookupTable = vtkSmartPointer<vtkLookupTable>::New();
+  pipeline->LabelmapFillColors = vtkSmartPointer<vtkImageMapToColors>::New();
+  pipeline->LabelmapFillActor = vtkSmartPointer<vtkActor2D>::New();
 
   // Set up pipeline
   pipeline->Transformer->SetTransform(pipeline->TransformToSlice);
   pipeline->Transformer->SetInputConnection(pipeline->Cutter->GetOutputPort());
-  pipeline->Cutter->SetCutFunction(pipeline->Plane);
-  pipeline->Cutter->SetGenerateCutScalars(0);
-  pipeline->Cutter->SetInputConnection(pipeline->ModelWarper->GetOutputPort());
+  pipeline->Cutter->SetPlane(pipeline->Plane);
+  pipeline->LabelmapReslice->SetInterpolationModeToNearestNeighbor();
+  pipeline->LabelmapReslice->SetOutputDimensionality(2);
+  pipeline->LabelmapReslice->SetOutputOrigin(0.0, 0.0, 0.0);
+  pipeline->LabelmapReslice->SetOutputSpacing(1.0, 1.0, 1.0);
+  pipeline->LabelmapReslice->SetBackgroundLevel(0.0);
+  pipeline->LabelmapOutline->SetInputConnection(pipeline->LabelmapReslice->GetOutputPort());
+  pipeline->LabelmapOutline->SetValue(0, 0.5);
+  pipeline->LabelmapOutline->ComputeScalarsOff();
+  pipeline->LabelmapOutline->ComputeNormalsOff();
   vtkSmartPointer<vtkPolyDataMapper2D> mapper = vtkSmartPointer<vtkPolyDataMapper2D>::New();
   pipeline->Actor->SetMapper(mapper);
   mapper->SetInputConnection(pipeline->Transformer->GetOutputPort());
   pipeline->Actor->SetVisibility(0);
 
-  // Add actor to Renderer and local cache
+  // The fill is drawn on the whole slice, so the resliced part is padded with background
+  pipeline->LabelmapFillPad->SetInputConnection(pipeline->LabelmapReslice->GetOutputPort());
+  pipeline->LabelmapFillPad->SetConstant(0.0);
+  // Background is transparent, segment voxels have the segment color and the fill opacity
+  pipeline->LabelmapFillLookupTable->SetNumberOfTableValues(2);
+  pipeline->LabelmapFillLookupTable->SetTableRange(0.0, 1.0);
+  pipeline->LabelmapFillLookupTable->SetTableValue(0, 0.0, 0.0, 0.0, 0.0);
+  pipeline->LabelmapFillColors->SetInputConnection(pipeline->LabelmapFillPad->GetOutputPort());
+  pipeline->LabelmapFillColors->SetLookupTable(pipeline->LabelmapFillLookupTable);
+  pipeline->LabelmapFillColors->SetOutputFormatToRGBA();
+  vtkSmartPointer<vtkImageMapper> fillMapper = vtkSmartPointer<vtkImageMapper>::New();
+  fillMapper->SetInputConnection(pipeline->LabelmapFillColors->GetOutputPort());
+  fillMapper->SetColorWindow(255.0);
+  fillMapper->SetColorLevel(127.5);
+  pipeline->LabelmapFillActor->SetMapper(fillMapper);
+  pipeline->LabelmapFillActor->SetVisibility(0);
+
+  // Add actors to Renderer and local cache. The fill is added first so that the outline is drawn over it.
+  this->External->GetRenderer()->AddActor( pipeline->LabelmapFillActor );
   this->External->GetRenderer()->AddActor( pipeline->Actor );
 
   return pipeline;
@@ -456,6 +539,7 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateSegmentPipelin
       ++pipelineIt;
       pipelines.erase(erasedIt);
       this->External->GetRenderer()->RemoveActor(pipeline->Actor);
+      this->External->GetRenderer()->RemoveActor(pipeline->LabelmapFillActor);
       delete pipeline;
       }
     else
@@ -480,10 +564,6 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
 
   // Determine which representation to show
   std::string polyDataRepresenatationName = segmentationDisplayNode->DeterminePolyDataDisplayRepresentationName();
-  if (polyDataRepresenatationName.empty())
-    {
-    return;
-    }
 
   // Get segmentation
   vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(
@@ -497,10 +577,25 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
     {
     return;
     }
-  // Make sure the requested representation exists
-  if (!segmentation->CreateRepresentation(polyDataRepresenatationName))
+
+  // If the master representation is binary labelmap and the poly data representation needs to be converted
+  // from it, then show the outline and the fill of the labelmap in the slice instead, so that the segmentation
+  // can be shown without generating surfaces
+  std::string binaryLabelmapRepresentationName(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+  bool showLabelmap = ( segmentation->GetMasterRepresentationName()
+    && !binaryLabelmapRepresentationName.compare(segmentation->GetMasterRepresentationName())
+    && (polyDataRepresenatationName.empty() || !segmentation->ContainsRepresentation(polyDataRepresenatationName)) );
+  if (!showLabelmap)
     {
-    return;
+    if (polyDataRepresenatationName.empty())
+      {
+      return;
+      }
+    // Make sure the requested representation exists
+    if (!segmentation->CreateRepresentation(polyDataRepresenatationName))
+      {
+      return;
+      }
     }
 
   // For all pipelines (pipeline per segment)
@@ -515,47 +610,72 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
       continue;
       }
     bool segmentVisible = displayNodeVisible && properties.Visible;
-    pipeline->Actor->SetVisibility(segmentVisible);
-    if (!segmentVisible)
+    bool outlineVisible = segmentVisible && segmentationDisplayNode->GetVisibility2DOutline();
+    bool fillVisible = segmentVisible && showLabelmap && segmentationDisplayNode->GetVisibility2DFill();
+    pipeline->Actor->SetVisibility(outlineVisible);
+    pipeline->LabelmapFillActor->SetVisibility(fillVisible);
+    if (!outlineVisible && !fillVisible)
       {
       continue;
       }
 
-    // Get poly data to display
-    vtkPolyData* polyData = vtkPolyData::SafeDownCast(
-      segmentation->GetSegmentRepresentation(pipeline->SegmentID, polyDataRepresenatationName) );
-    if (!polyData || polyData->GetNumberOfPoints() == 0)
+    vtkPolyDataMapper2D* mapper = vtkPolyDataMapper2D::SafeDownCast(pipeline->Actor->GetMapper());
+    if (showLabelmap)
       {
-      continue;
+      vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(
+        segmentation->GetSegmentRepresentation(pipeline->SegmentID, binaryLabelmapRepresentationName) );
+      if (!this->UpdateLabelmapPipeline(segmentationNode, labelmap, pipeline))
+        {
+        // Labelmap is empty or does not intersect the slice
+        pipeline->Actor->SetVisibility(false);
+        pipeline->LabelmapFillActor->SetVisibility(false);
+        continue;
+        }
+      mapper->SetInputConnection(pipeline->LabelmapOutline->GetOutputPort());
+      pipeline->LabelmapFillLookupTable->SetTableValue(1,
+        properties.Color[0], properties.Color[1], properties.Color[2], segmentationDisplayNode->GetOpacity2DFill());
       }
+    else
+      {
+      // Get poly data to display
+      vtkPolyData* polyData = vtkPolyData::SafeDownCast(
+        segmentation->GetSegmentRepresentation(pipeline->SegmentID, polyDataRepresenatationName) );
+      if (!polyData || polyData->GetNumberOfPoints() == 0)
+        {
+        continue;
+        }
+      mapper->SetInputConnection(pipeline->Transformer->GetOutputPort());
 
-    //polyData->Modified(); // If we call modified on the master representation, then it causes deletion of all others
+      //polyData->Modified(); // If we call modified on the master representation, then it causes deletion of all others
+      // Surface is transformed to world only if the segmentation is transformed. The cutter keeps the triangles of the
+      // transformed surface sorted along the slice normal, so the transform is applied once per transform change, not per slice
+      if (segmentationNode->GetParentTransformNode())
+        {
 #if (VTK_MAJOR_VERSION <= 5)
-    pipeline->ModelWarper->SetInput(polyData);
+        pipeline->ModelWarper->SetInput(polyData);
 #else
-    pipeline->ModelWarper->SetInputData(polyData);
+        pipeline->ModelWarper->SetInputData(polyData);
 #endif
+        pipeline->ModelWarper->SetTransform(pipeline->NodeToWorld);
+        pipeline->Cutter->SetInputConnection(pipeline->ModelWarper->GetOutputPort());
+        }
+      else
+        {
+#if (VTK_MAJOR_VERSION <= 5)
+        pipeline->Cutter->SetInput(polyData);
+#else
+        pipeline->Cutter->SetInputData(polyData);
+#endif
+        }
 
-    pipeline->ModelWarper->SetTransform(pipeline->NodeToWorld);
-
-    // Set Plane Transform
-    this->SetSlicePlaneFromMatrix(this->SliceXYToRAS, pipeline->Plane);
-    pipeline->Plane->Modified();
-
-    // Set PolyData Transform
-    vtkNew<vtkMatrix4x4> rasToSliceXY;
-    vtkMatrix4x4::Invert(this->SliceXYToRAS, rasToSliceXY.GetPointer());
-    pipeline->TransformToSlice->SetMatrix(rasToSliceXY.GetPointer());
+      // Set Plane Transform
+      this->SetSlicePlaneFromMatrix(this->SliceXYToRAS, pipeline->Plane);
+      pipeline->Plane->Modified();
 
-    // Optimization for slice to slice intersections which are 1 quad polydatas
-    // no need for 50^3 default locator divisions
-    if (polyData->GetPoints() != NULL && polyData->GetNumberOfPoints() <= 4)
-      {
-      vtkNew<vtkPointLocator> locator;
-      double *bounds = polyData->GetBounds();
-      locator->SetDivisions(2,2,2);
-      locator->InitPointInsertion(polyData->GetPoints(), bounds);
-      pipeline->Cutter->SetLocator(locator.GetPointer());
+      // Set PolyData Transform
+      vtkNew<vtkMatrix4x4> rasToSliceXY;
+      vtkMatrix4x4::Invert(this->SliceXYToRAS, rasToSliceXY.GetPointer());
+      pipeline->TransformToSlice->SetMatrix(rasToSliceXY.GetPointer());
       }
 
     // Update pipeline actor
@@ -564,10 +684,108 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
     actor->SetPosition(0,0);
     vtkProperty2D* actorProperties = actor->GetProperty();
     actorProperties->SetColor(properties.Color[0], properties.Color[1], properties.Color[2]);
+    actorProperties->SetOpacity(segmentationDisplayNode->GetOpacity2DOutline());
     actorProperties->SetLineWidth(displayNode->GetSliceIntersectionThickness() );
     }
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateLabelmapPipeline(
+  vtkMRMLSegmentationNode* segmentationNode, vtkOrientedImageData* labelmap, const Pipeline* pipeline)
+{
+  if (!segmentationNode || !labelmap || !labelmap->GetPointData()->GetScalars())
+    {
+    return false;
+    }
+  int labelmapExtent[6] = {0,-1,0,-1,0,-1};
+  labelmap->GetExtent(labelmapExtent);
+  if (labelmapExtent[0] > labelmapExtent[1] || labelmapExtent[2] > labelmapExtent[3] || labelmapExtent[4] > labelmapExtent[5])
+    {
+    return false;
+    }
+
+  // Reslice the labelmap in its IJK space, as the reslice filter does not consider image directions.
+  // The voxels are shared with the labelmap, which is not changed: its pending transform is part of the reslice transform.
+  vtkAbstractTransform* pendingTransform = labelmap->GetPendingTransform();
+  pipeline->LabelmapIjk->ShallowCopy(labelmap);
+  pipeline->LabelmapIjk->SetOrigin(0.0, 0.0, 0.0);
+  pipeline->LabelmapIjk->SetSpacing(1.0, 1.0, 1.0);
+#if (VTK_MAJOR_VERSION <= 5)
+  pipeline->LabelmapReslice->SetInput(pipeline->LabelmapIjk);
+#else
+  pipeline->LabelmapReslice->SetInputData(pipeline->LabelmapIjk);
+#endif
+  vtkNew<vtkMatrix4x4> segmentationToLabelmapIjk;
+  labelmap->GetWorldToImageMatrix(segmentationToLabelmapIjk.GetPointer());
+
+  // The resliced image is in the slice XY space, so the outline and the fill can be shown without transforming them
+  int* sliceDimensions = this->SliceNode->GetDimensions();
+  int outputExtent[6] = {0, sliceDimensions[0]-1, 0, sliceDimensions[1]-1, 0, 0};
+  pipeline->LabelmapFillPad->SetOutputWholeExtent(outputExtent);
+  if (segmentationNode->GetParentTransformNode() || pendingTransform)
+    {
+    // Slice XY to world, world to segmentation, segmentation to untransformed labelmap, labelmap to labelmap IJK
+    pipeline->SliceXYToLabelmapIjk->Identity();
+    pipeline->SliceXYToLabelmapIjk->PostMultiply();
+    pipeline->SliceXYToLabelmapIjk->Concatenate(this->SliceXYToRAS);
+    if (segmentationNode->GetParentTransformNode())
+      {
+      pipeline->SliceXYToLabelmapIjk->Concatenate(pipeline->NodeToWorld->GetInverse());
+      }
+    if (pendingTransform)
+      {
+      pipeline->SliceXYToLabelmapIjk->Concatenate(pendingTransform->GetInverse());
+      }
+    pipeline->SliceXYToLabelmapIjk->Concatenate(segmentationToLabelmapIjk.GetPointer());
+    pipeline->LabelmapReslice->SetResliceAxes(NULL);
+    pipeline->LabelmapReslice->SetResliceTransform(pipeline->SliceXYToLabelmapIjk);
+    }
+  else
+    {
+    vtkNew<vtkMatrix4x4> sliceXYToLabelmapIjk;
+    vtkMatrix4x4::Multiply4x4(segmentationToLabelmapIjk.GetPointer(), this->SliceXYToRAS, sliceXYToLabelmapIjk.GetPointer());
+    pipeline->LabelmapReslice->SetResliceTransform(NULL);
+    pipeline->LabelmapReslice->SetResliceAxes(sliceXYToLabelmapIjk.GetPointer());
+
+    // Only reslice the part of the slice covered by the labelmap, and skip the labelmap if it does not intersect the slice
+    vtkNew<vtkMatrix4x4> labelmapIjkToSliceXY;
+    vtkMatrix4x4::Invert(sliceXYToLabelmapIjk.GetPointer(), labelmapIjkToSliceXY.GetPointer());
+    double sliceBounds[6] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
+    for (int corner = 0; corner < 8; ++corner)
+      {
+      double cornerIjk[4] = {0.0, 0.0, 0.0, 1.0};
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        cornerIjk[axis] = ( (corner >> axis) & 1 ? labelmapExtent[2*axis+1] + 0.5 : labelmapExtent[2*axis] - 0.5 );
+        }
+      double cornerSliceXY[4] = {0.0, 0.0, 0.0, 1.0};
+      labelmapIjkToSliceXY->MultiplyPoint(cornerIjk, cornerSliceXY);
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        sliceBounds[2*axis] = std::min(sliceBounds[2*axis], cornerSliceXY[axis]);
+        sliceBounds[2*axis+1] = std::max(sliceBounds[2*axis+1], cornerSliceXY[axis]);
+        }
+      }
+    if (sliceBounds[4] > 0.0 || sliceBounds[5] < 0.0)
+      {
+      return false;
+      }
+    // Keep a background pixel around the labelmap so that the outline is closed
+    for (int axis = 0; axis < 2; ++axis)
+      {
+      outputExtent[2*axis] = std::max(outputExtent[2*axis], (int)floor(sliceBounds[2*axis]) - 1);
+      outputExtent[2*axis+1] = std::min(outputExtent[2*axis+1], (int)ceil(sliceBounds[2*axis+1]) + 1);
+      }
+    if (outputExtent[0] > outputExtent[1] || outputExtent[2] > outputExtent[3])
+      {
+      return false;
+      }
+    }
+  pipeline->LabelmapReslice->SetOutputExtent(outputExtent);
+
+  return true;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::AddObservations(vtkMRMLSegmentationNode* node)
 {
@@ -588,6 +806,10 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::AddObservations(vtkM
     {
     broker->AddObservation(node, vtkSegmentation::RepresentationCreated, this->External, this->External->GetMRMLNodesCallbackCommand() );
     }
+  if (!broker->GetObservationExist(node, vtkSegmentation::SegmentsBatchModified, this->External, this->External->GetMRMLNodesCallbackCommand() ))
+    {
+    broker->AddObservation(node, vtkSegmentation::SegmentsBatchModified, this->External, this->External->GetMRMLNodesCallbackCommand() );
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -603,6 +825,8 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::RemoveObservations(v
   broker->RemoveObservations(observations);
   observations = broker->GetObservations(node, vtkSegmentation::RepresentationCreated, this->External, this->External->GetMRMLNodesCallbackCommand() );
   broker->RemoveObservations(observations);
+  observations = broker->GetObservations(node, vtkSegmentation::SegmentsBatchModified, this->External, this->External->GetMRMLNodesCallbackCommand() );
+  broker->RemoveObservations(observations);
 }
 
 //---------------------------------------------------------------------------
@@ -734,11 +958,33 @@ void vtkMRMLSegmentationsDisplayableManager2D::ProcessMRMLNodesEvents(vtkObject*
       }
     else if ( (event == vtkMRMLDisplayableNode::TransformModifiedEvent)
            || (event == vtkMRMLTransformableNode::TransformModifiedEvent)
-           || (event == vtkSegmentation::RepresentationCreated) )
+           || (event == vtkSegmentation::RepresentationCreated)
+           || (event == vtkSegmentation::MasterRepresentationModified) )
       {
       this->Internal->UpdateDisplayableTransforms(displayableNode);
       this->RequestRender();
       }
+    else if (event == vtkSegmentation::SegmentsBatchModified)
+      {
+      vtkSegmentation::BatchModifiedEventData* batchModifiedData = reinterpret_cast<vtkSegmentation::BatchModifiedEventData*>(callData);
+      if (!batchModifiedData)
+        {
+        return;
+        }
+      if (batchModifiedData->MasterRepresentationModified || !batchModifiedData->CreatedRepresentationNames.empty())
+        {
+        // Representations may have changed in all segments
+        this->Internal->UpdateDisplayableTransforms(displayableNode);
+        }
+      else
+        {
+        // Only update the pipelines of the changed segments
+        std::set<std::string> changedSegmentIDs(batchModifiedData->AddedSegmentIDs.begin(), batchModifiedData->AddedSegmentIDs.end());
+        changedSegmentIDs.insert(batchModifiedData->ModifiedSegmentIDs.begin(), batchModifiedData->ModifiedSegmentIDs.end());
+        this->Internal->UpdateSegments(displayableNode, changedSegmentIDs);
+        }
+      this->RequestRender();
+      }
     }
   else if ( vtkMRMLSliceNode::SafeDownCast(caller) )
       {
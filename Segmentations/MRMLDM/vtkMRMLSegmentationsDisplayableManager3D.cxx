@@ -33,7 +33,10 @@
 #include <vtkMRMLTransformNode.h>
 
 // VTK includes
+#include <vtkAppendPolyData.h>
+#include <vtkCellData.h>
 #include <vtkDataSetAttributes.h>
+#include <vtkIntArray.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
@@ -43,6 +46,8 @@
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRenderer.h>
 #include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkWeakPointer.h>
 #include <vtkCallbackCommand.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
@@ -51,6 +56,13 @@
 //---------------------------------------------------------------------------
 vtkStandardNewMacro ( vtkMRMLSegmentationsDisplayableManager3D );
 
+//---------------------------------------------------------------------------
+// Opaque segments are rendered with a single actor per display node if the segmentation
+// has at least this many segments. Below this the per-segment actors are cheap enough.
+static const unsigned int MINIMUM_NUMBER_OF_SEGMENTS_FOR_BATCHED_RENDERING = 16;
+static const char* BATCHED_SEGMENT_INDEX_ARRAY_NAME = "SegmentIndex";
+static const char* BATCHED_SEGMENT_COLOR_ARRAY_NAME = "SegmentColor";
+
 //---------------------------------------------------------------------------
 class vtkMRMLSegmentationsDisplayableManager3D::vtkInternal
 {
@@ -72,6 +84,25 @@ public:
   typedef std::map < vtkMRMLSegmentationDisplayNode*, PipelineMapType > PipelinesCacheType;
   PipelinesCacheType DisplayPipelines;
 
+  /// Single actor showing the opaque segments of a display node.
+  /// The surfaces are appended into one poly data, with the index of the segment and its color stored
+  /// in cell data arrays, so that color changes only update the color array.
+  struct BatchedPipeline
+    {
+    vtkSmartPointer<vtkActor> Actor;
+    vtkSmartPointer<vtkPolyData> InputPolyData;
+    vtkSmartPointer<vtkTransformPolyDataFilter> ModelWarper;
+    vtkSmartPointer<vtkGeneralTransform> NodeToWorld;
+    /// IDs of the appended segments. The segment index cell array refers to this list
+    std::vector<std::string> SegmentIDs;
+    /// Appended segment surfaces, to detect when they need to be appended again
+    std::vector< vtkWeakPointer<vtkPolyData> > SegmentPolyDatas;
+    vtkTimeStamp AppendTime;
+    };
+
+  typedef std::map < vtkMRMLSegmentationDisplayNode*, BatchedPipeline* > BatchedPipelinesCacheType;
+  BatchedPipelinesCacheType BatchedPipelines;
+
   typedef std::map < vtkMRMLSegmentationNode*, std::set< vtkMRMLSegmentationDisplayNode* > > SegmentationToDisplayCacheType;
   SegmentationToDisplayCacheType SegmentationToDisplayNodes;
 
@@ -81,6 +112,9 @@ public:
 
   // Transforms
   void UpdateDisplayableTransforms(vtkMRMLSegmentationNode *node);
+
+  // Segments
+  void UpdateSegments(vtkMRMLSegmentationNode* node, const std::set<std::string>& segmentIDs);
   void GetNodeTransformToWorld(vtkMRMLTransformableNode* node, vtkGeneralTransform* transformToWorld);
 
   // Display Nodes
@@ -91,6 +125,15 @@ public:
   void UpdateDisplayNodePipeline(vtkMRMLSegmentationDisplayNode*, PipelineMapType);
   void RemoveDisplayNode(vtkMRMLSegmentationDisplayNode* displayNode);
 
+  // Batched rendering of opaque segments
+  bool UseBatchedPipeline(vtkMRMLSegmentationDisplayNode* displayNode);
+  bool IsSegmentBatched(vtkMRMLSegmentationDisplayNode* displayNode,
+    const vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties& properties);
+  BatchedPipeline* CreateBatchedPipeline();
+  void UpdateBatchedPipeline(vtkMRMLSegmentationDisplayNode* displayNode, vtkSegmentation* segmentation,
+    const std::string& polyDataRepresentationName, bool displayNodeVisible);
+  void UpdateActorProperties(vtkActor* actor, vtkMRMLSegmentationDisplayNode* displayNode);
+
   // Observations
   void AddObservations(vtkMRMLSegmentationNode* node);
   void RemoveObservations(vtkMRMLSegmentationNode* node);
@@ -234,6 +277,46 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateDisplayableTra
         const Pipeline* currentPipeline = pipelineIt->second;
         this->GetNodeTransformToWorld(mNode, currentPipeline->NodeToWorld);
         }
+      BatchedPipelinesCacheType::iterator batchedIt = this->BatchedPipelines.find(pipelinesIter->first);
+      if (batchedIt != this->BatchedPipelines.end())
+        {
+        this->GetNodeTransformToWorld(mNode, batchedIt->second->NodeToWorld);
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateSegments(vtkMRMLSegmentationNode* mNode, const std::set<std::string>& segmentIDs)
+{
+  // Add and remove segment pipelines, then update the pipelines of the given segments only
+  PipelinesCacheType::iterator pipelinesIter;
+  std::set<vtkMRMLSegmentationDisplayNode *> displayNodes = this->SegmentationToDisplayNodes[mNode];
+  std::set<vtkMRMLSegmentationDisplayNode *>::iterator dnodesIter;
+  for ( dnodesIter = displayNodes.begin(); dnodesIter != displayNodes.end(); dnodesIter++ )
+    {
+    if ( ((pipelinesIter = this->DisplayPipelines.find(*dnodesIter)) != this->DisplayPipelines.end()) )
+      {
+      this->UpdateSegmentPipelines(pipelinesIter->first, pipelinesIter->second);
+      PipelineMapType changedPipelines;
+      for (std::set<std::string>::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+        {
+        PipelineMapType::iterator pipelineIt = pipelinesIter->second.find(*segmentIdIt);
+        if (pipelineIt != pipelinesIter->second.end())
+          {
+          changedPipelines[pipelineIt->first] = pipelineIt->second;
+          this->GetNodeTransformToWorld(mNode, pipelineIt->second->NodeToWorld);
+          }
+        }
+      BatchedPipelinesCacheType::iterator batchedIt = this->BatchedPipelines.find(pipelinesIter->first);
+      if (batchedIt != this->BatchedPipelines.end())
+        {
+        this->GetNodeTransformToWorld(mNode, batchedIt->second->NodeToWorld);
+        }
+      if (!changedPipelines.empty())
+        {
+        this->UpdateDisplayNodePipeline(pipelinesIter->first, changedPipelines);
+        }
       }
     }
 }
@@ -254,6 +337,14 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::RemoveDisplayNode(vt
     delete pipeline;
     }
   this->DisplayPipelines.erase(pipelinesIter);
+
+  BatchedPipelinesCacheType::iterator batchedIt = this->BatchedPipelines.find(displayNode);
+  if (batchedIt != this->BatchedPipelines.end())
+    {
+    this->External->GetRenderer()->RemoveActor(batchedIt->second->Actor);
+    delete batchedIt->second;
+    this->BatchedPipelines.erase(batchedIt);
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -429,6 +520,10 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateDisplayNodePip
     return;
     }
 
+  // With many segments the opaque ones are shown by the batched actor, only the translucent
+  // segments keep using their own actors (they need to be depth sorted separately)
+  bool batched = this->UseBatchedPipeline(displayNode);
+
   // For all pipelines (pipeline per segment)
   for (PipelineMapType::iterator pipelineIt=pipelines.begin(); pipelineIt!=pipelines.end(); ++pipelineIt)
     {
@@ -441,6 +536,12 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateDisplayNodePip
       continue;
       }
     bool segmentVisible = displayNodeVisible && properties.Visible;
+    if (batched && this->IsSegmentBatched(displayNode, properties))
+      {
+      // Shown by the batched actor
+      pipeline->InputPolyData->Initialize();
+      segmentVisible = false;
+      }
     pipeline->Actor->SetVisibility(segmentVisible);
     if (!segmentVisible)
       {
@@ -460,36 +561,253 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateDisplayNodePip
 
     // Update pipeline actor
     pipeline->Actor->SetVisibility(displayNodeVisible);
-
-    pipeline->Actor->GetProperty()->SetRepresentation(displayNode->GetRepresentation());
-    pipeline->Actor->GetProperty()->SetPointSize(displayNode->GetPointSize());
-    pipeline->Actor->GetProperty()->SetLineWidth(displayNode->GetLineWidth());
-    pipeline->Actor->GetProperty()->SetLighting(displayNode->GetLighting());
-    pipeline->Actor->GetProperty()->SetInterpolation(displayNode->GetInterpolation());
-    pipeline->Actor->GetProperty()->SetShading(displayNode->GetShading());
-    pipeline->Actor->GetProperty()->SetFrontfaceCulling(displayNode->GetFrontfaceCulling());
-    pipeline->Actor->GetProperty()->SetBackfaceCulling(displayNode->GetBackfaceCulling());
-
+    this->UpdateActorProperties(pipeline->Actor, displayNode);
     pipeline->Actor->GetProperty()->SetColor(properties.Color[0], properties.Color[1], properties.Color[2]);
     pipeline->Actor->GetProperty()->SetOpacity(properties.PolyDataOpacity * displayNode->GetOpacity());
+  }
 
-    if (displayNode->GetSelected())
+  if (batched)
+    {
+    this->UpdateBatchedPipeline(displayNode, segmentation, polyDataRepresenatationName, displayNodeVisible);
+    }
+  else
+    {
+    // Hide batched actor if the number of segments dropped below the limit
+    BatchedPipelinesCacheType::iterator batchedIt = this->BatchedPipelines.find(displayNode);
+    if (batchedIt != this->BatchedPipelines.end())
       {
-      pipeline->Actor->GetProperty()->SetAmbient(displayNode->GetSelectedAmbient());
-      pipeline->Actor->GetProperty()->SetSpecular(displayNode->GetSelectedSpecular());
+      this->External->GetRenderer()->RemoveActor(batchedIt->second->Actor);
+      delete batchedIt->second;
+      this->BatchedPipelines.erase(batchedIt);
+
+      // Segments that were shown by the batched actor need their own pipelines again
+      PipelinesCacheType::iterator pipelinesIter = this->DisplayPipelines.find(displayNode);
+      if (pipelinesIter != this->DisplayPipelines.end() && pipelines.size() < pipelinesIter->second.size())
+        {
+        this->UpdateDisplayNodePipeline(displayNode, pipelinesIter->second);
+        }
       }
-    else
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateActorProperties(vtkActor* actor, vtkMRMLSegmentationDisplayNode* displayNode)
+{
+  actor->GetProperty()->SetRepresentation(displayNode->GetRepresentation());
+  actor->GetProperty()->SetPointSize(displayNode->GetPointSize());
+  actor->GetProperty()->SetLineWidth(displayNode->GetLineWidth());
+  actor->GetProperty()->SetLighting(displayNode->GetLighting());
+  actor->GetProperty()->SetInterpolation(displayNode->GetInterpolation());
+  actor->GetProperty()->SetShading(displayNode->GetShading());
+  actor->GetProperty()->SetFrontfaceCulling(displayNode->GetFrontfaceCulling());
+  actor->GetProperty()->SetBackfaceCulling(displayNode->GetBackfaceCulling());
+
+  if (displayNode->GetSelected())
+    {
+    actor->GetProperty()->SetAmbient(displayNode->GetSelectedAmbient());
+    actor->GetProperty()->SetSpecular(displayNode->GetSelectedSpecular());
+    }
+  else
+    {
+    actor->GetProperty()->SetAmbient(displayNode->GetAmbient());
+    actor->GetProperty()->SetSpecular(displayNode->GetSpecular());
+    }
+  actor->GetProperty()->SetDiffuse(displayNode->GetDiffuse());
+  actor->GetProperty()->SetSpecularPower(displayNode->GetPower());
+  actor->GetProperty()->SetEdgeVisibility(displayNode->GetEdgeVisibility());
+  actor->GetProperty()->SetEdgeColor(displayNode->GetEdgeColor());
+
+  actor->SetTexture(0);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UseBatchedPipeline(vtkMRMLSegmentationDisplayNode* displayNode)
+{
+  PipelinesCacheType::iterator pipelinesIter = this->DisplayPipelines.find(displayNode);
+  if (pipelinesIter == this->DisplayPipelines.end())
+    {
+    return false;
+    }
+  return pipelinesIter->second.size() >= MINIMUM_NUMBER_OF_SEGMENTS_FOR_BATCHED_RENDERING;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::IsSegmentBatched(vtkMRMLSegmentationDisplayNode* displayNode,
+  const vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties& properties)
+{
+  // Only segments that are opaque in the view are batched, translucent ones need their own actors for depth sorting
+  return properties.PolyDataOpacity * displayNode->GetOpacity() >= 1.0;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::BatchedPipeline*
+vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::CreateBatchedPipeline()
+{
+  BatchedPipeline* batched = new BatchedPipeline();
+  batched->Actor = vtkSmartPointer<vtkActor>::New();
+  vtkNew<vtkPolyDataMapper> mapper;
+  // Color cells directly by the segment color array
+  mapper->SetScalarModeToUseCellFieldData();
+  mapper->SelectColorArray(BATCHED_SEGMENT_COLOR_ARRAY_NAME);
+  mapper->SetColorModeToDefault();
+  mapper->ScalarVisibilityOn();
+  batched->Actor->SetMapper(mapper.GetPointer());
+  batched->Actor->SetVisibility(false);
+  batched->InputPolyData = vtkSmartPointer<vtkPolyData>::New();
+  batched->ModelWarper = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+  batched->NodeToWorld = vtkSmartPointer<vtkGeneralTransform>::New();
+#if VTK_MAJOR_VERSION <= 5
+  batched->ModelWarper->SetInput(batched->InputPolyData);
+#else
+  batched->ModelWarper->SetInputData(batched->InputPolyData);
+#endif
+  batched->ModelWarper->SetTransform(batched->NodeToWorld);
+  mapper->SetInputConnection(batched->ModelWarper->GetOutputPort());
+
+  this->External->GetRenderer()->AddActor( batched->Actor );
+
+  return batched;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::UpdateBatchedPipeline(vtkMRMLSegmentationDisplayNode* displayNode,
+  vtkSegmentation* segmentation, const std::string& polyDataRepresentationName, bool displayNodeVisible)
+{
+  PipelinesCacheType::iterator pipelinesIter = this->DisplayPipelines.find(displayNode);
+  if (pipelinesIter == this->DisplayPipelines.end())
+    {
+    return;
+    }
+
+  BatchedPipeline* batched = NULL;
+  BatchedPipelinesCacheType::iterator batchedIt = this->BatchedPipelines.find(displayNode);
+  if (batchedIt != this->BatchedPipelines.end())
+    {
+    batched = batchedIt->second;
+    }
+  else
+    {
+    batched = this->CreateBatchedPipeline();
+    this->BatchedPipelines[displayNode] = batched;
+    this->GetNodeTransformToWorld(vtkMRMLSegmentationNode::SafeDownCast(displayNode->GetDisplayableNode()), batched->NodeToWorld);
+    }
+
+  // Collect the visible opaque segments of all pipelines (not only the updated ones)
+  std::vector<std::string> segmentIDs;
+  std::vector<vtkPolyData*> segmentPolyDatas;
+  std::vector<unsigned char> segmentColors;
+  bool appendNeeded = false;
+  for (PipelineMapType::iterator pipelineIt=pipelinesIter->second.begin(); pipelineIt!=pipelinesIter->second.end(); ++pipelineIt)
+    {
+    const std::string& segmentID = pipelineIt->first;
+    vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
+    if ( !displayNodeVisible || !displayNode->GetSegmentDisplayProperties(segmentID, properties)
+      || !properties.Visible || !this->IsSegmentBatched(displayNode, properties) )
       {
-      pipeline->Actor->GetProperty()->SetAmbient(displayNode->GetAmbient());
-      pipeline->Actor->GetProperty()->SetSpecular(displayNode->GetSpecular());
+      continue;
+      }
+    vtkPolyData* polyData = vtkPolyData::SafeDownCast(
+      segmentation->GetSegmentRepresentation(segmentID, polyDataRepresentationName) );
+    if (!polyData || polyData->GetNumberOfPoints() == 0)
+      {
+      continue;
       }
-    pipeline->Actor->GetProperty()->SetDiffuse(displayNode->GetDiffuse());
-    pipeline->Actor->GetProperty()->SetSpecularPower(displayNode->GetPower());
-    pipeline->Actor->GetProperty()->SetEdgeVisibility(displayNode->GetEdgeVisibility());
-    pipeline->Actor->GetProperty()->SetEdgeColor(displayNode->GetEdgeColor());
 
-    pipeline->Actor->SetTexture(0);
-  }
+    unsigned int segmentIndex = segmentIDs.size();
+    if ( segmentIndex >= batched->SegmentIDs.size() || batched->SegmentIDs[segmentIndex] != segmentID
+      || batched->SegmentPolyDatas[segmentIndex].GetPointer() != polyData || polyData->GetMTime() > batched->AppendTime.GetMTime() )
+      {
+      appendNeeded = true;
+      }
+    segmentIDs.push_back(segmentID);
+    segmentPolyDatas.push_back(polyData);
+    for (int i=0; i<3; ++i)
+      {
+      segmentColors.push_back( (unsigned char)(properties.Color[i] * 255.0 + 0.5) );
+      }
+    }
+  if (segmentIDs.size() != batched->SegmentIDs.size())
+    {
+    appendNeeded = true;
+    }
+
+  if (segmentIDs.empty())
+    {
+    batched->Actor->SetVisibility(false);
+    batched->InputPolyData->Initialize();
+    batched->SegmentIDs.clear();
+    batched->SegmentPolyDatas.clear();
+    return;
+    }
+
+  // Append the segment surfaces if the set of batched segments or their surfaces changed
+  if (appendNeeded)
+    {
+    vtkNew<vtkAppendPolyData> appender;
+    batched->SegmentPolyDatas.clear();
+    for (unsigned int segmentIndex=0; segmentIndex<segmentIDs.size(); ++segmentIndex)
+      {
+      // Tag the cells of each segment with the segment index (the appender keeps cell order per input)
+      vtkNew<vtkPolyData> segmentPolyData;
+      segmentPolyData->ShallowCopy(segmentPolyDatas[segmentIndex]);
+      vtkNew<vtkIntArray> segmentIndexArray;
+      segmentIndexArray->SetName(BATCHED_SEGMENT_INDEX_ARRAY_NAME);
+      segmentIndexArray->SetNumberOfTuples(segmentPolyData->GetNumberOfCells());
+      segmentIndexArray->FillComponent(0, segmentIndex);
+      segmentPolyData->GetCellData()->Initialize();
+      segmentPolyData->GetCellData()->AddArray(segmentIndexArray.GetPointer());
+#if VTK_MAJOR_VERSION <= 5
+      appender->AddInput(segmentPolyData.GetPointer());
+#else
+      appender->AddInputData(segmentPolyData.GetPointer());
+#endif
+      batched->SegmentPolyDatas.push_back(segmentPolyDatas[segmentIndex]);
+      }
+    appender->Update();
+    batched->InputPolyData->ShallowCopy(appender->GetOutput());
+
+    vtkNew<vtkUnsignedCharArray> colorArray;
+    colorArray->SetName(BATCHED_SEGMENT_COLOR_ARRAY_NAME);
+    colorArray->SetNumberOfComponents(3);
+    colorArray->SetNumberOfTuples(batched->InputPolyData->GetNumberOfCells());
+    batched->InputPolyData->GetCellData()->AddArray(colorArray.GetPointer());
+
+    batched->SegmentIDs = segmentIDs;
+    batched->AppendTime.Modified();
+    }
+
+  // Update cell colors in place, only changed colors cause re-rendering of the mapper input
+  vtkIntArray* segmentIndexArray = vtkIntArray::SafeDownCast(
+    batched->InputPolyData->GetCellData()->GetArray(BATCHED_SEGMENT_INDEX_ARRAY_NAME) );
+  vtkUnsignedCharArray* colorArray = vtkUnsignedCharArray::SafeDownCast(
+    batched->InputPolyData->GetCellData()->GetArray(BATCHED_SEGMENT_COLOR_ARRAY_NAME) );
+  if (segmentIndexArray && colorArray)
+    {
+    bool colorsChanged = false;
+    int* segmentIndices = segmentIndexArray->GetPointer(0);
+    unsigned char* colors = colorArray->GetPointer(0);
+    vtkIdType numberOfCells = colorArray->GetNumberOfTuples();
+    for (vtkIdType cellId=0; cellId<numberOfCells; ++cellId, colors+=3)
+      {
+      const unsigned char* segmentColor = &(segmentColors[3*segmentIndices[cellId]]);
+      if (colors[0] != segmentColor[0] || colors[1] != segmentColor[1] || colors[2] != segmentColor[2])
+        {
+        colors[0] = segmentColor[0];
+        colors[1] = segmentColor[1];
+        colors[2] = segmentColor[2];
+        colorsChanged = true;
+        }
+      }
+    if (colorsChanged)
+      {
+      colorArray->Modified();
+      batched->InputPolyData->Modified();
+      }
+    }
+
+  batched->Actor->SetVisibility(true);
+  this->UpdateActorProperties(batched->Actor, displayNode);
+  batched->Actor->GetProperty()->SetOpacity(1.0);
 }
 
 //---------------------------------------------------------------------------
@@ -512,6 +830,10 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::AddObservations(vtkM
     {
     broker->AddObservation(node, vtkSegmentation::RepresentationCreated, this->External, this->External->GetMRMLNodesCallbackCommand() );
     }
+  if (!broker->GetObservationExist(node, vtkSegmentation::SegmentsBatchModified, this->External, this->External->GetMRMLNodesCallbackCommand() ))
+    {
+    broker->AddObservation(node, vtkSegmentation::SegmentsBatchModified, this->External, this->External->GetMRMLNodesCallbackCommand() );
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -525,7 +847,9 @@ void vtkMRMLSegmentationsDisplayableManager3D::vtkInternal::RemoveObservations(v
   broker->RemoveObservations(observations);
   observations = broker->GetObservations(node, vtkSegmentation::MasterRepresentationModified, this->External, this->External->GetMRMLNodesCallbackCommand() );
   broker->RemoveObservations(observations);
-  observations = broker->GetObservations(node, vtkSegmentation::MasterRepresentationModified, this->External, this->External->GetMRMLNodesCallbackCommand() );
+  observations = broker->GetObservations(node, vtkSegmentation::RepresentationCreated, this->External, this->External->GetMRMLNodesCallbackCommand() );
+  broker->RemoveObservations(observations);
+  observations = broker->GetObservations(node, vtkSegmentation::SegmentsBatchModified, this->External, this->External->GetMRMLNodesCallbackCommand() );
   broker->RemoveObservations(observations);
 }
 
@@ -662,6 +986,27 @@ void vtkMRMLSegmentationsDisplayableManager3D::ProcessMRMLNodesEvents(vtkObject*
       this->Internal->UpdateDisplayableTransforms(displayableNode);
       this->RequestRender();
       }
+    else if (event == vtkSegmentation::SegmentsBatchModified)
+      {
+      vtkSegmentation::BatchModifiedEventData* batchModifiedData = reinterpret_cast<vtkSegmentation::BatchModifiedEventData*>(callData);
+      if (!batchModifiedData)
+        {
+        return;
+        }
+      if (batchModifiedData->MasterRepresentationModified || !batchModifiedData->CreatedRepresentationNames.empty())
+        {
+        // Representations may have changed in all segments
+        this->Internal->UpdateDisplayableTransforms(displayableNode);
+        }
+      else
+        {
+        // Only update the pipelines of the changed segments
+        std::set<std::string> changedSegmentIDs(batchModifiedData->AddedSegmentIDs.begin(), batchModifiedData->AddedSegmentIDs.end());
+        changedSegmentIDs.insert(batchModifiedData->ModifiedSegmentIDs.begin(), batchModifiedData->ModifiedSegmentIDs.end());
+        this->Internal->UpdateSegments(displayableNode, changedSegmentIDs);
+        }
+      this->RequestRender();
+      }
     }
   else
     {
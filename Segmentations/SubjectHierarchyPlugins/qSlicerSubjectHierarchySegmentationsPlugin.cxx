@@ -485,6 +485,30 @@ void qSlicerSubjectHierarchySegmentationsPlugin::onSegmentModified(vtkObject* ca
   }
 }
 
+//---------------------------------------------------------------------------
+void qSlicerSubjectHierarchySegmentationsPlugin::onSegmentsBatchModified(vtkObject* caller, void* callData)
+{
+  vtkSegmentation::BatchModifiedEventData* batchModifiedData = reinterpret_cast<vtkSegmentation::BatchModifiedEventData*>(callData);
+  if (!caller || !batchModifiedData)
+  {
+    return;
+  }
+
+  std::vector<std::string>::iterator segmentIdIt;
+  for (segmentIdIt = batchModifiedData->RemovedSegmentIDs.begin(); segmentIdIt != batchModifiedData->RemovedSegmentIDs.end(); ++segmentIdIt)
+  {
+    this->onSegmentRemoved(caller, (void*)segmentIdIt->c_str());
+  }
+  for (segmentIdIt = batchModifiedData->AddedSegmentIDs.begin(); segmentIdIt != batchModifiedData->AddedSegmentIDs.end(); ++segmentIdIt)
+  {
+    this->onSegmentAdded(caller, (void*)segmentIdIt->c_str());
+  }
+  for (segmentIdIt = batchModifiedData->ModifiedSegmentIDs.begin(); segmentIdIt != batchModifiedData->ModifiedSegmentIDs.end(); ++segmentIdIt)
+  {
+    this->onSegmentModified(caller, (void*)segmentIdIt->c_str());
+  }
+}
+
 //---------------------------------------------------------------------------
 void qSlicerSubjectHierarchySegmentationsPlugin::createBinaryLabelmapRepresentation()
 {
@@ -111,6 +111,10 @@ public slots:
   /// Renames per-segment subject hierarchy node if necessary
   void onSegmentModified(vtkObject* caller, void* callData);
 
+  /// Called when a batch of modifications ends in an observed segmentation node.
+  /// Adds, removes and renames the per-segment subject hierarchy nodes of the changed segments
+  void onSegmentsBatchModified(vtkObject* caller, void* callData);
+
 protected slots:
   /// Create binary labelmap representation
   void createBinaryLabelmapRepresentation();
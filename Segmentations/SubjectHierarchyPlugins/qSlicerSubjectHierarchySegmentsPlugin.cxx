@@ -331,7 +331,7 @@ void qSlicerSubjectHierarchySegmentsPlugin::setDisplayVisibility(vtkMRMLSubjectH
     segmentationNode->GetDisplayNode() );
   if (!displayNode)
     {
-    qCritical() << "qMRMLSegmentsTableView::onSegmentTableItemChanged: No display node for segmentation!";
+    qCritical() << "qSlicerSubjectHierarchySegmentsPlugin::setDisplayVisibility: No display node for segmentation!";
     return;
     }
 
@@ -366,7 +366,7 @@ int qSlicerSubjectHierarchySegmentsPlugin::getDisplayVisibility(vtkMRMLSubjectHi
     segmentationNode->GetDisplayNode() );
   if (!displayNode)
     {
-    qCritical() << "qMRMLSegmentsTableView::onSegmentTableItemChanged: No display node for segmentation!";
+    qCritical() << "qSlicerSubjectHierarchySegmentsPlugin::getDisplayVisibility: No display node for segmentation!";
     return -1;
     }
 
@@ -0,0 +1,248 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// Segmentations includes
+#include "qMRMLSegmentsModel.h"
+#include "vtkMRMLSegmentationDisplayNode.h"
+#include "vtkMRMLSegmentationNode.h"
+
+// SegmentationCore includes
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+
+// MRML includes
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkVector.h>
+
+// Qt includes
+#include <QApplication>
+#include <QColor>
+#include <QStringList>
+
+// STD includes
+#include <cstring>
+#include <iostream>
+
+bool AddSegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId, const char* name, double r, double g, double b);
+bool CheckRows(qMRMLSegmentsModel& model, const QStringList& expectedSegmentIDs);
+bool CheckSegmentRow(qMRMLSegmentsModel& model, const QString& segmentId, const QString& expectedName, const QColor& expectedColor, bool expectedVisible);
+
+//-----------------------------------------------------------------------------
+int qMRMLSegmentsModelTest1(int argc, char* argv[])
+{
+  QApplication app(argc, argv);
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  segmentationNode->CreateDefaultDisplayNodes();
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  if (!displayNode)
+  {
+    std::cerr << __LINE__ << ": Failed to create segmentation display node!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  qMRMLSegmentsModel model;
+  if (model.rowCount() != 0 || model.columnCount() != qMRMLSegmentsModel::NumberOfColumns)
+  {
+    std::cerr << __LINE__ << ": Model without segmentation node has " << model.rowCount() << " rows and "
+      << model.columnCount() << " columns!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Existing segments are listed when the node is set
+  if ( !AddSegment(segmentationNode.GetPointer(), "Segment_B", "Bone", 1.0, 1.0, 0.0)
+    || !AddSegment(segmentationNode.GetPointer(), "Segment_D", "Duct", 0.0, 1.0, 1.0) )
+  {
+    return EXIT_FAILURE;
+  }
+  model.setSegmentationNode(segmentationNode.GetPointer());
+  if ( !CheckRows(model, QStringList() << "Segment_B" << "Segment_D")
+    || !CheckSegmentRow(model, "Segment_B", "Bone", QColor(255, 255, 0), true)
+    || !CheckSegmentRow(model, "Segment_D", "Duct", QColor(0, 255, 255), true) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Add segments before, between and after the existing rows
+  if ( !AddSegment(segmentationNode.GetPointer(), "Segment_C", "Cyst", 1.0, 0.0, 0.0)
+    || !AddSegment(segmentationNode.GetPointer(), "Segment_A", "Artery", 0.0, 0.0, 1.0)
+    || !AddSegment(segmentationNode.GetPointer(), "Segment_E", "Edema", 0.0, 1.0, 0.0) )
+  {
+    return EXIT_FAILURE;
+  }
+  if ( !CheckRows(model, QStringList() << "Segment_A" << "Segment_B" << "Segment_C" << "Segment_D" << "Segment_E")
+    || !CheckSegmentRow(model, "Segment_A", "Artery", QColor(0, 0, 255), true)
+    || !CheckSegmentRow(model, "Segment_C", "Cyst", QColor(255, 0, 0), true)
+    || !CheckSegmentRow(model, "Segment_E", "Edema", QColor(0, 255, 0), true) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Rename segments in the segmentation and through the model
+  segmentationNode->GetSegmentation()->GetSegment("Segment_C")->SetName("Cortex");
+  int row = model.rowFromSegmentID("Segment_D");
+  if (!model.setData(model.index(row, qMRMLSegmentsModel::NameColumn), QString("Dura"), Qt::EditRole))
+  {
+    std::cerr << __LINE__ << ": Failed to rename segment through the model!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (strcmp(segmentationNode->GetSegmentation()->GetSegment("Segment_D")->GetName(), "Dura"))
+  {
+    std::cerr << __LINE__ << ": Segment renamed through the model has name "
+      << segmentationNode->GetSegmentation()->GetSegment("Segment_D")->GetName() << " instead of Dura!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( !CheckSegmentRow(model, "Segment_C", "Cortex", QColor(255, 0, 0), true)
+    || !CheckSegmentRow(model, "Segment_D", "Dura", QColor(0, 255, 255), true) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Recolor and hide segments in the display node and through the model
+  displayNode->SetSegmentColor("Segment_A", 1.0, 0.0, 1.0);
+  displayNode->SetSegmentVisibility("Segment_E", false);
+  row = model.rowFromSegmentID("Segment_B");
+  if ( !model.setData(model.index(row, qMRMLSegmentsModel::ColorColumn), QColor(0, 0, 0), Qt::DecorationRole)
+    || !model.setData(model.index(row, qMRMLSegmentsModel::VisibleColumn), false, qMRMLSegmentsModel::VisibilityRole) )
+  {
+    std::cerr << __LINE__ << ": Failed to set segment display properties through the model!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkVector3d color = displayNode->GetSegmentColor("Segment_B");
+  if (color[0] != 0.0 || color[1] != 0.0 || color[2] != 0.0 || displayNode->GetSegmentVisibility("Segment_B"))
+  {
+    std::cerr << __LINE__ << ": Display properties set through the model are not stored in the display node!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( !CheckSegmentRow(model, "Segment_A", "Artery", QColor(255, 0, 255), true)
+    || !CheckSegmentRow(model, "Segment_B", "Bone", QColor(0, 0, 0), false)
+    || !CheckSegmentRow(model, "Segment_E", "Edema", QColor(0, 255, 0), false) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Remove segments from the start, middle and end
+  segmentationNode->GetSegmentation()->RemoveSegment("Segment_A");
+  segmentationNode->GetSegmentation()->RemoveSegment("Segment_C");
+  segmentationNode->GetSegmentation()->RemoveSegment("Segment_E");
+  if ( !CheckRows(model, QStringList() << "Segment_B" << "Segment_D")
+    || !CheckSegmentRow(model, "Segment_B", "Bone", QColor(0, 0, 0), false)
+    || !CheckSegmentRow(model, "Segment_D", "Dura", QColor(0, 255, 255), true) )
+  {
+    return EXIT_FAILURE;
+  }
+  if (model.rowFromSegmentID("Segment_C") != -1 || !model.segmentIDFromRow(2).isEmpty())
+  {
+    std::cerr << __LINE__ << ": Removed segment is still in the model!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Clearing the segmentation node empties the model
+  model.setSegmentationNode(NULL);
+  if (model.rowCount() != 0)
+  {
+    std::cerr << __LINE__ << ": Model without segmentation node has " << model.rowCount() << " rows!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Segments model test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+bool AddSegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId, const char* name, double r, double g, double b)
+{
+  vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+  segment->SetName(name);
+  segment->SetDefaultColor(r, g, b);
+  if (!segmentationNode->GetSegmentation()->AddSegment(segment, segmentId))
+  {
+    std::cerr << __LINE__ << ": Failed to add segment " << segmentId << "!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool CheckRows(qMRMLSegmentsModel& model, const QStringList& expectedSegmentIDs)
+{
+  if (model.rowCount() != expectedSegmentIDs.size())
+  {
+    std::cerr << __LINE__ << ": Model has " << model.rowCount() << " rows instead of " << expectedSegmentIDs.size() << "!" << std::endl;
+    return false;
+  }
+  for (int row = 0; row < expectedSegmentIDs.size(); ++row)
+  {
+    QString segmentId = expectedSegmentIDs[row];
+    if ( model.segmentIDFromRow(row) != segmentId
+      || model.rowFromSegmentID(segmentId) != row
+      || model.data(model.index(row, qMRMLSegmentsModel::NameColumn), qMRMLSegmentsModel::IDRole).toString() != segmentId )
+    {
+      std::cerr << __LINE__ << ": Row " << row << " does not show segment " << segmentId.toLatin1().constData() << "!" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool CheckSegmentRow(qMRMLSegmentsModel& model, const QString& segmentId, const QString& expectedName, const QColor& expectedColor, bool expectedVisible)
+{
+  int row = model.rowFromSegmentID(segmentId);
+  if (row < 0)
+  {
+    std::cerr << __LINE__ << ": Segment " << segmentId.toLatin1().constData() << " is not in the model!" << std::endl;
+    return false;
+  }
+  QString name = model.data(model.index(row, qMRMLSegmentsModel::NameColumn), Qt::DisplayRole).toString();
+  if (name != expectedName)
+  {
+    std::cerr << __LINE__ << ": Segment " << segmentId.toLatin1().constData() << " is shown with name "
+      << name.toLatin1().constData() << " instead of " << expectedName.toLatin1().constData() << "!" << std::endl;
+    return false;
+  }
+  QColor color = model.data(model.index(row, qMRMLSegmentsModel::ColorColumn), Qt::DecorationRole).value<QColor>();
+  if (color != expectedColor)
+  {
+    std::cerr << __LINE__ << ": Segment " << segmentId.toLatin1().constData() << " is shown with color "
+      << color.name().toLatin1().constData() << " instead of " << expectedColor.name().toLatin1().constData() << "!" << std::endl;
+    return false;
+  }
+  bool visible = model.data(model.index(row, qMRMLSegmentsModel::VisibleColumn), qMRMLSegmentsModel::VisibilityRole).toBool();
+  if (visible != expectedVisible)
+  {
+    std::cerr << __LINE__ << ": Segment " << segmentId.toLatin1().constData() << " is shown "
+      << (visible ? "visible" : "hidden") << " instead of " << (expectedVisible ? "visible" : "hidden") << "!" << std::endl;
+    return false;
+  }
+  return true;
+}
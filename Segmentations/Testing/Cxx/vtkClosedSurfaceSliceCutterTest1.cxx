@@ -0,0 +1,198 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// Segmentations includes
+#include "vtkClosedSurfaceSliceCutter.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCutter.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPlane.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSphereSource.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+bool CompareWithCutter(vtkPolyData* surface, vtkClosedSurfaceSliceCutter* sliceCutter, vtkPlane* plane);
+double GetTotalLineLength(vtkPolyData* polyData);
+
+//-----------------------------------------------------------------------------
+int vtkClosedSurfaceSliceCutterTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkPlane> plane;
+  vtkNew<vtkClosedSurfaceSliceCutter> sliceCutter;
+  sliceCutter->SetPlane(plane.GetPointer());
+
+  //////////////////////////////////////////////////////////////////////////
+  // Triangle mesh: scroll through slices, revisit cached ones, then change the plane orientation
+  vtkNew<vtkSphereSource> sphereSource;
+  sphereSource->SetRadius(20.0);
+  sphereSource->SetCenter(1.0, -2.0, 3.0);
+  sphereSource->SetThetaResolution(48);
+  sphereSource->SetPhiResolution(48);
+  sphereSource->Update();
+  vtkPolyData* sphere = sphereSource->GetOutput();
+#if (VTK_MAJOR_VERSION <= 5)
+  sliceCutter->SetInput(sphere);
+#else
+  sliceCutter->SetInputData(sphere);
+#endif
+
+  plane->SetNormal(0.0, 0.0, 1.0);
+  const double sliceOffsets[] = { -25.0, -16.9, -3.33, 0.0, 3.07, 12.5, 22.9, 3.07, -16.9 };
+  for (int sliceIndex=0; sliceIndex<9; ++sliceIndex)
+  {
+    plane->SetOrigin(0.0, 0.0, sliceOffsets[sliceIndex]);
+    if (!CompareWithCutter(sphere, sliceCutter.GetPointer(), plane.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Cutting triangle mesh at " << sliceOffsets[sliceIndex] << " differs from vtkCutter!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  plane->SetNormal(0.3, -0.5, 0.8);
+  plane->SetOrigin(2.5, 1.0, -4.1);
+  if (!CompareWithCutter(sphere, sliceCutter.GetPointer(), plane.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Cutting triangle mesh with oblique plane differs from vtkCutter!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Line mesh: the lines are cut to vertices as by vtkCutter instead of being dropped
+  vtkNew<vtkPoints> linePoints;
+  vtkNew<vtkCellArray> lines;
+  const int numberOfLinePoints = 12;
+  lines->InsertNextCell(numberOfLinePoints);
+  for (int pointIndex=0; pointIndex<numberOfLinePoints; ++pointIndex)
+  {
+    // Zig-zag polyline crossing the slices back and forth
+    lines->InsertCellPoint(linePoints->InsertNextPoint(pointIndex * 2.0, (pointIndex % 3) * 1.5, (pointIndex % 2 ? 10.0 : -10.0) + pointIndex * 0.5));
+  }
+  vtkNew<vtkPolyData> lineMesh;
+  lineMesh->SetPoints(linePoints.GetPointer());
+  lineMesh->SetLines(lines.GetPointer());
+#if (VTK_MAJOR_VERSION <= 5)
+  sliceCutter->SetInput(lineMesh.GetPointer());
+#else
+  sliceCutter->SetInputData(lineMesh.GetPointer());
+#endif
+
+  plane->SetNormal(0.0, 0.0, 1.0);
+  for (int sliceIndex=0; sliceIndex<9; ++sliceIndex)
+  {
+    plane->SetOrigin(0.0, 0.0, sliceOffsets[sliceIndex]);
+    sliceCutter->Update();
+    if (sliceOffsets[sliceIndex] > -10.0 && sliceOffsets[sliceIndex] < 10.0 && sliceCutter->GetOutput()->GetNumberOfPoints() == 0)
+    {
+      std::cerr << __LINE__ << ": Cutting line mesh at " << sliceOffsets[sliceIndex] << " dropped the lines!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CompareWithCutter(lineMesh.GetPointer(), sliceCutter.GetPointer(), plane.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Cutting line mesh at " << sliceOffsets[sliceIndex] << " differs from vtkCutter!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Closed surface slice cutter test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool CompareWithCutter(vtkPolyData* surface, vtkClosedSurfaceSliceCutter* sliceCutter, vtkPlane* plane)
+{
+  sliceCutter->Update();
+  vtkPolyData* contour = sliceCutter->GetOutput();
+
+  vtkNew<vtkCutter> cutter;
+  cutter->SetCutFunction(plane);
+#if (VTK_MAJOR_VERSION <= 5)
+  cutter->SetInput(surface);
+#else
+  cutter->SetInputData(surface);
+#endif
+  cutter->Update();
+  vtkPolyData* expectedContour = cutter->GetOutput();
+
+  // vtkCutter merges coincident points, so only the cells and their geometry are compared
+  if ( contour->GetNumberOfLines() != expectedContour->GetNumberOfLines()
+    || contour->GetNumberOfVerts() != expectedContour->GetNumberOfVerts() )
+  {
+    std::cerr << "Number of cells mismatch: expected " << expectedContour->GetNumberOfLines() << " lines and "
+      << expectedContour->GetNumberOfVerts() << " vertices, actual " << contour->GetNumberOfLines() << " lines and "
+      << contour->GetNumberOfVerts() << " vertices" << std::endl;
+    return false;
+  }
+  if (expectedContour->GetNumberOfCells() == 0)
+  {
+    return true;
+  }
+
+  double expectedLength = GetTotalLineLength(expectedContour);
+  double length = GetTotalLineLength(contour);
+  if (fabs(expectedLength - length) > 1e-6 * std::max(1.0, expectedLength))
+  {
+    std::cerr << "Contour length mismatch: expected " << expectedLength << ", actual " << length << std::endl;
+    return false;
+  }
+
+  double expectedBounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  expectedContour->GetBounds(expectedBounds);
+  double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  contour->GetBounds(bounds);
+  for (int i=0; i<6; ++i)
+  {
+    if (fabs(expectedBounds[i] - bounds[i]) > 1e-6)
+    {
+      std::cerr << "Contour bounds mismatch" << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+double GetTotalLineLength(vtkPolyData* polyData)
+{
+  double length = 0.0;
+  vtkCellArray* lines = polyData->GetLines();
+  vtkIdType numberOfPoints = 0;
+  vtkIdType* pointIds = NULL;
+  for (lines->InitTraversal(); lines->GetNextCell(numberOfPoints, pointIds); )
+  {
+    for (vtkIdType i=0; i+1<numberOfPoints; ++i)
+    {
+      double point1[3] = {0.0,0.0,0.0};
+      double point2[3] = {0.0,0.0,0.0};
+      polyData->GetPoint(pointIds[i], point1);
+      polyData->GetPoint(pointIds[i+1], point2);
+      length += sqrt(vtkMath::Distance2BetweenPoints(point1, point2));
+    }
+  }
+  return length;
+}
@@ -0,0 +1,350 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// Segmentations includes
+#include "vtkMRMLSegmentationDisplayNode.h"
+#include "vtkMRMLSegmentationNode.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+#include "vtkSegmentationConverter.h"
+
+// MRML includes
+#include <vtkMRMLColorTableNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <vector>
+
+void AddBoxSegment(vtkSegmentation* segmentation, const char* segmentId, int box[6], int scalarType);
+void SetBoxInLabelmap(vtkImageData* labelmap, int box[6], double value);
+void PaintExpectedMergedLabelmap(vtkMRMLSegmentationNode* segmentationNode, vtkImageData* expectedImage);
+bool AreImagesEqual(vtkImageData* expectedImage, vtkImageData* actualImage);
+bool IsDisplayedMergedLabelmapUpToDate(vtkMRMLSegmentationNode* segmentationNode);
+vtkImageData* GetSegmentLabelmap(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId);
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSegmentationNodeTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  segmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+
+  // Segments overlap each other, and span the boundaries of the slabs painted by different threads.
+  // The merged labelmap is large enough to be painted on multiple threads.
+  int boxA[6] = { 10, 80, 10, 80, 5, 60 };
+  AddBoxSegment(segmentationNode->GetSegmentation(), "A", boxA, VTK_UNSIGNED_CHAR);
+  int boxB[6] = { 40, 120, 30, 100, 30, 95 };
+  AddBoxSegment(segmentationNode->GetSegmentation(), "B", boxB, VTK_UNSIGNED_CHAR);
+  int boxC[6] = { 0, 127, 60, 70, 0, 95 };
+  AddBoxSegment(segmentationNode->GetSegmentation(), "C", boxC, VTK_SHORT);
+  int boxD[6] = { 20, 30, 20, 30, 20, 70 };
+  AddBoxSegment(segmentationNode->GetSegmentation(), "D", boxD, VTK_UNSIGNED_SHORT);
+
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  if (!displayNode || !vtkMRMLColorTableNode::SafeDownCast(displayNode->GetColorNode()))
+  {
+    std::cerr << __LINE__ << ": Segmentation display node and color table are not created!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Merged labelmap painted on multiple threads is the same as painted on one thread
+  int originalNumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+
+  vtkNew<vtkMatrix4x4> mergedImageToWorldMatrix;
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(1);
+  vtkNew<vtkImageData> singleThreadedImage;
+  if (!segmentationNode->GenerateMergedLabelmap(singleThreadedImage.GetPointer(), mergedImageToWorldMatrix.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Failed to generate merged labelmap on one thread!" << std::endl;
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkImageData> expectedImage;
+  expectedImage->SetExtent(singleThreadedImage->GetExtent());
+  PaintExpectedMergedLabelmap(segmentationNode.GetPointer(), expectedImage.GetPointer());
+  if (!AreImagesEqual(expectedImage.GetPointer(), singleThreadedImage.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Merged labelmap painted on one thread differs from expected!" << std::endl;
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+    return EXIT_FAILURE;
+  }
+
+  // Numbers of threads that do and do not divide the number of slices
+  const int numbersOfThreads[] = { 2, 3, 4, 7, 16 };
+  for (int threadsIndex=0; threadsIndex<5; ++threadsIndex)
+  {
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(numbersOfThreads[threadsIndex]);
+    vtkNew<vtkImageData> multiThreadedImage;
+    if ( !segmentationNode->GenerateMergedLabelmap(multiThreadedImage.GetPointer(), mergedImageToWorldMatrix.GetPointer())
+      || !AreImagesEqual(singleThreadedImage.GetPointer(), multiThreadedImage.GetPointer()) )
+    {
+      std::cerr << __LINE__ << ": Merged labelmap painted on " << numbersOfThreads[threadsIndex]
+        << " threads differs from the one painted on one thread!" << std::endl;
+      vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+      return EXIT_FAILURE;
+    }
+  }
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Displayed merged labelmap updated after changing segments is the same as the fully rebuilt one
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Generated displayed merged labelmap differs from rebuilt one!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Shrink segment: the region it covered before is repainted from the segments below it
+  int shrunkRegionB[6] = { 40, 120, 30, 100, 60, 95 };
+  SetBoxInLabelmap(GetSegmentLabelmap(segmentationNode.GetPointer(), "B"), shrunkRegionB, 0.0);
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after shrinking segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Grow segment under other segments
+  int grownBoxA[6] = { 0, 100, 0, 90, 0, 70 };
+  SetBoxInLabelmap(GetSegmentLabelmap(segmentationNode.GetPointer(), "A"), grownBoxA, 1.0);
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after growing segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Move segment to a disjoint region
+  SetBoxInLabelmap(GetSegmentLabelmap(segmentationNode.GetPointer(), "D"), boxD, 0.0);
+  int movedBoxD[6] = { 100, 115, 100, 120, 80, 90 };
+  SetBoxInLabelmap(GetSegmentLabelmap(segmentationNode.GetPointer(), "D"), movedBoxD, 1.0);
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after moving segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Shrink segment to empty, then make it non-empty again
+  SetBoxInLabelmap(GetSegmentLabelmap(segmentationNode.GetPointer(), "C"), boxC, 0.0);
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after emptying segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  int refilledBoxC[6] = { 50, 60, 0, 127, 10, 20 };
+  SetBoxInLabelmap(GetSegmentLabelmap(segmentationNode.GetPointer(), "C"), refilledBoxC, 1.0);
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after refilling empty segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Remove and add segments
+  segmentationNode->GetSegmentation()->RemoveSegment("B");
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after removing segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  int boxE[6] = { 5, 60, 50, 110, 15, 50 };
+  AddBoxSegment(segmentationNode->GetSegmentation(), "E", boxE, VTK_UNSIGNED_CHAR);
+  if (!IsDisplayedMergedLabelmapUpToDate(segmentationNode.GetPointer()))
+  {
+    std::cerr << __LINE__ << ": Displayed merged labelmap differs from rebuilt one after adding segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Segmentation node test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void AddBoxSegment(vtkSegmentation* segmentation, const char* segmentId, int box[6], int scalarType)
+{
+  vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  labelmap->SetExtent(0, 127, 0, 127, 0, 95);
+  labelmap->SetSpacing(0.5, 0.5, 1.0);
+  labelmap->SetOrigin(-30.0, 20.0, 0.0);
+#if (VTK_MAJOR_VERSION <= 5)
+  labelmap->SetScalarType(scalarType);
+  labelmap->SetNumberOfScalarComponents(1);
+  labelmap->AllocateScalars();
+#else
+  labelmap->AllocateScalars(scalarType, 1);
+#endif
+  int fullExtent[6] = { 0, 127, 0, 127, 0, 95 };
+  SetBoxInLabelmap(labelmap, fullExtent, 0.0);
+  SetBoxInLabelmap(labelmap, box, 1.0);
+
+  vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+  segment->SetName(segmentId);
+  segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+  segmentation->AddSegment(segment, segmentId);
+}
+
+//----------------------------------------------------------------------------
+void SetBoxInLabelmap(vtkImageData* labelmap, int box[6], double value)
+{
+  int extent[6] = {0,-1,0,-1,0,-1};
+  labelmap->GetExtent(extent);
+  for (int k=std::max(box[4],extent[4]); k<=std::min(box[5],extent[5]); ++k)
+  {
+    for (int j=std::max(box[2],extent[2]); j<=std::min(box[3],extent[3]); ++j)
+    {
+      for (int i=std::max(box[0],extent[0]); i<=std::min(box[1],extent[1]); ++i)
+      {
+        labelmap->SetScalarComponentFromDouble(i, j, k, 0, value);
+      }
+    }
+  }
+  labelmap->Modified();
+}
+
+//----------------------------------------------------------------------------
+void PaintExpectedMergedLabelmap(vtkMRMLSegmentationNode* segmentationNode, vtkImageData* expectedImage)
+{
+  // Each voxel gets the label of the segment with the highest label containing it. Labels are the color table indices.
+  // All segment labelmaps have the geometry of the merged labelmap.
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  vtkMRMLColorTableNode* colorTableNode = vtkMRMLColorTableNode::SafeDownCast(displayNode->GetColorNode());
+#if (VTK_MAJOR_VERSION <= 5)
+  expectedImage->SetScalarTypeToUnsignedChar();
+  expectedImage->SetNumberOfScalarComponents(1);
+  expectedImage->AllocateScalars();
+#else
+  expectedImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+  int extent[6] = {0,-1,0,-1,0,-1};
+  expectedImage->GetExtent(extent);
+  SetBoxInLabelmap(expectedImage, extent, vtkMRMLSegmentationDisplayNode::GetSegmentationColorIndexBackground());
+
+  for (int colorIndex=2; colorIndex<colorTableNode->GetNumberOfColors(); ++colorIndex)
+  {
+    const char* segmentId = colorTableNode->GetColorName(colorIndex);
+    vtkSegment* segment = (segmentId ? segmentationNode->GetSegmentation()->GetSegment(segmentId) : NULL);
+    if (!segment)
+    {
+      continue;
+    }
+    vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
+    if (!displayNode->GetSegmentDisplayProperties(segmentId, properties) || !properties.Visible)
+    {
+      continue;
+    }
+    vtkImageData* labelmap = vtkImageData::SafeDownCast(
+      segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    int labelmapExtent[6] = {0,-1,0,-1,0,-1};
+    labelmap->GetExtent(labelmapExtent);
+    for (int k=std::max(extent[4],labelmapExtent[4]); k<=std::min(extent[5],labelmapExtent[5]); ++k)
+    {
+      for (int j=std::max(extent[2],labelmapExtent[2]); j<=std::min(extent[3],labelmapExtent[3]); ++j)
+      {
+        for (int i=std::max(extent[0],labelmapExtent[0]); i<=std::min(extent[1],labelmapExtent[1]); ++i)
+        {
+          if (labelmap->GetScalarComponentAsDouble(i, j, k, 0) != 0.0)
+          {
+            expectedImage->SetScalarComponentFromDouble(i, j, k, 0, colorIndex);
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool IsDisplayedMergedLabelmapUpToDate(vtkMRMLSegmentationNode* segmentationNode)
+{
+  // Displayed merged labelmap is updated incrementally if possible
+  vtkImageData* displayedImage = segmentationNode->GetImageData();
+  if (!displayedImage)
+  {
+    std::cerr << "No displayed merged labelmap" << std::endl;
+    return false;
+  }
+
+  vtkNew<vtkImageData> rebuiltImage;
+  vtkNew<vtkMatrix4x4> rebuiltImageToWorldMatrix;
+  if (!segmentationNode->GenerateMergedLabelmap(rebuiltImage.GetPointer(), rebuiltImageToWorldMatrix.GetPointer()))
+  {
+    std::cerr << "Failed to rebuild merged labelmap" << std::endl;
+    return false;
+  }
+  return AreImagesEqual(rebuiltImage.GetPointer(), displayedImage);
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* GetSegmentLabelmap(vtkMRMLSegmentationNode* segmentationNode, const char* segmentId)
+{
+  return vtkImageData::SafeDownCast( segmentationNode->GetSegmentation()->GetSegment(segmentId)->GetRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() ) );
+}
+
+//----------------------------------------------------------------------------
+bool AreImagesEqual(vtkImageData* expectedImage, vtkImageData* actualImage)
+{
+  // Images are compared voxel by voxel in the order of the voxels, regardless of the start of their extents
+  int expectedDimensions[3] = {0,0,0};
+  expectedImage->GetDimensions(expectedDimensions);
+  int actualDimensions[3] = {0,0,0};
+  actualImage->GetDimensions(actualDimensions);
+  if ( expectedDimensions[0] != actualDimensions[0] || expectedDimensions[1] != actualDimensions[1]
+    || expectedDimensions[2] != actualDimensions[2] )
+  {
+    std::cerr << "Dimensions mismatch: expected (" << expectedDimensions[0] << ", " << expectedDimensions[1] << ", " << expectedDimensions[2]
+      << "), actual (" << actualDimensions[0] << ", " << actualDimensions[1] << ", " << actualDimensions[2] << ")" << std::endl;
+    return false;
+  }
+  if (expectedImage->GetScalarType() != actualImage->GetScalarType())
+  {
+    std::cerr << "Scalar type mismatch" << std::endl;
+    return false;
+  }
+
+  vtkIdType numberOfVoxels = (vtkIdType)expectedDimensions[0] * expectedDimensions[1] * expectedDimensions[2];
+  vtkDataArray* expectedScalars = expectedImage->GetPointData()->GetScalars();
+  vtkDataArray* actualScalars = actualImage->GetPointData()->GetScalars();
+  for (vtkIdType voxelIndex=0; voxelIndex<numberOfVoxels; ++voxelIndex)
+  {
+    if (expectedScalars->GetComponent(voxelIndex, 0) != actualScalars->GetComponent(voxelIndex, 0))
+    {
+      std::cerr << "Voxel mismatch at index " << voxelIndex << ": expected " << expectedScalars->GetComponent(voxelIndex, 0)
+        << ", actual " << actualScalars->GetComponent(voxelIndex, 0) << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,727 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// Segmentations includes
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkMRMLSegmentationStorageNode.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+#include "vtkSegmentationConverter.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+
+// ITK includes
+#include "itkFactoryRegistration.h"
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+  /// Write and read settings of a round-trip test case
+  struct StorageSettings
+  {
+    const char* Name;
+    int SparseLayout;
+    int UseCompression;
+    int ParallelCompression;
+    int FastCompression;
+  };
+}
+
+void CreateTestSegmentation(vtkSegmentation* segmentation);
+void SetBoxInLabelmap(vtkOrientedImageData* labelmap, int box[6], unsigned char value);
+void ConfigureStorageNode(vtkMRMLSegmentationStorageNode* storageNode, const StorageSettings& settings,
+  int lazyLoading, int memoryMapping, const std::string& filePath);
+bool CompareSegmentations(vtkSegmentation* expectedSegmentation, vtkSegmentation* actualSegmentation, bool compareTags);
+bool AreLabelmapsEqual(vtkOrientedImageData* expectedLabelmap, vtkOrientedImageData* actualLabelmap);
+bool IsSegmentationModifiedSinceRead(vtkSegmentation* segmentation, const vtkTimeStamp& readTime);
+bool CorruptNrrdDataStart(const std::string& filePath);
+bool AreFilesEqual(const std::string& filePath1, const std::string& filePath2);
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSegmentationStorageNodeTest1(int argc, char* argv[])
+{
+  int argIndex = 1;
+
+  const char* temporaryDirectoryPath = NULL;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-TemporaryDirectoryPath") == 0)
+    {
+      temporaryDirectoryPath = argv[argIndex+1];
+      std::cout << "Temporary directory path: " << temporaryDirectoryPath << std::endl;
+      argIndex += 2;
+    }
+  }
+  if (!temporaryDirectoryPath)
+  {
+    std::cerr << "No temporary directory path given!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtksys::SystemTools::MakeDirectory(temporaryDirectoryPath);
+
+  // Make sure NRRD reading and writing works
+  itk::itkFactoryRegistration();
+
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkMRMLSegmentationNode> referenceNode;
+  scene->AddNode(referenceNode.GetPointer());
+  CreateTestSegmentation(referenceNode->GetSegmentation());
+
+  const StorageSettings roundTripSettings[] =
+    {
+    { "SparseRaw", 1, 0, 0, 0 },
+    { "SparseGzipMembers", 1, 1, 1, 0 },
+    { "SparseGzipMembersFast", 1, 1, 1, 1 },
+    { "SparseGzip", 1, 1, 0, 0 },
+    { "LegacyRaw", 0, 0, 0, 0 },
+    { "LegacyGzip", 0, 1, 0, 0 }
+    };
+  const int numberOfRoundTripSettings = sizeof(roundTripSettings) / sizeof(roundTripSettings[0]);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Write and read back in all layouts, with full, lazy and memory mapped reading.
+  // Tags are only stored in sparse layout.
+  for (int settingsIndex=0; settingsIndex<numberOfRoundTripSettings; ++settingsIndex)
+  {
+    const StorageSettings& settings = roundTripSettings[settingsIndex];
+    std::string filePath = std::string(temporaryDirectoryPath) + "/vtkMRMLSegmentationStorageNodeTest1_" + settings.Name + ".seg.nrrd";
+    vtksys::SystemTools::RemoveFile(filePath.c_str());
+
+    vtkNew<vtkMRMLSegmentationStorageNode> writerStorageNode;
+    scene->AddNode(writerStorageNode.GetPointer());
+    ConfigureStorageNode(writerStorageNode.GetPointer(), settings, 0, 0, filePath);
+    if (!writerStorageNode->WriteData(referenceNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to write segmentation in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    for (int readMode=0; readMode<3; ++readMode)
+    {
+      int lazyLoading = (readMode == 1 ? 1 : 0);
+      int memoryMapping = (readMode == 2 ? 1 : 0);
+
+      vtkNew<vtkMRMLSegmentationNode> readNode;
+      scene->AddNode(readNode.GetPointer());
+      vtkNew<vtkMRMLSegmentationStorageNode> readerStorageNode;
+      scene->AddNode(readerStorageNode.GetPointer());
+      ConfigureStorageNode(readerStorageNode.GetPointer(), settings, lazyLoading, memoryMapping, filePath);
+      if (!readerStorageNode->ReadData(readNode.GetPointer()))
+      {
+        std::cerr << __LINE__ << ": Failed to read segmentation written in " << settings.Name
+          << " settings (lazy loading: " << lazyLoading << ", memory mapping: " << memoryMapping << ")!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      vtkTimeStamp readTime;
+      readTime.Modified();
+
+      if (!CompareSegmentations(referenceNode->GetSegmentation(), readNode->GetSegmentation(), settings.SparseLayout))
+      {
+        std::cerr << __LINE__ << ": Segmentation read back differs from the written one in " << settings.Name
+          << " settings (lazy loading: " << lazyLoading << ", memory mapping: " << memoryMapping << ")!" << std::endl;
+        return EXIT_FAILURE;
+      }
+      // Loading deferred segments while comparing must not be reported as modification
+      if (IsSegmentationModifiedSinceRead(readNode->GetSegmentation(), readTime))
+      {
+        std::cerr << __LINE__ << ": Segmentation read in " << settings.Name
+          << " settings is reported as modified since read (lazy loading: " << lazyLoading << ")!" << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      scene->RemoveNode(readerStorageNode.GetPointer());
+      scene->RemoveNode(readNode.GetPointer());
+    }
+    scene->RemoveNode(writerStorageNode.GetPointer());
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Lazy loading of a compressed file: segments written on multiple threads are decompressed from the stored
+  // position of their own compressed voxels, other files are decompressed from the start of the data
+  for (int parallelCompression=0; parallelCompression<2; ++parallelCompression)
+  {
+    const StorageSettings& settings = roundTripSettings[parallelCompression ? 1 : 3]; // SparseGzipMembers or SparseGzip
+    std::string filePath = std::string(temporaryDirectoryPath) + "/vtkMRMLSegmentationStorageNodeTest1_Lazy" + settings.Name + ".seg.nrrd";
+    vtksys::SystemTools::RemoveFile(filePath.c_str());
+
+    vtkNew<vtkMRMLSegmentationStorageNode> writerStorageNode;
+    scene->AddNode(writerStorageNode.GetPointer());
+    ConfigureStorageNode(writerStorageNode.GetPointer(), settings, 0, 0, filePath);
+    if (!writerStorageNode->WriteData(referenceNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to write segmentation for lazy loading (parallel compression: " << parallelCompression << ")!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    // The first segment cannot be decompressed after this, so the others only load if decompression starts at their own voxels
+    if (parallelCompression && !CorruptNrrdDataStart(filePath))
+    {
+      std::cerr << __LINE__ << ": Failed to modify data of file " << filePath << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkNew<vtkMRMLSegmentationNode> readNode;
+    scene->AddNode(readNode.GetPointer());
+    vtkNew<vtkMRMLSegmentationStorageNode> readerStorageNode;
+    scene->AddNode(readerStorageNode.GetPointer());
+    ConfigureStorageNode(readerStorageNode.GetPointer(), settings, 1, 0, filePath);
+    if (!readerStorageNode->ReadData(readNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to read segmentation lazily (parallel compression: " << parallelCompression << ")!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    // Segments are stored in the order of their IDs, the corrupted first one is not loaded
+    std::vector<std::string> segmentIds;
+    referenceNode->GetSegmentation()->GetSegmentIDs(segmentIds);
+    for (unsigned int segmentIndex = (parallelCompression ? 1 : 0); segmentIndex < segmentIds.size(); ++segmentIndex)
+    {
+      vtkSegment* loadedSegment = readNode->GetSegmentation()->GetSegment(segmentIds[segmentIndex]);
+      vtkOrientedImageData* loadedLabelmap = (loadedSegment ? vtkOrientedImageData::SafeDownCast(
+        loadedSegment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) : NULL);
+      vtkOrientedImageData* expectedLabelmap = vtkOrientedImageData::SafeDownCast(
+        referenceNode->GetSegmentation()->GetSegment(segmentIds[segmentIndex])->GetRepresentation(
+        vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+      if (!loadedLabelmap || !AreLabelmapsEqual(expectedLabelmap, loadedLabelmap))
+      {
+        std::cerr << __LINE__ << ": Lazily loaded segment " << segmentIds[segmentIndex] << " differs from the written one"
+          << " (parallel compression: " << parallelCompression << ")!" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    scene->RemoveNode(readerStorageNode.GetPointer());
+    scene->RemoveNode(readNode.GetPointer());
+    scene->RemoveNode(writerStorageNode.GetPointer());
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Memory mapped read: modifying the voxels in memory does not change the file,
+  // and writing the mapped segmentation over its own file succeeds
+  {
+    const StorageSettings& settings = roundTripSettings[0]; // SparseRaw
+    std::string filePath = std::string(temporaryDirectoryPath) + "/vtkMRMLSegmentationStorageNodeTest1_" + settings.Name + ".seg.nrrd";
+
+    vtkNew<vtkMRMLSegmentationNode> mappedNode;
+    scene->AddNode(mappedNode.GetPointer());
+    vtkNew<vtkMRMLSegmentationStorageNode> mappedStorageNode;
+    scene->AddNode(mappedStorageNode.GetPointer());
+    ConfigureStorageNode(mappedStorageNode.GetPointer(), settings, 0, 1, filePath);
+    if (!mappedStorageNode->ReadData(mappedNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to read segmentation with memory mapping!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkOrientedImageData* mappedLabelmap = vtkOrientedImageData::SafeDownCast(
+      mappedNode->GetSegmentation()->GetSegment("Box")->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    int mappedExtent[6] = {0,-1,0,-1,0,-1};
+    mappedLabelmap->GetExtent(mappedExtent);
+    int clearedBox[6] = { mappedExtent[0], mappedExtent[0]+2, mappedExtent[2], mappedExtent[2]+2, mappedExtent[4], mappedExtent[5] };
+    SetBoxInLabelmap(mappedLabelmap, clearedBox, 0);
+
+    vtkNew<vtkMRMLSegmentationNode> fileNode;
+    scene->AddNode(fileNode.GetPointer());
+    vtkNew<vtkMRMLSegmentationStorageNode> fileStorageNode;
+    scene->AddNode(fileStorageNode.GetPointer());
+    ConfigureStorageNode(fileStorageNode.GetPointer(), settings, 0, 0, filePath);
+    if (!fileStorageNode->ReadData(fileNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to read segmentation while it is mapped to memory!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CompareSegmentations(referenceNode->GetSegmentation(), fileNode->GetSegmentation(), true))
+    {
+      std::cerr << __LINE__ << ": Modifying memory mapped segment changed the file!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (!mappedStorageNode->WriteData(mappedNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to write memory mapped segmentation to its own file!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    // Output segmentation must be empty when reading
+    vtkNew<vtkMRMLSegmentationNode> writtenNode;
+    scene->AddNode(writtenNode.GetPointer());
+    if (!fileStorageNode->ReadData(writtenNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to read segmentation written from memory mapped data!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CompareSegmentations(mappedNode->GetSegmentation(), writtenNode->GetSegmentation(), true))
+    {
+      std::cerr << __LINE__ << ": Segmentation written from memory mapped data differs from the modified one!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    scene->RemoveNode(writtenNode.GetPointer());
+    scene->RemoveNode(fileStorageNode.GetPointer());
+    scene->RemoveNode(fileNode.GetPointer());
+    scene->RemoveNode(mappedStorageNode.GetPointer());
+    scene->RemoveNode(mappedNode.GetPointer());
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Files compressed on multiple threads do not depend on the number of threads
+  {
+    const StorageSettings& settings = roundTripSettings[1]; // SparseGzipMembers
+    std::string filePath = std::string(temporaryDirectoryPath) + "/vtkMRMLSegmentationStorageNodeTest1_" + settings.Name + ".seg.nrrd";
+    std::string singleThreadFilePath = std::string(temporaryDirectoryPath) + "/vtkMRMLSegmentationStorageNodeTest1_SingleThread" + settings.Name + ".seg.nrrd";
+    vtksys::SystemTools::RemoveFile(singleThreadFilePath.c_str());
+
+    vtkNew<vtkMRMLSegmentationStorageNode> singleThreadStorageNode;
+    scene->AddNode(singleThreadStorageNode.GetPointer());
+    ConfigureStorageNode(singleThreadStorageNode.GetPointer(), settings, 0, 0, singleThreadFilePath);
+    int originalNumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(1);
+    int writeSuccess = singleThreadStorageNode->WriteData(referenceNode.GetPointer());
+    vtkMultiThreader::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+    if (!writeSuccess)
+    {
+      std::cerr << __LINE__ << ": Failed to write segmentation on a single thread!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!AreFilesEqual(filePath, singleThreadFilePath))
+    {
+      std::cerr << __LINE__ << ": File compressed on a single thread differs from the one compressed on multiple threads!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    scene->RemoveNode(singleThreadStorageNode.GetPointer());
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Incremental write: only modified, added and removed segments are rewritten
+  const StorageSettings incrementalSettings[] = { roundTripSettings[0], roundTripSettings[1] }; // SparseRaw, SparseGzipMembers
+  for (int settingsIndex=0; settingsIndex<2; ++settingsIndex)
+  {
+    const StorageSettings& settings = incrementalSettings[settingsIndex];
+    std::string filePath = std::string(temporaryDirectoryPath) + "/vtkMRMLSegmentationStorageNodeTest1_Incremental" + settings.Name + ".seg.nrrd";
+    vtksys::SystemTools::RemoveFile(filePath.c_str());
+
+    vtkNew<vtkMRMLSegmentationNode> workNode;
+    scene->AddNode(workNode.GetPointer());
+    workNode->GetSegmentation()->DeepCopy(referenceNode->GetSegmentation());
+
+    vtkNew<vtkMRMLSegmentationStorageNode> workStorageNode;
+    scene->AddNode(workStorageNode.GetPointer());
+    ConfigureStorageNode(workStorageNode.GetPointer(), settings, 0, 0, filePath);
+    if (!workStorageNode->WriteData(workNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Failed to write segmentation for incremental write in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Shrink one segment, remove one and add a new one
+    vtkOrientedImageData* ballLabelmap = vtkOrientedImageData::SafeDownCast(
+      workNode->GetSegmentation()->GetSegment("Ball")->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    int ballClearedBox[6] = { 0, 17, 0, 24, 0, 19 };
+    SetBoxInLabelmap(ballLabelmap, ballClearedBox, 0);
+    workNode->GetSegmentation()->RemoveSegment("Overlap");
+    vtkSmartPointer<vtkSegment> addedSegment = vtkSmartPointer<vtkSegment>::New();
+    addedSegment->SetName("Added");
+    addedSegment->AddTag("Incremental");
+    vtkSmartPointer<vtkOrientedImageData> addedLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    addedLabelmap->DeepCopy(ballLabelmap);
+    int wholeBox[6] = { 0, 29, 0, 24, 0, 19 };
+    SetBoxInLabelmap(addedLabelmap, wholeBox, 0);
+    int addedBox[6] = { 25, 28, 20, 23, 15, 18 };
+    SetBoxInLabelmap(addedLabelmap, addedBox, 1);
+    addedSegment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), addedLabelmap);
+    workNode->GetSegmentation()->AddSegment(addedSegment, "Added");
+
+    if (!workStorageNode->WriteData(workNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Incremental write failed in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkNew<vtkMRMLSegmentationNode> readNode;
+    scene->AddNode(readNode.GetPointer());
+    vtkNew<vtkMRMLSegmentationStorageNode> readerStorageNode;
+    scene->AddNode(readerStorageNode.GetPointer());
+    ConfigureStorageNode(readerStorageNode.GetPointer(), settings, 0, 0, filePath);
+    if (!readerStorageNode->ReadData(readNode.GetPointer())
+      || !CompareSegmentations(workNode->GetSegmentation(), readNode->GetSegmentation(), true))
+    {
+      std::cerr << __LINE__ << ": Incrementally written segmentation differs from the modified one in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Writing unchanged segmentation after it was read
+    if (!readerStorageNode->WriteData(readNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Writing unchanged segmentation failed in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Lazy read, modify one segment, write over the same file
+    vtkNew<vtkMRMLSegmentationNode> lazyNode;
+    scene->AddNode(lazyNode.GetPointer());
+    vtkNew<vtkMRMLSegmentationStorageNode> lazyStorageNode;
+    scene->AddNode(lazyStorageNode.GetPointer());
+    ConfigureStorageNode(lazyStorageNode.GetPointer(), settings, 1, 0, filePath);
+    if (!lazyStorageNode->ReadData(lazyNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Lazy read failed in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkOrientedImageData* boxLabelmap = vtkOrientedImageData::SafeDownCast(
+      lazyNode->GetSegmentation()->GetSegment("Box")->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    int boxExtent[6] = {0,-1,0,-1,0,-1};
+    boxLabelmap->GetExtent(boxExtent);
+    int boxClearedBox[6] = { boxExtent[0], boxExtent[1], boxExtent[2], boxExtent[3], boxExtent[4], boxExtent[4] };
+    SetBoxInLabelmap(boxLabelmap, boxClearedBox, 0);
+    vtkOrientedImageData* workBoxLabelmap = vtkOrientedImageData::SafeDownCast(
+      workNode->GetSegmentation()->GetSegment("Box")->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    SetBoxInLabelmap(workBoxLabelmap, boxClearedBox, 0);
+    if (!lazyStorageNode->WriteData(lazyNode.GetPointer()))
+    {
+      std::cerr << __LINE__ << ": Writing lazily read segmentation failed in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkNew<vtkMRMLSegmentationNode> rereadNode;
+    scene->AddNode(rereadNode.GetPointer());
+    if (!readerStorageNode->ReadData(rereadNode.GetPointer())
+      || !CompareSegmentations(lazyNode->GetSegmentation(), rereadNode->GetSegmentation(), true))
+    {
+      std::cerr << __LINE__ << ": Segmentation written after lazy read differs from the modified one in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CompareSegmentations(workNode->GetSegmentation(), rereadNode->GetSegmentation(), true))
+    {
+      std::cerr << __LINE__ << ": Segments not modified after lazy read were lost in " << settings.Name << " settings!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    scene->RemoveNode(rereadNode.GetPointer());
+    scene->RemoveNode(lazyStorageNode.GetPointer());
+    scene->RemoveNode(lazyNode.GetPointer());
+    scene->RemoveNode(readerStorageNode.GetPointer());
+    scene->RemoveNode(readNode.GetPointer());
+    scene->RemoveNode(workStorageNode.GetPointer());
+    scene->RemoveNode(workNode.GetPointer());
+  }
+
+  std::cout << "Segmentation storage node test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void CreateTestSegmentation(vtkSegmentation* segmentation)
+{
+  segmentation->SetMasterRepresentationName(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+
+  // Non-identity geometry so that any loss of directions, spacing or origin is detected
+  double directions[3][3] = { {-1.0, 0.0, 0.0}, {0.0, -1.0, 0.0}, {0.0, 0.0, 1.0} };
+  vtkSmartPointer<vtkOrientedImageData> emptyLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  emptyLabelmap->SetExtent(0, 29, 0, 24, 0, 19);
+  emptyLabelmap->SetSpacing(0.8, 0.8, 1.5);
+  emptyLabelmap->SetOrigin(10.0, -20.0, 5.0);
+  emptyLabelmap->SetDirections(directions);
+#if (VTK_MAJOR_VERSION <= 5)
+  emptyLabelmap->SetScalarTypeToUnsignedChar();
+  emptyLabelmap->SetNumberOfScalarComponents(1);
+  emptyLabelmap->AllocateScalars();
+#else
+  emptyLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+  int fullExtent[6] = { 0, 29, 0, 24, 0, 19 };
+  SetBoxInLabelmap(emptyLabelmap, fullExtent, 0);
+
+  struct SegmentDefinition
+  {
+    const char* Id;
+    const char* Name;
+    double Color[3];
+    const char* Tags[2];
+    int Box[6];
+  };
+  SegmentDefinition segmentDefinitions[] =
+    {
+    { "Box", "Box", {1.0, 0.0, 0.0}, {"Organ", "Test"}, {3, 12, 4, 15, 2, 9} },
+    { "Ball", "Ball with spaces", {0.0, 0.5, 1.0}, {"Tag with space", NULL}, {14, 22, 8, 16, 6, 14} },
+    { "Overlap", "Overlap", {0.25, 0.75, 0.0}, {NULL, NULL}, {10, 20, 10, 14, 5, 7} },
+    { "Empty", "Empty", {1.0, 1.0, 0.0}, {NULL, NULL}, {0, -1, 0, -1, 0, -1} }
+    };
+
+  for (int segmentIndex=0; segmentIndex<4; ++segmentIndex)
+  {
+    const SegmentDefinition& definition = segmentDefinitions[segmentIndex];
+    vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    labelmap->DeepCopy(emptyLabelmap);
+    int box[6] = { definition.Box[0], definition.Box[1], definition.Box[2], definition.Box[3], definition.Box[4], definition.Box[5] };
+    SetBoxInLabelmap(labelmap, box, 1);
+    if (segmentIndex == 1)
+    {
+      // Cut the corners of the ball so that it is not a box
+      int corner[6] = { 14, 15, 8, 9, 6, 14 };
+      SetBoxInLabelmap(labelmap, corner, 0);
+    }
+
+    vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+    segment->SetName(definition.Name);
+    segment->SetDefaultColor(definition.Color[0], definition.Color[1], definition.Color[2]);
+    for (int tagIndex=0; tagIndex<2; ++tagIndex)
+    {
+      if (definition.Tags[tagIndex])
+      {
+        segment->AddTag(definition.Tags[tagIndex]);
+      }
+    }
+    segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+    segmentation->AddSegment(segment, definition.Id);
+  }
+}
+
+//----------------------------------------------------------------------------
+void SetBoxInLabelmap(vtkOrientedImageData* labelmap, int box[6], unsigned char value)
+{
+  int extent[6] = {0,-1,0,-1,0,-1};
+  labelmap->GetExtent(extent);
+  for (int k=std::max(box[4],extent[4]); k<=std::min(box[5],extent[5]); ++k)
+  {
+    for (int j=std::max(box[2],extent[2]); j<=std::min(box[3],extent[3]); ++j)
+    {
+      for (int i=std::max(box[0],extent[0]); i<=std::min(box[1],extent[1]); ++i)
+      {
+        labelmap->SetScalarComponentFromDouble(i, j, k, 0, value);
+      }
+    }
+  }
+  labelmap->Modified();
+}
+
+//----------------------------------------------------------------------------
+void ConfigureStorageNode(vtkMRMLSegmentationStorageNode* storageNode, const StorageSettings& settings,
+  int lazyLoading, int memoryMapping, const std::string& filePath)
+{
+  storageNode->SetSparseLayout(settings.SparseLayout);
+  storageNode->SetUseCompression(settings.UseCompression);
+  storageNode->SetParallelCompression(settings.ParallelCompression);
+  storageNode->SetFastCompression(settings.FastCompression);
+  storageNode->SetLazyLoading(lazyLoading);
+  storageNode->SetMemoryMapping(memoryMapping);
+  storageNode->SetIncrementalWrite(1);
+  storageNode->SetFileName(filePath.c_str());
+}
+
+//----------------------------------------------------------------------------
+bool CompareSegmentations(vtkSegmentation* expectedSegmentation, vtkSegmentation* actualSegmentation, bool compareTags)
+{
+  if (expectedSegmentation->GetNumberOfSegments() != actualSegmentation->GetNumberOfSegments())
+  {
+    std::cerr << "Number of segments mismatch: expected " << expectedSegmentation->GetNumberOfSegments()
+      << ", actual " << actualSegmentation->GetNumberOfSegments() << std::endl;
+    return false;
+  }
+
+  std::vector<std::string> segmentIds;
+  expectedSegmentation->GetSegmentIDs(segmentIds);
+  for (std::vector<std::string>::iterator segmentIdIt = segmentIds.begin(); segmentIdIt != segmentIds.end(); ++segmentIdIt)
+  {
+    vtkSegment* expectedSegment = expectedSegmentation->GetSegment(*segmentIdIt);
+    vtkSegment* actualSegment = actualSegmentation->GetSegment(*segmentIdIt);
+    if (!actualSegment)
+    {
+      std::cerr << "Segment '" << (*segmentIdIt) << "' is missing" << std::endl;
+      return false;
+    }
+    if (std::string(expectedSegment->GetName() ? expectedSegment->GetName() : "")
+      != std::string(actualSegment->GetName() ? actualSegment->GetName() : ""))
+    {
+      std::cerr << "Name mismatch in segment '" << (*segmentIdIt) << "'" << std::endl;
+      return false;
+    }
+    double* expectedColor = expectedSegment->GetDefaultColor();
+    double* actualColor = actualSegment->GetDefaultColor();
+    for (int i=0; i<3; ++i)
+    {
+      if (!vtkOrientedImageDataResample::AreEqualWithTolerance(expectedColor[i], actualColor[i]))
+      {
+        std::cerr << "Color mismatch in segment '" << (*segmentIdIt) << "'" << std::endl;
+        return false;
+      }
+    }
+    if (compareTags)
+    {
+      std::vector<std::string> expectedTags;
+      expectedSegment->GetTags(expectedTags);
+      std::vector<std::string> actualTags;
+      actualSegment->GetTags(actualTags);
+      if (expectedTags != actualTags)
+      {
+        std::cerr << "Tags mismatch in segment '" << (*segmentIdIt) << "'" << std::endl;
+        return false;
+      }
+    }
+
+    vtkOrientedImageData* expectedLabelmap = vtkOrientedImageData::SafeDownCast(
+      expectedSegment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    vtkOrientedImageData* actualLabelmap = vtkOrientedImageData::SafeDownCast(
+      actualSegment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    if (!expectedLabelmap || !actualLabelmap)
+    {
+      std::cerr << "Binary labelmap is missing in segment '" << (*segmentIdIt) << "'" << std::endl;
+      return false;
+    }
+    if (!AreLabelmapsEqual(expectedLabelmap, actualLabelmap))
+    {
+      std::cerr << "Binary labelmap mismatch in segment '" << (*segmentIdIt) << "'" << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool AreLabelmapsEqual(vtkOrientedImageData* expectedLabelmap, vtkOrientedImageData* actualLabelmap)
+{
+  // Stored extent may differ (sparse layout stores the effective extent), but the geometry must match
+  vtkNew<vtkMatrix4x4> expectedImageToWorldMatrix;
+  expectedLabelmap->GetImageToWorldMatrix(expectedImageToWorldMatrix.GetPointer());
+  vtkNew<vtkMatrix4x4> actualImageToWorldMatrix;
+  actualLabelmap->GetImageToWorldMatrix(actualImageToWorldMatrix.GetPointer());
+  for (int row=0; row<3; ++row)
+  {
+    for (int column=0; column<4; ++column)
+    {
+      if (!vtkOrientedImageDataResample::AreEqualWithTolerance(
+        expectedImageToWorldMatrix->GetElement(row, column), actualImageToWorldMatrix->GetElement(row, column)))
+      {
+        std::cerr << "Geometry mismatch" << std::endl;
+        return false;
+      }
+    }
+  }
+
+  int expectedEffectiveExtent[6] = {0,-1,0,-1,0,-1};
+  bool expectedNonEmpty = vtkOrientedImageDataResample::CalculateEffectiveExtent(expectedLabelmap, expectedEffectiveExtent);
+  int actualEffectiveExtent[6] = {0,-1,0,-1,0,-1};
+  bool actualNonEmpty = vtkOrientedImageDataResample::CalculateEffectiveExtent(actualLabelmap, actualEffectiveExtent);
+  if (expectedNonEmpty != actualNonEmpty)
+  {
+    std::cerr << "Emptiness mismatch" << std::endl;
+    return false;
+  }
+  if (!expectedNonEmpty)
+  {
+    return true;
+  }
+  for (int i=0; i<6; ++i)
+  {
+    if (expectedEffectiveExtent[i] != actualEffectiveExtent[i])
+    {
+      std::cerr << "Effective extent mismatch" << std::endl;
+      return false;
+    }
+  }
+
+  for (int k=expectedEffectiveExtent[4]; k<=expectedEffectiveExtent[5]; ++k)
+  {
+    for (int j=expectedEffectiveExtent[2]; j<=expectedEffectiveExtent[3]; ++j)
+    {
+      for (int i=expectedEffectiveExtent[0]; i<=expectedEffectiveExtent[1]; ++i)
+      {
+        if ( (expectedLabelmap->GetScalarComponentAsDouble(i, j, k, 0) != 0.0)
+          != (actualLabelmap->GetScalarComponentAsDouble(i, j, k, 0) != 0.0) )
+        {
+          std::cerr << "Voxel mismatch at (" << i << ", " << j << ", " << k << ")" << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool IsSegmentationModifiedSinceRead(vtkSegmentation* segmentation, const vtkTimeStamp& readTime)
+{
+  std::vector<std::string> segmentIds;
+  segmentation->GetSegmentIDs(segmentIds);
+  for (std::vector<std::string>::iterator segmentIdIt = segmentIds.begin(); segmentIdIt != segmentIds.end(); ++segmentIdIt)
+  {
+    if (segmentation->GetSegment(*segmentIdIt)->GetModifiedSinceRead(readTime))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool CorruptNrrdDataStart(const std::string& filePath)
+{
+  // Data starts after the empty line that terminates the header
+  std::fstream file(filePath.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  std::string line;
+  while (std::getline(file, line) && !line.empty())
+  {
+  }
+  if (!file)
+  {
+    return false;
+  }
+  std::streamoff dataOffset = file.tellg();
+
+  // Overwrite the gzip header of the first member
+  const char zeros[16] = {0};
+  file.seekp(dataOffset);
+  file.write(zeros, sizeof(zeros));
+  return !file.fail();
+}
+
+//----------------------------------------------------------------------------
+bool AreFilesEqual(const std::string& filePath1, const std::string& filePath2)
+{
+  std::ifstream file1(filePath1.c_str(), std::ios::in | std::ios::binary);
+  std::ifstream file2(filePath2.c_str(), std::ios::in | std::ios::binary);
+  if (!file1 || !file2)
+  {
+    return false;
+  }
+  std::string content1((std::istreambuf_iterator<char>(file1)), std::istreambuf_iterator<char>());
+  std::string content2((std::istreambuf_iterator<char>(file2)), std::istreambuf_iterator<char>());
+  return (content1 == content2);
+}
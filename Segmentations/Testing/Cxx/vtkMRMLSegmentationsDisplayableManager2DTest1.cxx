@@ -0,0 +1,322 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+
+// Segmentations includes
+#include "vtkMRMLSegmentationDisplayNode.h"
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkMRMLSegmentationsDisplayableManager2D.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+#include "vtkSegmentationConverter.h"
+
+// MRML includes
+#include <vtkMRMLDisplayableManagerGroup.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceNode.h>
+
+// VTK includes
+#include <vtkActor2D.h>
+#include <vtkActor2DCollection.h>
+#include <vtkImageData.h>
+#include <vtkImageMapper.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper2D.h>
+#include <vtkProperty2D.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkVector.h>
+
+// STD includes
+#include <cmath>
+
+vtkActor2D* GetFillActor(vtkRenderer* renderer);
+vtkActor2D* GetOutlineActor(vtkRenderer* renderer);
+bool GetFillPixel(vtkActor2D* fillActor, int x, int y, unsigned char rgba[4]);
+bool GetOutlineBounds(vtkActor2D* outlineActor, double bounds[6]);
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSegmentationsDisplayableManager2DTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkRenderer> renderer;
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->SetOffScreenRendering(1);
+  renderWindow->AddRenderer(renderer.GetPointer());
+
+  vtkNew<vtkMRMLScene> scene;
+
+  // Axial slice through the origin with one millimeter pixels
+  vtkNew<vtkMRMLSliceNode> sliceNode;
+  scene->AddNode(sliceNode.GetPointer());
+  sliceNode->SetDimensions(64, 64, 1);
+  sliceNode->SetFieldOfView(64.0, 64.0, 1.0);
+
+  vtkNew<vtkMRMLSegmentationsDisplayableManager2D> displayableManager;
+  vtkNew<vtkMRMLDisplayableManagerGroup> displayableManagerGroup;
+  displayableManagerGroup->SetRenderer(renderer.GetPointer());
+  displayableManagerGroup->AddDisplayableManager(displayableManager.GetPointer());
+  displayableManagerGroup->SetMRMLDisplayableNode(sliceNode.GetPointer());
+
+  // Segmentation with a box segment around the origin, stored only as binary labelmap
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  segmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName() );
+
+  vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  labelmap->SetExtent(0, 19, 0, 19, 0, 19);
+  labelmap->SetOrigin(-10.0, -10.0, -10.0);
+  labelmap->SetSpacing(1.0, 1.0, 1.0);
+#if (VTK_MAJOR_VERSION <= 5)
+  labelmap->SetScalarTypeToUnsignedChar();
+  labelmap->SetNumberOfScalarComponents(1);
+  labelmap->AllocateScalars();
+#else
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+#endif
+  for (int k=0; k<20; ++k)
+  {
+    for (int j=0; j<20; ++j)
+    {
+      for (int i=0; i<20; ++i)
+      {
+        bool inside = (i >= 5 && i <= 14 && j >= 5 && j <= 14 && k >= 5 && k <= 14);
+        *static_cast<unsigned char*>(labelmap->GetScalarPointer(i, j, k)) = (inside ? 1 : 0);
+      }
+    }
+  }
+  vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+  segment->SetName("Box");
+  segment->SetDefaultColor(1.0, 0.0, 0.0);
+  segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+  segmentationNode->GetSegmentation()->AddSegment(segment, "Box");
+
+  segmentationNode->CreateDefaultDisplayNodes();
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  if (!displayNode)
+  {
+    std::cerr << __LINE__ << ": Failed to create segmentation display node!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkActor2D* fillActor = GetFillActor(renderer.GetPointer());
+  vtkActor2D* outlineActor = GetOutlineActor(renderer.GetPointer());
+  if (!fillActor || !outlineActor)
+  {
+    std::cerr << __LINE__ << ": No fill or outline actor is created for the segment!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Both fill and outline are shown without generating surfaces
+  if (segmentationNode->GetSegmentation()->ContainsRepresentation(
+    vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()) )
+  {
+    std::cerr << __LINE__ << ": Closed surface is generated for showing the segmentation in the slice view!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!fillActor->GetVisibility() || !outlineActor->GetVisibility())
+  {
+    std::cerr << __LINE__ << ": Fill or outline of the segment is not shown!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Fill has the segment color and the fill opacity inside the segment and is transparent outside
+  vtkVector3d segmentColor = displayNode->GetSegmentColor("Box");
+  unsigned char insideRgba[4] = {0, 0, 0, 0};
+  unsigned char outsideRgba[4] = {0, 0, 0, 0};
+  if (!GetFillPixel(fillActor, 32, 32, insideRgba) || !GetFillPixel(fillActor, 2, 2, outsideRgba))
+  {
+    std::cerr << __LINE__ << ": Fill image does not cover the slice!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int component=0; component<3; ++component)
+  {
+    if (fabs(insideRgba[component] - segmentColor[component] * 255.0) > 1.0)
+    {
+      std::cerr << __LINE__ << ": Fill color component " << component << " mismatch: expected " << segmentColor[component] * 255.0
+        << ", actual " << (int)insideRgba[component] << "!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (fabs(insideRgba[3] - displayNode->GetOpacity2DFill() * 255.0) > 1.0 || outsideRgba[3] != 0)
+  {
+    std::cerr << __LINE__ << ": Fill opacity mismatch: expected " << displayNode->GetOpacity2DFill() * 255.0 << " inside and 0 outside, actual "
+      << (int)insideRgba[3] << " and " << (int)outsideRgba[3] << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Outline is around the box, which covers ten pixels around the slice center along both slice axes
+  double outlineBounds[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+  if (!GetOutlineBounds(outlineActor, outlineBounds))
+  {
+    std::cerr << __LINE__ << ": Outline of the segment is empty!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int axis=0; axis<2; ++axis)
+  {
+    if (outlineBounds[2*axis] < 25.0 || outlineBounds[2*axis] > 28.0 || outlineBounds[2*axis+1] < 35.0 || outlineBounds[2*axis+1] > 38.0)
+    {
+      std::cerr << __LINE__ << ": Outline bounds mismatch along axis " << axis << ": ("
+        << outlineBounds[2*axis] << ", " << outlineBounds[2*axis+1] << ")!" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Fill and outline opacity follow the display node
+  displayNode->SetOpacity2DFill(0.2);
+  displayNode->SetOpacity2DOutline(0.6);
+  if (!GetFillPixel(fillActor, 32, 32, insideRgba) || fabs(insideRgba[3] - 0.2 * 255.0) > 1.0)
+  {
+    std::cerr << __LINE__ << ": Fill opacity is not updated, actual " << (int)insideRgba[3] << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (outlineActor->GetProperty()->GetOpacity() != 0.6)
+  {
+    std::cerr << __LINE__ << ": Outline opacity is not updated, actual " << outlineActor->GetProperty()->GetOpacity() << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Fill and outline can be hidden separately
+  displayNode->SetVisibility2DFill(false);
+  if (fillActor->GetVisibility() || !outlineActor->GetVisibility())
+  {
+    std::cerr << __LINE__ << ": Hiding the fill does not show only the outline!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  displayNode->SetVisibility2DFill(true);
+  displayNode->SetVisibility2DOutline(false);
+  if (!fillActor->GetVisibility() || outlineActor->GetVisibility())
+  {
+    std::cerr << __LINE__ << ": Hiding the outline does not show only the fill!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  displayNode->SetVisibility2DOutline(true);
+  displayNode->SetSegmentVisibility("Box", false);
+  if (fillActor->GetVisibility() || outlineActor->GetVisibility())
+  {
+    std::cerr << __LINE__ << ": Hidden segment is shown!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  displayNode->SetSegmentVisibility("Box", true);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Nothing is shown in a slice that does not intersect the segment
+  sliceNode->SetSliceOffset(50.0);
+  if (fillActor->GetVisibility() || outlineActor->GetVisibility())
+  {
+    std::cerr << __LINE__ << ": Segment is shown in a slice that does not intersect it!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  sliceNode->SetSliceOffset(0.0);
+  if (!fillActor->GetVisibility() || !outlineActor->GetVisibility())
+  {
+    std::cerr << __LINE__ << ": Segment is not shown again in a slice that intersects it!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Segmentations 2D displayable manager test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+vtkActor2D* GetFillActor(vtkRenderer* renderer)
+{
+  // The fill is shown as an image, the outline as poly data
+  vtkActor2DCollection* actors = renderer->GetActors2D();
+  vtkCollectionSimpleIterator actorIt;
+  actors->InitTraversal(actorIt);
+  while (vtkActor2D* actor = actors->GetNextActor2D(actorIt))
+  {
+    if (vtkImageMapper::SafeDownCast(actor->GetMapper()))
+    {
+      return actor;
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkActor2D* GetOutlineActor(vtkRenderer* renderer)
+{
+  vtkActor2DCollection* actors = renderer->GetActors2D();
+  vtkCollectionSimpleIterator actorIt;
+  actors->InitTraversal(actorIt);
+  while (vtkActor2D* actor = actors->GetNextActor2D(actorIt))
+  {
+    if (vtkPolyDataMapper2D::SafeDownCast(actor->GetMapper()))
+    {
+      return actor;
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+bool GetFillPixel(vtkActor2D* fillActor, int x, int y, unsigned char rgba[4])
+{
+  vtkImageMapper* mapper = vtkImageMapper::SafeDownCast(fillActor->GetMapper());
+#if (VTK_MAJOR_VERSION <= 5)
+  mapper->GetInput()->Update();
+#else
+  mapper->GetInputAlgorithm()->Update();
+#endif
+  vtkImageData* image = mapper->GetInput();
+  int extent[6] = {0,-1,0,-1,0,-1};
+  image->GetExtent(extent);
+  if ( !image->GetPointData()->GetScalars() || image->GetNumberOfScalarComponents() != 4
+    || x < extent[0] || x > extent[1] || y < extent[2] || y > extent[3] )
+  {
+    return false;
+  }
+  unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer(x, y, extent[4]));
+  for (int component=0; component<4; ++component)
+  {
+    rgba[component] = pixel[component];
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool GetOutlineBounds(vtkActor2D* outlineActor, double bounds[6])
+{
+  vtkPolyDataMapper2D* mapper = vtkPolyDataMapper2D::SafeDownCast(outlineActor->GetMapper());
+#if (VTK_MAJOR_VERSION <= 5)
+  mapper->GetInput()->Update();
+#else
+  mapper->GetInputAlgorithm()->Update();
+#endif
+  vtkPolyData* polyData = mapper->GetInput();
+  if (!polyData || polyData->GetNumberOfPoints() == 0)
+  {
+    return false;
+  }
+  polyData->GetBounds(bounds);
+  return true;
+}
@@ -0,0 +1,231 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+// Segmentations includes
+#include "vtkMRMLSegmentationDisplayNode.h"
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkMRMLSegmentationsDisplayableManager3D.h"
+
+// SegmentationCore includes
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+#include "vtkSegmentationConverter.h"
+
+// MRML includes
+#include <vtkMRMLDisplayableManagerGroup.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLViewNode.h>
+
+// VTK includes
+#include <vtkActor.h>
+#include <vtkActorCollection.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+
+// STD includes
+#include <cstring>
+#include <sstream>
+
+vtkActor* GetBatchedActor(vtkRenderer* renderer);
+int GetNumberOfBatchedSegments(vtkRenderer* renderer);
+int GetNumberOfVisibleSegmentActors(vtkRenderer* renderer, double opacity);
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSegmentationsDisplayableManager3DTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkRenderer> renderer;
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->SetOffScreenRendering(1);
+  renderWindow->AddRenderer(renderer.GetPointer());
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLViewNode> viewNode;
+  scene->AddNode(viewNode.GetPointer());
+
+  vtkNew<vtkMRMLSegmentationsDisplayableManager3D> displayableManager;
+  vtkNew<vtkMRMLDisplayableManagerGroup> displayableManagerGroup;
+  displayableManagerGroup->SetRenderer(renderer.GetPointer());
+  displayableManagerGroup->AddDisplayableManager(displayableManager.GetPointer());
+  displayableManagerGroup->SetMRMLDisplayableNode(viewNode.GetPointer());
+
+  // Segmentation with enough opaque segments to be shown by the batched actor
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  segmentationNode->CreateDefaultDisplayNodes();
+  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  if (!displayNode)
+  {
+    std::cerr << __LINE__ << ": Failed to create segmentation display node!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  segmentationNode->GetSegmentation()->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName() );
+
+  const int numberOfSegments = 20;
+  for (int segmentIndex=0; segmentIndex<numberOfSegments; ++segmentIndex)
+  {
+    vtkNew<vtkSphereSource> sphereSource;
+    sphereSource->SetCenter(segmentIndex * 10.0, 0.0, 0.0);
+    sphereSource->SetRadius(4.0);
+    sphereSource->Update();
+    vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+    std::stringstream segmentIdStream;
+    segmentIdStream << "Segment_" << segmentIndex;
+    segment->SetName(segmentIdStream.str().c_str());
+    segment->SetDefaultColor(segmentIndex / (double)numberOfSegments, 0.5, 1.0 - segmentIndex / (double)numberOfSegments);
+    segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(), sphereSource->GetOutput());
+    segmentationNode->GetSegmentation()->AddSegment(segment, segmentIdStream.str());
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // All segments opaque: all are shown by the batched actor
+  if (!GetBatchedActor(renderer.GetPointer()) || !GetBatchedActor(renderer.GetPointer())->GetVisibility()
+    || GetBatchedActor(renderer.GetPointer())->GetProperty()->GetOpacity() != 1.0)
+  {
+    std::cerr << __LINE__ << ": Opaque segments are not shown by an opaque batched actor!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ( GetNumberOfBatchedSegments(renderer.GetPointer()) != numberOfSegments
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), -1.0) != 0 )
+  {
+    std::cerr << __LINE__ << ": Expected " << numberOfSegments << " batched segments and no segment actors, got "
+      << GetNumberOfBatchedSegments(renderer.GetPointer()) << " and " << GetNumberOfVisibleSegmentActors(renderer.GetPointer(), -1.0) << "!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Translucent segment is taken out of the batch and shown by its own actor, then put back
+  displayNode->SetSegmentPolyDataOpacity("Segment_5", 0.5);
+  if ( GetNumberOfBatchedSegments(renderer.GetPointer()) != numberOfSegments - 1
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), 0.5) != 1
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), -1.0) != 1 )
+  {
+    std::cerr << __LINE__ << ": Translucent segment is not shown by its own actor!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  displayNode->SetSegmentPolyDataOpacity("Segment_5", 1.0);
+  if ( GetNumberOfBatchedSegments(renderer.GetPointer()) != numberOfSegments
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), -1.0) != 0 )
+  {
+    std::cerr << __LINE__ << ": Segment made opaque again is not shown by the batched actor!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Hidden segment is shown neither by the batched actor nor by its own actor
+  displayNode->SetSegmentVisibility("Segment_7", false);
+  if ( GetNumberOfBatchedSegments(renderer.GetPointer()) != numberOfSegments - 1
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), -1.0) != 0 )
+  {
+    std::cerr << __LINE__ << ": Hidden segment is shown!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Translucent display node: no segment is batched, the visible ones are shown by their own translucent actors
+  displayNode->SetOpacity(0.5);
+  if ( GetNumberOfBatchedSegments(renderer.GetPointer()) != 0
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), 0.5) != numberOfSegments - 1 )
+  {
+    std::cerr << __LINE__ << ": Segments of translucent display node are batched!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  displayNode->SetOpacity(1.0);
+  if ( GetNumberOfBatchedSegments(renderer.GetPointer()) != numberOfSegments - 1
+    || GetNumberOfVisibleSegmentActors(renderer.GetPointer(), -1.0) != 0 )
+  {
+    std::cerr << __LINE__ << ": Segments of opaque display node are not batched!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Segmentations 3D displayable manager test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+vtkActor* GetBatchedActor(vtkRenderer* renderer)
+{
+  // The batched actor colors its cells by the segment color cell array
+  vtkActorCollection* actors = renderer->GetActors();
+  vtkCollectionSimpleIterator actorIt;
+  actors->InitTraversal(actorIt);
+  while (vtkActor* actor = actors->GetNextActor(actorIt))
+  {
+    vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(actor->GetMapper());
+    if ( mapper && mapper->GetScalarMode() == VTK_SCALAR_MODE_USE_CELL_FIELD_DATA
+      && mapper->GetArrayName() && !strcmp(mapper->GetArrayName(), "SegmentColor") )
+    {
+      return actor;
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+int GetNumberOfBatchedSegments(vtkRenderer* renderer)
+{
+  vtkActor* batchedActor = GetBatchedActor(renderer);
+  if (!batchedActor || !batchedActor->GetVisibility())
+  {
+    return 0;
+  }
+  vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(batchedActor->GetMapper());
+  mapper->Update();
+  vtkDataArray* segmentIndexArray = mapper->GetInput()->GetCellData()->GetArray("SegmentIndex");
+  if (!segmentIndexArray || segmentIndexArray->GetNumberOfTuples() == 0)
+  {
+    return 0;
+  }
+  // Segment indices are consecutive from zero
+  return (int)segmentIndexArray->GetRange()[1] + 1;
+}
+
+//----------------------------------------------------------------------------
+int GetNumberOfVisibleSegmentActors(vtkRenderer* renderer, double opacity)
+{
+  // Count the visible per-segment actors, optionally only the ones with the given opacity
+  vtkActor* batchedActor = GetBatchedActor(renderer);
+  int numberOfActors = 0;
+  vtkActorCollection* actors = renderer->GetActors();
+  vtkCollectionSimpleIterator actorIt;
+  actors->InitTraversal(actorIt);
+  while (vtkActor* actor = actors->GetNextActor(actorIt))
+  {
+    if (actor == batchedActor || !actor->GetVisibility())
+    {
+      continue;
+    }
+    if (opacity >= 0.0 && actor->GetProperty()->GetOpacity() != opacity)
+    {
+      continue;
+    }
+    ++numberOfActors;
+  }
+  return numberOfActors;
+}
@@ -111,6 +111,8 @@ void qMRMLSegmentSelectorWidget::onCurrentNodeChanged(vtkMRMLNode* node)
                    this, SLOT( populateSegmentCombobox() ) );
     qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentRemoved,
                    this, SLOT( populateSegmentCombobox() ) );
+    qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentsBatchModified,
+                   this, SLOT( populateSegmentCombobox() ) );
 
     d->SegmentationNode = segmentationNode;
     this->populateSegmentCombobox();
@@ -128,6 +128,8 @@ void qMRMLSegmentationRepresentationsListView::setSegmentationNode(vtkMRMLNode*
                  this, SLOT( populateRepresentationsList() ) );
   qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentRemoved,
                  this, SLOT( populateRepresentationsList() ) );
+  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentsBatchModified,
+                 this, SLOT( populateRepresentationsList() ) );
 
   d->SegmentationNode = segmentationNode;
   this->populateRepresentationsList();
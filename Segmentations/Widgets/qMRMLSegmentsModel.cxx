@@ -0,0 +1,625 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// Segmentations includes
+#include "qMRMLSegmentsModel.h"
+
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkMRMLSegmentationDisplayNode.h"
+#include "vtkSegmentation.h"
+#include "vtkSegment.h"
+
+// MRML includes
+#include <vtkMRMLLabelMapVolumeNode.h>
+#include <vtkMRMLModelNode.h>
+
+// Qt includes
+#include <QColor>
+#include <QDebug>
+#include <QFont>
+#include <QIcon>
+#include <QPixmap>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+
+//-----------------------------------------------------------------------------
+class qMRMLSegmentsModelPrivate
+{
+  Q_DECLARE_PUBLIC(qMRMLSegmentsModel);
+
+protected:
+  qMRMLSegmentsModel* const q_ptr;
+public:
+  qMRMLSegmentsModelPrivate(qMRMLSegmentsModel& object);
+
+  /// Get display node of the segmentation node
+  vtkMRMLSegmentationDisplayNode* displayNode()const;
+
+  /// Get row of a segment. -1 if segment is not in the model
+  int rowFromSegmentID(const std::string& segmentID)const;
+
+  /// Insert and remove rows so that they match the segments of the segmentation
+  void synchronizeSegmentIDs();
+
+public:
+  /// Segmentation MRML node containing shown segments
+  vtkMRMLSegmentationNode* SegmentationNode;
+
+  /// Model or labelmap volume MRML node containing a representation (for import/export)
+  vtkMRMLDisplayableNode* RepresentationNode;
+
+  /// Segment IDs in the order of the rows. Same as the order of the segments in the segmentation
+  /// (sorted by ID), so the row of a segment can be found by binary search
+  std::vector<std::string> SegmentIDs;
+};
+
+//-----------------------------------------------------------------------------
+qMRMLSegmentsModelPrivate::qMRMLSegmentsModelPrivate(qMRMLSegmentsModel& object)
+  : q_ptr(&object)
+{
+  this->SegmentationNode = NULL;
+  this->RepresentationNode = NULL;
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLSegmentationDisplayNode* qMRMLSegmentsModelPrivate::displayNode()const
+{
+  if (!this->SegmentationNode)
+  {
+    return NULL;
+  }
+  return vtkMRMLSegmentationDisplayNode::SafeDownCast(this->SegmentationNode->GetDisplayNode());
+}
+
+//-----------------------------------------------------------------------------
+int qMRMLSegmentsModelPrivate::rowFromSegmentID(const std::string& segmentID)const
+{
+  std::vector<std::string>::const_iterator segmentIdIt =
+    std::lower_bound(this->SegmentIDs.begin(), this->SegmentIDs.end(), segmentID);
+  if (segmentIdIt == this->SegmentIDs.end() || *segmentIdIt != segmentID)
+  {
+    return -1;
+  }
+  return segmentIdIt - this->SegmentIDs.begin();
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModelPrivate::synchronizeSegmentIDs()
+{
+  Q_Q(qMRMLSegmentsModel);
+
+  std::vector<std::string> segmentIDs;
+  if (this->SegmentationNode && this->SegmentationNode->GetSegmentation())
+  {
+    this->SegmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
+  }
+
+  // Both lists are sorted, so walk them together
+  int row = 0;
+  std::vector<std::string>::iterator segmentIdIt = segmentIDs.begin();
+  while (segmentIdIt != segmentIDs.end() || row < (int)this->SegmentIDs.size())
+  {
+    if ( row < (int)this->SegmentIDs.size()
+      && (segmentIdIt == segmentIDs.end() || this->SegmentIDs[row] < *segmentIdIt) )
+    {
+      // Segment of the row has been removed
+      q->beginRemoveRows(QModelIndex(), row, row);
+      this->SegmentIDs.erase(this->SegmentIDs.begin() + row);
+      q->endRemoveRows();
+    }
+    else if (row >= (int)this->SegmentIDs.size() || *segmentIdIt < this->SegmentIDs[row])
+    {
+      // Segment has been added
+      q->beginInsertRows(QModelIndex(), row, row);
+      this->SegmentIDs.insert(this->SegmentIDs.begin() + row, *segmentIdIt);
+      q->endInsertRows();
+      ++row;
+      ++segmentIdIt;
+    }
+    else
+    {
+      ++row;
+      ++segmentIdIt;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+// qMRMLSegmentsModel methods
+
+//-----------------------------------------------------------------------------
+qMRMLSegmentsModel::qMRMLSegmentsModel(QObject* _parent)
+  : QAbstractTableModel(_parent)
+  , d_ptr(new qMRMLSegmentsModelPrivate(*this))
+{
+}
+
+//-----------------------------------------------------------------------------
+qMRMLSegmentsModel::~qMRMLSegmentsModel()
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLNode* qMRMLSegmentsModel::segmentationNode()const
+{
+  Q_D(const qMRMLSegmentsModel);
+  return d->SegmentationNode;
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::setSegmentationNode(vtkMRMLNode* node)
+{
+  Q_D(qMRMLSegmentsModel);
+
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(node);
+
+  this->beginResetModel();
+
+  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentAdded,
+                 this, SLOT( onSegmentAdded(vtkObject*,void*) ) );
+  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentRemoved,
+                 this, SLOT( onSegmentRemoved(vtkObject*,void*) ) );
+  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentModified,
+                 this, SLOT( onSegmentModified(vtkObject*,void*) ) );
+  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkMRMLDisplayableNode::DisplayModifiedEvent,
+                 this, SLOT( onDisplayModified() ) );
+  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentsBatchModified,
+                 this, SLOT( onSegmentsBatchModified() ) );
+
+  d->SegmentationNode = segmentationNode;
+  d->SegmentIDs.clear();
+  if (segmentationNode && segmentationNode->GetSegmentation())
+  {
+    segmentationNode->GetSegmentation()->GetSegmentIDs(d->SegmentIDs);
+  }
+
+  this->endResetModel();
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLNode* qMRMLSegmentsModel::representationNode()const
+{
+  Q_D(const qMRMLSegmentsModel);
+  return d->RepresentationNode;
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::setRepresentationNode(vtkMRMLNode* node)
+{
+  Q_D(qMRMLSegmentsModel);
+
+  vtkMRMLLabelMapVolumeNode* labelmapNode = vtkMRMLLabelMapVolumeNode::SafeDownCast(node);
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node);
+
+  this->beginResetModel();
+  d->RepresentationNode = (labelmapNode ? (vtkMRMLDisplayableNode*)labelmapNode : (vtkMRMLDisplayableNode*)modelNode);
+  this->endResetModel();
+}
+
+//-----------------------------------------------------------------------------
+QString qMRMLSegmentsModel::segmentIDFromRow(int row)const
+{
+  Q_D(const qMRMLSegmentsModel);
+  if (d->RepresentationNode || row < 0 || row >= (int)d->SegmentIDs.size())
+  {
+    return QString();
+  }
+  return QString(d->SegmentIDs[row].c_str());
+}
+
+//-----------------------------------------------------------------------------
+int qMRMLSegmentsModel::rowFromSegmentID(const QString& segmentID)const
+{
+  Q_D(const qMRMLSegmentsModel);
+  if (d->RepresentationNode)
+  {
+    return -1;
+  }
+  return d->rowFromSegmentID(segmentID.toLatin1().constData());
+}
+
+//-----------------------------------------------------------------------------
+int qMRMLSegmentsModel::rowCount(const QModelIndex& parent)const
+{
+  Q_D(const qMRMLSegmentsModel);
+  if (parent.isValid())
+  {
+    return 0;
+  }
+  if (d->RepresentationNode)
+  {
+    return 1;
+  }
+  return (d->SegmentationNode ? (int)d->SegmentIDs.size() : 0);
+}
+
+//-----------------------------------------------------------------------------
+int qMRMLSegmentsModel::columnCount(const QModelIndex& parent)const
+{
+  return (parent.isValid() ? 0 : NumberOfColumns);
+}
+
+//-----------------------------------------------------------------------------
+QVariant qMRMLSegmentsModel::data(const QModelIndex& index, int role)const
+{
+  Q_D(const qMRMLSegmentsModel);
+
+  if (!index.isValid())
+  {
+    return QVariant();
+  }
+  int column = index.column();
+
+  // Show node name and type if representation node
+  if (d->RepresentationNode)
+  {
+    if (column != NameColumn)
+    {
+      return QVariant();
+    }
+    if (role == Qt::DisplayRole || role == Qt::ToolTipRole)
+    {
+      return QString("%1\n(%2 node)").arg(d->RepresentationNode->GetName()).arg(d->RepresentationNode->GetNodeTagName());
+    }
+    else if (role == Qt::FontRole)
+    {
+      QFont boldFont;
+      boldFont.setWeight(QFont::Bold);
+      return boldFont;
+    }
+    return QVariant();
+  }
+
+  if (!d->SegmentationNode || index.row() >= (int)d->SegmentIDs.size())
+  {
+    return QVariant();
+  }
+  const std::string& segmentId = d->SegmentIDs[index.row()];
+  if (role == IDRole)
+  {
+    return QString(segmentId.c_str());
+  }
+
+  // Segment name
+  if (column == NameColumn)
+  {
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+    {
+      return QVariant();
+    }
+    vtkSegment* segment = d->SegmentationNode->GetSegmentation()->GetSegment(segmentId);
+    return (segment ? QVariant(QString(segment->GetName())) : QVariant());
+  }
+
+  // All other columns show segment display properties
+  vtkMRMLSegmentationDisplayNode* displayNode = d->displayNode();
+  vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
+  if (!displayNode || !displayNode->GetSegmentDisplayProperties(segmentId, properties))
+  {
+    return QVariant();
+  }
+
+  if (column == VisibleColumn)
+  {
+    if (role == VisibilityRole)
+    {
+      return QVariant(properties.Visible);
+    }
+    else if (role == Qt::DecorationRole)
+    {
+      return QPixmap(properties.Visible ? ":/Icons/Small/SlicerVisible.png" : ":/Icons/Small/SlicerInvisible.png");
+    }
+  }
+  else if (column == ColorColumn)
+  {
+    if (role == Qt::DecorationRole)
+    {
+      return QColor::fromRgbF(properties.Color[0], properties.Color[1], properties.Color[2]);
+    }
+    else if (role == Qt::ToolTipRole)
+    {
+      return QString("Color");
+    }
+  }
+  else if (column == OpacityColumn)
+  {
+    if (role == Qt::DisplayRole || role == Qt::EditRole) // EditRole for qMRMLDoubleSpinBoxDelegate
+    {
+      return properties.PolyDataOpacity;
+    }
+    else if (role == Qt::ToolTipRole)
+    {
+      return QString("Opacity");
+    }
+  }
+
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+bool qMRMLSegmentsModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+  Q_D(qMRMLSegmentsModel);
+
+  if (!index.isValid() || !d->SegmentationNode || d->RepresentationNode || index.row() >= (int)d->SegmentIDs.size())
+  {
+    return false;
+  }
+  // Copy the ID, as the rows may change while the segmentation is being modified
+  std::string segmentId = d->SegmentIDs[index.row()];
+  int column = index.column();
+
+  // If segment name has been changed. The row is updated when the segment modified event is received
+  if (column == NameColumn)
+  {
+    if (role != Qt::EditRole)
+    {
+      return false;
+    }
+    vtkSegment* segment = d->SegmentationNode->GetSegmentation()->GetSegment(segmentId);
+    if (!segment)
+    {
+      qCritical() << "qMRMLSegmentsModel::setData: Segment with ID '" << segmentId.c_str() << "' not found in segmentation node " << d->SegmentationNode->GetName();
+      return false;
+    }
+    QString nameText = value.toString();
+    if (nameText.compare(segment->GetName()))
+    {
+      segment->SetName(nameText.toLatin1().constData());
+    }
+    return true;
+  }
+
+  // For all other columns we need the display node. The rows are updated when the display modified event is received
+  vtkMRMLSegmentationDisplayNode* displayNode = d->displayNode();
+  if (!displayNode)
+  {
+    qCritical() << "qMRMLSegmentsModel::setData: No display node for segmentation!";
+    return false;
+  }
+  vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
+  if (!displayNode->GetSegmentDisplayProperties(segmentId, properties))
+  {
+    return false;
+  }
+
+  bool valueChanged = false;
+
+  // Visibility changed
+  if (column == VisibleColumn && role == VisibilityRole)
+  {
+    bool visible = value.toBool();
+    if (properties.Visible != visible)
+    {
+      properties.Visible = visible;
+      valueChanged = true;
+    }
+  }
+  // Color changed
+  else if (column == ColorColumn && role == Qt::DecorationRole)
+  {
+    QColor color = value.value<QColor>();
+    QColor oldColor = QColor::fromRgbF(properties.Color[0], properties.Color[1], properties.Color[2]);
+    if (oldColor != color)
+    {
+      properties.Color[0] = color.redF();
+      properties.Color[1] = color.greenF();
+      properties.Color[2] = color.blueF();
+      valueChanged = true;
+    }
+  }
+  // Opacity changed
+  else if (column == OpacityColumn && role == Qt::EditRole)
+  {
+    QString opacity = QString::number(value.toDouble(), 'f', 2);
+    QString currentOpacity = QString::number(properties.PolyDataOpacity, 'f', 2);
+    if (opacity != currentOpacity)
+    {
+      properties.PolyDataOpacity = opacity.toDouble();
+      valueChanged = true;
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  // Set changed properties to segmentation display node if a value has actually changed
+  if (valueChanged)
+  {
+    displayNode->SetSegmentDisplayProperties(segmentId, properties);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+Qt::ItemFlags qMRMLSegmentsModel::flags(const QModelIndex& index)const
+{
+  Q_D(const qMRMLSegmentsModel);
+
+  if (!index.isValid())
+  {
+    return Qt::NoItemFlags;
+  }
+  Qt::ItemFlags itemFlags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+  // Visibility is toggled by clicking, disable editing so that a double click won't bring up an entry box
+  if (!d->RepresentationNode && index.column() != VisibleColumn)
+  {
+    itemFlags |= Qt::ItemIsEditable;
+  }
+  return itemFlags;
+}
+
+//-----------------------------------------------------------------------------
+QVariant qMRMLSegmentsModel::headerData(int section, Qt::Orientation orientation, int role)const
+{
+  if (orientation != Qt::Horizontal)
+  {
+    return QVariant();
+  }
+  if (role == Qt::DisplayRole)
+  {
+    switch (section)
+    {
+    case ColorColumn: return QString("Color");
+    case OpacityColumn: return QString("Opacity");
+    case NameColumn: return QString("Name");
+    default: return QVariant();
+    }
+  }
+  else if (role == Qt::DecorationRole && section == VisibleColumn)
+  {
+    return QIcon(":/Icons/Small/SlicerVisibleInvisible.png");
+  }
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::onSegmentAdded(vtkObject* vtkNotUsed(caller), void* callData)
+{
+  Q_D(qMRMLSegmentsModel);
+
+  const char* segmentId = reinterpret_cast<const char*>(callData);
+  if (!segmentId || d->RepresentationNode)
+  {
+    return;
+  }
+  std::vector<std::string>::iterator segmentIdIt =
+    std::lower_bound(d->SegmentIDs.begin(), d->SegmentIDs.end(), std::string(segmentId));
+  if (segmentIdIt != d->SegmentIDs.end() && !segmentIdIt->compare(segmentId))
+  {
+    // Already added when synchronizing with the segmentation
+    return;
+  }
+
+  int row = segmentIdIt - d->SegmentIDs.begin();
+  this->beginInsertRows(QModelIndex(), row, row);
+  d->SegmentIDs.insert(segmentIdIt, segmentId);
+  this->endInsertRows();
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::onSegmentRemoved(vtkObject* vtkNotUsed(caller), void* callData)
+{
+  Q_D(qMRMLSegmentsModel);
+
+  const char* segmentId = reinterpret_cast<const char*>(callData);
+  if (!segmentId || d->RepresentationNode)
+  {
+    return;
+  }
+  int row = d->rowFromSegmentID(segmentId);
+  if (row < 0)
+  {
+    // Already removed when synchronizing with the segmentation
+    return;
+  }
+
+  this->beginRemoveRows(QModelIndex(), row, row);
+  d->SegmentIDs.erase(d->SegmentIDs.begin() + row);
+  this->endRemoveRows();
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::onSegmentModified(vtkObject* vtkNotUsed(caller), void* callData)
+{
+  Q_D(qMRMLSegmentsModel);
+
+  const char* segmentId = reinterpret_cast<const char*>(callData);
+  if (!segmentId || d->RepresentationNode)
+  {
+    return;
+  }
+  int row = d->rowFromSegmentID(segmentId);
+  if (row < 0)
+  {
+    return;
+  }
+  emit dataChanged(this->index(row, 0), this->index(row, NumberOfColumns-1));
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::onDisplayModified()
+{
+  Q_D(qMRMLSegmentsModel);
+
+  if (d->RepresentationNode || !d->SegmentationNode)
+  {
+    return;
+  }
+
+  // Display properties are added and removed before the segment added and removed events
+  // are received, and no segment events are invoked during scene import, so make sure
+  // the rows match the segments. A single segment is inserted or removed, more changes
+  // come from batch modification or import, for which the model is reset.
+  vtkSegmentation* segmentation = d->SegmentationNode->GetSegmentation();
+  int numberOfSegments = (segmentation ? segmentation->GetNumberOfSegments() : 0);
+  int numberOfChangedRows = abs(numberOfSegments - (int)d->SegmentIDs.size());
+  if (numberOfChangedRows == 1)
+  {
+    d->synchronizeSegmentIDs();
+  }
+  else if (numberOfChangedRows > 1)
+  {
+    this->onSegmentsBatchModified();
+    return;
+  }
+
+  // The event does not tell which segment changed, but only the visible rows are repainted
+  if (!d->SegmentIDs.empty())
+  {
+    emit dataChanged(this->index(0, VisibleColumn), this->index(d->SegmentIDs.size()-1, OpacityColumn));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSegmentsModel::onSegmentsBatchModified()
+{
+  Q_D(qMRMLSegmentsModel);
+
+  if (d->RepresentationNode)
+  {
+    return;
+  }
+
+  std::vector<std::string> segmentIDs;
+  if (d->SegmentationNode && d->SegmentationNode->GetSegmentation())
+  {
+    d->SegmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
+  }
+
+  // Rows may have already been updated when the display node was modified in the batch,
+  // in which case only the contents of the rows need to be updated
+  if (segmentIDs == d->SegmentIDs)
+  {
+    if (!d->SegmentIDs.empty())
+    {
+      emit dataChanged(this->index(0, 0), this->index(d->SegmentIDs.size()-1, NumberOfColumns-1));
+    }
+    return;
+  }
+
+  this->beginResetModel();
+  d->SegmentIDs.swap(segmentIDs);
+  this->endResetModel();
+}
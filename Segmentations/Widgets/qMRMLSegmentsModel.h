@@ -0,0 +1,117 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __qMRMLSegmentsModel_h
+#define __qMRMLSegmentsModel_h
+
+// Qt includes
+#include <QAbstractTableModel>
+
+// MRMLWidgets includes
+#include "qSlicerSegmentationsModuleWidgetsExport.h"
+
+// CTK includes
+#include <ctkPimpl.h>
+#include <ctkVTKObject.h>
+
+class vtkMRMLNode;
+class vtkObject;
+class qMRMLSegmentsModelPrivate;
+
+/// \brief Table model listing the segments of a segmentation node, used by \sa qMRMLSegmentsTableView
+///
+/// Only the segment IDs are stored in the model, all other data is read from the segmentation and its
+/// display node when requested. Adding, removing and modifying a segment only updates the affected row,
+/// batch modification of the segmentation resets the model once.
+/// If a representation node (model or labelmap volume) is set instead of a segmentation node, then
+/// a single row shows the name and type of that node.
+/// \ingroup SlicerRt_QtModules_Segmentations_Widgets
+class Q_SLICER_MODULE_SEGMENTATIONS_WIDGETS_EXPORT qMRMLSegmentsModel : public QAbstractTableModel
+{
+  Q_OBJECT
+  QVTK_OBJECT
+
+public:
+  enum SegmentColumn
+    {
+    VisibleColumn = 0,
+    ColorColumn,
+    OpacityColumn,
+    NameColumn,
+    NumberOfColumns
+    };
+
+  enum SegmentItemDataRole
+    {
+    /// Segment ID of the row
+    IDRole = Qt::UserRole + 1,
+    /// Visibility of the segment. It is closely related to the item icon.
+    VisibilityRole
+    };
+
+public:
+  /// Constructor
+  explicit qMRMLSegmentsModel(QObject* parent = 0);
+  /// Destructor
+  virtual ~qMRMLSegmentsModel();
+
+  /// Get segmentation MRML node
+  vtkMRMLNode* segmentationNode()const;
+  /// Set segmentation MRML node. Resets the model
+  void setSegmentationNode(vtkMRMLNode* node);
+
+  /// Get representation MRML node (model or labelmap volume MRML node for import/export)
+  vtkMRMLNode* representationNode()const;
+  /// Set representation MRML node (model or labelmap volume MRML node for import/export). Resets the model
+  void setRepresentationNode(vtkMRMLNode* node);
+
+  /// Get segment ID shown in a row. Empty string if there is no such row
+  QString segmentIDFromRow(int row)const;
+  /// Get row of a segment. -1 if segment is not in the model
+  int rowFromSegmentID(const QString& segmentID)const;
+
+  virtual int rowCount(const QModelIndex& parent = QModelIndex())const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex())const;
+  virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole)const;
+  virtual bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
+  virtual Qt::ItemFlags flags(const QModelIndex& index)const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole)const;
+
+protected slots:
+  /// Insert row of added segment
+  void onSegmentAdded(vtkObject* caller, void* callData);
+  /// Remove row of removed segment
+  void onSegmentRemoved(vtkObject* caller, void* callData);
+  /// Update row of modified segment (name)
+  void onSegmentModified(vtkObject* caller, void* callData);
+  /// Update display properties of the segments (visibility, color, opacity)
+  void onDisplayModified();
+  /// Reset model after batch modification of the segmentation
+  void onSegmentsBatchModified();
+
+protected:
+  QScopedPointer<qMRMLSegmentsModelPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qMRMLSegmentsModel);
+  Q_DISABLE_COPY(qMRMLSegmentsModel);
+};
+
+#endif
@@ -24,17 +24,12 @@
 #include "ui_qMRMLSegmentsTableView.h"
 
 #include "qMRMLDoubleSpinBoxDelegate.h"
+#include "qMRMLSegmentsModel.h"
 
 #include "vtkMRMLSegmentationNode.h"
-#include "vtkMRMLSegmentationDisplayNode.h"
-#include "vtkSegmentation.h"
-#include "vtkSegment.h"
-
-// MRML includes
-#include <vtkMRMLLabelMapVolumeNode.h>
-#include <vtkMRMLModelNode.h>
 
 // Qt includes
+#include <QItemSelection>
 #include <QStringList>
 #include <QDebug>
 
@@ -55,32 +50,19 @@ public:
   /// Sets table message and takes care of the visibility of the label
   void setMessage(const QString& message);
 
-  /// Return the column index for a given string, -1 if not a valid header
-  int columnIndex(QString label);
-
-  /// Find name item of row corresponding to a segment ID
-  QTableWidgetItem* findItemBySegmentID(QString segmentID);
-
 public:
-  /// Segmentation MRML node containing shown segments
-  vtkMRMLSegmentationNode* SegmentationNode;
-
-  /// Model or labelmap volume MRML node containing a representation (for import/export)
-  vtkMRMLDisplayableNode* RepresentationNode;
+  /// Model listing the segments of the segmentation node shown in the table
+  qMRMLSegmentsModel* Model;
 
   /// Mode of segment table. See modes \sa SegmentTableMode
   qMRMLSegmentsTableView::SegmentTableMode Mode;
-
-private:
-  QStringList ColumnLabels;
 };
 
 //-----------------------------------------------------------------------------
 qMRMLSegmentsTableViewPrivate::qMRMLSegmentsTableViewPrivate(qMRMLSegmentsTableView& object)
   : q_ptr(&object)
 {
-  this->SegmentationNode = NULL;
-  this->RepresentationNode = NULL;
+  this->Model = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -91,40 +73,33 @@ void qMRMLSegmentsTableViewPrivate::init()
 
   this->setMessage(QString());
 
-  // Set table header properties
-  this->ColumnLabels << "Visible" << "Color" << "Opacity" << "Name";
-  this->SegmentsTable->setHorizontalHeaderLabels(
-    QStringList() << "" << "Color" << "Opacity" << "Name" );
-  this->SegmentsTable->setColumnCount(this->ColumnLabels.size());
-
-  this->SegmentsTable->horizontalHeaderItem(
-    this->columnIndex("Visible"))->setIcon(QIcon(":/Icons/Small/SlicerVisibleInvisible.png") );
+  // Set model. Header labels are provided by the model
+  this->Model = new qMRMLSegmentsModel(q);
+  this->SegmentsTable->setModel(this->Model);
 
   this->SegmentsTable->horizontalHeader()->setResizeMode(QHeaderView::ResizeToContents);
   this->SegmentsTable->horizontalHeader()->setStretchLastSection(1);
 
+  // Row height is smaller than default (which is 30)
+  this->SegmentsTable->verticalHeader()->setDefaultSectionSize(20);
+
   // Select rows
   this->SegmentsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
 
   // Make connections
-  QObject::connect(this->SegmentsTable, SIGNAL(itemChanged(QTableWidgetItem*)),
-                   q, SLOT(onSegmentTableItemChanged(QTableWidgetItem*)));
-  QObject::connect(this->SegmentsTable, SIGNAL(itemClicked(QTableWidgetItem*)),
-                   q, SLOT(onSegmentTableItemClicked(QTableWidgetItem*)));
+  QObject::connect(this->SegmentsTable, SIGNAL(clicked(QModelIndex)),
+                   q, SLOT(onSegmentTableClicked(QModelIndex)));
   QObject::connect(this->SegmentsTable->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
                    q, SIGNAL(selectionChanged(QItemSelection,QItemSelection)));
+  QObject::connect(this->Model, SIGNAL(modelReset()), q, SLOT(updateMessage()));
+  QObject::connect(this->Model, SIGNAL(rowsInserted(QModelIndex,int,int)), q, SLOT(updateMessage()));
+  QObject::connect(this->Model, SIGNAL(rowsRemoved(QModelIndex,int,int)), q, SLOT(updateMessage()));
 
   // Set item delegate to handle color and opacity changes
   qMRMLItemDelegate* itemDelegate = new qMRMLItemDelegate(this->SegmentsTable);
-  this->SegmentsTable->setItemDelegateForColumn(this->columnIndex("Color"), itemDelegate);
-  //this->SegmentsTable->setItemDelegateForColumn(this->columnIndex("Opacity"), itemDelegate);
-  this->SegmentsTable->setItemDelegateForColumn(this->columnIndex("Opacity"), new qMRMLDoubleSpinBoxDelegate(this->SegmentsTable));
-}
-
-//-----------------------------------------------------------------------------
-int qMRMLSegmentsTableViewPrivate::columnIndex(QString label)
-{
-  return this->ColumnLabels.indexOf(label);
+  this->SegmentsTable->setItemDelegateForColumn(qMRMLSegmentsModel::ColorColumn, itemDelegate);
+  //this->SegmentsTable->setItemDelegateForColumn(qMRMLSegmentsModel::OpacityColumn, itemDelegate);
+  this->SegmentsTable->setItemDelegateForColumn(qMRMLSegmentsModel::OpacityColumn, new qMRMLDoubleSpinBoxDelegate(this->SegmentsTable));
 }
 
 //-----------------------------------------------------------------------------
@@ -134,25 +109,6 @@ void qMRMLSegmentsTableViewPrivate::setMessage(const QString& message)
   this->SegmentsTableMessageLabel->setText(message);
 }
 
-//-----------------------------------------------------------------------------
-QTableWidgetItem* qMRMLSegmentsTableViewPrivate::findItemBySegmentID(QString segmentID)
-{
-  Q_Q(qMRMLSegmentsTableView);
-  for (int row=0; row<this->SegmentsTable->rowCount(); ++row)
-  {
-    QTableWidgetItem* item = this->SegmentsTable->item(row, this->columnIndex("Name"));
-    if (!item->data(q->IDRole).toString().compare(segmentID))
-    {
-      return item;
-    }
-  }
-
-  return NULL;
-}
-
-
-//-----------------------------------------------------------------------------
-
 
 //-----------------------------------------------------------------------------
 // qMRMLSegmentsTableView methods
@@ -165,7 +121,7 @@ qMRMLSegmentsTableView::qMRMLSegmentsTableView(QWidget* _parent)
   Q_D(qMRMLSegmentsTableView);
   d->init();
   this->setMode(VisibilityOptionsMode);
-  this->populateSegmentTable();
+  this->updateMessage();
 }
 
 //-----------------------------------------------------------------------------
@@ -186,20 +142,8 @@ void qMRMLSegmentsTableView::setSegmentationNode(vtkMRMLNode* node)
     this->setRepresentationNode(NULL);
   }
 
-  // Connect display modified event to population of the table
-  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkMRMLDisplayableNode::DisplayModifiedEvent,
-                 this, SLOT( populateSegmentTable() ) );
-
-  // Connect segment added/removed and display modified events to population of the table
-  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentAdded,
-                 this, SLOT( populateSegmentTable() ) );
-  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentRemoved,
-                 this, SLOT( populateSegmentTable() ) );
-  qvtkReconnect( d->SegmentationNode, segmentationNode, vtkSegmentation::SegmentModified,
-                 this, SLOT( populateSegmentTable() ) );
-
-  d->SegmentationNode = segmentationNode;
-  this->populateSegmentTable();
+  // The model observes the segment and display events and updates the affected rows
+  d->Model->setSegmentationNode(segmentationNode);
 }
 
 //-----------------------------------------------------------------------------
@@ -207,17 +151,20 @@ void qMRMLSegmentsTableView::setRepresentationNode(vtkMRMLNode* node)
 {
   Q_D(qMRMLSegmentsTableView);
 
-  vtkMRMLLabelMapVolumeNode* labelmapNode = vtkMRMLLabelMapVolumeNode::SafeDownCast(node);
-  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node);
-
   // Clear segmentation node if representation node is valid
-  if (labelmapNode || modelNode)
+  d->Model->setRepresentationNode(node);
+  if (d->Model->representationNode())
   {
     this->setSegmentationNode(NULL);
-  }
 
-  d->RepresentationNode = (labelmapNode ? (vtkMRMLDisplayableNode*)labelmapNode : (vtkMRMLDisplayableNode*)modelNode);
-  this->populateSegmentTable();
+    // Force representation mode
+    if (d->Mode != RepresentationMode)
+    {
+      qWarning() << "qMRMLSegmentsTableView::setRepresentationNode: Representation node is selected, but mode is not representation mode! Setting to representation mode.";
+      this->setMode(RepresentationMode);
+    }
+    d->SegmentsTable->setRowHeight(0, 52);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -225,7 +172,7 @@ vtkMRMLNode* qMRMLSegmentsTableView::segmentationNode()
 {
   Q_D(qMRMLSegmentsTableView);
 
-  return d->SegmentationNode;
+  return d->Model->segmentationNode();
 }
 
 //-----------------------------------------------------------------------------
@@ -233,7 +180,7 @@ vtkMRMLNode* qMRMLSegmentsTableView::representationNode()
 {
   Q_D(qMRMLSegmentsTableView);
 
-  return d->RepresentationNode;
+  return d->Model->representationNode();
 }
 
 //-----------------------------------------------------------------------------
@@ -253,27 +200,27 @@ void qMRMLSegmentsTableView::setMode(SegmentTableMode mode)
     {
     d->SegmentsTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Visible"), false);
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Color"), false);
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Opacity"), false);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::VisibleColumn, false);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::ColorColumn, false);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::OpacityColumn, false);
     }
   else if (mode == SimpleListMode)
     {
     d->SegmentsTable->horizontalHeader()->setVisible(false);
     d->SegmentsTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Visible"), true);
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Color"), true);
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Opacity"), true);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::VisibleColumn, true);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::ColorColumn, true);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::OpacityColumn, true);
     }
   else if (mode == RepresentationMode)
     {
     d->SegmentsTable->horizontalHeader()->setVisible(false);
     d->SegmentsTable->setSelectionMode(QAbstractItemView::NoSelection);
 
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Visible"), true);
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Color"), true);
-    d->SegmentsTable->setColumnHidden(d->columnIndex("Opacity"), true);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::VisibleColumn, true);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::ColorColumn, true);
+    d->SegmentsTable->setColumnHidden(qMRMLSegmentsModel::OpacityColumn, true);
     }
   else
     {
@@ -290,239 +237,44 @@ void qMRMLSegmentsTableView::setMode(int mode)
 }
 
 //-----------------------------------------------------------------------------
-void qMRMLSegmentsTableView::populateSegmentTable()
+void qMRMLSegmentsTableView::updateMessage()
 {
   Q_D(qMRMLSegmentsTableView);
 
-  d->setMessage(QString());
-
-  // Block signals so that onSegmentTableItemChanged function is not called when populating
-  d->SegmentsTable->blockSignals(true);
-
-  d->SegmentsTable->clearContents();
-
-  // Show node name and type if representation node
-  if (d->RepresentationNode)
-  {
-    // Force simple list mode
-    if (d->Mode != RepresentationMode)
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(d->Model->segmentationNode());
+  if (d->Model->representationNode())
     {
-      qWarning() << "qMRMLSegmentsTableView::populateSegmentTable: Representation node is selected, but mode is not representation mode! Setting to representation mode.";
-      this->setMode(RepresentationMode);
+    d->setMessage(QString());
     }
-
-    d->SegmentsTable->setRowCount(1);
-    d->SegmentsTable->setRowHeight(0, 52);
-
-    QString name = QString("%1\n(%2 node)").arg(d->RepresentationNode->GetName()).arg(d->RepresentationNode->GetNodeTagName());
-    QTableWidgetItem* representationItem = new QTableWidgetItem(name);
-    representationItem->setToolTip(name);
-    representationItem->setFlags(representationItem->flags() & ~Qt::ItemIsEditable);
-    QFont boldFont;
-    boldFont.setWeight(QFont::Bold);
-    representationItem->setFont(boldFont);
-    d->SegmentsTable->setItem(0, d->columnIndex("Name"), representationItem);
-
-    d->SegmentsTable->blockSignals(false);
-    return;
-  }
-
-  // If not representation, then segmentation must be selected. Check validity
-  if (!d->SegmentationNode)
+  else if (!segmentationNode)
     {
     d->setMessage(tr("No node is selected"));
-    d->SegmentsTable->setRowCount(0);
-    d->SegmentsTable->blockSignals(false);
-    return;
     }
-  else if (d->SegmentationNode->GetSegmentation()->GetNumberOfSegments() == 0)
+  else if (d->Model->rowCount() == 0)
     {
     d->setMessage(tr("Empty segmentation"));
-    d->SegmentsTable->setRowCount(0);
-    d->SegmentsTable->blockSignals(false);
-    return;
     }
-
-  // Get segmentation display node
-  vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(
-    d->SegmentationNode->GetDisplayNode() );
-  if (!displayNode)
-  {
-    qCritical() << "qMRMLSegmentsTableView::populateSegmentTable: No display node for segmentation!";
-    return;
-  }
-
-  vtkSegmentation::SegmentMap segmentMap = d->SegmentationNode->GetSegmentation()->GetSegments();
-  d->SegmentsTable->setRowCount(segmentMap.size());
-  int row = 0;
-  for (vtkSegmentation::SegmentMap::iterator segmentIt = segmentMap.begin(); segmentIt != segmentMap.end(); ++segmentIt, ++row)
-  {
-    QString segmentId(segmentIt->first.c_str());
-
-    // Row height is smaller than default (which is 30)
-    d->SegmentsTable->setRowHeight(row, 20);
-
-    // Segment name
-    QString name(segmentIt->second->GetName());
-    QTableWidgetItem* nameItem = new QTableWidgetItem(name);
-    nameItem->setData(IDRole, segmentId);
-    d->SegmentsTable->setItem(row, d->columnIndex("Name"), nameItem);
-
-    // Get segment display properties
-    vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
-    if (!displayNode->GetSegmentDisplayProperties(segmentIt->first, properties))
-      {
-      continue;
-      }
-
-    // Visibility
-    QTableWidgetItem* visibilityItem = new QTableWidgetItem();
-    visibilityItem->setData(VisibilityRole, QVariant(properties.Visible));
-    visibilityItem->setData(IDRole, segmentId);
-    visibilityItem->setData(Qt::CheckStateRole, QVariant());
-    visibilityItem->setFlags(visibilityItem->flags() & ~Qt::ItemIsUserCheckable);
-    // Disable editing so that a double click won't bring up an entry box
-    visibilityItem->setFlags(visibilityItem->flags() & ~Qt::ItemIsEditable);
-    if (properties.Visible)
-      {
-      visibilityItem->setData(Qt::DecorationRole, QPixmap(":/Icons/Small/SlicerVisible.png"));
-      }
-    else
-      {
-      visibilityItem->setData(Qt::DecorationRole, QPixmap(":/Icons/Small/SlicerInvisible.png"));
-      }
-    d->SegmentsTable->setItem(row, d->columnIndex("Visible"), visibilityItem);
-
-    // Color
-    QTableWidgetItem* colorItem = new QTableWidgetItem();
-    QColor color = QColor::fromRgbF(properties.Color[0], properties.Color[1], properties.Color[2]);
-    colorItem->setData(Qt::DecorationRole, color);
-    colorItem->setData(IDRole, segmentId);
-    colorItem->setToolTip("Color");
-    d->SegmentsTable->setItem(row, d->columnIndex("Color"), colorItem);
-
-    // Opacity
-    QTableWidgetItem* opacityItem = new QTableWidgetItem();
-    QString displayedOpacity = QString::number(properties.PolyDataOpacity, 'f', 2);
-    //opacityItem->setData(Qt::EditRole, displayedOpacity); // for qMRMLItemDelegate
-    opacityItem->setData(Qt::EditRole, properties.PolyDataOpacity); // for qMRMLDoubleSpinBoxDelegate
-    opacityItem->setData(IDRole, segmentId);
-    opacityItem->setToolTip("Opacity");
-    d->SegmentsTable->setItem(row, d->columnIndex("Opacity"), opacityItem);
-  }
-
-  // Unblock signals
-  d->SegmentsTable->blockSignals(false);
-}
-
-//-----------------------------------------------------------------------------
-void qMRMLSegmentsTableView::onSegmentTableItemChanged(QTableWidgetItem* changedItem)
-{
-  Q_D(qMRMLSegmentsTableView);
-
-  d->setMessage(QString());
-
-  if (!changedItem || !d->SegmentationNode)
-    {
-    return;
-    }
-
-  // All items contain the segment ID, get that
-  QString segmentId = changedItem->data(IDRole).toString();
-
-  // If segment name has been changed
-  if (changedItem->column() == d->columnIndex("Name"))
-    {
-    QString nameText(changedItem->text());
-    vtkSegment* segment = d->SegmentationNode->GetSegmentation()->GetSegment(segmentId.toLatin1().constData());
-    if (!segment)
-      {
-      qCritical() << "qMRMLSegmentsTableView::onSegmentTableItemChanged: Segment with ID '" << segmentId << "' not found in segmentation node " << d->SegmentationNode->GetName();
-      return;
-      }
-    segment->SetName(nameText.toLatin1().constData());
-    }
-  // If visualization has been changed
   else
     {
-    // For all other columns we need the display node
-    vtkMRMLSegmentationDisplayNode* displayNode = vtkMRMLSegmentationDisplayNode::SafeDownCast(
-      d->SegmentationNode->GetDisplayNode() );
-    if (!displayNode)
-      {
-      qCritical() << "qMRMLSegmentsTableView::onSegmentTableItemChanged: No display node for segmentation!";
-      return;
-      }
-    // Get display properties
-    vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
-    if (!displayNode->GetSegmentDisplayProperties(segmentId.toLatin1().constData(), properties))
-      {
-      return;
-      }
-
-    bool valueChanged = false;
-
-    // Visibility changed
-    if (changedItem->column() == d->columnIndex("Visible"))
-      {
-      int visible = changedItem->data(VisibilityRole).toInt();
-      properties.Visible = (bool)visible;
-      valueChanged = true;
-      }
-    // Color changed
-    else if (changedItem->column() == d->columnIndex("Color"))
-      {
-      QColor color = changedItem->data(Qt::DecorationRole).value<QColor>();
-      QColor oldColor = QColor::fromRgbF(properties.Color[0], properties.Color[1], properties.Color[2]);
-      if (oldColor != color)
-        {
-        properties.Color[0] = color.redF();
-        properties.Color[1] = color.greenF();
-        properties.Color[2] = color.blueF();
-        valueChanged = true;
-        }
-      }
-    // Opacity changed
-    else if (changedItem->column() == d->columnIndex("Opacity"))
-      {
-      QString opacity = changedItem->data(Qt::EditRole).toString();
-      QString currentOpacity = QString::number( properties.PolyDataOpacity, 'f', 2);
-      if (opacity != currentOpacity)
-        {
-        properties.PolyDataOpacity = opacity.toDouble();
-        valueChanged = true;
-        }
-      }
-    // Set changed properties to segmentation display node if a value has actually changed
-    if (valueChanged)
-      {
-      displayNode->SetSegmentDisplayProperties(segmentId.toLatin1().constData(), properties);
-      }
+    d->setMessage(QString());
     }
 }
 
 //-----------------------------------------------------------------------------
-void qMRMLSegmentsTableView::onSegmentTableItemClicked(QTableWidgetItem* item)
+void qMRMLSegmentsTableView::onSegmentTableClicked(const QModelIndex& index)
 {
   Q_D(qMRMLSegmentsTableView);
 
-  if (!item)
+  if (!index.isValid())
     {
     return;
     }
 
-  int column = item->column();
-  if (column == d->columnIndex(QString("Visible")))
+  if (index.column() == qMRMLSegmentsModel::VisibleColumn)
     {
-    // Toggle the visibility role, the icon update is triggered by this change
-    if (item->data(VisibilityRole) == QVariant(false))
-      {
-      item->setData(VisibilityRole, QVariant(true));
-      }
-    else
-      {
-      item->setData(VisibilityRole, QVariant(false));
-      }
+    // Toggle the visibility role, the icon update is triggered by the display node change
+    bool visible = d->Model->data(index, qMRMLSegmentsModel::VisibilityRole).toBool();
+    d->Model->setData(index, QVariant(!visible), qMRMLSegmentsModel::VisibilityRole);
     }
 }
 
@@ -531,7 +283,7 @@ int qMRMLSegmentsTableView::segmentCount() const
 {
   Q_D(const qMRMLSegmentsTableView);
 
-  return d->SegmentsTable->rowCount();
+  return d->Model->rowCount();
 }
 
 //-----------------------------------------------------------------------------
@@ -539,16 +291,16 @@ QStringList qMRMLSegmentsTableView::selectedSegmentIDs()
 {
   Q_D(qMRMLSegmentsTableView);
 
-  QList<QTableWidgetItem*> selectedItems = d->SegmentsTable->selectedItems();
+  QModelIndexList selectedIndexes = d->SegmentsTable->selectionModel()->selectedIndexes();
   QStringList selectedSegmentIds;
   QSet<int> rows;
-  foreach (QTableWidgetItem* item, selectedItems)
+  foreach (QModelIndex index, selectedIndexes)
   {
-    int row = item->row();
+    int row = index.row();
     if (!rows.contains(row))
     {
       rows.insert(row);
-      selectedSegmentIds << item->data(IDRole).toString();
+      selectedSegmentIds << d->Model->segmentIDFromRow(row);
     }
   }
 
@@ -560,24 +312,20 @@ void qMRMLSegmentsTableView::setSelectedSegmentIDs(QStringList segmentIDs)
 {
   Q_D(qMRMLSegmentsTableView);
 
-  // Deselect selected items first
-  QList<QTableWidgetItem*> selectedItems = d->SegmentsTable->selectedItems();
-  foreach (QTableWidgetItem* item, selectedItems)
-  {
-    d->SegmentsTable->setItemSelected(item, false);
-  }
-
-  // Find item by segment ID
+  // Collect rows of the segments, and replace the selection in one step
+  QItemSelection selection;
   foreach (QString segmentID, segmentIDs)
   {
-    QTableWidgetItem* segmentItem = d->findItemBySegmentID(segmentID);
-    if (!segmentItem)
+    int row = d->Model->rowFromSegmentID(segmentID);
+    if (row < 0)
     {
-      qCritical() << "qMRMLSegmentsTableView::setSelectedSegmentIDs: Cannot find table item correspondig to segment ID '" << segmentID << " in segmentation node " << d->SegmentationNode->GetName();
+      vtkMRMLNode* segmentationNode = d->Model->segmentationNode();
+      qCritical() << "qMRMLSegmentsTableView::setSelectedSegmentIDs: Cannot find table item correspondig to segment ID '" << segmentID << " in segmentation node " << (segmentationNode ? segmentationNode->GetName() : "(none)");
       continue;
     }
 
-    // Select item for segment
-    d->SegmentsTable->setItemSelected(segmentItem, true);
+    // Select row of segment
+    selection.select(d->Model->index(row, 0), d->Model->index(row, qMRMLSegmentsModel::NumberOfColumns-1));
   }
+  d->SegmentsTable->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
 }
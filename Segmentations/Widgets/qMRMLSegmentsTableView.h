@@ -35,7 +35,7 @@
 
 class vtkMRMLNode;
 class qMRMLSegmentsTableViewPrivate;
-class QTableWidgetItem;
+class QModelIndex;
 class QItemSelection;
 
 /// \ingroup SlicerRt_QtModules_Segmentations_Widgets
@@ -44,15 +44,6 @@ class Q_SLICER_MODULE_SEGMENTATIONS_WIDGETS_EXPORT qMRMLSegmentsTableView : publ
   Q_OBJECT
   QVTK_OBJECT
 
-  enum SegmentTableItemDataRole
-    {
-    /// Unique ID of the item. For nodes, it is the node ID.
-    IDRole = Qt::UserRole + 1,
-    /// Integer that contains the visibility property of a node.
-    /// It is closely related to the item icon.
-    VisibilityRole,
-    };
-
 public:
   enum SegmentTableMode
     {
@@ -107,14 +98,12 @@ signals:
   void selectionChanged(const QItemSelection &selected, const QItemSelection &deselected);
 
 protected slots:
-  /// Handles changing of values in a cell (segment name, visibility, color, opacity)
-  void onSegmentTableItemChanged(QTableWidgetItem* changedItem);
-
   /// Handles clicks on a table cell (visibility)
-  void onSegmentTableItemClicked(QTableWidgetItem* item);
+  void onSegmentTableClicked(const QModelIndex& index);
 
-  /// Populate segment table according to the segmentation node
-  void populateSegmentTable();
+  /// Update message label according to the nodes and number of segments.
+  /// Rows are updated by the segments model (\sa qMRMLSegmentsModel)
+  void updateMessage();
 
 protected:
   QScopedPointer<qMRMLSegmentsTableViewPrivate> d_ptr;
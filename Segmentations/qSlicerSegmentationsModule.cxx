@@ -186,6 +186,8 @@ void qSlicerSegmentationsModule::onNodeAdded(vtkObject* sceneObject, vtkObject*
       segmentationsPlugin, SLOT( onSegmentRemoved(vtkObject*,void*) ) );
     qvtkConnect( segmentationNode, vtkSegmentation::SegmentModified,
       segmentationsPlugin, SLOT( onSegmentModified(vtkObject*,void*) ) );
+    qvtkConnect( segmentationNode, vtkSegmentation::SegmentsBatchModified,
+      segmentationsPlugin, SLOT( onSegmentsBatchModified(vtkObject*,void*) ) );
 
     // Workaround for auto-select new segmentation node issue
     // (although the flag is on in the MRML node combobox, it does not select newly added nodes)